@@ -0,0 +1,620 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// Microbenchmarks for the backend utilities. The Triton C API is
+// provided by the mock in mock_triton.cc so the benchmarks run without
+// a server. Each benchmark prints one line per configuration with the
+// throughput and the per-call latency percentiles. The data moved by
+// the last call of each configuration is compared to the expected
+// contents and a mismatch fails the run.
+//
+//   backend_utils_bench [--iterations=N] [--quick] [--filter=NAME]
+//
+// NAME selects one of 'collector', 'responder', 'copy' or 'memory'.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mock_triton.h"
+#include "triton/backend/backend_common.h"
+#include "triton/backend/backend_input_collector.h"
+#include "triton/backend/backend_memory.h"
+#include "triton/backend/backend_output_responder.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend { namespace bench {
+
+namespace {
+
+struct Options {
+  size_t iterations_ = 50;
+  bool quick_ = false;
+  std::string filter_;
+};
+
+// Memory types that can be allocated in this build and on this
+// machine.
+std::vector<TRITONSERVER_MemoryType>
+AvailableMemoryTypes()
+{
+  std::vector<TRITONSERVER_MemoryType> types{TRITONSERVER_MEMORY_CPU};
+#ifdef TRITON_ENABLE_GPU
+  int device_count = 0;
+  if ((cudaGetDeviceCount(&device_count) == cudaSuccess) &&
+      (device_count > 0)) {
+    types.push_back(TRITONSERVER_MEMORY_CPU_PINNED);
+    types.push_back(TRITONSERVER_MEMORY_GPU);
+  }
+#endif  // TRITON_ENABLE_GPU
+  return types;
+}
+
+// The expected contents of byte 'offset' of the data identified by
+// 'seed', for example the input of one request.
+char
+PatternByte(const size_t seed, const size_t offset)
+{
+  return static_cast<char>((seed * 131 + offset * 7 + 1) & 0xff);
+}
+
+// Copy 'byte_size' bytes from host memory to memory of 'memory_type',
+// or from memory of 'memory_type' to host memory.
+void
+WriteBuffer(
+    void* dst, const TRITONSERVER_MemoryType memory_type, const char* src,
+    const size_t byte_size)
+{
+#ifdef TRITON_ENABLE_GPU
+  if (memory_type == TRITONSERVER_MEMORY_GPU) {
+    cudaMemcpy(dst, src, byte_size, cudaMemcpyHostToDevice);
+    return;
+  }
+#endif  // TRITON_ENABLE_GPU
+  memcpy(dst, src, byte_size);
+}
+
+void
+ReadBuffer(
+    char* dst, const void* src, const TRITONSERVER_MemoryType memory_type,
+    const size_t byte_size)
+{
+#ifdef TRITON_ENABLE_GPU
+  if (memory_type == TRITONSERVER_MEMORY_GPU) {
+    cudaMemcpy(dst, src, byte_size, cudaMemcpyDeviceToHost);
+    return;
+  }
+#endif  // TRITON_ENABLE_GPU
+  memcpy(dst, src, byte_size);
+}
+
+// Fill 'byte_size' bytes of 'buffer' with the pattern of 'seed',
+// starting at byte 'offset' of the pattern.
+void
+FillPattern(
+    void* buffer, const TRITONSERVER_MemoryType memory_type, const size_t seed,
+    const size_t offset, const size_t byte_size)
+{
+  std::vector<char> contents(byte_size);
+  for (size_t i = 0; i < byte_size; ++i) {
+    contents[i] = PatternByte(seed, offset + i);
+  }
+  WriteBuffer(buffer, memory_type, contents.data(), byte_size);
+}
+
+void
+FillZero(
+    void* buffer, const TRITONSERVER_MemoryType memory_type,
+    const size_t byte_size)
+{
+  const std::vector<char> contents(byte_size, 0);
+  WriteBuffer(buffer, memory_type, contents.data(), byte_size);
+}
+
+// Return true if 'byte_size' bytes of 'buffer' hold the pattern of
+// 'seed', otherwise report the first mismatch of benchmark 'label'.
+bool
+CheckPattern(
+    const std::string& label, const void* buffer,
+    const TRITONSERVER_MemoryType memory_type, const size_t seed,
+    const size_t byte_size)
+{
+  std::vector<char> contents(byte_size);
+  if (byte_size > 0) {
+    if (buffer == nullptr) {
+      fprintf(stderr, "FAILED %s: no output\n", label.c_str());
+      return false;
+    }
+    ReadBuffer(contents.data(), buffer, memory_type, byte_size);
+  }
+  for (size_t i = 0; i < byte_size; ++i) {
+    if (contents[i] != PatternByte(seed, i)) {
+      fprintf(
+          stderr, "FAILED %s: mismatch at byte %zu of data %zu\n",
+          label.c_str(), i, seed);
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+Synchronize(cudaStream_t stream)
+{
+#ifdef TRITON_ENABLE_GPU
+  if (stream != nullptr) {
+    cudaStreamSynchronize(stream);
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+// Run 'fn' 'iterations' times, after a couple of warm-up runs, and
+// print the throughput computed from 'byte_size' and 'request_count'
+// per call and the latency percentiles of the calls. 'setup' is called
+// before each call and is not timed.
+void
+Measure(
+    const std::string& label, const Options& options, const size_t byte_size,
+    const size_t request_count, const std::function<void()>& setup,
+    const std::function<void()>& fn)
+{
+  constexpr size_t kWarmupIterations = 2;
+  std::vector<double> latencies_us;
+  latencies_us.reserve(options.iterations_);
+  for (size_t i = 0; i < (kWarmupIterations + options.iterations_); ++i) {
+    setup();
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto end = std::chrono::steady_clock::now();
+    if (i >= kWarmupIterations) {
+      latencies_us.push_back(
+          std::chrono::duration<double, std::micro>(end - start).count());
+    }
+  }
+
+  std::sort(latencies_us.begin(), latencies_us.end());
+  double total_us = 0;
+  for (const double us : latencies_us) {
+    total_us += us;
+  }
+  const double mean_us = total_us / latencies_us.size();
+  auto percentile = [&latencies_us](const double p) {
+    const size_t idx = std::min(
+        latencies_us.size() - 1, size_t(p * (latencies_us.size() - 1) + 0.5));
+    return latencies_us[idx];
+  };
+
+  // Throughput in bytes is only meaningful for the benchmarks that
+  // move data.
+  const std::string throughput =
+      (byte_size == 0) ? std::string(14, ' ')
+                       : (std::to_string((byte_size / 1e3) / mean_us) + " GB/s");
+  printf(
+      "%-64s %14s %12.0f req/s  p50 %9.1f us  p90 %9.1f us  p99 %9.1f us\n",
+      label.c_str(), throughput.c_str(), (request_count * 1e6) / mean_us,
+      percentile(0.50), percentile(0.90), percentile(0.99));
+}
+
+// Request inputs of 'byte_size' bytes each, split into
+// 'buffer_count' buffers of 'memory_type'. The input of request 'r'
+// holds the pattern of seed 'r'.
+class RequestSet {
+ public:
+  RequestSet(
+      const size_t request_count, const size_t byte_size,
+      const size_t buffer_count, const TRITONSERVER_MemoryType memory_type)
+      : requests_(request_count), memory_type_(memory_type)
+  {
+    for (size_t r = 0; r < requests_.size(); ++r) {
+      MockRequest& request = requests_[r];
+      request.inputs_.emplace_back();
+      MockInput& input = request.inputs_.back();
+      input.name_ = "INPUT0";
+      input.datatype_ = TRITONSERVER_TYPE_UINT8;
+      input.shape_ = {1, int64_t(byte_size)};
+      input.byte_size_ = byte_size;
+      size_t remaining = byte_size;
+      for (size_t b = 0; b < buffer_count; ++b) {
+        const size_t size =
+            (b + 1 == buffer_count) ? remaining : (byte_size / buffer_count);
+        void* base = MockAllocate(memory_type, 0, size);
+        FillPattern(base, memory_type, r, byte_size - remaining, size);
+        allocations_.push_back(base);
+        input.buffers_.push_back({base, size, memory_type, 0});
+        remaining -= size;
+      }
+      request.requested_outputs_.push_back("OUTPUT0");
+      request_handles_.push_back(AsRequest(&request));
+    }
+  }
+
+  ~RequestSet()
+  {
+    for (void* base : allocations_) {
+      MockFree(base, memory_type_, 0);
+    }
+  }
+
+  TRITONBACKEND_Request** Requests() { return request_handles_.data(); }
+  uint32_t Count() const { return requests_.size(); }
+
+ private:
+  std::vector<MockRequest> requests_;
+  std::vector<TRITONBACKEND_Request*> request_handles_;
+  TRITONSERVER_MemoryType memory_type_;
+  std::vector<void*> allocations_;
+};
+
+// Fresh responses, one per request.
+class ResponseSet {
+ public:
+  void Reset(const size_t count)
+  {
+    responses_.clear();
+    handles_.clear();
+    for (size_t i = 0; i < count; ++i) {
+      responses_.emplace_back(new MockResponse());
+      handles_.push_back(AsResponse(responses_.back().get()));
+    }
+  }
+
+  std::vector<TRITONBACKEND_Response*>* Handles() { return &handles_; }
+  const MockResponse& Response(const size_t idx) const
+  {
+    return *responses_[idx];
+  }
+
+ private:
+  std::vector<std::unique_ptr<MockResponse>> responses_;
+  std::vector<TRITONBACKEND_Response*> handles_;
+};
+
+std::string
+Label(
+    const char* name, const size_t batch_size, const size_t byte_size,
+    const size_t buffer_count, const TRITONSERVER_MemoryType src,
+    const TRITONSERVER_MemoryType dst, const bool pinned)
+{
+  return std::string(name) + " batch=" + std::to_string(batch_size) +
+         " size=" + std::to_string(byte_size) +
+         " buffers=" + std::to_string(buffer_count) + " " +
+         TRITONSERVER_MemoryTypeString(src) + "->" +
+         TRITONSERVER_MemoryTypeString(dst) + (pinned ? " pinned" : "");
+}
+
+// Each benchmark returns the number of configurations whose output
+// doesn't have the expected contents.
+size_t
+BenchCollector(const Options& options, cudaStream_t stream)
+{
+  const std::vector<size_t> batch_sizes =
+      options.quick_ ? std::vector<size_t>{8, 64}
+                     : std::vector<size_t>{1, 8, 64, 256};
+  const std::vector<size_t> byte_sizes =
+      options.quick_ ? std::vector<size_t>{4096}
+                     : std::vector<size_t>{4096, 256 * 1024, 4 * 1024 * 1024};
+  const std::vector<size_t> buffer_counts{1, 4};
+  const auto memory_types = AvailableMemoryTypes();
+
+  size_t failures = 0;
+  for (const size_t batch_size : batch_sizes) {
+    for (const size_t byte_size : byte_sizes) {
+      for (const size_t buffer_count : buffer_counts) {
+        for (const auto src : memory_types) {
+          RequestSet requests(batch_size, byte_size, buffer_count, src);
+          for (const auto dst : memory_types) {
+            const size_t total_byte_size = batch_size * byte_size;
+            void* dst_buffer = MockAllocate(dst, 0, total_byte_size);
+            for (const bool pinned : {false, true}) {
+              if (pinned && (memory_types.size() == 1)) {
+                continue;
+              }
+              const std::string label = Label(
+                  "collector", batch_size, byte_size, buffer_count, src, dst,
+                  pinned);
+              FillZero(dst_buffer, dst, total_byte_size);
+              ResponseSet responses;
+              Measure(
+                  label, options, total_byte_size, batch_size,
+                  [&] { responses.Reset(batch_size); },
+                  [&] {
+                    BackendInputCollector collector(
+                        requests.Requests(), requests.Count(),
+                        responses.Handles(), MockMemoryManager(), pinned,
+                        stream);
+                    collector.ProcessTensor(
+                        "INPUT0", reinterpret_cast<char*>(dst_buffer),
+                        total_byte_size, dst, 0 /* memory_type_id */);
+                    if (collector.Finalize()) {
+                      Synchronize(stream);
+                    }
+                  });
+              for (size_t r = 0; r < batch_size; ++r) {
+                if (!CheckPattern(
+                        label,
+                        reinterpret_cast<char*>(dst_buffer) + r * byte_size,
+                        dst, r, byte_size)) {
+                  ++failures;
+                  break;
+                }
+              }
+            }
+            MockFree(dst_buffer, dst, 0);
+          }
+        }
+      }
+    }
+  }
+  return failures;
+}
+
+size_t
+BenchResponder(const Options& options, cudaStream_t stream)
+{
+  const std::vector<size_t> batch_sizes =
+      options.quick_ ? std::vector<size_t>{8, 64}
+                     : std::vector<size_t>{1, 8, 64, 256};
+  const std::vector<size_t> byte_sizes =
+      options.quick_ ? std::vector<size_t>{4096}
+                     : std::vector<size_t>{4096, 256 * 1024, 4 * 1024 * 1024};
+  const auto memory_types = AvailableMemoryTypes();
+
+  size_t failures = 0;
+  for (const size_t batch_size : batch_sizes) {
+    for (const size_t byte_size : byte_sizes) {
+      RequestSet requests(
+          batch_size, 1 /* byte_size */, 1 /* buffer_count */,
+          TRITONSERVER_MEMORY_CPU);
+      // The responder asks for response buffers in the memory type of
+      // the tensor, so only the source memory type is swept.
+      for (const auto src : memory_types) {
+        const size_t total_byte_size = batch_size * byte_size;
+        void* src_buffer = MockAllocate(src, 0, total_byte_size);
+        for (size_t r = 0; r < batch_size; ++r) {
+          FillPattern(
+              reinterpret_cast<char*>(src_buffer) + r * byte_size, src, r,
+              0 /* offset */, byte_size);
+        }
+        for (const bool pinned : {false, true}) {
+          if (pinned && (memory_types.size() == 1)) {
+            continue;
+          }
+          const std::string label =
+              Label("responder", batch_size, byte_size, 1, src, src, pinned);
+          ResponseSet responses;
+          Measure(
+              label, options, total_byte_size, batch_size,
+              [&] { responses.Reset(batch_size); },
+              [&] {
+                std::vector<int64_t> shape{1, int64_t(byte_size)};
+                BackendOutputResponder responder(
+                    requests.Requests(), requests.Count(), responses.Handles(),
+                    1 /* max_batch_size */, MockMemoryManager(), pinned,
+                    stream);
+                responder.ProcessTensor(
+                    "OUTPUT0", TRITONSERVER_TYPE_UINT8, shape,
+                    reinterpret_cast<const char*>(src_buffer), src,
+                    0 /* memory_type_id */);
+                if (responder.Finalize()) {
+                  Synchronize(stream);
+                }
+              });
+          for (size_t r = 0; r < batch_size; ++r) {
+            const MockResponse& response = responses.Response(r);
+            const void* output = nullptr;
+            TRITONSERVER_MemoryType output_memory_type = src;
+            if (!response.outputs_.empty()) {
+              output = response.outputs_.front().buffer_;
+              output_memory_type = response.outputs_.front().memory_type_;
+            }
+            if (!CheckPattern(label, output, output_memory_type, r, byte_size)) {
+              ++failures;
+              break;
+            }
+          }
+        }
+        MockFree(src_buffer, src, 0);
+      }
+    }
+  }
+  return failures;
+}
+
+size_t
+BenchCopyBuffer(const Options& options, cudaStream_t stream)
+{
+  const std::vector<size_t> byte_sizes =
+      options.quick_ ? std::vector<size_t>{4096, 1024 * 1024}
+                     : std::vector<size_t>{
+                           256, 4096, 64 * 1024, 1024 * 1024,
+                           16 * 1024 * 1024};
+  const auto memory_types = AvailableMemoryTypes();
+
+  size_t failures = 0;
+  for (const size_t byte_size : byte_sizes) {
+    for (const auto src : memory_types) {
+      void* src_buffer = MockAllocate(src, 0, byte_size);
+      FillPattern(src_buffer, src, 0 /* seed */, 0 /* offset */, byte_size);
+      for (const auto dst : memory_types) {
+        void* dst_buffer = MockAllocate(dst, 0, byte_size);
+        const std::string label =
+            Label("copy", 1, byte_size, 1, src, dst, false);
+        FillZero(dst_buffer, dst, byte_size);
+        Measure(
+            label, options, byte_size, 1, [] {},
+            [&] {
+              bool cuda_used = false;
+              TRITONSERVER_Error* err = CopyBuffer(
+                  "bench", src, 0, dst, 0, byte_size, src_buffer, dst_buffer,
+                  stream, &cuda_used);
+              if (err != nullptr) {
+                TRITONSERVER_ErrorDelete(err);
+              }
+              if (cuda_used) {
+                Synchronize(stream);
+              }
+            });
+        if (!CheckPattern(label, dst_buffer, dst, 0 /* seed */, byte_size)) {
+          ++failures;
+        }
+        MockFree(dst_buffer, dst, 0);
+      }
+      MockFree(src_buffer, src, 0);
+    }
+  }
+  return failures;
+}
+
+void
+BenchMemoryCreate(const Options& options)
+{
+  const std::vector<size_t> byte_sizes =
+      options.quick_ ? std::vector<size_t>{4096, 1024 * 1024}
+                     : std::vector<size_t>{4096, 1024 * 1024, 64 * 1024 * 1024};
+  std::vector<BackendMemory::AllocationType> alloc_types{
+      BackendMemory::AllocationType::CPU};
+  if (AvailableMemoryTypes().size() > 1) {
+    alloc_types.push_back(BackendMemory::AllocationType::CPU_PINNED);
+    alloc_types.push_back(BackendMemory::AllocationType::CPU_PINNED_POOL);
+    alloc_types.push_back(BackendMemory::AllocationType::GPU);
+    alloc_types.push_back(BackendMemory::AllocationType::GPU_POOL);
+    alloc_types.push_back(BackendMemory::AllocationType::CPU_PINNED_CACHED);
+    alloc_types.push_back(BackendMemory::AllocationType::GPU_CACHED);
+    alloc_types.push_back(BackendMemory::AllocationType::GPU_ASYNC);
+  }
+
+  for (const size_t byte_size : byte_sizes) {
+    for (const auto alloc_type : alloc_types) {
+      Measure(
+          std::string("memory create+free size=") + std::to_string(byte_size) +
+              " " + BackendMemory::AllocTypeString(alloc_type),
+          options, 0 /* byte_size */, 1, [] {},
+          [&] {
+            BackendMemory* mem = nullptr;
+            TRITONSERVER_Error* err = BackendMemory::Create(
+                MockMemoryManager(), alloc_type, 0 /* memory_type_id */,
+                byte_size, &mem);
+            if (err != nullptr) {
+              TRITONSERVER_ErrorDelete(err);
+            }
+            delete mem;
+          });
+    }
+  }
+}
+
+}  // namespace
+
+}}}  // namespace triton::backend::bench
+
+int
+main(int argc, char** argv)
+{
+  using namespace triton::backend;
+  using namespace triton::backend::bench;
+
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if (arg.rfind("--iterations=", 0) == 0) {
+      const char* value = arg.c_str() + 13;
+      char* end = nullptr;
+      errno = 0;
+      const unsigned long long iterations = strtoull(value, &end, 10);
+      if ((*value < '0') || (*value > '9') || (*end != '\0') ||
+          (errno != 0) || (iterations == 0)) {
+        fprintf(
+            stderr, "%s: --iterations must be a positive integer, got '%s'\n",
+            argv[0], value);
+        return 1;
+      }
+      options.iterations_ = iterations;
+    } else if (arg == "--quick") {
+      options.quick_ = true;
+    } else if (arg.rfind("--filter=", 0) == 0) {
+      options.filter_ = arg.substr(9);
+      if ((options.filter_ != "collector") &&
+          (options.filter_ != "responder") && (options.filter_ != "copy") &&
+          (options.filter_ != "memory")) {
+        fprintf(
+            stderr, "%s: unknown benchmark '%s'\n", argv[0],
+            options.filter_.c_str());
+        return 1;
+      }
+    } else {
+      fprintf(
+          stderr,
+          "usage: %s [--iterations=N] [--quick] "
+          "[--filter=collector|responder|copy|memory]\n",
+          argv[0]);
+      return 1;
+    }
+  }
+
+  cudaStream_t stream = nullptr;
+#ifdef TRITON_ENABLE_GPU
+  if (AvailableMemoryTypes().size() > 1) {
+    cudaStreamCreate(&stream);
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  auto selected = [&options](const char* name) {
+    return options.filter_.empty() || (options.filter_ == name);
+  };
+  size_t failures = 0;
+  if (selected("collector")) {
+    failures += BenchCollector(options, stream);
+  }
+  if (selected("responder")) {
+    failures += BenchResponder(options, stream);
+  }
+  if (selected("copy")) {
+    failures += BenchCopyBuffer(options, stream);
+  }
+  if (selected("memory")) {
+    BenchMemoryCreate(options);
+  }
+
+#ifdef TRITON_ENABLE_GPU
+  if (stream != nullptr) {
+    cudaStreamDestroy(stream);
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  if (failures > 0) {
+    fprintf(stderr, "%zu configurations had unexpected output\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,696 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Unit tests of the backend utilities, run against the mock of the
+// Triton C API in mock_triton.cc. The tests that need a GPU are
+// skipped when none is available.
+//
+//   backend_utils_test
+//
+// Prints each failed check and exits with a non-zero status if any
+// check fails.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mock_triton.h"
+#include "triton/backend/backend_common.h"
+#include "triton/backend/backend_copy_graph.h"
+#include "triton/backend/backend_input_collector.h"
+#include "triton/backend/backend_memory.h"
+#include "triton/backend/backend_output_responder.h"
+#include "triton/backend/backend_residency_cache.h"
+#include "triton/backend/backend_resource_registry.h"
+#include "triton/backend/backend_response_sender.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend { namespace bench {
+
+namespace {
+
+size_t check_failures = 0;
+
+#define CHECK(X)                                                         \
+  do {                                                                   \
+    if (!(X)) {                                                          \
+      fprintf(                                                           \
+          stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #X);  \
+      ++triton::backend::bench::check_failures;                          \
+    }                                                                    \
+  } while (false)
+
+#define CHECK_OK(X)                                                      \
+  do {                                                                   \
+    TRITONSERVER_Error* check_err__ = (X);                               \
+    if (check_err__ != nullptr) {                                        \
+      fprintf(                                                           \
+          stderr, "%s:%d: %s failed: %s\n", __FILE__, __LINE__, #X,      \
+          TRITONSERVER_ErrorMessage(check_err__));                       \
+      TRITONSERVER_ErrorDelete(check_err__);                             \
+      ++triton::backend::bench::check_failures;                          \
+    }                                                                    \
+  } while (false)
+
+bool
+GpuAvailable()
+{
+#ifdef TRITON_ENABLE_GPU
+  int device_count = 0;
+  return (cudaGetDeviceCount(&device_count) == cudaSuccess) &&
+         (device_count > 0);
+#else
+  return false;
+#endif  // TRITON_ENABLE_GPU
+}
+
+// Add to 'request' an input named 'name' whose contents are split into
+// host buffers of 'buffer_byte_sizes' bytes taken from 'contents' in
+// order.
+void
+AddInput(
+    MockRequest* request, const std::string& name,
+    const TRITONSERVER_DataType datatype, const std::vector<int64_t>& shape,
+    const void* contents, const std::vector<size_t>& buffer_byte_sizes,
+    const TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU)
+{
+  request->inputs_.emplace_back();
+  MockInput& input = request->inputs_.back();
+  input.name_ = name;
+  input.datatype_ = datatype;
+  input.shape_ = shape;
+  input.byte_size_ = 0;
+  const char* base = reinterpret_cast<const char*>(contents);
+  for (const size_t byte_size : buffer_byte_sizes) {
+    input.buffers_.push_back({base, byte_size, memory_type, 0});
+    input.byte_size_ += byte_size;
+    base += byte_size;
+  }
+}
+
+// Requests and their handles, and one fresh response per request.
+struct Batch {
+  explicit Batch(const size_t request_count)
+      : requests_(request_count), responses_(request_count)
+  {
+    for (size_t i = 0; i < request_count; ++i) {
+      request_handles_.push_back(AsRequest(&requests_[i]));
+      response_handles_.push_back(AsResponse(&responses_[i]));
+    }
+  }
+
+  std::vector<MockRequest> requests_;
+  std::vector<MockResponse> responses_;
+  std::vector<TRITONBACKEND_Request*> request_handles_;
+  std::vector<TRITONBACKEND_Response*> response_handles_;
+};
+
+void
+TestCollectorBatched()
+{
+  // The second request is split into several buffers and the third
+  // request is missing the input, which only fails its response.
+  const std::vector<uint8_t> input0{1, 2, 3, 4};
+  const std::vector<uint8_t> input1{5, 6, 7, 8, 9, 10};
+  Batch batch(3);
+  AddInput(
+      &batch.requests_[0], "INPUT0", TRITONSERVER_TYPE_UINT8, {1, 4},
+      input0.data(), {4});
+  AddInput(
+      &batch.requests_[1], "INPUT0", TRITONSERVER_TYPE_UINT8, {1, 6},
+      input1.data(), {1, 2, 3});
+  AddInput(
+      &batch.requests_[2], "OTHER", TRITONSERVER_TYPE_UINT8, {1, 4},
+      input0.data(), {4});
+
+  std::vector<uint8_t> tensor(14, 0);
+  BackendInputCollector collector(
+      batch.request_handles_.data(), batch.request_handles_.size(),
+      &batch.response_handles_, MockMemoryManager(), false /* pinned */,
+      nullptr /* stream */);
+  collector.ProcessTensor(
+      "INPUT0", reinterpret_cast<char*>(tensor.data()), tensor.size(),
+      TRITONSERVER_MEMORY_CPU, 0);
+  CHECK(!collector.Finalize());
+
+  CHECK(memcmp(tensor.data(), input0.data(), input0.size()) == 0);
+  CHECK(memcmp(tensor.data() + 4, input1.data(), input1.size()) == 0);
+  CHECK(batch.response_handles_[0] != nullptr);
+  CHECK(batch.response_handles_[1] != nullptr);
+  CHECK(batch.response_handles_[2] == nullptr);
+  CHECK(batch.responses_[2].sent_ && batch.responses_[2].failed_);
+}
+
+void
+TestCollectorConversion()
+{
+  // Each element is converted as 'element * 2 + 1', the elements of
+  // the first request are split across buffers.
+  const std::vector<uint8_t> input0{1, 2, 3, 4};
+  const std::vector<uint8_t> input1{10, 20, 30, 40};
+  Batch batch(2);
+  AddInput(
+      &batch.requests_[0], "INPUT0", TRITONSERVER_TYPE_UINT8, {1, 4},
+      input0.data(), {1, 3});
+  AddInput(
+      &batch.requests_[1], "INPUT0", TRITONSERVER_TYPE_UINT8, {1, 4},
+      input1.data(), {4});
+
+  BackendInputCollector::InputConversion conversion;
+  conversion.datatype_ = TRITONSERVER_TYPE_FP32;
+  conversion.scale_ = 2.0f;
+  conversion.bias_ = 1.0f;
+
+  BackendInputCollector collector(
+      batch.request_handles_.data(), batch.request_handles_.size(),
+      &batch.response_handles_, MockMemoryManager(), false /* pinned */,
+      nullptr /* stream */);
+  const char* buffer = nullptr;
+  size_t byte_size = 0;
+  TRITONSERVER_MemoryType memory_type;
+  int64_t memory_type_id;
+  CHECK_OK(collector.ProcessTensor(
+      "INPUT0", conversion, nullptr /* buffer */, 0 /* buffer_byte_size */,
+      {{TRITONSERVER_MEMORY_CPU, 0}}, &buffer, &byte_size, &memory_type,
+      &memory_type_id));
+  collector.Finalize();
+
+  const std::vector<float> expected{3, 5, 7, 9, 21, 41, 61, 81};
+  CHECK(buffer != nullptr);
+  CHECK(byte_size == expected.size() * sizeof(float));
+  if ((buffer != nullptr) && (byte_size == expected.size() * sizeof(float))) {
+    CHECK(memcmp(buffer, expected.data(), byte_size) == 0);
+  }
+  CHECK(batch.response_handles_[0] != nullptr);
+  CHECK(batch.response_handles_[1] != nullptr);
+}
+
+void
+TestCollectorConversionSplitElements()
+{
+  // The elements of the first request straddle its two buffers, the
+  // input of the second request isn't a whole number of elements so
+  // only its response fails.
+  const std::vector<int16_t> input0{-3, 300, 7};
+  const std::vector<int16_t> input1{1, 2};
+  Batch batch(2);
+  AddInput(
+      &batch.requests_[0], "INPUT0", TRITONSERVER_TYPE_INT16, {1, 3},
+      input0.data(), {3, 3});
+  AddInput(
+      &batch.requests_[1], "INPUT0", TRITONSERVER_TYPE_INT16, {1, 2},
+      input1.data(), {3});
+
+  BackendInputCollector::InputConversion conversion;
+  BackendInputCollector collector(
+      batch.request_handles_.data(), batch.request_handles_.size(),
+      &batch.response_handles_, MockMemoryManager(), false /* pinned */,
+      nullptr /* stream */);
+  const char* buffer = nullptr;
+  size_t byte_size = 0;
+  TRITONSERVER_MemoryType memory_type;
+  int64_t memory_type_id;
+  CHECK_OK(collector.ProcessTensor(
+      "INPUT0", conversion, nullptr /* buffer */, 0 /* buffer_byte_size */,
+      {{TRITONSERVER_MEMORY_CPU, 0}}, &buffer, &byte_size, &memory_type,
+      &memory_type_id));
+  collector.Finalize();
+
+  const std::vector<float> expected{-3, 300, 7};
+  CHECK(buffer != nullptr);
+  CHECK(byte_size >= expected.size() * sizeof(float));
+  if ((buffer != nullptr) && (byte_size >= expected.size() * sizeof(float))) {
+    CHECK(
+        memcmp(buffer, expected.data(), expected.size() * sizeof(float)) ==
+        0);
+  }
+  CHECK(batch.response_handles_[0] != nullptr);
+  CHECK(batch.response_handles_[1] == nullptr);
+  CHECK(batch.responses_[1].failed_);
+}
+
+#ifdef TRITON_ENABLE_GPU
+// Read 'byte_size' bytes of GPU memory at 'buffer'.
+std::vector<char>
+ReadGpu(const void* buffer, const size_t byte_size)
+{
+  std::vector<char> contents(byte_size);
+  cudaMemcpy(contents.data(), buffer, byte_size, cudaMemcpyDeviceToHost);
+  return contents;
+}
+#endif  // TRITON_ENABLE_GPU
+
+void
+TestCollectorCopyGraph()
+{
+  if (!GpuAvailable()) {
+    printf("TestCollectorCopyGraph: skipped, no GPU\n");
+    return;
+  }
+#ifdef TRITON_ENABLE_GPU
+  // Pinned request buffers copied to a GPU tensor: the first batch
+  // builds the graph and the second batch, with the same copies,
+  // replays it.
+  constexpr size_t kRequestCount = 4;
+  constexpr size_t kByteSize = 1024;
+  std::vector<void*> inputs;
+  std::vector<char> expected;
+  for (size_t r = 0; r < kRequestCount; ++r) {
+    void* input = MockAllocate(TRITONSERVER_MEMORY_CPU_PINNED, 0, kByteSize);
+    memset(input, int(r + 1), kByteSize);
+    inputs.push_back(input);
+    expected.insert(expected.end(), kByteSize, char(r + 1));
+  }
+  void* tensor = MockAllocate(
+      TRITONSERVER_MEMORY_GPU, 0, kRequestCount * kByteSize);
+  cudaStream_t stream;
+  cudaStreamCreate(&stream);
+
+  BackendCopyGraph copy_graph(1 /* min_copy_count */);
+  for (size_t iteration = 0; iteration < 2; ++iteration) {
+    cudaMemset(tensor, 0, kRequestCount * kByteSize);
+    Batch batch(kRequestCount);
+    for (size_t r = 0; r < kRequestCount; ++r) {
+      AddInput(
+          &batch.requests_[r], "INPUT0", TRITONSERVER_TYPE_UINT8,
+          {1, int64_t(kByteSize)}, inputs[r], {kByteSize},
+          TRITONSERVER_MEMORY_CPU_PINNED);
+    }
+    BackendInputCollector collector(
+        batch.request_handles_.data(), batch.request_handles_.size(),
+        &batch.response_handles_, MockMemoryManager(), true /* pinned */,
+        stream);
+    collector.SetCopyGraph(&copy_graph);
+    collector.ProcessTensor(
+        "INPUT0", reinterpret_cast<char*>(tensor), kRequestCount * kByteSize,
+        TRITONSERVER_MEMORY_GPU, 0);
+    if (collector.Finalize()) {
+      cudaStreamSynchronize(stream);
+    }
+    CHECK(ReadGpu(tensor, kRequestCount * kByteSize) == expected);
+    CHECK(copy_graph.GraphCount() == 1);
+  }
+
+  cudaStreamDestroy(stream);
+  MockFree(tensor, TRITONSERVER_MEMORY_GPU, 0);
+  for (void* input : inputs) {
+    MockFree(input, TRITONSERVER_MEMORY_CPU_PINNED, 0);
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+std::shared_ptr<BackendMemory>
+CpuMemory(const size_t byte_size)
+{
+  BackendMemory* memory = nullptr;
+  CHECK_OK(BackendMemory::Create(
+      MockMemoryManager(), BackendMemory::AllocationType::CPU,
+      0 /* memory_type_id */, byte_size, &memory));
+  return std::shared_ptr<BackendMemory>(memory);
+}
+
+void
+TestResidencyCacheEviction()
+{
+  BackendResidencyCache cache(
+      MockMemoryManager(), 0 /* device_id */, nullptr /* stream */,
+      2048 /* byte_size_limit */, {"EMBEDDING"});
+  CHECK(cache.IsCachedInput("EMBEDDING"));
+  CHECK(!cache.IsCachedInput("INPUT0"));
+
+  const auto contents = std::make_shared<const std::string>("contents");
+  cache.Insert("a", CpuMemory(1024), contents);
+  cache.Insert("b", CpuMemory(1024));
+  CHECK(cache.ByteSize() == 2048);
+
+  // Finding 'a' makes it the most recently used, so inserting 'c'
+  // evicts 'b'.
+  std::shared_ptr<BackendMemory> memory;
+  std::shared_ptr<const std::string> found_contents;
+  CHECK(cache.Find("a", &memory, &found_contents));
+  CHECK(found_contents == contents);
+  cache.Insert("c", CpuMemory(1024));
+  CHECK(cache.ByteSize() == 2048);
+  CHECK(cache.Find("a", &memory, &found_contents));
+  CHECK(!cache.Find("b", &memory, &found_contents));
+  CHECK(cache.Find("c", &memory, &found_contents));
+  CHECK(found_contents == nullptr);
+
+  // A copy larger than the limit is refused.
+  TRITONSERVER_Error* err = cache.Allocate(4096, &memory);
+  CHECK(err != nullptr);
+  TRITONSERVER_ErrorDelete(err);
+
+  cache.Clear();
+  CHECK(cache.ByteSize() == 0);
+  CHECK(!cache.Find("a", &memory, &found_contents));
+}
+
+void
+TestResidencyCacheHash()
+{
+  const std::string data("0123456789abcdefghij");
+  const uint64_t hash = BackendResidencyCache::Hash(data.data(), 20, 0);
+  CHECK(hash == BackendResidencyCache::Hash(data.data(), 20, 0));
+  CHECK(hash != BackendResidencyCache::Hash(data.data(), 20, 1));
+  CHECK(hash != BackendResidencyCache::Hash(data.data(), 19, 0));
+  CHECK(hash != BackendResidencyCache::Hash(data.data() + 1, 20 - 1, 0));
+}
+
+void
+TestCollectorResidency()
+{
+  if (!GpuAvailable()) {
+    printf("TestCollectorResidency: skipped, no GPU\n");
+    return;
+  }
+#ifdef TRITON_ENABLE_GPU
+  // The second batch with the same contents gets the cached copy, the
+  // third batch with different contents doesn't.
+  cudaStream_t stream;
+  cudaStreamCreate(&stream);
+  BackendResidencyCache cache(
+      MockMemoryManager(), 0 /* device_id */, stream,
+      1024 * 1024 /* byte_size_limit */, {"EMBEDDING"});
+
+  std::vector<char> embedding(4096, 'e');
+  const char* first_buffer = nullptr;
+  for (size_t iteration = 0; iteration < 3; ++iteration) {
+    if (iteration == 2) {
+      embedding[100] = 'x';
+    }
+    Batch batch(1);
+    AddInput(
+        &batch.requests_[0], "EMBEDDING", TRITONSERVER_TYPE_UINT8,
+        {1, int64_t(embedding.size())}, embedding.data(), {embedding.size()});
+    BackendInputCollector collector(
+        batch.request_handles_.data(), batch.request_handles_.size(),
+        &batch.response_handles_, MockMemoryManager(), false /* pinned */,
+        stream);
+    collector.SetResidencyCache(&cache);
+    const char* buffer = nullptr;
+    size_t byte_size = 0;
+    TRITONSERVER_MemoryType memory_type;
+    int64_t memory_type_id;
+    CHECK_OK(collector.ProcessTensor(
+        "EMBEDDING", nullptr /* buffer */, 0 /* buffer_byte_size */,
+        {{TRITONSERVER_MEMORY_GPU, 0}}, &buffer, &byte_size, &memory_type,
+        &memory_type_id));
+    if (collector.Finalize()) {
+      cudaStreamSynchronize(stream);
+    }
+    CHECK(memory_type == TRITONSERVER_MEMORY_GPU);
+    CHECK(ReadGpu(buffer, byte_size) == embedding);
+    if (iteration == 0) {
+      first_buffer = buffer;
+    } else {
+      CHECK((buffer == first_buffer) == (iteration == 1));
+    }
+  }
+
+  cache.Clear();
+  cudaStreamDestroy(stream);
+#endif  // TRITON_ENABLE_GPU
+}
+
+void
+TestRegistry()
+{
+  BackendResourceRegistry registry;
+  CHECK(registry.Find<int>("weights") == nullptr);
+
+  // Concurrent callers for the same name create the resource once and
+  // all get it.
+  std::atomic<int> create_count(0);
+  std::vector<std::shared_ptr<int>> resources(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < resources.size(); ++i) {
+    threads.emplace_back([&registry, &create_count, &resources, i] {
+      CHECK_OK(registry.GetOrCreate<int>(
+          "weights",
+          [&create_count](std::shared_ptr<int>* created)
+              -> TRITONSERVER_Error* {
+            ++create_count;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            created->reset(new int(42));
+            return nullptr;  // success
+          },
+          &resources[i]));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  CHECK(create_count == 1);
+  for (const auto& resource : resources) {
+    CHECK((resource != nullptr) && (resource == resources[0]));
+  }
+  CHECK(registry.Find<int>("weights") == resources[0]);
+  CHECK(registry.Count() == 1);
+
+  // A resource looked up as another type is an error.
+  CHECK(registry.Find<float>("weights") == nullptr);
+  std::shared_ptr<float> wrong_type;
+  TRITONSERVER_Error* err = registry.GetOrCreate<float>(
+      "weights",
+      [](std::shared_ptr<float>* created) -> TRITONSERVER_Error* {
+        created->reset(new float(0));
+        return nullptr;  // success
+      },
+      &wrong_type);
+  CHECK(err != nullptr);
+  TRITONSERVER_ErrorDelete(err);
+
+  // A failed creation registers nothing and a later call creates the
+  // resource.
+  std::shared_ptr<int> retried;
+  err = registry.GetOrCreate<int>(
+      "tokenizer",
+      [](std::shared_ptr<int>*) -> TRITONSERVER_Error* {
+        return TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, "failed");
+      },
+      &retried);
+  CHECK(err != nullptr);
+  TRITONSERVER_ErrorDelete(err);
+  CHECK(registry.Find<int>("tokenizer") == nullptr);
+  CHECK_OK(registry.GetOrCreate<int>(
+      "tokenizer",
+      [](std::shared_ptr<int>* created) -> TRITONSERVER_Error* {
+        created->reset(new int(7));
+        return nullptr;  // success
+      },
+      &retried));
+  CHECK((retried != nullptr) && (*retried == 7));
+
+  // Creating a resource doesn't block the creation of another name.
+  std::atomic<bool> slow_done(false);
+  std::thread slow([&registry, &slow_done] {
+    std::shared_ptr<int> resource;
+    CHECK_OK(registry.GetOrCreate<int>(
+        "slow",
+        [](std::shared_ptr<int>* created) -> TRITONSERVER_Error* {
+          std::this_thread::sleep_for(std::chrono::milliseconds(200));
+          created->reset(new int(1));
+          return nullptr;  // success
+        },
+        &resource));
+    slow_done = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::shared_ptr<int> fast;
+  CHECK_OK(registry.GetOrCreate<int>(
+      "fast",
+      [](std::shared_ptr<int>* created) -> TRITONSERVER_Error* {
+        created->reset(new int(2));
+        return nullptr;  // success
+      },
+      &fast));
+  CHECK(!slow_done);
+  slow.join();
+
+  CHECK(registry.Remove("weights"));
+  CHECK(!registry.Remove("weights"));
+  CHECK(registry.Find<int>("weights") == nullptr);
+  CHECK(*resources[0] == 42);
+  CHECK(registry.Count() == 3);
+}
+
+void
+TestResponseSenderNulledResponses()
+{
+  // Responses 1 and 3 are set to nullptr after the sender is created
+  // and without a Refresh(), as RESPOND_AND_SET_NULL_IF_ERROR does.
+  // Setting an error on them fails nothing.
+  {
+    Batch batch(4);
+    BackendResponseSender sender(&batch.response_handles_);
+    batch.response_handles_[1] = nullptr;
+    batch.response_handles_[3] = nullptr;
+
+    sender.SetError(
+        1, TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, "nulled"));
+    CHECK(!sender.IsLive(1));
+    sender.SetError(
+        0, TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, "failed"));
+    CHECK(!sender.IsLive(0));
+    CHECK(sender.LiveCount() == 2);
+    sender.Send();
+
+    CHECK(batch.responses_[0].sent_ && batch.responses_[0].failed_);
+    CHECK(!batch.responses_[1].sent_);
+    CHECK(batch.responses_[2].sent_ && !batch.responses_[2].failed_);
+    CHECK(!batch.responses_[3].sent_);
+    CHECK(batch.response_handles_[0] == nullptr);
+    CHECK(batch.response_handles_[2] == nullptr);
+  }
+
+  // SetErrorAll() fails only the responses that are not nullptr.
+  {
+    Batch batch(3);
+    BackendResponseSender sender(&batch.response_handles_);
+    batch.response_handles_[0] = nullptr;
+    batch.response_handles_[2] = nullptr;
+
+    sender.SetErrorAll(
+        TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, "failed"));
+    CHECK(sender.LiveCount() == 0);
+    sender.Send();
+
+    CHECK(!batch.responses_[0].sent_);
+    CHECK(batch.responses_[1].sent_ && batch.responses_[1].failed_);
+    CHECK(!batch.responses_[2].sent_);
+  }
+
+  // When all the responses were set to nullptr SetErrorAll() fails
+  // nothing.
+  {
+    Batch batch(2);
+    BackendResponseSender sender(&batch.response_handles_);
+    batch.response_handles_[0] = nullptr;
+    batch.response_handles_[1] = nullptr;
+
+    sender.SetErrorAll(
+        TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, "failed"));
+    CHECK(sender.LiveCount() == 0);
+    sender.Send();
+
+    CHECK(!batch.responses_[0].sent_);
+    CHECK(!batch.responses_[1].sent_);
+  }
+}
+
+void
+TestResponderVariableSize()
+{
+  // Each response gets its slice of the buffer as is.
+  const std::vector<uint8_t> buffer{1, 2, 3, 4, 5, 6, 7, 8};
+  {
+    Batch batch(2);
+    batch.requests_[0].requested_outputs_.push_back("OUTPUT0");
+    batch.requests_[1].requested_outputs_.push_back("OUTPUT0");
+    BackendOutputResponder responder(
+        batch.request_handles_.data(), batch.request_handles_.size(),
+        &batch.response_handles_, 0 /* max_batch_size */,
+        MockMemoryManager(), false /* pinned */, nullptr /* stream */);
+    CHECK_OK(responder.ProcessVariableSizeTensor(
+        "OUTPUT0", TRITONSERVER_TYPE_UINT8, {{3}, {5}}, {0, 3}, {3, 5},
+        reinterpret_cast<const char*>(buffer.data()), buffer.size(),
+        TRITONSERVER_MEMORY_CPU, 0));
+    CHECK(!responder.Finalize());
+
+    for (size_t i = 0; i < 2; ++i) {
+      CHECK(batch.responses_[i].outputs_.size() == 1);
+    }
+    const MockOutput& output0 = batch.responses_[0].outputs_.front();
+    const MockOutput& output1 = batch.responses_[1].outputs_.front();
+    CHECK(
+        (output0.byte_size_ == 3) &&
+        (memcmp(output0.buffer_, buffer.data(), 3) == 0));
+    CHECK(
+        (output1.byte_size_ == 5) &&
+        (memcmp(output1.buffer_, buffer.data() + 3, 5) == 0));
+  }
+
+  // A slice past the end of the buffer, including one whose end
+  // overflows, is an error and no response is processed.
+  const std::vector<std::vector<size_t>> bad_offsets{{0, 4}, {0, SIZE_MAX}};
+  for (const auto& offsets : bad_offsets) {
+    Batch batch(2);
+    batch.requests_[0].requested_outputs_.push_back("OUTPUT0");
+    batch.requests_[1].requested_outputs_.push_back("OUTPUT0");
+    BackendOutputResponder responder(
+        batch.request_handles_.data(), batch.request_handles_.size(),
+        &batch.response_handles_, 0 /* max_batch_size */,
+        MockMemoryManager(), false /* pinned */, nullptr /* stream */);
+    TRITONSERVER_Error* err = responder.ProcessVariableSizeTensor(
+        "OUTPUT0", TRITONSERVER_TYPE_UINT8, {{3}, {5}}, offsets, {3, 5},
+        reinterpret_cast<const char*>(buffer.data()), buffer.size(),
+        TRITONSERVER_MEMORY_CPU, 0);
+    CHECK(
+        (err != nullptr) &&
+        (TRITONSERVER_ErrorCode(err) == TRITONSERVER_ERROR_INVALID_ARG));
+    TRITONSERVER_ErrorDelete(err);
+    CHECK(!responder.Finalize());
+    CHECK(batch.responses_[0].outputs_.empty());
+    CHECK(batch.responses_[1].outputs_.empty());
+    CHECK(!batch.responses_[0].sent_ && !batch.responses_[1].sent_);
+  }
+}
+
+}  // namespace
+
+}}}  // namespace triton::backend::bench
+
+int
+main()
+{
+  using namespace triton::backend::bench;
+
+  TestCollectorBatched();
+  TestCollectorConversion();
+  TestCollectorConversionSplitElements();
+  TestCollectorCopyGraph();
+  TestResidencyCacheEviction();
+  TestResidencyCacheHash();
+  TestCollectorResidency();
+  TestRegistry();
+  TestResponseSenderNulledResponses();
+  TestResponderVariableSize();
+
+  if (check_failures > 0) {
+    fprintf(stderr, "%zu checks failed\n", check_failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,620 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mock_triton.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend { namespace bench {
+
+namespace {
+
+struct MockError {
+  TRITONSERVER_Error_Code code_;
+  std::string msg_;
+};
+
+TRITONSERVER_Error*
+Unsupported(const char* fn)
+{
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED,
+      (std::string(fn) + " is not supported by the benchmark mock").c_str());
+}
+
+int mock_memory_manager = 0;
+
+}  // namespace
+
+MockResponse::~MockResponse()
+{
+  for (auto& output : outputs_) {
+    if (output.buffer_ != nullptr) {
+      MockFree(output.buffer_, output.memory_type_, output.memory_type_id_);
+    }
+  }
+}
+
+void*
+MockAllocate(
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    const size_t byte_size)
+{
+  void* buffer = nullptr;
+  switch (memory_type) {
+    case TRITONSERVER_MEMORY_CPU:
+      buffer = malloc(byte_size);
+      break;
+    case TRITONSERVER_MEMORY_CPU_PINNED:
+#ifdef TRITON_ENABLE_GPU
+      if (cudaHostAlloc(&buffer, byte_size, cudaHostAllocPortable) !=
+          cudaSuccess) {
+        buffer = nullptr;
+      }
+#endif  // TRITON_ENABLE_GPU
+      break;
+    case TRITONSERVER_MEMORY_GPU:
+#ifdef TRITON_ENABLE_GPU
+      if ((cudaSetDevice(memory_type_id) != cudaSuccess) ||
+          (cudaMalloc(&buffer, byte_size) != cudaSuccess)) {
+        buffer = nullptr;
+      }
+#endif  // TRITON_ENABLE_GPU
+      break;
+  }
+  return buffer;
+}
+
+void
+MockFree(
+    void* buffer, const TRITONSERVER_MemoryType memory_type,
+    const int64_t memory_type_id)
+{
+  switch (memory_type) {
+    case TRITONSERVER_MEMORY_CPU:
+      free(buffer);
+      break;
+    case TRITONSERVER_MEMORY_CPU_PINNED:
+#ifdef TRITON_ENABLE_GPU
+      cudaFreeHost(buffer);
+#endif  // TRITON_ENABLE_GPU
+      break;
+    case TRITONSERVER_MEMORY_GPU:
+#ifdef TRITON_ENABLE_GPU
+      cudaSetDevice(memory_type_id);
+      cudaFree(buffer);
+#endif  // TRITON_ENABLE_GPU
+      break;
+  }
+}
+
+TRITONBACKEND_MemoryManager*
+MockMemoryManager()
+{
+  return reinterpret_cast<TRITONBACKEND_MemoryManager*>(&mock_memory_manager);
+}
+
+}}}  // namespace triton::backend::bench
+
+using triton::backend::bench::MockAllocate;
+using triton::backend::bench::MockError;
+using triton::backend::bench::MockFree;
+using triton::backend::bench::MockInput;
+using triton::backend::bench::MockOutput;
+using triton::backend::bench::MockRequest;
+using triton::backend::bench::MockResponse;
+using triton::backend::bench::Unsupported;
+
+extern "C" {
+
+//
+// TRITONSERVER
+//
+TRITONSERVER_Error*
+TRITONSERVER_ErrorNew(TRITONSERVER_Error_Code code, const char* msg)
+{
+  return reinterpret_cast<TRITONSERVER_Error*>(new MockError{code, msg});
+}
+
+void
+TRITONSERVER_ErrorDelete(TRITONSERVER_Error* error)
+{
+  delete reinterpret_cast<MockError*>(error);
+}
+
+TRITONSERVER_Error_Code
+TRITONSERVER_ErrorCode(TRITONSERVER_Error* error)
+{
+  return reinterpret_cast<MockError*>(error)->code_;
+}
+
+const char*
+TRITONSERVER_ErrorCodeString(TRITONSERVER_Error* error)
+{
+  switch (TRITONSERVER_ErrorCode(error)) {
+    case TRITONSERVER_ERROR_INTERNAL:
+      return "Internal";
+    case TRITONSERVER_ERROR_NOT_FOUND:
+      return "Not found";
+    case TRITONSERVER_ERROR_INVALID_ARG:
+      return "Invalid argument";
+    case TRITONSERVER_ERROR_UNAVAILABLE:
+      return "Unavailable";
+    case TRITONSERVER_ERROR_UNSUPPORTED:
+      return "Unsupported";
+    case TRITONSERVER_ERROR_ALREADY_EXISTS:
+      return "Already exists";
+    default:
+      return "Unknown";
+  }
+}
+
+const char*
+TRITONSERVER_ErrorMessage(TRITONSERVER_Error* error)
+{
+  return reinterpret_cast<MockError*>(error)->msg_.c_str();
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_LogMessage(
+    TRITONSERVER_LogLevel level, const char* filename, const int line,
+    const char* msg)
+{
+  if (level == TRITONSERVER_LOG_ERROR) {
+    fprintf(stderr, "E %s:%d] %s\n", filename, line, msg);
+  }
+  return nullptr;  // success
+}
+
+bool
+TRITONSERVER_LogIsEnabled(TRITONSERVER_LogLevel level)
+{
+  return level == TRITONSERVER_LOG_ERROR;
+}
+
+const char*
+TRITONSERVER_MemoryTypeString(TRITONSERVER_MemoryType memtype)
+{
+  switch (memtype) {
+    case TRITONSERVER_MEMORY_CPU:
+      return "CPU";
+    case TRITONSERVER_MEMORY_CPU_PINNED:
+      return "CPU_PINNED";
+    case TRITONSERVER_MEMORY_GPU:
+      return "GPU";
+    default:
+      return "<invalid>";
+  }
+}
+
+const char*
+TRITONSERVER_DataTypeString(TRITONSERVER_DataType datatype)
+{
+  switch (datatype) {
+    case TRITONSERVER_TYPE_BOOL:
+      return "BOOL";
+    case TRITONSERVER_TYPE_UINT8:
+      return "UINT8";
+    case TRITONSERVER_TYPE_UINT16:
+      return "UINT16";
+    case TRITONSERVER_TYPE_UINT32:
+      return "UINT32";
+    case TRITONSERVER_TYPE_UINT64:
+      return "UINT64";
+    case TRITONSERVER_TYPE_INT8:
+      return "INT8";
+    case TRITONSERVER_TYPE_INT16:
+      return "INT16";
+    case TRITONSERVER_TYPE_INT32:
+      return "INT32";
+    case TRITONSERVER_TYPE_INT64:
+      return "INT64";
+    case TRITONSERVER_TYPE_FP16:
+      return "FP16";
+    case TRITONSERVER_TYPE_FP32:
+      return "FP32";
+    case TRITONSERVER_TYPE_FP64:
+      return "FP64";
+    case TRITONSERVER_TYPE_BYTES:
+      return "BYTES";
+    default:
+      return "<invalid>";
+  }
+}
+
+TRITONSERVER_DataType
+TRITONSERVER_StringToDataType(const char* dtype)
+{
+  for (int dt = TRITONSERVER_TYPE_BOOL; dt <= TRITONSERVER_TYPE_BYTES; ++dt) {
+    const TRITONSERVER_DataType datatype =
+        static_cast<TRITONSERVER_DataType>(dt);
+    if (strcmp(dtype, TRITONSERVER_DataTypeString(datatype)) == 0) {
+      return datatype;
+    }
+  }
+  return TRITONSERVER_TYPE_INVALID;
+}
+
+uint32_t
+TRITONSERVER_DataTypeByteSize(TRITONSERVER_DataType datatype)
+{
+  switch (datatype) {
+    case TRITONSERVER_TYPE_BOOL:
+    case TRITONSERVER_TYPE_UINT8:
+    case TRITONSERVER_TYPE_INT8:
+      return 1;
+    case TRITONSERVER_TYPE_UINT16:
+    case TRITONSERVER_TYPE_INT16:
+    case TRITONSERVER_TYPE_FP16:
+      return 2;
+    case TRITONSERVER_TYPE_UINT32:
+    case TRITONSERVER_TYPE_INT32:
+    case TRITONSERVER_TYPE_FP32:
+      return 4;
+    case TRITONSERVER_TYPE_UINT64:
+    case TRITONSERVER_TYPE_INT64:
+    case TRITONSERVER_TYPE_FP64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_MessageSerializeToJson(
+    TRITONSERVER_Message* message, const char** base, size_t* byte_size)
+{
+  return Unsupported("TRITONSERVER_MessageSerializeToJson");
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_MessageDelete(TRITONSERVER_Message* message)
+{
+  return Unsupported("TRITONSERVER_MessageDelete");
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_ServerModelBatchProperties(
+    TRITONSERVER_Server* server, const char* model_name,
+    const int64_t model_version, uint32_t* flags, void** voidp)
+{
+  return Unsupported("TRITONSERVER_ServerModelBatchProperties");
+}
+
+//
+// TRITONBACKEND memory manager
+//
+TRITONSERVER_Error*
+TRITONBACKEND_MemoryManagerAllocate(
+    TRITONBACKEND_MemoryManager* manager, void** buffer,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    const uint64_t byte_size)
+{
+  *buffer = MockAllocate(memory_type, memory_type_id, byte_size);
+  if (*buffer == nullptr) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNAVAILABLE,
+        (std::string("unable to allocate ") + std::to_string(byte_size) +
+         " bytes of " + TRITONSERVER_MemoryTypeString(memory_type) +
+         " memory")
+            .c_str());
+  }
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_MemoryManagerFree(
+    TRITONBACKEND_MemoryManager* manager, void* buffer,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
+{
+  MockFree(buffer, memory_type, memory_type_id);
+  return nullptr;  // success
+}
+
+//
+// TRITONBACKEND request, input and output
+//
+TRITONSERVER_Error*
+TRITONBACKEND_InputProperties(
+    TRITONBACKEND_Input* input, const char** name,
+    TRITONSERVER_DataType* datatype, const int64_t** shape,
+    uint32_t* dims_count, uint64_t* byte_size, uint32_t* buffer_count)
+{
+  MockInput* minput = reinterpret_cast<MockInput*>(input);
+  if (name != nullptr) {
+    *name = minput->name_.c_str();
+  }
+  if (datatype != nullptr) {
+    *datatype = minput->datatype_;
+  }
+  if (shape != nullptr) {
+    *shape = minput->shape_.data();
+  }
+  if (dims_count != nullptr) {
+    *dims_count = minput->shape_.size();
+  }
+  if (byte_size != nullptr) {
+    *byte_size = minput->byte_size_;
+  }
+  if (buffer_count != nullptr) {
+    *buffer_count = minput->buffers_.size();
+  }
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_InputBuffer(
+    TRITONBACKEND_Input* input, const uint32_t index, const void** buffer,
+    uint64_t* buffer_byte_size, TRITONSERVER_MemoryType* memory_type,
+    int64_t* memory_type_id)
+{
+  MockInput* minput = reinterpret_cast<MockInput*>(input);
+  if (index >= minput->buffers_.size()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG, "input buffer index out of range");
+  }
+  const auto& mbuffer = minput->buffers_[index];
+  *buffer = mbuffer.base_;
+  *buffer_byte_size = mbuffer.byte_size_;
+  *memory_type = mbuffer.memory_type_;
+  *memory_type_id = mbuffer.memory_type_id_;
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_OutputBuffer(
+    TRITONBACKEND_Output* output, void** buffer,
+    const uint64_t buffer_byte_size, TRITONSERVER_MemoryType* memory_type,
+    int64_t* memory_type_id)
+{
+  MockOutput* moutput = reinterpret_cast<MockOutput*>(output);
+  void* lbuffer = MockAllocate(*memory_type, *memory_type_id, buffer_byte_size);
+  if (lbuffer == nullptr) {
+    // Fall back to CPU like the server does.
+    *memory_type = TRITONSERVER_MEMORY_CPU;
+    *memory_type_id = 0;
+    lbuffer = MockAllocate(*memory_type, *memory_type_id, buffer_byte_size);
+  }
+  moutput->buffer_ = lbuffer;
+  moutput->byte_size_ = buffer_byte_size;
+  moutput->memory_type_ = *memory_type;
+  moutput->memory_type_id_ = *memory_type_id;
+  *buffer = lbuffer;
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestInputName(
+    TRITONBACKEND_Request* request, const uint32_t index,
+    const char** input_name)
+{
+  MockRequest* mrequest = reinterpret_cast<MockRequest*>(request);
+  if (index >= mrequest->inputs_.size()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG, "input index out of range");
+  }
+  *input_name = mrequest->inputs_[index].name_.c_str();
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestInput(
+    TRITONBACKEND_Request* request, const char* name,
+    TRITONBACKEND_Input** input)
+{
+  MockRequest* mrequest = reinterpret_cast<MockRequest*>(request);
+  for (auto& minput : mrequest->inputs_) {
+    if (minput.name_ == name) {
+      *input = reinterpret_cast<TRITONBACKEND_Input*>(&minput);
+      return nullptr;  // success
+    }
+  }
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_INVALID_ARG,
+      (std::string("unknown request input '") + name + "'").c_str());
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestInputByIndex(
+    TRITONBACKEND_Request* request, const uint32_t index,
+    TRITONBACKEND_Input** input)
+{
+  MockRequest* mrequest = reinterpret_cast<MockRequest*>(request);
+  if (index >= mrequest->inputs_.size()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG, "input index out of range");
+  }
+  *input = reinterpret_cast<TRITONBACKEND_Input*>(&mrequest->inputs_[index]);
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestFlags(TRITONBACKEND_Request* request, uint32_t* flags)
+{
+  *flags = reinterpret_cast<MockRequest*>(request)->flags_;
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestCorrelationId(TRITONBACKEND_Request* request, uint64_t* id)
+{
+  *id = reinterpret_cast<MockRequest*>(request)->correlation_id_;
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestOutputCount(
+    TRITONBACKEND_Request* request, uint32_t* count)
+{
+  *count = reinterpret_cast<MockRequest*>(request)->requested_outputs_.size();
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestOutputName(
+    TRITONBACKEND_Request* request, const uint32_t index,
+    const char** output_name)
+{
+  MockRequest* mrequest = reinterpret_cast<MockRequest*>(request);
+  if (index >= mrequest->requested_outputs_.size()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG, "output index out of range");
+  }
+  *output_name = mrequest->requested_outputs_[index].c_str();
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestRelease(
+    TRITONBACKEND_Request* request, uint32_t release_flags)
+{
+  return nullptr;  // success, requests are owned by the benchmark
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ResponseNew(
+    TRITONBACKEND_Response** response, TRITONBACKEND_Request* request)
+{
+  return Unsupported("TRITONBACKEND_ResponseNew");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ResponseFactoryDelete(TRITONBACKEND_ResponseFactory* factory)
+{
+  return Unsupported("TRITONBACKEND_ResponseFactoryDelete");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ResponseOutput(
+    TRITONBACKEND_Response* response, TRITONBACKEND_Output** output,
+    const char* name, const TRITONSERVER_DataType datatype,
+    const int64_t* shape, const uint32_t dims_count)
+{
+  MockResponse* mresponse = reinterpret_cast<MockResponse*>(response);
+  mresponse->outputs_.emplace_back();
+  MockOutput& moutput = mresponse->outputs_.back();
+  moutput.name_ = name;
+  moutput.datatype_ = datatype;
+  moutput.shape_.assign(shape, shape + dims_count);
+  moutput.buffer_ = nullptr;
+  moutput.byte_size_ = 0;
+  moutput.memory_type_ = TRITONSERVER_MEMORY_CPU;
+  moutput.memory_type_id_ = 0;
+  *output = reinterpret_cast<TRITONBACKEND_Output*>(&moutput);
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ResponseSend(
+    TRITONBACKEND_Response* response, const uint32_t send_flags,
+    TRITONSERVER_Error* error)
+{
+  MockResponse* mresponse = reinterpret_cast<MockResponse*>(response);
+  mresponse->sent_ = true;
+  mresponse->failed_ = (error != nullptr);
+  return nullptr;  // success
+}
+
+//
+// TRITONBACKEND model and instance, not used by the benchmarks
+//
+TRITONSERVER_Error*
+TRITONBACKEND_ModelConfig(
+    TRITONBACKEND_Model* model, const uint32_t config_version,
+    TRITONSERVER_Message** model_config)
+{
+  return Unsupported("TRITONBACKEND_ModelConfig");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ModelName(TRITONBACKEND_Model* model, const char** name)
+{
+  return Unsupported("TRITONBACKEND_ModelName");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ModelVersion(TRITONBACKEND_Model* model, uint64_t* version)
+{
+  return Unsupported("TRITONBACKEND_ModelVersion");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ModelRepository(
+    TRITONBACKEND_Model* model, TRITONBACKEND_ArtifactType* artifact_type,
+    const char** location)
+{
+  return Unsupported("TRITONBACKEND_ModelRepository");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ModelServer(
+    TRITONBACKEND_Model* model, TRITONSERVER_Server** server)
+{
+  return Unsupported("TRITONBACKEND_ModelServer");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ModelBackend(
+    TRITONBACKEND_Model* model, TRITONBACKEND_Backend** backend)
+{
+  return Unsupported("TRITONBACKEND_ModelBackend");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_BackendMemoryManager(
+    TRITONBACKEND_Backend* backend, TRITONBACKEND_MemoryManager** manager)
+{
+  return Unsupported("TRITONBACKEND_BackendMemoryManager");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ModelInstanceName(
+    TRITONBACKEND_ModelInstance* instance, const char** name)
+{
+  return Unsupported("TRITONBACKEND_ModelInstanceName");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ModelInstanceKind(
+    TRITONBACKEND_ModelInstance* instance,
+    TRITONSERVER_InstanceGroupKind* kind)
+{
+  return Unsupported("TRITONBACKEND_ModelInstanceKind");
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_ModelInstanceDeviceId(
+    TRITONBACKEND_ModelInstance* instance, int32_t* device_id)
+{
+  return Unsupported("TRITONBACKEND_ModelInstanceDeviceId");
+}
+
+}  // extern "C"
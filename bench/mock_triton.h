@@ -0,0 +1,112 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <list>
+#include <string>
+#include <vector>
+#include "triton/core/tritonbackend.h"
+#include "triton/core/tritonserver.h"
+
+//
+// A minimal in-process implementation of the parts of the Triton
+// server C API that are used by the backend utilities, so that they
+// can be exercised without a server. Requests, responses and the
+// memory manager are plain host objects that the benchmarks build
+// directly.
+//
+namespace triton { namespace backend { namespace bench {
+
+// Location of one buffer of a request input.
+struct MockBuffer {
+  const void* base_;
+  size_t byte_size_;
+  TRITONSERVER_MemoryType memory_type_;
+  int64_t memory_type_id_;
+};
+
+struct MockInput {
+  std::string name_;
+  TRITONSERVER_DataType datatype_;
+  std::vector<int64_t> shape_;
+  uint64_t byte_size_;
+  std::vector<MockBuffer> buffers_;
+};
+
+struct MockRequest {
+  MockRequest() : flags_(0), correlation_id_(0) {}
+  std::vector<MockInput> inputs_;
+  std::vector<std::string> requested_outputs_;
+  uint32_t flags_;
+  uint64_t correlation_id_;
+};
+
+struct MockOutput {
+  std::string name_;
+  TRITONSERVER_DataType datatype_;
+  std::vector<int64_t> shape_;
+  void* buffer_;
+  size_t byte_size_;
+  TRITONSERVER_MemoryType memory_type_;
+  int64_t memory_type_id_;
+};
+
+// Responses are owned by the benchmark, TRITONBACKEND_ResponseSend()
+// only records the outcome.
+struct MockResponse {
+  MockResponse() : sent_(false), failed_(false) {}
+  ~MockResponse();
+  std::list<MockOutput> outputs_;
+  bool sent_;
+  bool failed_;
+};
+
+// Allocate and free memory of any type the way the server's memory
+// manager does. Pinned and GPU memory are only available when GPU
+// support is enabled.
+void* MockAllocate(
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    const size_t byte_size);
+void MockFree(
+    void* buffer, const TRITONSERVER_MemoryType memory_type,
+    const int64_t memory_type_id);
+
+// The memory manager handle to pass to the backend utilities.
+TRITONBACKEND_MemoryManager* MockMemoryManager();
+
+inline TRITONBACKEND_Request*
+AsRequest(MockRequest* request)
+{
+  return reinterpret_cast<TRITONBACKEND_Request*>(request);
+}
+
+inline TRITONBACKEND_Response*
+AsResponse(MockResponse* response)
+{
+  return reinterpret_cast<TRITONBACKEND_Response*>(response);
+}
+
+}}}  // namespace triton::backend::bench
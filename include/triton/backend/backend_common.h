@@ -29,6 +29,7 @@
 #include <condition_variable>
 #include <deque>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <string>
@@ -349,6 +350,65 @@ TRITONSERVER_Error* CopyBuffer(
     const int64_t dst_memory_type_id, const size_t byte_size, const void* src,
     void* dst, cudaStream_t cuda_stream, bool* cuda_used);
 
+/// Copy buffer from 'src' to 'dst' for given 'byte_size'. Same as the
+/// above but 'msg' is a C string, so that a caller that has the name
+/// of a tensor as a C string doesn't construct a std::string for each
+/// copy. The message is only used if the copy fails.
+TRITONSERVER_Error* CopyBuffer(
+    const char* msg, const TRITONSERVER_MemoryType src_memory_type,
+    const int64_t src_memory_type_id,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, const size_t byte_size, const void* src,
+    void* dst, cudaStream_t cuda_stream, bool* cuda_used);
+
+/// How a copy between buffers on two GPUs is performed, see
+/// GetGpuCopyPath().
+enum class GpuCopyPath {
+  // The buffers are on the same GPU.
+  SAME_DEVICE,
+  // Peer access between the GPUs is enabled in both directions, so the
+  // copy goes directly over NVLink or PCIe and a kernel on either GPU
+  // can access the memory of both.
+  PEER,
+  // Peer access between the GPUs is not enabled, so the copy is
+  // staged through host memory. CopyBuffer() leaves the staging to the
+  // driver, BackendInputCollector and BackendOutputResponder stage the
+  // copy through a pinned buffer of their own.
+  DRIVER_STAGED
+};
+
+/// Enable peer access between GPU 'src_device_id' and GPU
+/// 'dst_device_id' in both directions if the GPUs support it, so that
+/// the copies between them made by CopyBuffer() go directly over
+/// NVLink or PCIe. Peer access is a setting of the process, not of a
+/// stream or a model, so this is meant to be called once for each pair
+/// of GPUs when the model instances that copy between them are
+/// created, as BackendModelInstance does for its GPU and each other
+/// visible GPU. The later calls for a pair return the cached result.
+/// CopyBuffer() doesn't enable peer access itself.
+///
+/// \param src_device_id The ID of the source GPU.
+/// \param dst_device_id The ID of the destination GPU.
+/// \param path Returns the copy path following the call.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_Error* EnableGpuPeerAccess(
+    const int64_t src_device_id, const int64_t dst_device_id,
+    GpuCopyPath* path);
+
+/// Get how a copy from GPU 'src_device_id' to GPU 'dst_device_id' is
+/// performed, from the result of EnableGpuPeerAccess() for that pair
+/// of GPUs. A pair that EnableGpuPeerAccess() wasn't called for is
+/// DRIVER_STAGED. Doesn't change any CUDA state, so it is cheap to get
+/// for each copy.
+///
+/// \param src_device_id The ID of the source GPU.
+/// \param dst_device_id The ID of the destination GPU.
+/// \param path Returns the copy path.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_Error* GetGpuCopyPath(
+    const int64_t src_device_id, const int64_t dst_device_id,
+    GpuCopyPath* path);
+
 /// Does a file or directory exist?
 /// \param path The path to check for existance.
 /// \param exists Returns true if file/dir exists
@@ -362,6 +422,62 @@ TRITONSERVER_Error* FileExists(const std::string& path, bool* exists);
 TRITONSERVER_Error* ReadTextFile(
     const std::string& path, std::string* contents);
 
+/// A read-only memory mapping of the contents of a file, created by
+/// MapFile(). The mapping is released when the last reference to the
+/// MappedFile object is released.
+class MappedFile {
+ public:
+  ~MappedFile();
+
+  /// The path of the mapped file.
+  const std::string& Path() const { return path_; }
+
+  /// The contents of the file, nullptr if the file is empty.
+  const char* Data() const { return data_; }
+
+  /// The byte size of the contents of the file.
+  size_t ByteSize() const { return byte_size_; }
+
+ private:
+  friend TRITONSERVER_Error* MapFile(
+      const std::string& path, const bool prefetch,
+      std::shared_ptr<const MappedFile>* file);
+
+  MappedFile(const std::string& path)
+      : path_(path), data_(nullptr), byte_size_(0), device_(0), inode_(0),
+        modified_time_(0)
+  {
+  }
+
+  std::string path_;
+  const char* data_;
+  size_t byte_size_;
+
+  // Identify the version of the file that is mapped.
+  uint64_t device_;
+  uint64_t inode_;
+  int64_t modified_time_;
+
+  // The contents of the file on platforms without memory mapping.
+  std::string contents_;
+};
+
+/// Map the contents of a file into memory, read-only. Unlike
+/// ReadTextFile() the contents are not copied, the pages are read from
+/// the page cache as they are accessed, so mapping a large artifact
+/// doesn't need memory for a second copy of the file. Mapping a path
+/// that is already mapped by the process, for example by another
+/// instance of the same model version, returns the existing mapping if
+/// the file hasn't changed since it was mapped.
+/// \param path The path of the file.
+/// \param prefetch Whether to advise the kernel to read the whole file
+/// ahead, which is faster when all the contents are going to be used.
+/// \param file Returns the mapped file.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_Error* MapFile(
+    const std::string& path, const bool prefetch,
+    std::shared_ptr<const MappedFile>* file);
+
 /// Is a path a directory?
 /// \param path The path to check.
 /// \param is_dir Returns true if path represents a directory
@@ -398,6 +514,28 @@ TRITONSERVER_Error* ModelPaths(
 TRITONSERVER_Error* CreateCudaStream(
     const int device_id, const int cuda_stream_priority, cudaStream_t* stream);
 
+/// Get the device of a CUDA stream. With a CUDA runtime that can't
+/// report the device of a stream, and for the legacy default stream,
+/// the current device is returned, as a kernel launched on a stream of
+/// another device fails.
+///
+/// \param stream The stream.
+/// \param device_id Returns the ID of the GPU of the stream.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_Error* GetCudaStreamDevice(
+    cudaStream_t stream, int* device_id);
+
+/// Get the compute capability of a GPU device as "<major>.<minor>",
+/// for example "8.0". The compute capability of a device is queried
+/// once and cached for the lifetime of the process, so it is cheap to
+/// get for each model instance.
+///
+/// \param device_id The ID of the GPU.
+/// \param cc Returns the compute capability.
+/// \return a TRITONSERVER_Error indicating success or failure.
+TRITONSERVER_Error* GetDeviceComputeCapability(
+    const int device_id, std::string* cc);
+
 /// Parse the string as long long integer.
 ///
 /// \param value The string.
@@ -439,4 +577,70 @@ TRITONSERVER_Error* GetParameterValue(
     triton::common::TritonJson::Value& params, const std::string& key,
     std::string* value);
 
+/// Convert a model configuration data type string, such as
+/// "TYPE_FP32", to the corresponding TRITONSERVER_DataType.
+///
+/// \param data_type_str The data type string.
+/// \return The data type, or TRITONSERVER_TYPE_INVALID if the string
+/// is not a recognized data type.
+TRITONSERVER_DataType ModelConfigDataTypeToTritonServerDataType(
+    const std::string& data_type_str);
+
+//
+// BatchInput
+//
+// A batch input as specified in the 'batch_input' section of the
+// model configuration. A batch input is a tensor that is generated
+// from the shapes of the other inputs in a batch, for example to
+// describe where each request lives in a ragged input that has been
+// packed without padding.
+//
+class BatchInput {
+ public:
+  // The kind of the batch input.
+  enum class Kind {
+    // The element count of the source input of each request.
+    BATCH_ELEMENT_COUNT,
+    // The accumulated element count of the source input, i.e. the
+    // end offset of each request in the packed source input.
+    BATCH_ACCUMULATED_ELEMENT_COUNT,
+    // As BATCH_ACCUMULATED_ELEMENT_COUNT but with a leading zero, i.e.
+    // the start offset of each request followed by the total count.
+    BATCH_ACCUMULATED_ELEMENT_COUNT_WITH_ZERO,
+    // The shape of the batch input is [max element count] where the
+    // max is taken over the source input of each request. The content
+    // of the batch input is not used.
+    BATCH_MAX_ELEMENT_COUNT_AS_SHAPE,
+    // The shape, without the batch dimension, of the source input of
+    // each batch item.
+    BATCH_ITEM_SHAPE
+  };
+
+  /// Parse all the batch inputs in a model configuration.
+  ///
+  /// \param config The model configuration.
+  /// \param batch_inputs Returns the batch inputs.
+  /// \return a TRITONSERVER_Error indicating success or failure.
+  static TRITONSERVER_Error* ParseFromModelConfig(
+      common::TritonJson::Value& config, std::vector<BatchInput>* batch_inputs);
+
+  const std::vector<std::string>& TargetNames() const { return target_names_; }
+  TRITONSERVER_DataType DataType() const { return data_type_; }
+  Kind BatchInputKind() const { return kind_; }
+  const std::string& BatchInputKindString() const { return kind_str_; }
+  const std::vector<std::string>& SourceInputs() const
+  {
+    return source_inputs_;
+  }
+
+ private:
+  TRITONSERVER_Error* Init(common::TritonJson::Value& bi_config);
+
+  Kind kind_;
+  std::string kind_str_;
+  std::vector<std::string> target_names_;
+  TRITONSERVER_DataType data_type_;
+  std::vector<std::string> source_inputs_;
+};
+
 }}  // namespace triton::backend
@@ -0,0 +1,157 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+#include "triton/core/tritonserver.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend {
+
+#ifndef TRITON_ENABLE_GPU
+using cudaStream_t = void*;
+#endif  // !TRITON_ENABLE_GPU
+
+//
+// BackendCopyGraph
+//
+// Issues the copies between CPU and GPU memory of a tensor as a single
+// CUDA graph launch instead of one cudaMemcpyAsync per copy. For
+// fixed-shape models the sequence of copies of a tensor only depends
+// on the batch, so the graph built for a sequence is kept and
+// replayed for the later sequences that have the same copies, only
+// the addresses of the copies whose buffers changed are updated in the
+// instantiated graph. A sequence is keyed by the direction, the device
+// and the byte size of each of its copies. Only copies that the
+// driver performs asynchronously are added to a graph, that is copies
+// between pinned CPU memory and a GPU and copies within a GPU. The
+// BackendInputCollector and BackendOutputResponder objects queue their
+// copies to the graph given to SetCopyGraph() and launch them when
+// done with the tensor. The graph is launched on the stream the copies
+// would have been issued on, so an event recorded on that stream after
+// Launch(), as the collector and responder do, completes after the
+// copies; the event record itself is not part of the graph. Once the
+// graphs of the steady batch sizes are built, Launch() doesn't
+// allocate from the heap. A graph is typically owned by a
+// BackendModelInstance, see InputCopyGraph() and OutputCopyGraph().
+// The object is not thread-safe.
+//
+class BackendCopyGraph {
+ public:
+  // The default number of graphs kept for replay.
+  static constexpr size_t kDefaultMaxGraphCount = 16;
+
+  // Sequences of less than 'min_copy_count' copies are issued with
+  // one cudaMemcpyAsync per copy, as a graph launch costs more than a
+  // few copies. 'max_graph_count' bounds the number of graphs kept,
+  // the least recently launched graph is destroyed to make room for a
+  // new sequence.
+  explicit BackendCopyGraph(
+      const size_t min_copy_count,
+      const size_t max_graph_count = kDefaultMaxGraphCount);
+  ~BackendCopyGraph();
+
+  // Return true if a copy from 'src_memory_type' to 'dst_memory_type'
+  // can be added to a graph.
+  static bool IsGraphCopy(
+      const TRITONSERVER_MemoryType src_memory_type,
+      const int64_t src_memory_type_id,
+      const TRITONSERVER_MemoryType dst_memory_type,
+      const int64_t dst_memory_type_id);
+
+  // Queue a copy of 'byte_size' bytes from 'src' to 'dst', which must
+  // be a copy for which IsGraphCopy() returns true.
+  void AddCopy(
+      const void* src, const TRITONSERVER_MemoryType src_memory_type,
+      const int64_t src_memory_type_id, void* dst,
+      const TRITONSERVER_MemoryType dst_memory_type,
+      const int64_t dst_memory_type_id, const size_t byte_size);
+
+  // The number of queued copies.
+  size_t PendingCount() const { return pending_copies_.size(); }
+
+  // Issue the queued copies on 'stream' and clear the queue. The
+  // copies are issued one by one if there are too few of them or if
+  // the graph can't be built or updated. Set 'cuda_used' to true if
+  // any copy is issued.
+  TRITONSERVER_Error* Launch(cudaStream_t stream, bool* cuda_used);
+
+  // The number of graphs currently kept for replay.
+  size_t GraphCount() const { return lru_.size(); }
+
+ private:
+  struct Copy {
+    const void* src_;
+    TRITONSERVER_MemoryType src_memory_type_;
+    void* dst_;
+    TRITONSERVER_MemoryType dst_memory_type_;
+    int64_t device_id_;
+    size_t byte_size_;
+  };
+
+  // An instantiated graph, defined with the CUDA types in the source
+  // file.
+  struct Graph;
+
+  // The direction, the device and the byte size of each copy of a
+  // sequence.
+  using GraphKey = std::vector<int64_t>;
+  struct GraphKeyLess {
+    bool operator()(const GraphKey* lhs, const GraphKey* rhs) const
+    {
+      return *lhs < *rhs;
+    }
+  };
+
+  // The graphs, most recently launched first.
+  using GraphList = std::list<std::pair<GraphKey, std::unique_ptr<Graph>>>;
+
+  bool LaunchGraph(cudaStream_t stream);
+  TRITONSERVER_Error* LaunchCopies(cudaStream_t stream);
+
+  const size_t min_copy_count_;
+  const size_t max_graph_count_;
+  std::vector<Copy> pending_copies_;
+
+  // The key of the pending copies, a member so that its storage is
+  // reused by each launch.
+  GraphKey key_;
+
+  // The graphs indexed by the keys they hold.
+  GraphList lru_;
+  std::map<const GraphKey*, GraphList::iterator, GraphKeyLess> graphs_;
+};
+
+}}  // namespace triton::backend
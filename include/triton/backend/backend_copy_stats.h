@@ -0,0 +1,175 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendCopyStats
+//
+// Counters and latency histograms for the stages of input collection
+// and output responding, the bytes copied for each pair of memory
+// types, and the outcome of the zero-copy and pinned memory paths.
+// A BackendModelInstance owns one object that the
+// BackendInputCollector and BackendOutputResponder objects of the
+// instance report into, see SetStats() of those classes, and that the
+// backend can read with GetSnapshot() to export. The object is
+// thread-safe. Nothing is recorded unless the backend utilities are
+// built with TRITON_ENABLE_STATS.
+//
+class BackendCopyStats {
+ public:
+  enum class Stage {
+    // BackendInputCollector::ProcessTensor(), ProcessTensors() and the
+    // other Process*() functions, including the pinned flush and the
+    // issuing of the copies.
+    COLLECTOR_PROCESS,
+    // Copies of the pending inputs through a pinned buffer.
+    COLLECTOR_PINNED_FLUSH,
+    // The wait for in-flight copies in BackendInputCollector::Finalize().
+    COLLECTOR_SYNC_WAIT,
+    // BackendInputCollector::Finalize(), including the wait.
+    COLLECTOR_FINALIZE,
+    // BackendOutputResponder::ProcessTensor() and
+    // ProcessVariableSizeTensor().
+    RESPONDER_PROCESS,
+    // Copies of the pending outputs through a pinned buffer.
+    RESPONDER_PINNED_FLUSH,
+    // The wait for in-flight copies in BackendOutputResponder::Finalize().
+    RESPONDER_SYNC_WAIT,
+    // BackendOutputResponder::Finalize(), including the wait.
+    RESPONDER_FINALIZE,
+    COUNT
+  };
+
+  static constexpr size_t kStageCount = static_cast<size_t>(Stage::COUNT);
+
+  // Latency histogram buckets are powers of 2 of microseconds. Bucket
+  // 'i' counts the durations below 2^i us, the last bucket counts all
+  // the longer durations.
+  static constexpr size_t kHistogramBucketCount = 24;
+
+  // The memory types that copies are counted for, indexed by
+  // TRITONSERVER_MemoryType.
+  static constexpr size_t kMemoryTypeCount = 3;
+
+  struct StageSnapshot {
+    uint64_t count_;
+    uint64_t total_ns_;
+    uint64_t max_ns_;
+    std::array<uint64_t, kHistogramBucketCount> histogram_;
+  };
+
+  struct Snapshot {
+    std::array<StageSnapshot, kStageCount> stages_;
+    // Indexed by [src memory type][dst memory type].
+    uint64_t copy_bytes_[kMemoryTypeCount][kMemoryTypeCount];
+    uint64_t copy_count_[kMemoryTypeCount][kMemoryTypeCount];
+    // Whether the contiguous request buffers of an input could be used
+    // directly instead of being gathered.
+    uint64_t zero_copy_hits_;
+    uint64_t zero_copy_misses_;
+    // Pinned staging buffers that could not be allocated so that the
+    // copies were done directly, or through non-pinned CPU memory.
+    uint64_t pinned_fallbacks_;
+    // The tensors that a BackendPinnedPolicy decided to stage through
+    // a pinned buffer or to copy directly.
+    uint64_t pinned_staged_tensors_;
+    uint64_t pinned_direct_tensors_;
+  };
+
+  // Measure the time from construction to destruction as one
+  // execution of 'stage'. 'stats' may be nullptr in which case nothing
+  // is recorded.
+  class ScopedTimer {
+   public:
+    ScopedTimer(BackendCopyStats* stats, const Stage stage)
+        : stats_(stats), stage_(stage)
+    {
+      if (stats_ != nullptr) {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~ScopedTimer()
+    {
+      if (stats_ != nullptr) {
+        stats_->RecordStage(
+            stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start_)
+                        .count());
+      }
+    }
+
+   private:
+    BackendCopyStats* stats_;
+    const Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  BackendCopyStats();
+
+  void RecordStage(const Stage stage, const uint64_t duration_ns);
+  void RecordCopy(
+      const TRITONSERVER_MemoryType src_memory_type,
+      const TRITONSERVER_MemoryType dst_memory_type, const uint64_t byte_size);
+  void RecordZeroCopy(const bool hit);
+  void RecordPinnedFallback();
+  void RecordPinnedDecision(const bool staged);
+
+  // Return the current values of all the statistics.
+  void GetSnapshot(Snapshot* snapshot) const;
+
+  // Reset all the statistics to 0.
+  void Reset();
+
+  static const char* StageString(const Stage stage);
+
+ private:
+  struct StageStats {
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> total_ns_;
+    std::atomic<uint64_t> max_ns_;
+    std::array<std::atomic<uint64_t>, kHistogramBucketCount> histogram_;
+  };
+
+  std::array<StageStats, kStageCount> stages_;
+  std::atomic<uint64_t> copy_bytes_[kMemoryTypeCount][kMemoryTypeCount];
+  std::atomic<uint64_t> copy_count_[kMemoryTypeCount][kMemoryTypeCount];
+  std::atomic<uint64_t> zero_copy_hits_;
+  std::atomic<uint64_t> zero_copy_misses_;
+  std::atomic<uint64_t> pinned_fallbacks_;
+  std::atomic<uint64_t> pinned_staged_tensors_;
+  std::atomic<uint64_t> pinned_direct_tensors_;
+};
+
+}}  // namespace triton::backend
@@ -0,0 +1,210 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "triton/backend/backend_memory.h"
+#include "triton/backend/backend_model_config.h"
+#include "triton/backend/backend_request_metadata.h"
+#include "triton/core/tritonbackend.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend {
+
+#ifndef TRITON_ENABLE_GPU
+using cudaStream_t = void*;
+#endif  // !TRITON_ENABLE_GPU
+
+//
+// BackendFixedShapeCollector
+//
+// Gathers an input whose shape is fully specified by the model
+// configuration. Everything that the generic BackendInputCollector
+// decides for each request is decided once when the collector is
+// created for a model instance: the byte size of a batch item, the
+// memory the input is gathered into and whether it is staged through
+// pinned memory. The pinned staging buffer is allocated for the
+// maximum batch size and reused by every batch, so gathering a batch
+// does no allocation and keeps no per-request bookkeeping.
+//
+class BackendFixedShapeCollector {
+ public:
+  // Create a collector for 'input' of a model with 'max_batch_size'.
+  // The input is gathered into buffers of 'memory_type' and
+  // 'memory_type_id' and, if 'pinned_enabled' and the buffers are in
+  // GPU memory, staged through pinned memory. Return an UNSUPPORTED
+  // error if the shape or the data type of 'input' is not fixed, in
+  // which case the generic BackendInputCollector should be used.
+  static TRITONSERVER_Error* Create(
+      const BackendModelConfig::Tensor& input, const int max_batch_size,
+      TRITONBACKEND_MemoryManager* memory_manager,
+      const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+      const bool pinned_enabled,
+      std::unique_ptr<BackendFixedShapeCollector>* collector);
+
+  const std::string& Name() const { return name_; }
+
+  // The byte size of a batch item, and of the input of a batch of the
+  // maximum batch size.
+  size_t ItemByteSize() const { return item_byte_size_; }
+  size_t MaxByteSize() const { return max_byte_size_; }
+
+  // Gather the input of 'requests' back to back into 'buffer', which
+  // must have MaxByteSize() bytes of the memory type given at
+  // creation. 'byte_size' returns the byte size of the batch. If the
+  // input of a request can't be gathered, or is not a whole number of
+  // batch items, an error response is sent and the corresponding
+  // entry of 'responses' is set to nullptr. Return true if
+  // cudaMemcpyAsync is called, and the caller should call
+  // cudaStreamSynchronize on 'stream' before using the data and
+  // before the next call, as the staging buffer is reused.
+  bool Process(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<TRITONBACKEND_Response*>* responses, char* buffer,
+      cudaStream_t stream, size_t* byte_size);
+
+ private:
+  BackendFixedShapeCollector(
+      const std::string& name, const size_t item_byte_size,
+      const size_t max_byte_size, const TRITONSERVER_MemoryType memory_type,
+      const int64_t memory_type_id)
+      : name_(name), item_byte_size_(item_byte_size),
+        max_byte_size_(max_byte_size), memory_type_(memory_type),
+        memory_type_id_(memory_type_id)
+  {
+  }
+
+  template <bool kHostTensor>
+  bool Gather(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<TRITONBACKEND_Response*>* responses, char* buffer,
+      cudaStream_t stream, size_t* byte_size);
+  bool FlushStaged(
+      const size_t begin, const size_t end, char* buffer, cudaStream_t stream,
+      std::vector<TRITONBACKEND_Response*>* responses);
+
+  const std::string name_;
+  const size_t item_byte_size_;
+  const size_t max_byte_size_;
+  const TRITONSERVER_MemoryType memory_type_;
+  const int64_t memory_type_id_;
+  std::unique_ptr<BackendMemory> staging_;
+
+  // The indices of the requests with bytes in the run of staged bytes
+  // not yet copied to the tensor, a member so that its storage is
+  // reused.
+  std::vector<uint32_t> staged_responses_;
+};
+
+//
+// BackendFixedShapeResponder
+//
+// Scatters an output whose shape is fully specified by the model
+// configuration into the responses of a batch, the counterpart of
+// BackendFixedShapeCollector. The shape of each response output only
+// differs in its batch dimension and the requests of the batch are
+// described by a BackendRequestMetadata, so the responder neither
+// queries the requests nor builds a shape for each response. An
+// output in GPU memory is copied to a reused pinned staging buffer
+// with a single copy before it is scattered.
+//
+class BackendFixedShapeResponder {
+ public:
+  // Create a responder for 'output' of a model with 'max_batch_size'.
+  // The output is scattered from buffers of 'memory_type' and
+  // 'memory_type_id' and, if 'pinned_enabled' and the buffers are in
+  // GPU memory, staged through pinned memory. Return an UNSUPPORTED
+  // error if the shape or the data type of 'output' is not fixed, in
+  // which case the generic BackendOutputResponder should be used.
+  static TRITONSERVER_Error* Create(
+      const BackendModelConfig::Tensor& output, const int max_batch_size,
+      TRITONBACKEND_MemoryManager* memory_manager,
+      const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+      const bool pinned_enabled,
+      std::unique_ptr<BackendFixedShapeResponder>* responder);
+
+  const std::string& Name() const { return name_; }
+
+  // The byte size of a batch item, and of the output of a batch of
+  // the maximum batch size.
+  size_t ItemByteSize() const { return item_byte_size_; }
+  size_t MaxByteSize() const { return max_byte_size_; }
+
+  // Scatter 'buffer', the output of the batch described by 'metadata',
+  // into the responses that request the output. If the output can't
+  // be set in a response, an error response is sent and the
+  // corresponding entry of 'responses' is set to nullptr. Return true
+  // if cudaMemcpyAsync is called, and the caller should call
+  // cudaStreamSynchronize on 'stream' before calling Finalize(). The
+  // responses must not be sent before Finalize() is called.
+  bool ProcessTensor(
+      const BackendRequestMetadata& metadata,
+      std::vector<TRITONBACKEND_Response*>* responses, const char* buffer,
+      cudaStream_t stream);
+
+  // Complete the copies of the output staged by ProcessTensor() to
+  // the response buffers in CPU memory, which wait for the staging
+  // copy to be done.
+  void Finalize();
+
+ private:
+  BackendFixedShapeResponder(
+      const BackendModelConfig::Tensor& output, const bool batching,
+      const size_t item_byte_size, const size_t max_byte_size,
+      const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id);
+
+  const std::string name_;
+  const TRITONSERVER_DataType datatype_;
+  const bool batching_;
+  const size_t item_byte_size_;
+  const size_t max_byte_size_;
+  const TRITONSERVER_MemoryType memory_type_;
+  const int64_t memory_type_id_;
+  std::unique_ptr<BackendMemory> staging_;
+
+  // The shape of the response outputs, the batch dimension is set
+  // for each response of a batching model.
+  std::vector<int64_t> shape_;
+
+  // The copies from the staging buffer deferred until Finalize().
+  struct DeferredCopy {
+    DeferredCopy(char* dst, const size_t offset, const size_t byte_size)
+        : dst_(dst), offset_(offset), byte_size_(byte_size)
+    {
+    }
+    char* dst_;
+    size_t offset_;
+    size_t byte_size_;
+  };
+  std::vector<DeferredCopy> deferred_copies_;
+};
+
+}}  // namespace triton::backend
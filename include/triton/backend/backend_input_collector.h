@@ -25,11 +25,20 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
-#include <list>
+#include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include "triton/backend/backend_common.h"
+#include "triton/backend/backend_copy_graph.h"
+#include "triton/backend/backend_copy_stats.h"
 #include "triton/backend/backend_memory.h"
+#include "triton/backend/backend_model_config.h"
+#include "triton/backend/backend_pinned_arena.h"
+#include "triton/backend/backend_pinned_policy.h"
+#include "triton/backend/backend_residency_cache.h"
+#include "triton/backend/backend_thread_pool.h"
 #include "triton/core/tritonbackend.h"
 
 #ifdef TRITON_ENABLE_GPU
@@ -49,26 +58,174 @@ using cudaEvent_t = void*;
 class BackendInputCollector {
  public:
   // The caller can optionally provide 'event' for internal synchronization
-  // instead of using 'stream'.
+  // instead of using 'stream'. The caller can optionally provide
+  // 'pinned_arena' to borrow the pinned staging buffers from, instead
+  // of allocating them for each batch. The borrowed buffers are returned
+  // when the BackendInputCollector object is destroyed, so it must not
+  // be destroyed before the synchronization described in Finalize().
   explicit BackendInputCollector(
       TRITONBACKEND_Request** requests, const uint32_t request_count,
       std::vector<TRITONBACKEND_Response*>* responses,
       TRITONBACKEND_MemoryManager* memory_manager, const bool pinned_enabled,
-      cudaStream_t stream, cudaEvent_t event = nullptr)
+      cudaStream_t stream, cudaEvent_t event = nullptr,
+      BackendPinnedArena* pinned_arena = nullptr)
       : need_sync_(false), requests_(requests), request_count_(request_count),
         responses_(responses), memory_manager_(memory_manager),
         pinned_enabled_(pinned_enabled), stream_(stream), event_(event),
-        pending_pinned_byte_size_(0)
+        pinned_arena_(pinned_arena), pending_pinned_byte_size_(0),
+        gather_thread_pool_(nullptr), gather_min_byte_size_(0),
+        pending_host_byte_size_(0), copy_kernel_threshold_(0),
+        copy_graph_(nullptr), stats_(nullptr), pinned_policy_(nullptr),
+        compute_stream_(nullptr), compute_event_(nullptr),
+        residency_cache_(nullptr)
   {
   }
 
-  ~BackendInputCollector() = default;
+  ~BackendInputCollector();
+
+  // Reuse this collector for another batch of requests. The staging
+  // and input buffers of the previous batch are released, but the
+  // containers keep their capacity and the settings of the collector,
+  // such as the stats or the residency cache, are kept, so a model
+  // instance can keep one collector and, once the sizes of its
+  // batches are steady, collect them without allocating from the
+  // heap, provided the staging buffers are borrowed from a pinned
+  // arena. As for destroying the collector, it must not be reset
+  // before the synchronization described in Finalize(). The input
+  // keys given to SetResidentInputKey() are cleared as they belong to
+  // the previous batch.
+  void Reset(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<TRITONBACKEND_Response*>* responses);
+
+  // Gather the inputs in parallel using the threads of 'thread_pool'
+  // when both the request buffers and the tensor buffer are in CPU
+  // memory. The copies of a tensor are split across the threads only
+  // if the tensor has at least 'min_byte_size' bytes to gather in CPU
+  // memory, smaller tensors are gathered by the calling thread. Passing
+  // a nullptr 'thread_pool' disables parallel gather, which is the
+  // default.
+  void SetParallelGather(
+      BackendThreadPool* thread_pool, const size_t min_byte_size)
+  {
+    gather_thread_pool_ = thread_pool;
+    gather_min_byte_size_ = min_byte_size;
+  }
+
+  // Copy the request buffers that are in the same GPU as the tensor
+  // buffer with a single kernel launch, instead of one cudaMemcpyAsync
+  // per request buffer, when a tensor has at least
+  // 'request_buffer_threshold' such request buffers. A value of 0
+  // disables the copy kernel, which is the default. Has no effect if
+  // GPU support is disabled.
+  void SetCopyKernelThreshold(const size_t request_buffer_threshold)
+  {
+    copy_kernel_threshold_ = request_buffer_threshold;
+  }
+
+  // Issue the copies between pinned CPU memory and the GPU, and within
+  // the GPU, of each tensor collected by ProcessTensor() and of the
+  // tensors collected by ProcessTensors() as a single launch of a CUDA
+  // graph of 'copy_graph', see BackendModelInstance::InputCopyGraph().
+  // Passing a nullptr 'copy_graph', the default, issues each copy with
+  // cudaMemcpyAsync.
+  // Has no effect if GPU support is disabled.
+  void SetCopyGraph(BackendCopyGraph* copy_graph) { copy_graph_ = copy_graph; }
+
+  // Report the stage latencies, the bytes copied and the zero-copy
+  // and pinned memory outcomes of this collector to 'stats'. Nothing
+  // is reported unless built with TRITON_ENABLE_STATS.
+  void SetStats(BackendCopyStats* stats) { stats_ = stats; }
+
+  // Let 'policy' decide for each tensor collected by ProcessTensor()
+  // and ProcessTensors() whether the request buffers are staged
+  // through a pinned buffer, from the number of request buffers and
+  // the byte size of the tensor, and report the duration of the copies
+  // of this collector to it, see BackendModelInstance::PinnedPolicy().
+  // The decisions are counted in the stats given to SetStats(). Has no
+  // effect if pinned memory is not enabled for this collector. Passing
+  // a nullptr 'policy', the default, stages all the tensors that can
+  // be staged.
+  void SetPinnedPolicy(BackendPinnedPolicy* policy)
+  {
+    pinned_policy_ = policy;
+  }
+
+  // Keep the inputs cached by 'cache' resident on its GPU across
+  // batches. When ProcessTensor() is asked for a contiguous buffer of
+  // such an input that can be on the GPU of 'cache', and the batch has
+  // the same input as a previous batch, the cached copy is returned
+  // instead of copying the input to the GPU again. Inputs are
+  // identified by the hash of their contents, and a copy found by hash
+  // is only used once the contents are compared equal to the host copy
+  // kept with it. The contents are hashed and compared on the host so
+  // only inputs in CPU memory are cached, unless an ID is given with
+  // SetResidentInputKey(). The returned copy must not be
+  // modified. Passing nullptr disables the cache, which is the
+  // default.
+  void SetResidencyCache(BackendResidencyCache* cache)
+  {
+    residency_cache_ = cache;
+  }
+
+  // Identify the input named 'input_name' of this batch by 'key'
+  // instead of by the hash of its contents, for example with an ID
+  // supplied by the client, so the input doesn't need to be hashed.
+  // Batches with the same key for an input must have the same
+  // contents for that input.
+  void SetResidentInputKey(
+      const std::string& input_name, const std::string& key)
+  {
+    resident_keys_[input_name] = key;
+  }
+
+  // Order the work submitted to 'compute_stream' after Finalize() is
+  // called after the copies of this collector, using 'event'. Useful
+  // when 'stream' is a dedicated copy stream, see
+  // BackendModelInstance::InputCopyStream(), so that a GPU consumer of
+  // the inputs on 'compute_stream' doesn't need to wait for the copies
+  // on the host. Has no effect if 'compute_stream' is 'stream'.
+  void SetComputeStream(cudaStream_t compute_stream, cudaEvent_t event)
+  {
+    compute_stream_ = compute_stream;
+    compute_event_ = event;
+  }
 
   // Process all requests for a named input tensor.
   void ProcessTensor(
       const char* input_name, char* buffer, const size_t buffer_byte_size,
       const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id);
 
+  // An input tensor processed by ProcessTensors() and the buffer that
+  // the input is collected into.
+  struct InputTensor {
+    InputTensor(
+        const char* input_name, char* buffer, const size_t buffer_byte_size,
+        const TRITONSERVER_MemoryType memory_type,
+        const int64_t memory_type_id)
+        : input_name_(input_name), buffer_(buffer),
+          buffer_byte_size_(buffer_byte_size), memory_type_(memory_type),
+          memory_type_id_(memory_type_id)
+    {
+    }
+
+    const char* input_name_;
+    char* buffer_;
+    size_t buffer_byte_size_;
+    TRITONSERVER_MemoryType memory_type_;
+    int64_t memory_type_id_;
+  };
+
+  // Process all requests for several input tensors. This is equivalent
+  // to calling ProcessTensor() for each of 'tensors' but the requests
+  // are only walked once and the input properties of each request are
+  // only queried once. The inputs of all 'tensors' that need to be
+  // staged through pinned memory share a single pinned buffer, and
+  // inputs whose destinations are adjacent, for example tensors placed
+  // back to back in one device allocation, are transferred to the
+  // destination with a single copy.
+  void ProcessTensors(const std::vector<InputTensor>& tensors);
+
   // Process all requests for a named input tensor and returns the contiguous
   // buffer of the input tensor. This overload of the function can avoid data
   // copy if the input buffer is already contiguous and the caller doesn't
@@ -91,6 +248,122 @@ class BackendInputCollector {
       const char** dst_buffer, size_t* dst_buffer_byte_size,
       TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id);
 
+  // A conversion applied to an input while it is gathered. Each
+  // element is cast to 'datatype_', which must be TYPE_FP32 or
+  // TYPE_FP16, as 'element * scale_ + bias_'. If 'nhwc_to_nchw_' is
+  // true each batch item is an image of 'height_' x 'width_' x
+  // 'channels_' elements in NHWC layout that is also transposed to
+  // NCHW layout.
+  struct InputConversion {
+    InputConversion()
+        : datatype_(TRITONSERVER_TYPE_FP32), scale_(1.0f), bias_(0.0f),
+          nhwc_to_nchw_(false), height_(0), width_(0), channels_(0)
+    {
+    }
+
+    TRITONSERVER_DataType datatype_;
+    float scale_;
+    float bias_;
+    bool nhwc_to_nchw_;
+    int64_t height_;
+    int64_t width_;
+    int64_t channels_;
+  };
+
+  // Process all requests for a named input tensor and convert it as
+  // described by 'conversion'. The input must have the same data type
+  // in all requests, one of UINT8, INT8, INT16, INT32, FP16 or FP32. A
+  // request whose input can't be converted gets an error response and
+  // its entry of 'responses' is set to nullptr, the other requests of
+  // the batch are still converted.
+  // If the returned buffer is in GPU memory and the conversion widens
+  // the elements, the narrower unconverted elements are gathered to
+  // the GPU and converted there with a single kernel launch.
+  // Otherwise the elements are converted on the host as they are
+  // gathered, through a host staging buffer if the returned buffer is
+  // in GPU memory, so that a narrowing conversion also reduces the
+  // bytes copied to the GPU. 'buffer', 'buffer_byte_size',
+  // 'allowed_input_types' and the returned values have the same
+  // meaning as for ProcessBatchInput().
+  TRITONSERVER_Error* ProcessTensor(
+      const char* input_name, const InputConversion& conversion,
+      char* buffer, const size_t buffer_byte_size,
+      const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+          allowed_input_types,
+      const char** dst_buffer, size_t* dst_buffer_byte_size,
+      TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id);
+
+  // Process all requests for a named BYTES input tensor. The
+  // length-prefixed string elements of every request are gathered back
+  // to back, with the length prefixes removed, into a single contiguous
+  // buffer that is managed by the BackendInputCollector object and has
+  // the same lifecycle as the BackendInputCollector object. If the
+  // returned buffer is in GPU memory the elements are gathered into a
+  // host staging buffer and transferred with a single copy.
+  // 'allowed_input_types' is the ordered list of the memory type and id
+  //   pairs that the returned buffer can be.
+  // 'dst_buffer' returns the contiguous string data of the input tensor.
+  // 'dst_buffer_byte_size' returns the byte size of the string data.
+  // 'dst_memory_type' returns the memory type of 'dst_buffer'.
+  // 'dst_memory_type_id' returns the memory type id of 'dst_buffer'.
+  // 'offsets' returns the element count of the batch plus one offsets into
+  //   'dst_buffer', element 'i' occupies [offsets[i], offsets[i + 1]). The
+  //   elements of a request that fails to be processed are returned as
+  //   empty strings so that the element indices still match the batch.
+  TRITONSERVER_Error* ProcessBytesTensor(
+      const char* input_name,
+      const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+          allowed_input_types,
+      const char** dst_buffer, size_t* dst_buffer_byte_size,
+      TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id,
+      std::vector<uint64_t>* offsets);
+
+  // Return the shape of the tensor that ProcessBatchInput() generates
+  // for 'batch_input' from the requests of this collector.
+  TRITONSERVER_Error* BatchInputShape(
+      const BatchInput& batch_input, std::vector<int64_t>* shape);
+
+  // Process all requests to generate the tensor for 'batch_input'.
+  // ProcessTensor() concatenates the requests of an input back to back
+  // with no padding, so for inputs that allow ragged batches a batch
+  // input such as BATCH_ACCUMULATED_ELEMENT_COUNT_WITH_ZERO describes
+  // where each request lives in the packed input. 'buffer',
+  // 'buffer_byte_size', 'allowed_input_types' and the returned values
+  // have the same meaning as for the ProcessTensor() overload that
+  // returns the contiguous buffer of an input tensor.
+  TRITONSERVER_Error* ProcessBatchInput(
+      const BatchInput& batch_input, char* buffer,
+      const size_t buffer_byte_size,
+      const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+          allowed_input_types,
+      const char** dst_buffer, size_t* dst_buffer_byte_size,
+      TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id);
+
+  // Generate the tensor mapped to sequence batcher control 'kind',
+  // described by 'control', for a batch of 'slot_count' sequence
+  // slots. The requests of this collector occupy the first slots and
+  // the remaining slots are not ready. The tensor has shape
+  // [ slot_count, 1 ]: for START and END each slot holds the true
+  // value if the request has the corresponding sequence flag, for
+  // READY each occupied slot holds the true value, and for CORRID
+  // each slot holds the correlation ID of the request, or 0. A
+  // request whose flags or correlation ID can't be read gets an error
+  // response and its slot holds the false value, or 0. The values are
+  // filled a run of slots at a time on the host and, if
+  // the tensor is in GPU memory, staged in pinned memory and copied on
+  // the stream of the collector. 'slot_count' must not be less than
+  // the request count. 'buffer', 'buffer_byte_size',
+  // 'allowed_input_types' and the returned values have the same
+  // meaning as for ProcessBatchInput().
+  TRITONSERVER_Error* ProcessSequenceControl(
+      const BackendModelConfig::ControlKind kind,
+      const BackendModelConfig::SequenceControl& control,
+      const size_t slot_count, char* buffer, const size_t buffer_byte_size,
+      const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+          allowed_input_types,
+      const char** dst_buffer, size_t* dst_buffer_byte_size,
+      TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id);
+
   // Finalize processing of all requests for all input tensors. Return
   // true if cudaMemcpyAsync is called, and the caller should call
   // should call cudaStreamSynchronize (or cudaEventSynchronize on 'event')
@@ -105,6 +378,120 @@ class BackendInputCollector {
   bool GetInputBufferIfContiguous(
       const char* input_name, const char** buffer, size_t* buffer_byte_size,
       TRITONSERVER_MemoryType* memory_type, int64_t* memory_type_id);
+  TRITONSERVER_Error* BatchInputValues(
+      const BatchInput& batch_input, std::vector<int64_t>* values,
+      std::vector<int64_t>* shape);
+  TRITONSERVER_Error* ProcessGeneratedTensor(
+      const std::string& name, const char* tensor_kind,
+      const size_t byte_size,
+      const std::function<TRITONSERVER_Error*(char*)>& generate, char* buffer,
+      const size_t buffer_byte_size,
+      const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+          allowed_input_types,
+      const char** dst_buffer, size_t* dst_buffer_byte_size,
+      TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id);
+  TRITONSERVER_Error* AcquireTensorBuffer(
+      const std::string& name, const char* tensor_kind,
+      const size_t byte_size, char* buffer, const size_t buffer_byte_size,
+      const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+          allowed_input_types,
+      const char** dst_buffer, size_t* dst_buffer_byte_size,
+      TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id);
+  TRITONSERVER_Error* WriteGeneratedTensor(
+      const std::string& name, const size_t byte_size,
+      const std::function<TRITONSERVER_Error*(char*)>& generate, char* buffer,
+      const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id);
+  // Get in 'host_buffer' the host buffer to generate the values of a
+  // tensor in 'buffer' into, a staging buffer if the tensor is in GPU
+  // memory, and copy the values to the tensor once generated.
+  TRITONSERVER_Error* HostGeneratedBuffer(
+      const size_t byte_size, char* buffer,
+      const TRITONSERVER_MemoryType memory_type, char** host_buffer,
+      TRITONSERVER_MemoryType* host_memory_type);
+  TRITONSERVER_Error* CopyGeneratedBuffer(
+      const std::string& name, const size_t byte_size, char* host_buffer,
+      const TRITONSERVER_MemoryType host_memory_type, char* buffer,
+      const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id);
+  TRITONSERVER_Error* ConvertRequestInputs(
+      const char* input_name, const TRITONSERVER_DataType src_datatype,
+      const InputConversion& conversion, char* host_buffer);
+  TRITONSERVER_Error* AllocateStagingBuffer(
+      const size_t byte_size, const bool allow_cpu, char** buffer,
+      TRITONSERVER_MemoryType* memory_type);
+  TRITONSERVER_Error* AllocateInputBuffer(
+      const char* input_name, const size_t byte_size,
+      const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+          allowed_input_types,
+      BackendMemory** backend_memory);
+  void CollectInputBuffers(
+      TRITONBACKEND_Input* request_input, const uint32_t buffer_count,
+      const InputTensor& tensor, const size_t tensor_buffer_offset,
+      const TRITONSERVER_MemoryType use_pinned_memory_type,
+      TRITONBACKEND_Response** response);
+  bool ProcessResidentTensor(
+      const char* input_name, const size_t byte_size,
+      const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+          allowed_input_types,
+      const char** dst_buffer, TRITONSERVER_MemoryType* dst_memory_type,
+      int64_t* dst_memory_type_id);
+  bool ResidentInputBuffers(const char* input_name, const size_t byte_size);
+  bool FlushStagedCopies(const bool to_gpu);
+  void FlushPendingHostCopies();
+  void RecordCopy(
+      const TRITONSERVER_MemoryType src_memory_type,
+      const TRITONSERVER_MemoryType dst_memory_type, const size_t byte_size)
+  {
+#ifdef TRITON_ENABLE_STATS
+    if (stats_ != nullptr) {
+      stats_->RecordCopy(src_memory_type, dst_memory_type, byte_size);
+    }
+#endif  // TRITON_ENABLE_STATS
+  }
+  void RecordPinnedFallback()
+  {
+#ifdef TRITON_ENABLE_STATS
+    if (stats_ != nullptr) {
+      stats_->RecordPinnedFallback();
+    }
+#endif  // TRITON_ENABLE_STATS
+  }
+  void RecordPinnedDecision(const bool staged)
+  {
+#ifdef TRITON_ENABLE_STATS
+    if (stats_ != nullptr) {
+      stats_->RecordPinnedDecision(staged);
+    }
+#endif  // TRITON_ENABLE_STATS
+  }
+  TRITONSERVER_MemoryType ApplyPinnedPolicy(
+      const TRITONSERVER_MemoryType use_pinned_memory_type,
+      const size_t byte_size);
+  BackendPinnedPolicy* TransferPolicy(
+      const TRITONSERVER_MemoryType src_memory_type,
+      const TRITONSERVER_MemoryType dst_memory_type) const
+  {
+    return BackendPinnedPolicy::IsTransfer(src_memory_type, dst_memory_type)
+               ? pinned_policy_
+               : nullptr;
+  }
+  bool FlushPendingKernelCopies();
+  TRITONSERVER_Error* IssueCopy(
+      const char* msg, const TRITONSERVER_MemoryType src_memory_type,
+      const int64_t src_memory_type_id,
+      const TRITONSERVER_MemoryType dst_memory_type,
+      const int64_t dst_memory_type_id, const size_t byte_size,
+      const void* src, void* dst, bool* cuda_used);
+  TRITONSERVER_Error* IssueCopyBetweenGpus(
+      const char* msg, const int64_t src_device_id,
+      const int64_t dst_device_id, const size_t byte_size, const void* src,
+      void* dst, bool* cuda_used);
+  bool LaunchCopyGraph();
+  bool FlushQueuedCopies();
+  bool UseCopyKernel(
+      const TRITONSERVER_MemoryType src_memory_type,
+      const int64_t src_memory_type_id,
+      const TRITONSERVER_MemoryType tensor_memory_type,
+      const int64_t tensor_memory_type_id) const;
   bool FlushPendingPinned(
       char* tensor_buffer, const size_t tensor_buffer_byte_size,
       const TRITONSERVER_MemoryType tensor_memory_type,
@@ -116,42 +503,154 @@ class BackendInputCollector {
       const int64_t tensor_memory_type_id,
       const TRITONSERVER_MemoryType use_pinned_memory_type,
       TRITONBACKEND_Response** response);
+  TRITONSERVER_Error* SetBytesInputTensor(
+      TRITONBACKEND_Input* request_input, const uint32_t buffer_count,
+      const int64_t element_count, char* data_buffer,
+      const size_t data_buffer_byte_size, size_t* data_offset,
+      std::vector<uint64_t>* offsets);
+  void ReleaseBatchMemories();
 
   bool need_sync_;
   TRITONBACKEND_Request** requests_;
-  const uint32_t request_count_;
+  uint32_t request_count_;
   std::vector<TRITONBACKEND_Response*>* responses_;
   TRITONBACKEND_MemoryManager* memory_manager_;
   const bool pinned_enabled_;
   cudaStream_t stream_;
   cudaEvent_t event_;
+  BackendPinnedArena* pinned_arena_;
 
   using RequestsList =
-      std::list<std::pair<TRITONBACKEND_Response**, TRITONBACKEND_Input*>>;
+      std::vector<std::pair<TRITONBACKEND_Response**, TRITONBACKEND_Input*>>;
 
   size_t pending_pinned_byte_size_;
   size_t pending_pinned_offset_;
   RequestsList pending_pinned_inputs_;
 
+  BackendThreadPool* gather_thread_pool_;
+  size_t gather_min_byte_size_;
+
+  // CPU to CPU copies that are delayed so that they can be performed
+  // in parallel by FlushPendingHostCopies().
+  struct HostCopy {
+    HostCopy(const char* src, char* dst, const size_t byte_size)
+        : src_(src), dst_(dst), byte_size_(byte_size)
+    {
+    }
+
+    const char* src_;
+    char* dst_;
+    size_t byte_size_;
+  };
+
+  size_t pending_host_byte_size_;
+  std::vector<HostCopy> pending_host_copies_;
+  // The chunks of 'pending_host_copies_' shared among the threads,
+  // kept so that its capacity is reused by each flush.
+  std::vector<HostCopy> host_copy_chunks_;
+
+  // Request input buffers collected by ProcessTensors() that are
+  // copied to the tensors through a shared pinned buffer.
+  struct StagedCopy {
+    StagedCopy(
+        const char* src, const TRITONSERVER_MemoryType src_memory_type,
+        const int64_t src_memory_type_id, char* dst,
+        const TRITONSERVER_MemoryType dst_memory_type,
+        const int64_t dst_memory_type_id, const size_t byte_size,
+        TRITONBACKEND_Response** response, TRITONBACKEND_Input* request_input)
+        : src_(src), src_memory_type_(src_memory_type),
+          src_memory_type_id_(src_memory_type_id), dst_(dst),
+          dst_memory_type_(dst_memory_type),
+          dst_memory_type_id_(dst_memory_type_id), byte_size_(byte_size),
+          response_(response), request_input_(request_input)
+    {
+    }
+
+    const char* src_;
+    TRITONSERVER_MemoryType src_memory_type_;
+    int64_t src_memory_type_id_;
+    char* dst_;
+    TRITONSERVER_MemoryType dst_memory_type_;
+    int64_t dst_memory_type_id_;
+    size_t byte_size_;
+    TRITONBACKEND_Response** response_;
+    TRITONBACKEND_Input* request_input_;
+  };
+
+  std::vector<StagedCopy> staged_h2d_copies_;
+  std::vector<StagedCopy> staged_d2h_copies_;
+
+  // GPU to GPU copies that are delayed so that they can be performed
+  // by a single kernel launch in FlushPendingKernelCopies().
+  size_t copy_kernel_threshold_;
+  std::vector<StagedCopy> pending_kernel_copies_;
+
+  // The graph the copies of ProcessTensor() are queued to.
+  BackendCopyGraph* copy_graph_;
+
+  BackendCopyStats* stats_;
+  BackendPinnedPolicy* pinned_policy_;
+
+  cudaStream_t compute_stream_;
+  cudaEvent_t compute_event_;
+
+  // The residency cache, the inputs identified by key instead of by
+  // hash, and the cached copies used by this batch.
+  BackendResidencyCache* residency_cache_;
+  std::unordered_map<std::string, std::string> resident_keys_;
+  std::vector<std::shared_ptr<BackendMemory>> resident_memories_;
+  // The host buffers of the input being looked up in the residency
+  // cache, a member so that its storage is reused.
+  std::vector<std::pair<const char*, size_t>> resident_buffers_;
+
+  // The offset in the tensor of the elements of each request of the
+  // input being converted, and the host buffers of the requests that
+  // the elements are converted from, members so that their storage is
+  // reused.
+  struct ConvertSource {
+    ConvertSource(
+        const size_t request_index, const char* buffer, const size_t byte_size)
+        : request_index_(request_index), buffer_(buffer),
+          byte_size_(byte_size)
+    {
+    }
+    size_t request_index_;
+    const char* buffer_;
+    size_t byte_size_;
+  };
+  std::vector<size_t> convert_element_offsets_;
+  std::vector<ConvertSource> convert_sources_;
+
+  // The value of each request for the sequence control tensor being
+  // generated, reused across ProcessSequenceControl() calls.
+  std::vector<uint64_t> sequence_control_values_;
+
   // managed memories that need to live over the lifetime of this
   // BackendInputCollector object.
-  std::list<std::unique_ptr<BackendMemory>> backend_memories_;
+  std::vector<std::unique_ptr<BackendMemory>> backend_memories_;
+
+  // Staging buffers borrowed from 'pinned_arena_' that are returned
+  // when this BackendInputCollector object is destroyed.
+  std::vector<BackendMemory*> arena_memories_;
 
   // Pinned memory buffers and the corresponding request_inputs where
   // the final copy to the tensor is deferred until Finalize() after
-  // waiting for all in-flight copies.
+  // waiting for all in-flight copies. The request inputs of a buffer
+  // are [requests_begin_, requests_end_) of 'deferred_inputs_'.
   struct DeferredPinned {
     DeferredPinned(
         char* pinned_memory, const size_t pinned_memory_size,
         char* tensor_buffer, const size_t tensor_buffer_offset,
         const TRITONSERVER_MemoryType tensor_memory_type,
-        const int64_t tensor_memory_id, RequestsList&& requests)
+        const int64_t tensor_memory_id, const size_t requests_begin,
+        const size_t requests_end)
         : pinned_memory_(pinned_memory),
           pinned_memory_size_(pinned_memory_size),
           tensor_buffer_(tensor_buffer),
           tensor_buffer_offset_(tensor_buffer_offset),
           tensor_memory_type_(tensor_memory_type),
-          tensor_memory_id_(tensor_memory_id), requests_(std::move(requests))
+          tensor_memory_id_(tensor_memory_id), requests_begin_(requests_begin),
+          requests_end_(requests_end)
     {
     }
 
@@ -163,10 +662,12 @@ class BackendInputCollector {
     const size_t tensor_buffer_offset_;
     const TRITONSERVER_MemoryType tensor_memory_type_;
     const int64_t tensor_memory_id_;
-    RequestsList requests_;
+    const size_t requests_begin_;
+    const size_t requests_end_;
   };
 
-  std::list<DeferredPinned> deferred_pinned_;
+  std::vector<DeferredPinned> deferred_pinned_;
+  RequestsList deferred_inputs_;
 };
 
 }}  // namespace triton::backend
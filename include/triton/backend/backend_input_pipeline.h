@@ -0,0 +1,194 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "triton/backend/backend_input_collector.h"
+#include "triton/backend/backend_memory.h"
+#include "triton/backend/backend_model_instance.h"
+#include "triton/core/tritonbackend.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend {
+
+//
+// BackendInputPipeline
+//
+// Overlap the input collection of the next batch with the execution
+// of the current batch. The pipeline holds a fixed number of stages
+// (two by default, ping-pong) that are used in turn. Each stage owns
+// a BackendInputCollector and the input buffers that its batch is
+// collected into, which are kept and reused by the later batches of
+// the stage. The copies are issued on the
+// instance's stream and each stage records events on it so that:
+//
+//   - the execution of a batch can wait for its input copies without
+//     blocking the host, see BackendInputPipeline::Stage::WaitReady().
+//
+//   - a stage is only reused once the execution that read its input
+//     buffers is complete, see BackendInputPipeline::Stage::Release().
+//
+// A typical use collects batch N + 1 with BeginBatch() and Submit()
+// while batch N is still executing on the GPU:
+//
+//   BackendInputPipeline::Stage* stage;
+//   RETURN_IF_ERROR(pipeline->BeginBatch(
+//       requests, request_count, &responses, &stage));
+//   RETURN_IF_ERROR(stage->InputBuffer(
+//       "INPUT0", byte_size, TRITONSERVER_MEMORY_GPU, device_id, &buffer));
+//   stage->Collector()->ProcessTensor(
+//       "INPUT0", buffer, byte_size, TRITONSERVER_MEMORY_GPU, device_id);
+//   RETURN_IF_ERROR(stage->Submit());
+//   RETURN_IF_ERROR(stage->WaitReady(execution_stream));
+//   ... enqueue the execution on 'execution_stream' ...
+//   RETURN_IF_ERROR(stage->Release(execution_stream));
+//
+// The pipeline is not thread-safe, all the stages are expected to be
+// driven by the thread that executes the model instance.
+//
+class BackendInputPipeline {
+ public:
+  class Stage {
+   public:
+    ~Stage();
+
+    // The collector of the batch held by the stage. The stage keeps
+    // one collector that is reset by each
+    // BackendInputPipeline::BeginBatch(), so the settings of the
+    // collector, such as SetStats(), are kept across the batches
+    // of the stage. Valid once the stage has been begun.
+    BackendInputCollector* Collector() { return collector_.get(); }
+
+    // Return a buffer of at least 'byte_size' bytes in the given memory
+    // type and id that the input 'name' of the batch can be collected
+    // into. The buffer belongs to the stage and is reused by the later
+    // batches of the stage, it is only reallocated when a larger buffer
+    // is needed.
+    TRITONSERVER_Error* InputBuffer(
+        const std::string& name, const size_t byte_size,
+        const TRITONSERVER_MemoryType memory_type,
+        const int64_t memory_type_id, char** buffer);
+
+    // Finish the collection of the batch. Any deferred copies are
+    // performed and the ready event of the stage is recorded on the
+    // stream after all the input copies of the batch.
+    TRITONSERVER_Error* Submit();
+
+    // Return true if all the input copies of the submitted batch have
+    // completed.
+    bool IsReady();
+
+    // Make 'stream' wait for the input copies of the submitted batch
+    // without blocking the calling thread. Nothing needs to be done if
+    // 'stream' is the stream of the pipeline.
+    TRITONSERVER_Error* WaitReady(cudaStream_t stream);
+
+    // Block the calling thread until all the input copies of the
+    // submitted batch have completed.
+    TRITONSERVER_Error* SynchronizeReady();
+
+    // Record a consumed event on 'stream', typically the stream of the
+    // execution, so that the input buffers of the batch are only
+    // reused once both the input copies and the work currently
+    // enqueued on 'stream' complete. If not called the stage is reused
+    // once its input copies complete.
+    TRITONSERVER_Error* Release(cudaStream_t stream);
+
+   private:
+    friend class BackendInputPipeline;
+    Stage(BackendInputPipeline* pipeline)
+        : pipeline_(pipeline), ready_event_(nullptr),
+          consumed_event_(nullptr), consumed_(false), begun_(false)
+    {
+    }
+
+    // Wait until the previous batch of the stage is no longer using
+    // the stage.
+    TRITONSERVER_Error* Wait();
+
+    BackendInputPipeline* pipeline_;
+    cudaEvent_t ready_event_;
+    cudaEvent_t consumed_event_;
+    bool consumed_;
+    bool begun_;
+    std::unique_ptr<BackendInputCollector> collector_;
+    std::unordered_map<std::string, std::unique_ptr<BackendMemory>> buffers_;
+  };
+
+  // Create a pipeline for 'instance' with 'stage_count' stages. The
+  // copies are issued on the input copy stream of the instance (see
+  // BackendModelInstance::InputCopyStream()) and the pinned staging
+  // buffers are borrowed from the pinned arena of the instance.
+  static TRITONSERVER_Error* Create(
+      BackendModelInstance* instance, const size_t stage_count,
+      std::unique_ptr<BackendInputPipeline>* pipeline);
+
+  // Create a pipeline with 'stage_count' stages that issues the copies
+  // on 'stream'. 'pinned_arena' is optional.
+  static TRITONSERVER_Error* Create(
+      TRITONBACKEND_MemoryManager* memory_manager, const bool pinned_enabled,
+      cudaStream_t stream, BackendPinnedArena* pinned_arena,
+      const size_t stage_count, std::unique_ptr<BackendInputPipeline>* pipeline);
+
+  ~BackendInputPipeline() = default;
+
+  // Begin the collection of a batch in the next stage of the pipeline.
+  // The call blocks until the batch that previously used the stage is
+  // released. 'requests' and 'responses' must remain valid until the
+  // next time the returned stage is begun, or until the pipeline is
+  // destroyed.
+  TRITONSERVER_Error* BeginBatch(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<TRITONBACKEND_Response*>* responses, Stage** stage);
+
+  // The stream the input copies are issued on.
+  cudaStream_t Stream() const { return stream_; }
+
+ private:
+  BackendInputPipeline(
+      TRITONBACKEND_MemoryManager* memory_manager, const bool pinned_enabled,
+      cudaStream_t stream, BackendPinnedArena* pinned_arena)
+      : memory_manager_(memory_manager), pinned_enabled_(pinned_enabled),
+        stream_(stream), pinned_arena_(pinned_arena), next_stage_(0)
+  {
+  }
+
+  TRITONBACKEND_MemoryManager* memory_manager_;
+  const bool pinned_enabled_;
+  cudaStream_t stream_;
+  BackendPinnedArena* pinned_arena_;
+
+  size_t next_stage_;
+  std::vector<std::unique_ptr<Stage>> stages_;
+};
+
+}}  // namespace triton::backend
@@ -30,8 +30,16 @@
 #include "triton/core/tritonbackend.h"
 #include "triton/core/tritonserver.h"
 
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
 namespace triton { namespace backend {
 
+#ifndef TRITON_ENABLE_GPU
+using cudaStream_t = void*;
+#endif  // !TRITON_ENABLE_GPU
+
 //
 // BackendMemory
 //
@@ -40,7 +48,22 @@ namespace triton { namespace backend {
 //
 class BackendMemory {
  public:
-  enum class AllocationType { CPU, CPU_PINNED, GPU, CPU_PINNED_POOL, GPU_POOL };
+  enum class AllocationType {
+    CPU,
+    CPU_PINNED,
+    GPU,
+    CPU_PINNED_POOL,
+    GPU_POOL,
+    CPU_PINNED_CACHED,
+    GPU_CACHED,
+    GPU_ASYNC,
+    CPU_NUMA,
+    CPU_PINNED_NUMA
+  };
+
+  // The default total byte size of the idle blocks kept by the cache
+  // used for the CACHED allocation types.
+  static constexpr size_t kDefaultCacheHighWaterMark = 256 * 1024 * 1024;
 
   // Allocate a contiguous block of 'alloc_type' memory.  'mem'
   // returns the pointer to the allocated memory.
@@ -49,6 +72,37 @@ class BackendMemory {
   // TRITONBACKEND_MemoryManagerAllocate. Note that CPU_PINNED and GPU
   // allocations can be much slower than the POOL variants.
   //
+  // CPU_PINNED_CACHED and GPU_CACHED are allocated from a cache of
+  // pinned and GPU blocks kept by this library. Blocks are rounded up
+  // to a size class and a freed block is kept for reuse instead of
+  // being released. Each thread keeps a small number of idle blocks
+  // of each size class that it can reuse without locking, the other
+  // idle blocks are shared by all threads. Blocks are allocated with
+  // cudaHostAlloc and cudaMalloc when the cache has none to reuse. The
+  // memory is assumed to be used by work on the stream given to
+  // Create(), and a freed block is only reused once the work submitted
+  // to that stream before the free is done, or, for a GPU block, by
+  // memory of the same stream. The idle blocks are not released at
+  // process exit, as CUDA may be torn down before the thread and
+  // static destructors run; call TrimCache() to release them, for
+  // example when the backend is finalized.
+  //
+  // GPU_ASYNC is allocated with cudaMallocAsync from the default
+  // memory pool of the device and freed with cudaFreeAsync, both
+  // ordered on the stream given to Create(). Unlike GPU it doesn't
+  // synchronize with the work in flight on the device. The memory
+  // must only be used by work ordered after the allocation on that
+  // stream, and the stream must outlive the BackendMemory object. It
+  // requires CUDA 11.2 and a device that supports memory pools, or
+  // else fails with TRITONSERVER_ERROR_UNSUPPORTED.
+  //
+  // CPU_NUMA and CPU_PINNED_NUMA are page aligned CPU and pinned
+  // allocations whose pages are placed on the NUMA node given by
+  // 'memory_type_id', typically the node of the GPU the memory is
+  // copied to or from (see GpuNumaNode()). As for the other CPU
+  // allocation types, MemoryTypeId() of the allocated memory is 0.
+  // They are only supported on Linux.
+  //
   // Two error codes have specific interpretations for this function:
   //
   //   TRITONSERVER_ERROR_UNSUPPORTED: Indicates that function is
@@ -65,6 +119,15 @@ class BackendMemory {
       const int64_t memory_type_id, const size_t byte_size,
       BackendMemory** mem);
 
+  // Allocate a contiguous block of 'alloc_type' memory. The GPU_ASYNC
+  // allocation is ordered on 'stream', and the CACHED allocation types
+  // order the reuse of the memory after the work on 'stream', the
+  // other allocation types ignore it.
+  static TRITONSERVER_Error* Create(
+      TRITONBACKEND_MemoryManager* manager, const AllocationType alloc_type,
+      const int64_t memory_type_id, const size_t byte_size,
+      cudaStream_t stream, BackendMemory** mem);
+
   // Allocate a contiguous block of memory by attempting the
   // allocation using 'alloc_types' in order until one is successful.
   // See BackendMemory::Create() above for details.
@@ -73,6 +136,11 @@ class BackendMemory {
       const std::vector<AllocationType>& alloc_types,
       const int64_t memory_type_id, const size_t byte_size,
       BackendMemory** mem);
+  static TRITONSERVER_Error* Create(
+      TRITONBACKEND_MemoryManager* manager,
+      const std::vector<AllocationType>& alloc_types,
+      const int64_t memory_type_id, const size_t byte_size,
+      cudaStream_t stream, BackendMemory** mem);
 
   ~BackendMemory();
 
@@ -88,12 +156,30 @@ class BackendMemory {
   static TRITONSERVER_MemoryType AllocTypeToMemoryType(const AllocationType a);
   static const char* AllocTypeString(const AllocationType a);
 
+  // Set the bound on the total byte size of the idle blocks shared by
+  // all threads in the cache of the CACHED allocation types. A block
+  // freed when the bound would be exceeded is released. Setting a
+  // lower bound immediately releases idle blocks until it is met.
+  static void SetCacheHighWaterMark(const size_t byte_size);
+
+  // Release the idle blocks of the calling thread and the idle blocks
+  // shared by all threads until at most 'byte_size' bytes of shared
+  // idle blocks remain. The idle blocks of other threads are released
+  // to the shared blocks when those threads exit. Also releases the
+  // unused memory of the device memory pools used by GPU_ASYNC.
+  static void TrimCache(const size_t byte_size = 0);
+
+  // The total byte size of the idle blocks shared by all threads in
+  // the cache of the CACHED allocation types.
+  static size_t CachedByteSize();
+
  private:
   BackendMemory(
       TRITONBACKEND_MemoryManager* manager, const AllocationType alloctype,
-      const int64_t memtype_id, char* buffer, const size_t byte_size)
+      const int64_t memtype_id, char* buffer, const size_t byte_size,
+      cudaStream_t stream)
       : manager_(manager), alloctype_(alloctype), memtype_id_(memtype_id),
-        buffer_(buffer), byte_size_(byte_size)
+        buffer_(buffer), byte_size_(byte_size), stream_(stream)
   {
   }
 
@@ -102,6 +188,7 @@ class BackendMemory {
   int64_t memtype_id_;
   char* buffer_;
   size_t byte_size_;
+  cudaStream_t stream_;
 };
 
 }}  // namespace triton::backend
@@ -25,8 +25,16 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include "triton/backend/backend_common.h"
+#include "triton/backend/backend_model_config.h"
+#include "triton/backend/backend_resource_registry.h"
+#include "triton/backend/backend_thread_pool.h"
 #include "triton/core/tritonbackend.h"
 #include "triton/core/tritonserver.h"
 
@@ -38,6 +46,13 @@ namespace triton { namespace backend {
 // Common functionality for a backend model. This class is provided as
 // a convenience; backends are not required to use this class.
 //
+// The instances of a model share its BackendModel object and can
+// execute concurrently. Once the model is loaded, that is once the
+// configuration is no longer changed, all the const functions, as
+// well as MaxBatchSize(), SupportsFirstDimBatching(),
+// ArtifactFilename() and Resources(), are thread-safe and don't
+// serialize the instances.
+//
 class BackendModel {
  public:
   BackendModel(TRITONBACKEND_Model* triton_model);
@@ -60,28 +75,122 @@ class BackendModel {
   uint64_t Version() const { return version_; }
   const std::string& RepositoryPath() const { return repository_path_; }
 
-  // The model configuration.
+  // The model configuration. The JSON value is not thread-safe. The
+  // mutable overload is meant to change the configuration while the
+  // model is loaded, for example to auto-complete it, and must not be
+  // used once instances execute. Code on the request path should use
+  // ParsedModelConfig(), or else read the const overload through a
+  // const BackendModel.
   common::TritonJson::Value& ModelConfig() { return model_config_; }
+  const common::TritonJson::Value& ModelConfig() const
+  {
+    return model_config_;
+  }
+
+  // The typed view of the model configuration, parsed when the model
+  // is created. Use it instead of ModelConfig() to look up inputs,
+  // outputs, sequence controls and parameters on the request path. A
+  // backend that changes ModelConfig(), for example to auto-complete
+  // the configuration, must call ReparseModelConfig() before creating
+  // any instance of the model. ReparseModelConfig() is load-time only,
+  // calling it once instances execute invalidates the references
+  // returned by ParsedModelConfig().
+  const BackendModelConfig& ParsedModelConfig() const
+  {
+    return *parsed_config_;
+  }
+  TRITONSERVER_Error* ReparseModelConfig();
+
+  // Returns shared ownership of the typed view of the model
+  // configuration, for a caller that needs it to outlive the model.
+  std::shared_ptr<const BackendModelConfig> ParsedModelConfigSnapshot() const
+  {
+    return parsed_config_;
+  }
 
   // Maximum batch size supported by the model. A value of 0
   // indicates that the model does not support batching.
-  int MaxBatchSize() const { return max_batch_size_; }
+  int MaxBatchSize() const
+  {
+    return max_batch_size_.load(std::memory_order_relaxed);
+  }
 
   // Set the max batch size for the model. When a backend
   // auto-completes a configuration it may set or change the maximum
   // batch size.
-  void SetMaxBatchSize(const int b) { max_batch_size_ = b; }
+  void SetMaxBatchSize(const int b)
+  {
+    max_batch_size_.store(b, std::memory_order_relaxed);
+  }
 
   // Does this model support batching in the first dimension. If
   // called before the model is completely loaded this function will
-  // return an error.
+  // return an error. Thread-safe.
   TRITONSERVER_Error* SupportsFirstDimBatching(bool* supports);
 
+  // The resources shared by all the instances of the model, see
+  // BackendResourceRegistry.
+  BackendResourceRegistry* Resources() { return &resources_; }
+
+  // Get in 'filename' the model artifact for compute capability 'cc',
+  // that is the model configuration 'cc_model_filenames' value for
+  // 'cc' or else the 'default_model_filename' value, or the empty
+  // string if neither is specified. The model configuration is parsed
+  // on the first call and the result is shared by all the instances
+  // of the model, so the configuration must not be changed after the
+  // first instance is created. Thread-safe.
+  TRITONSERVER_Error* ArtifactFilename(
+      const std::string& cc, std::string* filename);
+
   // Use indirect pinned memory buffer when copying an input or output
   // tensor to/from the model.
   bool EnablePinnedInput() const { return enable_pinned_input_; }
   bool EnablePinnedOutput() const { return enable_pinned_output_; }
 
+  // The thread pool shared by all the instances of the model to gather
+  // large CPU inputs in parallel, see
+  // BackendInputCollector::SetParallelGather(). The pool is created
+  // when the model configuration parameter
+  // 'parallel_gather_thread_count' is greater than 0, otherwise
+  // nullptr is returned. The model configuration parameter
+  // 'parallel_gather_min_byte_size' sets the minimum byte size of an
+  // input for it to be gathered in parallel, 1 MB by default.
+  BackendThreadPool* GatherThreadPool() { return gather_thread_pool_.get(); }
+  size_t GatherMinByteSize() const { return gather_min_byte_size_; }
+
+  // The minimum number of GPU to GPU copies of a tensor for them to be
+  // performed by a single kernel launch, see
+  // BackendInputCollector::SetCopyKernelThreshold() and
+  // BackendOutputResponder::SetCopyKernelThreshold(). Set by the model
+  // configuration parameter 'copy_kernel_threshold', 0 (disabled) by
+  // default.
+  size_t CopyKernelThreshold() const { return copy_kernel_threshold_; }
+
+  // Whether the GPU instances of the model use dedicated input and
+  // output copy streams, see BackendModelInstance::InputCopyStream().
+  // Set by the model configuration parameter 'separate_copy_streams',
+  // false by default.
+  bool SeparateCopyStreams() const { return separate_copy_streams_; }
+
+  // The inputs that the GPU instances of the model keep resident on
+  // the GPU across batches, and the GPU memory each instance can use
+  // for them, see BackendModelInstance::ResidencyCache(). Set by the
+  // model configuration parameters 'residency_cache_inputs', a comma
+  // separated list of input names, and 'residency_cache_byte_size', 0
+  // (disabled) by default.
+  const std::set<std::string>& ResidencyCacheInputs() const
+  {
+    return residency_cache_inputs_;
+  }
+  size_t ResidencyCacheByteSize() const { return residency_cache_byte_size_; }
+
+  // The smallest number of copies of a tensor that the GPU instances
+  // of the model issue as a CUDA graph launch, see
+  // BackendModelInstance::InputCopyGraph(). Set by the model
+  // configuration parameter 'copy_graph_min_copy_count', 0 (disabled)
+  // by default.
+  size_t CopyGraphMinCopyCount() const { return copy_graph_min_copy_count_; }
+
  protected:
   TRITONSERVER_Server* triton_server_;
   TRITONBACKEND_MemoryManager* triton_memory_manager_;
@@ -91,13 +200,29 @@ class BackendModel {
   std::string repository_path_;
 
   common::TritonJson::Value model_config_;
-  int max_batch_size_;
+  // Replaced only by ReparseModelConfig(), while the model loads.
+  std::shared_ptr<const BackendModelConfig> parsed_config_;
+  std::atomic<int> max_batch_size_;
   bool enable_pinned_input_;
   bool enable_pinned_output_;
+  std::unique_ptr<BackendThreadPool> gather_thread_pool_;
+  size_t gather_min_byte_size_;
+  size_t copy_kernel_threshold_;
+  bool separate_copy_streams_;
+  std::set<std::string> residency_cache_inputs_;
+  size_t residency_cache_byte_size_;
+  size_t copy_graph_min_copy_count_;
+
+  std::mutex artifact_mu_;
+  bool artifacts_resolved_;
+  std::string default_model_filename_;
+  std::unordered_map<std::string, std::string> cc_model_filenames_;
 
   // Does this model support batching in the first dimension.
-  bool supports_batching_initialized_;
-  bool supports_batching_;
+  std::atomic<bool> supports_batching_initialized_;
+  std::atomic<bool> supports_batching_;
+
+  BackendResourceRegistry resources_;
 };
 
 //
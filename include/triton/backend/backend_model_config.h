@@ -0,0 +1,140 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "triton/backend/backend_common.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendModelConfig
+//
+// A typed view of a model configuration, parsed once so that the
+// inputs, outputs, sequence control tensors and parameters of the
+// model can be looked up on the request path without walking the
+// JSON configuration and comparing strings. The view is a snapshot,
+// it does not track later changes to the JSON configuration.
+//
+class BackendModelConfig {
+ public:
+  // An input or output of the model. 'dims_' is the shape from the
+  // model configuration, which does not include the batch dimension
+  // of a batching model. 'byte_size_' is the size of a tensor with
+  // 'dims_', or -1 if the shape has wildcard dimensions or the
+  // datatype has no fixed size.
+  struct Tensor {
+    std::string name_;
+    size_t index_;
+    TRITONSERVER_DataType datatype_;
+    std::vector<int64_t> dims_;
+    bool has_reshape_;
+    std::vector<int64_t> reshape_;
+    int64_t byte_size_;
+    bool is_shape_tensor_;
+    bool optional_;
+  };
+
+  // The sequence batcher control kinds.
+  enum class ControlKind { START, END, READY, CORRID };
+  static constexpr size_t kControlKindCount = 4;
+
+  // The tensor mapped to a sequence batcher control. For the boolean
+  // controls, START, END and READY, the false and true values are
+  // given by 'int32_false_value_' and 'int32_true_value_' for a
+  // TYPE_INT32 tensor, and by 'fp32_false_value_' and
+  // 'fp32_true_value_' for a TYPE_FP32 tensor.
+  struct SequenceControl {
+    std::string tensor_name_;
+    TRITONSERVER_DataType datatype_;
+    float fp32_false_value_;
+    float fp32_true_value_;
+    int32_t int32_false_value_;
+    int32_t int32_true_value_;
+  };
+
+  // Create the view of 'config', the configuration of model
+  // 'model_name'. Returns an error if the inputs, outputs, sequence
+  // controls or parameters of the configuration are malformed.
+  static TRITONSERVER_Error* Create(
+      common::TritonJson::Value& config, const std::string& model_name,
+      std::unique_ptr<BackendModelConfig>* model_config);
+
+  // The inputs and outputs in the order of the model configuration,
+  // so that 'Inputs()[i].index_ == i'.
+  const std::vector<Tensor>& Inputs() const { return inputs_; }
+  const std::vector<Tensor>& Outputs() const { return outputs_; }
+
+  // Find the input or output named 'name'. Return false if the model
+  // configuration has no such input or output.
+  bool FindInput(const std::string& name, const Tensor** input) const;
+  bool FindOutput(const std::string& name, const Tensor** output) const;
+
+  // Whether the model uses the sequence batcher.
+  bool HasSequenceBatching() const { return has_sequence_batching_; }
+
+  // Find the tensor mapped to control 'kind'. Return false if the
+  // model does not use the sequence batcher or the control is not
+  // mapped to a tensor.
+  bool FindSequenceControl(
+      const ControlKind kind, const SequenceControl** control) const;
+
+  // Find in 'value' the string value of model configuration parameter
+  // 'key'. Return false if the parameter is not specified.
+  bool FindParameter(const std::string& key, std::string* value) const;
+  const std::unordered_map<std::string, std::string>& Parameters() const
+  {
+    return parameters_;
+  }
+
+ private:
+  BackendModelConfig() : has_sequence_batching_(false) {}
+
+  static TRITONSERVER_Error* ParseTensors(
+      common::TritonJson::Value& config, const char* member,
+      std::vector<Tensor>* tensors,
+      std::unordered_map<std::string, size_t>* indices);
+  TRITONSERVER_Error* ParseSequenceControls(
+      common::TritonJson::Value& batcher, const std::string& model_name);
+
+  std::vector<Tensor> inputs_;
+  std::unordered_map<std::string, size_t> input_indices_;
+  std::vector<Tensor> outputs_;
+  std::unordered_map<std::string, size_t> output_indices_;
+
+  bool has_sequence_batching_;
+  std::array<bool, kControlKindCount> has_control_;
+  std::array<SequenceControl, kControlKindCount> controls_;
+
+  std::unordered_map<std::string, std::string> parameters_;
+};
+
+}}  // namespace triton::backend
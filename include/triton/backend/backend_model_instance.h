@@ -25,7 +25,15 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <memory>
 #include <string>
+#include <vector>
+#include "triton/backend/backend_common.h"
+#include "triton/backend/backend_copy_graph.h"
+#include "triton/backend/backend_copy_stats.h"
+#include "triton/backend/backend_pinned_arena.h"
+#include "triton/backend/backend_pinned_policy.h"
+#include "triton/backend/backend_residency_cache.h"
 #include "triton/core/tritonbackend.h"
 
 #ifdef TRITON_ENABLE_GPU
@@ -36,6 +44,7 @@ namespace triton { namespace backend {
 
 #ifndef TRITON_ENABLE_GPU
 using cudaStream_t = void*;
+using cudaEvent_t = void*;
 #endif  // !TRITON_ENABLE_GPU
 
 class BackendModel;
@@ -66,7 +75,9 @@ class BackendModelInstance {
   }
 
   // Get the BackendModel representing the model that corresponds to
-  // this instance.
+  // this instance. When executing, read the model configuration with
+  // BackendModel::ParsedModelConfig() rather than the mutable
+  // BackendModel::ModelConfig().
   BackendModel* Model() const { return backend_model_; }
 
   // The model configuration 'default_model_filename' value, or the
@@ -80,6 +91,84 @@ class BackendModelInstance {
   // disabled or if this instance is not executing on a GPU.
   cudaStream_t CudaStream() { return stream_; }
 
+  // Returns the streams to use for the input (CPU->GPU) and output
+  // (GPU->CPU) copies of this instance, typically by the
+  // BackendInputCollector and BackendOutputResponder objects used to
+  // execute the instance. If the model enables separate copy streams
+  // (see BackendModel::SeparateCopyStreams()) these are dedicated
+  // streams with the greatest priority, so that the input and output
+  // copies of consecutive executions can use both copy engines of the
+  // GPU and overlap with the computation on CudaStream(). Otherwise
+  // CudaStream() is returned.
+  cudaStream_t InputCopyStream() { return input_copy_stream_; }
+  cudaStream_t OutputCopyStream() { return output_copy_stream_; }
+
+  // Returns the events used to order the work on CudaStream() and on
+  // the copy streams, see BackendInputCollector::SetComputeStream() and
+  // BackendOutputResponder::SetComputeStream(). Returns nullptr if
+  // separate copy streams are not used.
+  cudaEvent_t InputCopyEvent() { return input_copy_event_; }
+  cudaEvent_t OutputCopyEvent() { return output_copy_event_; }
+
+  // Returns the NUMA node that the GPU of this instance is attached
+  // to, or -1 if unknown or if this instance is not executing on a
+  // GPU. The pinned buffers of PinnedArena() are allocated on this
+  // node, and an instance thread can be restricted to the CPUs of the
+  // node with SetThreadNumaAffinity().
+  int NumaNode() const { return numa_node_; }
+
+  // Returns how the copies between the GPU of this instance and GPU
+  // 'device_id' are performed. Peer access between the GPU of this
+  // instance and each other visible GPU is enabled when the instance
+  // is created, see EnableGpuPeerAccess(). Returns DRIVER_STAGED for a
+  // GPU that peer access couldn't be enabled with, and for any GPU if
+  // this instance is not executing on a GPU.
+  GpuCopyPath PeerCopyPath(const int device_id) const
+  {
+    if ((device_id < 0) ||
+        (static_cast<size_t>(device_id) >= peer_copy_paths_.size())) {
+      return GpuCopyPath::DRIVER_STAGED;
+    }
+    return peer_copy_paths_[device_id];
+  }
+
+  // Returns the arena of pinned memory buffers owned by this instance
+  // that can be used to stage GPU<->CPU memory transfers, for example
+  // by the BackendInputCollector and BackendOutputResponder objects
+  // used to execute the instance.
+  BackendPinnedArena* PinnedArena() { return pinned_arena_.get(); }
+
+  // Returns the copy statistics owned by this instance that the
+  // BackendInputCollector and BackendOutputResponder objects used to
+  // execute the instance can report to with SetStats(). The statistics
+  // are only recorded if built with TRITON_ENABLE_STATS.
+  BackendCopyStats* CopyStats() { return copy_stats_.get(); }
+
+  // Returns the policy owned by this instance that the
+  // BackendInputCollector and BackendOutputResponder objects used to
+  // execute the instance can share with SetPinnedPolicy(), so that the
+  // copies of all the batches of the instance refine its estimates.
+  BackendPinnedPolicy* PinnedPolicy() { return pinned_policy_.get(); }
+
+  // Returns the cache of the inputs that this instance keeps resident
+  // on its GPU across batches, see
+  // BackendInputCollector::SetResidencyCache(). Returns nullptr if the
+  // model doesn't enable the cache, see
+  // BackendModel::ResidencyCacheByteSize(), or if this instance is not
+  // executing on a GPU.
+  BackendResidencyCache* ResidencyCache() { return residency_cache_.get(); }
+
+  // Returns the graphs of copies owned by this instance that the
+  // BackendInputCollector and BackendOutputResponder objects used to
+  // execute the instance can issue their copies with, see
+  // SetCopyGraph() of those classes. Returns nullptr if the model
+  // doesn't enable copy graphs, see
+  // BackendModel::CopyGraphMinCopyCount(), or if this instance is not
+  // executing on a GPU. The input and output graphs must not be used
+  // at the same time by more than one collector or responder.
+  BackendCopyGraph* InputCopyGraph() { return input_copy_graph_.get(); }
+  BackendCopyGraph* OutputCopyGraph() { return output_copy_graph_.get(); }
+
  protected:
   BackendModel* backend_model_;
   TRITONBACKEND_ModelInstance* triton_model_instance_;
@@ -90,6 +179,26 @@ class BackendModelInstance {
 
   std::string artifact_filename_;
   cudaStream_t stream_;
+  cudaStream_t input_copy_stream_;
+  cudaStream_t output_copy_stream_;
+  cudaEvent_t input_copy_event_;
+  cudaEvent_t output_copy_event_;
+  int numa_node_;
+  std::vector<GpuCopyPath> peer_copy_paths_;
+  std::unique_ptr<BackendPinnedArena> pinned_arena_;
+  std::unique_ptr<BackendCopyStats> copy_stats_;
+  std::unique_ptr<BackendPinnedPolicy> pinned_policy_;
+  std::unique_ptr<BackendResidencyCache> residency_cache_;
+  std::unique_ptr<BackendCopyGraph> input_copy_graph_;
+  std::unique_ptr<BackendCopyGraph> output_copy_graph_;
+
+ private:
+  // Destroy the CUDA streams and events of the instance.
+  void DestroyStreams();
+
+  // Enable peer access between the GPU of the instance and each other
+  // visible GPU and record the resulting copy paths.
+  void EnablePeerCopyPaths();
 };
 
 //
@@ -0,0 +1,63 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <vector>
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend {
+
+//
+// NUMA topology helpers. A GPU is attached to the PCIe root of one NUMA
+// node and copies between the GPU and host memory of another node cross
+// the socket interconnect, so host and pinned staging buffers and the
+// threads that fill them should be local to the node of the GPU. The
+// topology is read from sysfs and is only available on Linux, the
+// functions return TRITONSERVER_ERROR_UNSUPPORTED on other platforms.
+//
+
+// Get in 'numa_node' the NUMA node that GPU 'device_id' is attached
+// to, or -1 if the platform doesn't report one (e.g. a single node
+// system).
+TRITONSERVER_Error* GpuNumaNode(const int device_id, int* numa_node);
+
+// Get in 'cpus' the CPUs of NUMA node 'numa_node'.
+TRITONSERVER_Error* NumaNodeCpus(const int numa_node, std::vector<int>* cpus);
+
+// Restrict the calling thread to the CPUs of NUMA node 'numa_node'.
+// Typically called by an instance thread with the node of the
+// instance's GPU, see BackendModelInstance::NumaNode(). Does nothing if
+// 'numa_node' is -1.
+TRITONSERVER_Error* SetThreadNumaAffinity(const int numa_node);
+
+// Set the memory policy of the pages in ['ptr', 'ptr' + 'byte_size')
+// to prefer NUMA node 'numa_node'. The policy applies to the pages
+// that are not yet faulted in, so it must be set before the memory is
+// first touched or pinned.
+TRITONSERVER_Error* BindMemoryToNumaNode(
+    void* ptr, const size_t byte_size, const int numa_node);
+
+}}  // namespace triton::backend
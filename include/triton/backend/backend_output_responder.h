@@ -25,9 +25,14 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
-#include <list>
+#include <memory>
 #include <string>
 #include <vector>
+#include "triton/backend/backend_copy_graph.h"
+#include "triton/backend/backend_copy_stats.h"
+#include "triton/backend/backend_pinned_arena.h"
+#include "triton/backend/backend_pinned_policy.h"
+#include "triton/backend/backend_request_metadata.h"
 #include "triton/core/tritonbackend.h"
 
 #ifdef TRITON_ENABLE_GPU
@@ -47,27 +52,159 @@ using cudaEvent_t = void*;
 class BackendOutputResponder {
  public:
   // The caller can optionally provide 'event' for internal synchronization
-  // instead of using 'stream'.
+  // instead of using 'stream'. The caller can optionally provide
+  // 'pinned_arena' to borrow the pinned staging buffers from, instead
+  // of allocating them for each batch. The borrowed buffers are returned
+  // when the BackendOutputResponder object is destroyed, so it must not
+  // be destroyed before the synchronization described in Finalize().
   explicit BackendOutputResponder(
       TRITONBACKEND_Request** requests, const uint32_t request_count,
       std::vector<TRITONBACKEND_Response*>* responses, const int max_batch_size,
       TRITONBACKEND_MemoryManager* memory_manager, const bool pinned_enabled,
-      cudaStream_t stream, cudaEvent_t event = nullptr)
+      cudaStream_t stream, cudaEvent_t event = nullptr,
+      BackendPinnedArena* pinned_arena = nullptr)
       : need_sync_(false), requests_(requests), request_count_(request_count),
         responses_(responses), max_batch_size_(max_batch_size),
         memory_manager_(memory_manager), pinned_enabled_(pinned_enabled),
-        stream_(stream), event_(event), pending_pinned_byte_size_(0)
+        stream_(stream), event_(event), pinned_arena_(pinned_arena),
+        pending_pinned_byte_size_(0), copy_kernel_threshold_(0),
+        copy_graph_(nullptr), stats_(nullptr), pinned_policy_(nullptr),
+        compute_stream_(nullptr), compute_event_(nullptr),
+        compute_waited_(false), metadata_(nullptr)
   {
   }
 
   ~BackendOutputResponder();
 
+  // Reuse this responder for another batch of requests. The staging
+  // buffers of the previous batch are released, but the containers
+  // keep their capacity and the settings of the responder, such as
+  // the stats or the compute stream, are kept, so a model instance can
+  // keep one responder and, once the sizes of its batches are steady,
+  // respond to them without allocating from the heap, provided the
+  // staging buffers are borrowed from a pinned arena. As for
+  // destroying the responder, it must not be reset before the
+  // synchronization described in Finalize(). The request metadata is
+  // cleared as it belongs to the previous batch.
+  void Reset(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      std::vector<TRITONBACKEND_Response*>* responses);
+
+  // Copy the slices of a tensor into the response buffers that are in
+  // the same GPU as the tensor with a single kernel launch, instead of
+  // one cudaMemcpyAsync per response, when the tensor has at least
+  // 'response_threshold' such responses. A value of 0 disables the
+  // copy kernel, which is the default. Has no effect if GPU support is
+  // disabled.
+  void SetCopyKernelThreshold(const size_t response_threshold)
+  {
+    copy_kernel_threshold_ = response_threshold;
+  }
+
+  // Issue the copies between the GPU and pinned CPU memory, and within
+  // the GPU, of each tensor as a single launch of a CUDA graph of
+  // 'copy_graph', see BackendModelInstance::OutputCopyGraph(). Passing
+  // a nullptr 'copy_graph', the default, issues each copy with
+  // cudaMemcpyAsync. Has no effect if GPU support is disabled.
+  void SetCopyGraph(BackendCopyGraph* copy_graph) { copy_graph_ = copy_graph; }
+
+  // Report the stage latencies, the bytes copied and the pinned memory
+  // outcomes of this responder to 'stats'. Nothing is reported unless
+  // built with TRITON_ENABLE_STATS.
+  void SetStats(BackendCopyStats* stats) { stats_ = stats; }
+
+  // Let 'policy' decide for each tensor whether it is copied to the
+  // response buffers through a pinned buffer, from the number of
+  // responses and the byte size of the tensor, and report the duration
+  // of the copies of this responder to it, see
+  // BackendModelInstance::PinnedPolicy(). The decisions are counted in
+  // the stats given to SetStats(). Has no effect if pinned memory is
+  // not enabled for this responder. Passing a nullptr 'policy', the
+  // default, stages all the tensors that can be staged.
+  void SetPinnedPolicy(BackendPinnedPolicy* policy)
+  {
+    pinned_policy_ = policy;
+  }
+
+  // Order the copies of this responder after the work already
+  // submitted to 'compute_stream' when the first tensor is processed,
+  // using 'event'. Useful when 'stream' is a dedicated copy stream, see
+  // BackendModelInstance::OutputCopyStream(), so that the outputs
+  // produced on 'compute_stream' don't need to be waited for on the
+  // host before being processed. Has no effect if 'compute_stream' is
+  // 'stream'.
+  void SetComputeStream(cudaStream_t compute_stream, cudaEvent_t event)
+  {
+    compute_stream_ = compute_stream;
+    compute_event_ = event;
+  }
+
+  // Use the batch sizes and requested outputs gathered in 'metadata'
+  // for the requests of this responder, instead of querying each
+  // request for each output tensor. 'metadata' must be created for
+  // the same requests and outlive the responder.
+  void SetRequestMetadata(const BackendRequestMetadata* metadata)
+  {
+    metadata_ = metadata;
+  }
+
   // Process all responses for a named output tensor.
   void ProcessTensor(
       const std::string& name, const TRITONSERVER_DataType datatype,
       std::vector<int64_t>& batchn_shape, const char* buffer,
       const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id);
 
+  // Process all responses for a named output tensor whose per-response
+  // size can't be derived from the datatype and a batch shape, for
+  // example ragged or BYTES outputs. For each response 'shapes' gives
+  // the shape of the output, and 'offsets' and 'byte_sizes' give the
+  // location and size of the response's slice in 'buffer', which has
+  // 'buffer_byte_size' bytes. A slice that doesn't fit in 'buffer' is
+  // an INVALID_ARG error, returned before any response is processed.
+  // A slice is copied to the response as is, so a BYTES slice must
+  // already be serialized with the 4-byte length prefix of each
+  // element. Slices that are adjacent in 'buffer' share the pinned
+  // staging copies.
+  TRITONSERVER_Error* ProcessVariableSizeTensor(
+      const std::string& name, const TRITONSERVER_DataType datatype,
+      const std::vector<std::vector<int64_t>>& shapes,
+      const std::vector<size_t>& offsets,
+      const std::vector<size_t>& byte_sizes, const char* buffer,
+      const size_t buffer_byte_size, const TRITONSERVER_MemoryType memory_type,
+      const int64_t memory_type_id);
+
+  // A response output buffer returned by AllocateTensor().
+  struct ResponseBuffer {
+    ResponseBuffer()
+        : buffer_(nullptr), byte_size_(0),
+          memory_type_(TRITONSERVER_MEMORY_CPU), memory_type_id_(0)
+    {
+    }
+
+    char* buffer_;
+    size_t byte_size_;
+    TRITONSERVER_MemoryType memory_type_;
+    int64_t memory_type_id_;
+  };
+
+  // Allocate the buffers of a named output tensor in all responses
+  // before the model is executed, so that the model can write the
+  // output directly into the responses instead of into a batch buffer
+  // that is then copied with ProcessTensor(). This is typically useful
+  // when the batch holds a single request, or when the framework
+  // accepts an output pointer per request. 'batchn_shape' has the same
+  // meaning as for ProcessTensor(). 'memory_type' and 'memory_type_id'
+  // give the preferred memory of the buffers, but the buffers may be
+  // allocated in a different memory, so the caller must check the
+  // returned memory type of each buffer. 'response_buffers' returns
+  // one entry per response, with a nullptr buffer if the response
+  // doesn't request the output or failed.
+  void AllocateTensor(
+      const std::string& name, const TRITONSERVER_DataType datatype,
+      std::vector<int64_t>& batchn_shape,
+      const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+      std::vector<ResponseBuffer>* response_buffers);
+
   // Finalize processing of all responses for all output
   // tensors. Return true if cudaMemcpyAsync is called, and the caller
   // should call cudaStreamSynchronize (or cudaEventSynchronize on 'event')
@@ -75,8 +212,63 @@ class BackendOutputResponder {
   bool Finalize();
 
  private:
+  TRITONSERVER_MemoryType UsePinnedMemoryType(
+      const TRITONSERVER_MemoryType tensor_memory_type) const;
+  TRITONSERVER_MemoryType ApplyPinnedPolicy(
+      const TRITONSERVER_MemoryType use_pinned_memory_type,
+      const size_t response_count, const size_t byte_size);
+  void SetBatchDimension(
+      const size_t idx, std::vector<int64_t>* batchn_shape);
+  size_t OutputIndex(const std::string& output_name) const;
+  void CreateRequestedOutput(
+      const size_t idx, TRITONBACKEND_Response** response,
+      const std::string& output_name, const size_t output_index,
+      const TRITONSERVER_DataType datatype, const std::vector<int64_t>& shape,
+      TRITONBACKEND_Output** response_output);
+  char* AllocatePinnedBuffer(const size_t byte_size);
+  void WaitComputeStream();
+  void RecordCopy(
+      const TRITONSERVER_MemoryType src_memory_type,
+      const TRITONSERVER_MemoryType dst_memory_type, const size_t byte_size)
+  {
+#ifdef TRITON_ENABLE_STATS
+    if (stats_ != nullptr) {
+      stats_->RecordCopy(src_memory_type, dst_memory_type, byte_size);
+    }
+#endif  // TRITON_ENABLE_STATS
+  }
+  void RecordPinnedFallback()
+  {
+#ifdef TRITON_ENABLE_STATS
+    if (stats_ != nullptr) {
+      stats_->RecordPinnedFallback();
+    }
+#endif  // TRITON_ENABLE_STATS
+  }
+  void RecordPinnedDecision(const bool staged)
+  {
+#ifdef TRITON_ENABLE_STATS
+    if (stats_ != nullptr) {
+      stats_->RecordPinnedDecision(staged);
+    }
+#endif  // TRITON_ENABLE_STATS
+  }
+  bool FlushPendingKernelCopies();
+  TRITONSERVER_Error* IssueCopy(
+      const char* msg, const TRITONSERVER_MemoryType src_memory_type,
+      const int64_t src_memory_type_id,
+      const TRITONSERVER_MemoryType dst_memory_type,
+      const int64_t dst_memory_type_id, const size_t byte_size,
+      const void* src, void* dst, bool* cuda_used);
+  TRITONSERVER_Error* IssueCopyBetweenGpus(
+      const char* msg, const int64_t src_device_id,
+      const int64_t dst_device_id, const size_t byte_size, const void* src,
+      void* dst, bool* cuda_used);
+  bool LaunchCopyGraph();
+  bool FlushQueuedCopies();
+  void ReleaseBatchMemories();
   bool FlushPendingPinned(
-      const char* tensor_buffer,
+      const std::string& output_name, const char* tensor_buffer,
       const TRITONSERVER_MemoryType tensor_memory_type,
       const int64_t tensor_memory_type_id);
   bool SetFixedSizeOutputBuffer(
@@ -89,31 +281,31 @@ class BackendOutputResponder {
 
   struct OutputData {
     OutputData(
-        const std::string& name, void* buffer, const size_t buffer_byte_size,
+        void* buffer, const size_t buffer_byte_size,
         const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
-        : name_(name), buffer_(buffer), buffer_byte_size_(buffer_byte_size),
+        : buffer_(buffer), buffer_byte_size_(buffer_byte_size),
           memory_type_(memory_type), memory_type_id_(memory_type_id)
     {
     }
-    const std::string name_;
     void* buffer_;
-    const size_t buffer_byte_size_;
-    const TRITONSERVER_MemoryType memory_type_;
-    const int64_t memory_type_id_;
+    size_t buffer_byte_size_;
+    TRITONSERVER_MemoryType memory_type_;
+    int64_t memory_type_id_;
   };
 
   bool need_sync_;
   TRITONBACKEND_Request** requests_;
-  const uint32_t request_count_;
+  uint32_t request_count_;
   std::vector<TRITONBACKEND_Response*>* responses_;
   const int max_batch_size_;
   TRITONBACKEND_MemoryManager* memory_manager_;
   const bool pinned_enabled_;
   cudaStream_t stream_;
   cudaEvent_t event_;
+  BackendPinnedArena* pinned_arena_;
 
   using ResponsesList =
-      std::list<std::pair<TRITONBACKEND_Response**, OutputData>>;
+      std::vector<std::pair<TRITONBACKEND_Response**, OutputData>>;
 
   size_t pending_pinned_byte_size_;
   size_t pending_pinned_offset_;
@@ -121,26 +313,71 @@ class BackendOutputResponder {
 
   // Pinned memories that need to live over the lifetime of this
   // BackendOutputResponder object.
-  std::list<char*> pinned_memories_;
+  std::vector<char*> pinned_memories_;
+
+  // Pinned memories borrowed from 'pinned_arena_' that are returned
+  // when this BackendOutputResponder object is destroyed.
+  std::vector<BackendMemory*> arena_memories_;
 
   // Pinned memory buffers and the corresponding response outputs
   // where the final copy to the response is deferred until Finalize()
-  // after waiting for all in-flight copies.
+  // after waiting for all in-flight copies. The response outputs of a
+  // buffer are [responses_begin_, responses_end_) of
+  // 'deferred_outputs_'.
   struct DeferredPinned {
     DeferredPinned(
         char* pinned_memory, const size_t pinned_memory_size,
-        ResponsesList&& responses)
+        const size_t responses_begin, const size_t responses_end)
         : pinned_memory_(pinned_memory),
           pinned_memory_size_(pinned_memory_size),
-          responses_(std::move(responses))
+          responses_begin_(responses_begin), responses_end_(responses_end)
     {
     }
     char* pinned_memory_;
     const size_t pinned_memory_size_;
-    ResponsesList responses_;
+    const size_t responses_begin_;
+    const size_t responses_end_;
   };
 
-  std::list<DeferredPinned> deferred_pinned_;
+  std::vector<DeferredPinned> deferred_pinned_;
+  ResponsesList deferred_outputs_;
+
+  // GPU to GPU copies that are delayed so that they can be performed
+  // by a single kernel launch in FlushPendingKernelCopies().
+  struct KernelCopy {
+    KernelCopy(
+        TRITONBACKEND_Response** response, const char* src, void* dst,
+        const size_t byte_size, const int64_t device_id)
+        : response_(response), src_(src), dst_(dst), byte_size_(byte_size),
+          device_id_(device_id)
+    {
+    }
+
+    TRITONBACKEND_Response** response_;
+    const char* src_;
+    void* dst_;
+    size_t byte_size_;
+    int64_t device_id_;
+  };
+
+  size_t copy_kernel_threshold_;
+  std::vector<KernelCopy> pending_kernel_copies_;
+
+  // Device copy tables that need to live over the lifetime of this
+  // BackendOutputResponder object.
+  std::vector<std::unique_ptr<BackendMemory>> device_tables_;
+
+  // The graph the copies of the tensors are queued to.
+  BackendCopyGraph* copy_graph_;
+
+  BackendCopyStats* stats_;
+  BackendPinnedPolicy* pinned_policy_;
+
+  cudaStream_t compute_stream_;
+  cudaEvent_t compute_event_;
+  bool compute_waited_;
+
+  const BackendRequestMetadata* metadata_;
 };
 
 }}  // namespace triton::backend
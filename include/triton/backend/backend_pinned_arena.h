@@ -0,0 +1,99 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "triton/backend/backend_memory.h"
+#include "triton/core/tritonbackend.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendPinnedArena
+//
+// A reusable pool of pinned memory buffers used to stage copies
+// between CPU and GPU memory. Buffers are grouped in size classes and a
+// buffer returned to the arena is kept for reuse instead of being freed,
+// so that a steady stream of similarly sized batches does not go back
+// to the memory manager or to cudaHostAlloc for each batch. New buffers
+// are taken from the pinned memory pool of the server, and only pinned
+// with cudaHostAlloc when the pool is exhausted. An arena is
+// typically owned by a BackendModelInstance and shared by the
+// BackendInputCollector and BackendOutputResponder objects of that
+// instance.
+//
+class BackendPinnedArena {
+ public:
+  // The smallest size class. All borrowed buffers are at least this
+  // large.
+  static constexpr size_t kMinClassByteSize = 4096;
+
+  // The default total byte size of the idle buffers kept by the arena.
+  static constexpr size_t kDefaultMaxCachedByteSize = 64 * 1024 * 1024;
+
+  // 'max_cached_byte_size' bounds the total byte size of the idle
+  // buffers kept by the arena. A buffer returned when the bound would
+  // be exceeded is freed. If 'numa_node' is not -1 the buffers that
+  // can't be taken from the pinned memory pool are preferably
+  // allocated on that NUMA node, typically the node of the GPU the
+  // buffers are copied to and from.
+  explicit BackendPinnedArena(
+      TRITONBACKEND_MemoryManager* manager,
+      const size_t max_cached_byte_size = kDefaultMaxCachedByteSize,
+      const int numa_node = -1);
+  ~BackendPinnedArena() = default;
+
+  // Borrow a pinned buffer of at least 'byte_size' bytes. The arena
+  // keeps ownership of 'mem' and the buffer must be given back with
+  // Return() once all copies using it have completed.
+  TRITONSERVER_Error* Borrow(const size_t byte_size, BackendMemory** mem);
+
+  // Return a buffer previously obtained from Borrow().
+  void Return(BackendMemory* mem);
+
+  // The total byte size of the idle buffers currently kept by the
+  // arena.
+  size_t CachedByteSize();
+
+ private:
+  // Return the index and byte size of the size class for 'byte_size'.
+  // Classes are spaced four per power of 2 so that rounding up never
+  // wastes more than 25% of a buffer.
+  static void SizeClass(
+      const size_t byte_size, size_t* class_index, size_t* class_byte_size);
+
+  TRITONBACKEND_MemoryManager* manager_;
+  const size_t max_cached_byte_size_;
+  const int numa_node_;
+
+  std::mutex mu_;
+  size_t cached_byte_size_;
+  std::vector<std::vector<std::unique_ptr<BackendMemory>>> idle_buffers_;
+};
+
+}}  // namespace triton::backend
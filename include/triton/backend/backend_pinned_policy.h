@@ -0,0 +1,209 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "triton/core/tritonserver.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend {
+
+#ifndef TRITON_ENABLE_GPU
+using cudaStream_t = void*;
+using cudaEvent_t = void*;
+#endif  // !TRITON_ENABLE_GPU
+
+//
+// BackendPinnedPolicy
+//
+// Decides, for each tensor of a batch that is copied between CPU and
+// GPU memory, whether the copy is staged through a pinned buffer or
+// done directly from and to the request and response buffers. Staging
+// costs a host copy of all the bytes into or out of the pinned buffer
+// but needs a single transfer, copying directly costs one transfer
+// per buffer each of which is slower as the memory is pageable. The
+// policy estimates both costs from the number of buffers, the total
+// byte size and the rolling averages of the copies measured by the
+// BackendInputCollector and BackendOutputResponder objects that use
+// it, see SetPinnedPolicy() of those classes. With the initial
+// estimates the policy stages every tensor, as is done without a
+// policy. A BackendModelInstance owns one object shared by the
+// collectors and responders of the instance. The object is
+// thread-safe.
+//
+class BackendPinnedPolicy {
+ public:
+  // The current estimates of the costs, in nanoseconds, of the copies.
+  struct Estimates {
+    // The fixed cost of a direct copy between CPU and GPU memory.
+    double copy_overhead_ns_;
+    // The cost per byte of a direct copy between CPU and GPU memory.
+    double direct_ns_per_byte_;
+    // The cost per byte of the host copy into or out of a pinned
+    // buffer.
+    double staging_ns_per_byte_;
+  };
+
+  // Direct copies of at most this many bytes measure the fixed cost of
+  // a copy, direct copies of at least kLargeCopyByteSize bytes measure
+  // the cost per byte.
+  static constexpr size_t kSmallCopyByteSize = 16 * 1024;
+  static constexpr size_t kLargeCopyByteSize = 256 * 1024;
+
+  // So that the estimates of both ways of copying are kept up to date,
+  // every kExploreInterval decisions the policy picks the way it
+  // doesn't favor.
+  static constexpr uint64_t kExploreInterval = 64;
+
+  // At most this many direct copies are measured at a time by
+  // CopyTimer objects.
+  static constexpr size_t kMaxPendingTimings = 8;
+
+  // Measure the time from construction to destruction as a copy of
+  // 'byte_size' bytes, either through a pinned buffer if 'staging' or
+  // directly. Only suitable for copies that complete before they
+  // return, such as the host copies into and out of a pinned buffer.
+  // 'policy' may be nullptr in which case nothing is recorded.
+  class ScopedTimer {
+   public:
+    ScopedTimer(
+        BackendPinnedPolicy* policy, const bool staging,
+        const size_t byte_size)
+        : policy_(policy), staging_(staging), byte_size_(byte_size)
+    {
+      if (policy_ != nullptr) {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~ScopedTimer()
+    {
+      if (policy_ != nullptr) {
+        const uint64_t duration_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_)
+                .count();
+        if (staging_) {
+          policy_->RecordStagingCopy(byte_size_, duration_ns);
+        } else {
+          policy_->RecordDirectCopy(byte_size_, duration_ns);
+        }
+      }
+    }
+
+   private:
+    BackendPinnedPolicy* policy_;
+    const bool staging_;
+    const size_t byte_size_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  // Measure the direct copies issued on 'stream' between construction
+  // and destruction as a copy of 'byte_size' bytes, using CUDA events
+  // recorded on 'stream' as the copies may complete after they are
+  // issued. The measurement is recorded by a later call to
+  // UseStaging() once the copies are done. When kMaxPendingTimings
+  // measurements are already pending the copies are not measured.
+  // 'policy' may be nullptr in which case nothing is recorded.
+  class CopyTimer {
+   public:
+    CopyTimer(
+        BackendPinnedPolicy* policy, cudaStream_t stream,
+        const size_t byte_size);
+    ~CopyTimer();
+
+   private:
+    BackendPinnedPolicy* policy_;
+    cudaStream_t stream_;
+    const size_t byte_size_;
+    // The timing slot of the measurement, kMaxPendingTimings if the
+    // copies are not measured.
+    size_t slot_;
+  };
+
+  BackendPinnedPolicy();
+  ~BackendPinnedPolicy();
+
+  // Return true if a tensor of 'byte_size' bytes split across
+  // 'buffer_count' request or response buffers should be staged
+  // through a pinned buffer.
+  bool UseStaging(const size_t buffer_count, const size_t byte_size);
+
+  // Record the duration of a direct copy between CPU and GPU memory.
+  void RecordDirectCopy(const size_t byte_size, const uint64_t duration_ns);
+
+  // Record the duration of the host copies into or out of a pinned
+  // buffer.
+  void RecordStagingCopy(const size_t byte_size, const uint64_t duration_ns);
+
+  // Return true if a direct copy from 'src_memory_type' to
+  // 'dst_memory_type' is a copy between CPU and GPU memory that the
+  // policy decides about.
+  static bool IsTransfer(
+      const TRITONSERVER_MemoryType src_memory_type,
+      const TRITONSERVER_MemoryType dst_memory_type)
+  {
+    return ((src_memory_type == TRITONSERVER_MEMORY_CPU) &&
+            (dst_memory_type == TRITONSERVER_MEMORY_GPU)) ||
+           ((src_memory_type == TRITONSERVER_MEMORY_GPU) &&
+            (dst_memory_type == TRITONSERVER_MEMORY_CPU));
+  }
+
+  void GetEstimates(Estimates* estimates);
+
+  // Forget the measured copies and go back to the initial estimates.
+  void Reset();
+
+ private:
+  // The CUDA events measuring the direct copies of a CopyTimer. The
+  // events are created once and reused by the later measurements.
+  struct Timing {
+    enum class State { FREE, ISSUING, PENDING };
+    State state_;
+    cudaEvent_t start_;
+    cudaEvent_t end_;
+    size_t byte_size_;
+  };
+
+  size_t BeginTiming();
+  void EndTiming(const size_t slot, const size_t byte_size);
+  void CollectTimings();
+  void UpdateDirectCopy(const size_t byte_size, const uint64_t duration_ns);
+
+  std::mutex mu_;
+  Estimates estimates_;
+  uint64_t decision_count_;
+  Timing timings_[kMaxPendingTimings];
+};
+
+}}  // namespace triton::backend
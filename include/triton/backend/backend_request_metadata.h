@@ -0,0 +1,101 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "triton/core/tritonbackend.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendRequestMetadata
+//
+// The batch size and the requested outputs of each request of a
+// batch, gathered once per execution with a single pass over the
+// requests. BackendOutputResponder::SetRequestMetadata() uses it to
+// size and create the response outputs without calling into the
+// backend API for each output of each response. The requests must
+// outlive the metadata.
+//
+class BackendRequestMetadata {
+ public:
+  // Index returned by OutputIndex() for an output that no request of
+  // the batch requests.
+  static constexpr size_t kNoOutput = SIZE_MAX;
+
+  // Gather the metadata of 'requests'. 'max_batch_size' is the maximum
+  // batch size of the model. If it is not 0 the batch size of a
+  // request is the first dimension of its first input, otherwise the
+  // batch size of every request is 0.
+  static TRITONSERVER_Error* Create(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      const int max_batch_size,
+      std::unique_ptr<BackendRequestMetadata>* metadata);
+
+  uint32_t RequestCount() const { return request_count_; }
+
+  // The batch size of request 'idx', and the sum of the batch sizes of
+  // all the requests.
+  int64_t BatchSize(const size_t idx) const { return batch_sizes_[idx]; }
+  int64_t TotalBatchSize() const { return total_batch_size_; }
+
+  // Return the index of output 'name' among the outputs requested by
+  // the batch, or kNoOutput if no request requests it.
+  size_t OutputIndex(const std::string& name) const;
+
+  // Return whether request 'idx' requests the output with index
+  // 'output_index', as returned by OutputIndex().
+  bool IsOutputRequested(const size_t idx, const size_t output_index) const
+  {
+    return (output_index != kNoOutput) &&
+           ((requested_[idx * words_per_request_ + output_index / 64] &
+             (uint64_t(1) << (output_index % 64))) != 0);
+  }
+
+ private:
+  explicit BackendRequestMetadata(const uint32_t request_count)
+      : request_count_(request_count), total_batch_size_(0),
+        words_per_request_(0)
+  {
+  }
+
+  const uint32_t request_count_;
+  std::vector<int64_t> batch_sizes_;
+  int64_t total_batch_size_;
+
+  // The requested outputs of the batch, and for each request a bitmap
+  // of 'words_per_request_' words indexed by the output index.
+  std::unordered_map<std::string, size_t> output_indices_;
+  size_t words_per_request_;
+  std::vector<uint64_t> requested_;
+};
+
+}}  // namespace triton::backend
@@ -0,0 +1,132 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include "triton/backend/backend_memory.h"
+#include "triton/core/tritonbackend.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendResidencyCache
+//
+// GPU copies of input tensors that are sent unchanged with many
+// batches, for example embedding tables or prompt prefixes, kept
+// resident on the device of a model instance so that the input
+// doesn't need to be copied to the GPU again. An input is identified
+// by a key, either the hash of its contents or an ID supplied by the
+// client, see BackendInputCollector::SetResidencyCache(). As different
+// contents can have the same hash, a copy identified by hash is cached
+// with a host copy of its contents that a batch is compared against
+// before using the GPU copy. The host copies are not counted in the
+// byte size limit. The least
+// recently used copies are evicted to keep the cache within its byte
+// size limit. A copy that is evicted while still in use by a batch is
+// released when the batch is done with it.
+//
+// The copies are written on the stream of the instance, so a cache
+// must only be used by the instance that owns it.
+//
+class BackendResidencyCache {
+ public:
+  // Cache copies of the inputs named in 'input_names' on GPU
+  // 'device_id', using at most 'byte_size_limit' bytes. The copies are
+  // allocated and released in order on 'stream'.
+  BackendResidencyCache(
+      TRITONBACKEND_MemoryManager* memory_manager, const int64_t device_id,
+      cudaStream_t stream, const size_t byte_size_limit,
+      const std::set<std::string>& input_names);
+
+  int64_t DeviceId() const { return device_id_; }
+  size_t ByteSizeLimit() const { return byte_size_limit_; }
+
+  // The total byte size of the cached copies.
+  size_t ByteSize();
+
+  // Return whether the input named 'input_name' can be cached.
+  bool IsCachedInput(const std::string& input_name) const
+  {
+    return input_names_.find(input_name) != input_names_.end();
+  }
+
+  // Find the copy cached for 'key'. Return false if there is none. A
+  // found copy becomes the most recently used. 'contents' returns the
+  // host copy of the contents given to Insert(), nullptr if none.
+  bool Find(
+      const std::string& key, std::shared_ptr<BackendMemory>* memory,
+      std::shared_ptr<const std::string>* contents);
+
+  // Allocate a GPU buffer of 'byte_size' bytes for a new copy, evicting
+  // the least recently used copies as needed. Returns an error if
+  // 'byte_size' exceeds the byte size limit or the allocation fails.
+  TRITONSERVER_Error* Allocate(
+      const size_t byte_size, std::shared_ptr<BackendMemory>* memory);
+
+  // Cache 'memory', allocated with Allocate() and holding the complete
+  // copy of the input identified by 'key'. 'contents', if not nullptr,
+  // is the host copy of the input to return with the copy from Find().
+  void Insert(
+      const std::string& key, const std::shared_ptr<BackendMemory>& memory,
+      const std::shared_ptr<const std::string>& contents = nullptr);
+
+  // Evict all the copies.
+  void Clear();
+
+  // Return the hash of 'byte_size' bytes at 'base', combined with
+  // 'seed' so that the hash of a tensor in several buffers can be
+  // computed one buffer at a time.
+  static uint64_t Hash(
+      const void* base, const size_t byte_size, const uint64_t seed);
+
+ private:
+  void Evict(const size_t byte_size);
+
+  TRITONBACKEND_MemoryManager* memory_manager_;
+  const int64_t device_id_;
+  cudaStream_t stream_;
+  const size_t byte_size_limit_;
+  const std::set<std::string> input_names_;
+
+  struct Entry {
+    std::string key_;
+    std::shared_ptr<BackendMemory> memory_;
+    std::shared_ptr<const std::string> contents_;
+  };
+  using LruList = std::list<Entry>;
+
+  std::mutex mu_;
+  size_t byte_size_;
+  LruList lru_;
+  std::unordered_map<std::string, LruList::iterator> entries_;
+};
+
+}}  // namespace triton::backend
@@ -0,0 +1,146 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "triton/backend/backend_common.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendResourceRegistry
+//
+// Resources shared by all the instances of a model, such as weight
+// buffers, memory pools or tokenizers, registered by name. The first
+// instance that needs a resource creates it with GetOrCreate() and the
+// other instances get the same object. Lookups read an immutable
+// snapshot of the registry through an atomic pointer, without taking a
+// lock, so they can be done on the request path of every instance. A
+// registration publishes a new snapshot and keeps the replaced one
+// until the registry is destroyed, since a concurrent lookup may still
+// read it. Registrations are meant to happen a few times while the
+// model and its instances are loaded. A BackendModel owns one
+// registry, see BackendModel::Resources(). The object is thread-safe.
+//
+class BackendResourceRegistry {
+ public:
+  BackendResourceRegistry();
+  ~BackendResourceRegistry() = default;
+
+  // Return the resource registered with 'name', or nullptr if there is
+  // no such resource or if it is not of type T.
+  template <typename T>
+  std::shared_ptr<T> Find(const std::string& name) const
+  {
+    return std::static_pointer_cast<T>(FindResource(name, typeid(T)));
+  }
+
+  // Get in 'resource' the resource registered with 'name', calling
+  // 'create' to create and register it if there is no such resource.
+  // 'create' is called without holding the registry lock and at most
+  // once at a time for a name, concurrent callers for the same name
+  // wait for it and get the same resource, callers for other names
+  // don't wait. Returns an INVALID_ARG
+  // error if the resource registered with 'name' is not of type T, or
+  // the error returned by 'create', in which case nothing is
+  // registered.
+  template <typename T>
+  TRITONSERVER_Error* GetOrCreate(
+      const std::string& name,
+      const std::function<TRITONSERVER_Error*(std::shared_ptr<T>*)>& create,
+      std::shared_ptr<T>* resource)
+  {
+    std::shared_ptr<void> untyped;
+    RETURN_IF_ERROR(GetOrCreateResource(
+        name, typeid(T),
+        [&create](std::shared_ptr<void>* created) -> TRITONSERVER_Error* {
+          std::shared_ptr<T> typed;
+          RETURN_IF_ERROR(create(&typed));
+          *created = typed;
+          return nullptr;  // success
+        },
+        &untyped));
+    *resource = std::static_pointer_cast<T>(untyped);
+    return nullptr;  // success
+  }
+
+  // Remove the resource registered with 'name' from the registry.
+  // Instances that got the resource keep it until they release it,
+  // and the retired snapshots keep it until the registry is destroyed.
+  // Return true if there was such a resource.
+  bool Remove(const std::string& name);
+
+  // The number of registered resources.
+  size_t Count() const;
+
+  BackendResourceRegistry(const BackendResourceRegistry&) = delete;
+  BackendResourceRegistry& operator=(const BackendResourceRegistry&) = delete;
+
+ private:
+  struct Entry {
+    std::shared_ptr<void> resource_;
+    const std::type_info* type_;
+  };
+
+  using Resources = std::unordered_map<std::string, Entry>;
+
+  std::shared_ptr<void> FindResource(
+      const std::string& name, const std::type_info& type) const;
+  TRITONSERVER_Error* GetOrCreateResource(
+      const std::string& name, const std::type_info& type,
+      const std::function<TRITONSERVER_Error*(std::shared_ptr<void>*)>&
+          create,
+      std::shared_ptr<void>* resource);
+
+  // Publishes 'updated' as the current snapshot and retires the
+  // previous one. Must be called with 'mu_' held.
+  void Publish(std::unique_ptr<const Resources>&& updated);
+
+  // The current snapshot, read without a lock.
+  std::atomic<const Resources*> resources_;
+
+  // Serializes the registrations. 'creating_' holds the names whose
+  // resource is being created, 'created_cv_' is notified when one of
+  // them is done. 'snapshots_' owns the current and the retired
+  // snapshots.
+  std::mutex mu_;
+  std::condition_variable created_cv_;
+  std::unordered_set<std::string> creating_;
+  std::vector<std::unique_ptr<const Resources>> snapshots_;
+};
+
+}}  // namespace triton::backend
@@ -0,0 +1,111 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "triton/core/tritonbackend.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendResponseSender
+//
+// Sends the responses of a batch in one sweep. The sender tracks which
+// responses are still live in a dense bitmask, so code that walks the
+// batch can skip the responses that already failed 64 at a time.
+// Errors are not sent when they are set, they are collected and sent
+// by Send(), and consecutive errors with the same code and message
+// share a single error object, so an error that fails the whole batch
+// costs one error object instead of one per request.
+//
+class BackendResponseSender {
+ public:
+  // Sentinel returned by NextLive() when there is no live response.
+  static constexpr size_t kNoResponse = SIZE_MAX;
+
+  // 'responses' is the response of each request of the batch, where
+  // nullptr indicates that the request has no response to send. The
+  // sender sets an entry to nullptr once it takes over the response.
+  explicit BackendResponseSender(
+      std::vector<TRITONBACKEND_Response*>* responses);
+
+  // Send any collected errors that have not been sent.
+  ~BackendResponseSender();
+
+  // Return whether response 'idx' is live, that is it is not nullptr
+  // and no error has been set for it.
+  bool IsLive(const size_t idx) const
+  {
+    return (live_[idx / 64] & (uint64_t(1) << (idx % 64))) != 0;
+  }
+
+  // Return the number of live responses.
+  size_t LiveCount() const { return live_count_; }
+
+  // Return the index of the first live response at or after 'idx', or
+  // kNoResponse if there is none.
+  size_t NextLive(const size_t idx) const;
+
+  // Fail response 'idx' with 'err'. The sender takes ownership of
+  // 'err', which must not be nullptr. Does nothing but delete 'err' if
+  // the response is not live.
+  void SetError(const size_t idx, TRITONSERVER_Error* err);
+
+  // Fail all the live responses with 'err'. The sender takes ownership
+  // of 'err', which must not be nullptr.
+  void SetErrorAll(TRITONSERVER_Error* err);
+
+  // Mark as not live the responses that were set to nullptr in the
+  // response vector since the sender was created, for example by
+  // RESPOND_AND_SET_NULL_IF_ERROR in BackendInputCollector or
+  // BackendOutputResponder.
+  void Refresh();
+
+  // Send the failed responses with their error and, if 'send_live' is
+  // true, the live responses with no error. All the sent responses
+  // are set to nullptr in the response vector. 'flags' are the send
+  // flags for the live responses.
+  void Send(
+      const bool send_live = true,
+      const uint32_t flags = TRITONSERVER_RESPONSE_COMPLETE_FINAL);
+
+ private:
+  void ClearLive(const size_t idx);
+  void SendErrors();
+
+  std::vector<TRITONBACKEND_Response*>* responses_;
+  std::vector<uint64_t> live_;
+  size_t live_count_;
+
+  // The failed responses and the index of their error in 'errors_'.
+  std::vector<std::pair<TRITONBACKEND_Response*, size_t>> failed_;
+  std::vector<TRITONSERVER_Error*> errors_;
+};
+
+}}  // namespace triton::backend
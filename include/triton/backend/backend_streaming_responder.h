@@ -0,0 +1,139 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "triton/backend/backend_output_responder.h"
+#include "triton/backend/backend_pinned_arena.h"
+#include "triton/backend/backend_request_metadata.h"
+#include "triton/core/tritonbackend.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend {
+
+#ifndef TRITON_ENABLE_GPU
+using cudaStream_t = void*;
+using cudaEvent_t = void*;
+#endif  // !TRITON_ENABLE_GPU
+
+//
+// BackendStreamingResponder
+//
+// Sends the responses of a decoupled model that produces an output
+// for a group of streams at each step, for example a token for each
+// sequence being generated. Each request of the group is a stream
+// with its own response factory. At each step the output of all the
+// streams is processed by one reused BackendOutputResponder, so the
+// slices of the streams whose responses are in the same memory are
+// staged with a single transfer, and the partial responses are sent
+// without querying the requests again.
+//
+// A step is BeginStep(), ProcessTensor() for each output, EndStream()
+// for each stream that the step completes, and SendStep().
+//
+class BackendStreamingResponder {
+ public:
+  // Create the streams of 'requests'. The requests are only read by
+  // Create(), so they can be released once it returns. The
+  // remaining arguments are passed to the BackendOutputResponder that
+  // processes the outputs of each step.
+  static TRITONSERVER_Error* Create(
+      TRITONBACKEND_Request** requests, const uint32_t request_count,
+      TRITONBACKEND_MemoryManager* memory_manager, const bool pinned_enabled,
+      cudaStream_t stream, cudaEvent_t event, BackendPinnedArena* pinned_arena,
+      std::unique_ptr<BackendStreamingResponder>* responder);
+
+  // Complete the streams that are still active, without sending them
+  // another response.
+  ~BackendStreamingResponder();
+
+  // The number of streams, and of the streams that are not complete.
+  uint32_t StreamCount() const { return stream_count_; }
+  uint32_t ActiveCount() const { return active_count_; }
+  bool IsActive(const uint32_t idx) const { return factories_[idx] != nullptr; }
+
+  // The responder used for the outputs of each step, for example to
+  // set its stats or its compute stream. Its settings are kept across
+  // steps.
+  BackendOutputResponder* Responder() { return &responder_; }
+
+  // Begin a step by creating a response for each active stream. A
+  // stream whose response can't be created is completed.
+  void BeginStep();
+
+  // Process an output of the step. 'buffer' holds a slice of
+  // 'stream_shape' for every stream, in stream order, including the
+  // complete streams whose slices are skipped, like the output of a
+  // batch of StreamCount() requests.
+  void ProcessTensor(
+      const std::string& name, const TRITONSERVER_DataType datatype,
+      std::vector<int64_t>& stream_shape, const char* buffer,
+      const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id);
+
+  // Complete stream 'idx' with the response of this step, which is
+  // sent as the final response of the stream.
+  void EndStream(const uint32_t idx) { ending_[idx] = true; }
+
+  // Complete stream 'idx' by sending 'error' as its final response,
+  // instead of the response of this step. Takes ownership of 'error'.
+  void FailStream(const uint32_t idx, TRITONSERVER_Error* error);
+
+  // Wait for the copies of the step and send its responses. The
+  // streams ended by EndStream() are complete after this call.
+  void SendStep();
+
+ private:
+  BackendStreamingResponder(
+      const uint32_t request_count, TRITONBACKEND_MemoryManager* memory_manager,
+      const bool pinned_enabled, cudaStream_t stream, cudaEvent_t event,
+      BackendPinnedArena* pinned_arena);
+
+  void CompleteStream(const uint32_t idx, const bool send_final_flag);
+
+  const uint32_t stream_count_;
+  uint32_t active_count_;
+  bool in_step_;
+  cudaStream_t stream_;
+  cudaEvent_t event_;
+
+  // The response factory of each stream, nullptr once the stream is
+  // complete, and whether the response of this step is the last.
+  std::vector<TRITONBACKEND_ResponseFactory*> factories_;
+  std::vector<bool> ending_;
+
+  // The responses of the current step, nullptr for the complete
+  // streams, and the requested outputs of the streams.
+  std::vector<TRITONBACKEND_Response*> responses_;
+  std::unique_ptr<BackendRequestMetadata> metadata_;
+  BackendOutputResponder responder_;
+};
+
+}}  // namespace triton::backend
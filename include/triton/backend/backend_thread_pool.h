@@ -0,0 +1,85 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace triton { namespace backend {
+
+//
+// BackendThreadPool
+//
+// A fixed set of worker threads that run data-parallel loops. The pool
+// is meant to be shared, for example by all the instances of a model,
+// and is safe to use from multiple threads at the same time.
+//
+class BackendThreadPool {
+ public:
+  explicit BackendThreadPool(const size_t thread_count);
+  ~BackendThreadPool();
+
+  // The number of worker threads of the pool.
+  size_t ThreadCount() const { return workers_.size(); }
+
+  // Call 'fn' for each index in [0, 'count') using the worker threads
+  // and the calling thread, and return once all calls have completed.
+  // The calls may happen in any order.
+  void ParallelFor(const size_t count, const std::function<void(size_t)>& fn);
+
+ private:
+  struct Job {
+    Job(const size_t count, const std::function<void(size_t)>* fn)
+        : count_(count), fn_(fn), next_(0), active_(0)
+    {
+    }
+
+    const size_t count_;
+    const std::function<void(size_t)>* fn_;
+    std::atomic<size_t> next_;
+    // The number of workers running the job.
+    std::atomic<size_t> active_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+  };
+
+  static void RunJob(Job* job);
+  void WorkerThread();
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool exiting_;
+  std::deque<Job*> jobs_;
+  std::vector<std::thread> workers_;
+};
+
+}}  // namespace triton::backend
@@ -38,13 +38,18 @@
 #include <io.h>
 #else
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <thread>
 
 #ifdef _WIN32
 // <sys/stat.h> in Windows doesn't define S_ISDIR macro
@@ -551,7 +556,184 @@ SendErrorForResponses(
           std::string((MSG) + ": " + cudaGetErrorString(err__)).c_str()); \
     }                                                                     \
   } while (false)
+
+namespace {
+
+// The copy paths and the unified addressing support are cached
+// without locking for GPUs with an ID less than this. GPUs with a
+// larger ID are probed again for each copy, and GetGpuCopyPath()
+// reports their copies as DRIVER_STAGED.
+constexpr int64_t kMaxCachedDevices = 64;
+
+// 0 if EnableGpuPeerAccess() wasn't called for the pair of GPUs yet,
+// otherwise 1 + GpuCopyPath.
+std::atomic<uint8_t> gpu_copy_paths[kMaxCachedDevices][kMaxCachedDevices];
+
+// 0 if the GPU is not probed yet, 1 if it doesn't support unified
+// addressing and 2 if it does.
+std::atomic<uint8_t> gpu_unified_addressing[kMaxCachedDevices];
+
+// Serialize the peer access setup and the probes since they change
+// the current device.
+std::mutex gpu_probe_mu;
+
+bool
+CachedDevice(const int64_t device_id)
+{
+  return (device_id >= 0) && (device_id < kMaxCachedDevices);
+}
+
+// Enable access of 'device_id' to the memory of 'peer_device_id'.
+// Return false if it can't be enabled.
+bool
+EnablePeerAccess(const int64_t device_id, const int64_t peer_device_id)
+{
+  if (cudaSetDevice(device_id) != cudaSuccess) {
+    return false;
+  }
+
+  cudaError_t err = cudaDeviceEnablePeerAccess(peer_device_id, 0 /* flags */);
+  if (err == cudaErrorPeerAccessAlreadyEnabled) {
+    // Clear the sticky error so it isn't reported by a later call.
+    cudaGetLastError();
+    return true;
+  }
+
+  return (err == cudaSuccess);
+}
+
+GpuCopyPath
+ProbeGpuCopyPath(const int64_t src_device_id, const int64_t dst_device_id)
+{
+  int src_to_dst = 0, dst_to_src = 0;
+  if ((cudaDeviceCanAccessPeer(&src_to_dst, src_device_id, dst_device_id) !=
+       cudaSuccess) ||
+      (cudaDeviceCanAccessPeer(&dst_to_src, dst_device_id, src_device_id) !=
+       cudaSuccess) ||
+      (src_to_dst == 0) || (dst_to_src == 0)) {
+    return GpuCopyPath::DRIVER_STAGED;
+  }
+
+  int current_device;
+  if (cudaGetDevice(&current_device) != cudaSuccess) {
+    return GpuCopyPath::DRIVER_STAGED;
+  }
+
+  const bool enabled = EnablePeerAccess(src_device_id, dst_device_id) &&
+                       EnablePeerAccess(dst_device_id, src_device_id);
+  cudaSetDevice(current_device);
+  if (!enabled) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        (std::string("failed to enable peer access between GPU ") +
+         std::to_string(src_device_id) + " and GPU " +
+         std::to_string(dst_device_id) +
+         ", copies between them are staged by the driver")
+            .c_str());
+    return GpuCopyPath::DRIVER_STAGED;
+  }
+
+  return GpuCopyPath::PEER;
+}
+
+// Return whether 'device_id' supports unified addressing, in which
+// case the driver can infer the direction of a copy from the
+// pointers.
+bool
+UnifiedAddressing(const int64_t device_id)
+{
+  if (CachedDevice(device_id)) {
+    const uint8_t cached =
+        gpu_unified_addressing[device_id].load(std::memory_order_acquire);
+    if (cached != 0) {
+      return (cached == 2);
+    }
+  }
+
+  int supported = 0;
+  if (cudaDeviceGetAttribute(
+          &supported, cudaDevAttrUnifiedAddressing, device_id) != cudaSuccess) {
+    cudaGetLastError();
+    supported = 0;
+  }
+  if (CachedDevice(device_id)) {
+    gpu_unified_addressing[device_id].store(
+        (supported != 0) ? 2 : 1, std::memory_order_release);
+  }
+
+  return (supported != 0);
+}
+
+}  // namespace
+#endif  // TRITON_ENABLE_GPU
+
+TRITONSERVER_Error*
+GetGpuCopyPath(
+    const int64_t src_device_id, const int64_t dst_device_id,
+    GpuCopyPath* path)
+{
+  if (src_device_id == dst_device_id) {
+    *path = GpuCopyPath::SAME_DEVICE;
+    return nullptr;  // success
+  }
+
+#ifdef TRITON_ENABLE_GPU
+  *path = GpuCopyPath::DRIVER_STAGED;
+  if (CachedDevice(src_device_id) && CachedDevice(dst_device_id)) {
+    const uint8_t value = gpu_copy_paths[src_device_id][dst_device_id].load(
+        std::memory_order_acquire);
+    if (value != 0) {
+      *path = static_cast<GpuCopyPath>(value - 1);
+    }
+  }
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "GPU copy path not supported");
+#endif  // TRITON_ENABLE_GPU
+}
+
+TRITONSERVER_Error*
+EnableGpuPeerAccess(
+    const int64_t src_device_id, const int64_t dst_device_id,
+    GpuCopyPath* path)
+{
+  if (src_device_id == dst_device_id) {
+    *path = GpuCopyPath::SAME_DEVICE;
+    return nullptr;  // success
+  }
+
+#ifdef TRITON_ENABLE_GPU
+  const bool cached =
+      CachedDevice(src_device_id) && CachedDevice(dst_device_id);
+  std::lock_guard<std::mutex> lk(gpu_probe_mu);
+  if (cached) {
+    const uint8_t value = gpu_copy_paths[src_device_id][dst_device_id].load(
+        std::memory_order_acquire);
+    if (value != 0) {
+      *path = static_cast<GpuCopyPath>(value - 1);
+      return nullptr;  // success
+    }
+  }
+
+  *path = ProbeGpuCopyPath(src_device_id, dst_device_id);
+  if (cached) {
+    // Peer access is enabled in both directions so the reverse copy
+    // has the same path.
+    const uint8_t value = static_cast<uint8_t>(*path) + 1;
+    gpu_copy_paths[src_device_id][dst_device_id].store(
+        value, std::memory_order_release);
+    gpu_copy_paths[dst_device_id][src_device_id].store(
+        value, std::memory_order_release);
+  }
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "GPU peer access not supported");
 #endif  // TRITON_ENABLE_GPU
+}
 
 TRITONSERVER_Error*
 CopyBuffer(
@@ -560,6 +742,19 @@ CopyBuffer(
     const TRITONSERVER_MemoryType dst_memory_type,
     const int64_t dst_memory_type_id, const size_t byte_size, const void* src,
     void* dst, cudaStream_t cuda_stream, bool* cuda_used)
+{
+  return CopyBuffer(
+      msg.c_str(), src_memory_type, src_memory_type_id, dst_memory_type,
+      dst_memory_type_id, byte_size, src, dst, cuda_stream, cuda_used);
+}
+
+TRITONSERVER_Error*
+CopyBuffer(
+    const char* msg, const TRITONSERVER_MemoryType src_memory_type,
+    const int64_t src_memory_type_id,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, const size_t byte_size, const void* src,
+    void* dst, cudaStream_t cuda_stream, bool* cuda_used)
 {
   *cuda_used = false;
 
@@ -571,7 +766,6 @@ CopyBuffer(
     memcpy(dst, src, byte_size);
   } else {
 #ifdef TRITON_ENABLE_GPU
-    // [TODO] use cudaMemcpyDefault if UVM is supported for the device
     auto copy_kind = cudaMemcpyDeviceToDevice;
     if (src_memory_type != TRITONSERVER_MEMORY_GPU) {
       copy_kind = cudaMemcpyHostToDevice;
@@ -581,22 +775,34 @@ CopyBuffer(
 
     if ((src_memory_type_id != dst_memory_type_id) &&
         (copy_kind == cudaMemcpyDeviceToDevice)) {
+      // The copy is direct if EnableGpuPeerAccess() enabled peer access
+      // between the GPUs, otherwise the driver stages it.
       RETURN_IF_CUDA_ERR(
           cudaMemcpyPeerAsync(
               dst, dst_memory_type_id, src, src_memory_type_id, byte_size,
               cuda_stream),
-          msg + ": failed to perform CUDA copy");
+          std::string(msg) + ": failed to perform CUDA copy");
     } else {
+      // With unified addressing the driver infers the direction of the
+      // copy from the pointers, which is also correct for host buffers
+      // that are actually managed or device memory.
+      const int64_t device_id = (src_memory_type == TRITONSERVER_MEMORY_GPU)
+                                    ? src_memory_type_id
+                                    : dst_memory_type_id;
+      if (UnifiedAddressing(device_id)) {
+        copy_kind = cudaMemcpyDefault;
+      }
       RETURN_IF_CUDA_ERR(
           cudaMemcpyAsync(dst, src, byte_size, copy_kind, cuda_stream),
-          msg + ": failed to perform CUDA copy");
+          std::string(msg) + ": failed to perform CUDA copy");
     }
 
     *cuda_used = true;
 #else
     return TRITONSERVER_ErrorNew(
         TRITONSERVER_ERROR_INTERNAL,
-        std::string(msg + ": try to use CUDA copy while GPU is not supported")
+        (std::string(msg) +
+         ": try to use CUDA copy while GPU is not supported")
             .c_str());
 #endif  // TRITON_ENABLE_GPU
   }
@@ -673,6 +879,104 @@ ReadTextFile(const std::string& path, std::string* contents)
   return nullptr;  // success
 }
 
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), byte_size_);
+  }
+#endif  // !_WIN32
+}
+
+TRITONSERVER_Error*
+MapFile(
+    const std::string& path, const bool prefetch,
+    std::shared_ptr<const MappedFile>* file)
+{
+  // The files mapped by the process. A mapping is shared while it is
+  // referenced and the file is unchanged.
+  static std::mutex mu;
+  static std::unordered_map<std::string, std::weak_ptr<const MappedFile>>
+      mapped_files;
+
+  struct stat st;
+#ifdef _WIN32
+  if (stat(path.c_str(), &st) != 0) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        ("failed to stat file '" + path + "': " + strerror(errno)).c_str());
+  }
+#else
+  // Open the file before reading its properties, so that the size that
+  // is mapped is the size of the file that is open even if 'path' is
+  // replaced meanwhile. The mapping holds its own reference to the file
+  // so the descriptor isn't needed after mapping.
+  struct FileCloser {
+    ~FileCloser() { close(fd_); }
+    int fd_;
+  };
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        ("failed to open file '" + path + "': " + strerror(errno)).c_str());
+  }
+  FileCloser closer{fd};
+  if (fstat(fd, &st) != 0) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        ("failed to stat file '" + path + "': " + strerror(errno)).c_str());
+  }
+#endif  // _WIN32
+
+  std::lock_guard<std::mutex> lk(mu);
+  auto it = mapped_files.find(path);
+  if (it != mapped_files.end()) {
+    *file = it->second.lock();
+    if ((*file != nullptr) &&
+        ((*file)->device_ == static_cast<uint64_t>(st.st_dev)) &&
+        ((*file)->inode_ == static_cast<uint64_t>(st.st_ino)) &&
+        ((*file)->modified_time_ == static_cast<int64_t>(st.st_mtime)) &&
+        ((*file)->byte_size_ == static_cast<size_t>(st.st_size))) {
+      return nullptr;  // success
+    }
+  }
+
+  std::shared_ptr<MappedFile> mapped(new MappedFile(path));
+  mapped->device_ = st.st_dev;
+  mapped->inode_ = st.st_ino;
+  mapped->modified_time_ = st.st_mtime;
+
+#ifdef _WIN32
+  RETURN_IF_ERROR(ReadTextFile(path, &mapped->contents_));
+  mapped->byte_size_ = mapped->contents_.size();
+  if (mapped->byte_size_ > 0) {
+    mapped->data_ = &mapped->contents_[0];
+  }
+#else
+  mapped->byte_size_ = st.st_size;
+  if (mapped->byte_size_ > 0) {
+    void* data =
+        mmap(nullptr, mapped->byte_size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          ("failed to map file '" + path + "': " + strerror(errno)).c_str());
+    }
+    mapped->data_ = reinterpret_cast<const char*>(data);
+
+    if (prefetch) {
+      // Only advice, the contents are read on access anyway.
+      madvise(data, mapped->byte_size_, MADV_WILLNEED);
+    }
+  }
+#endif  // _WIN32
+
+  mapped_files[path] = mapped;
+  *file = std::move(mapped);
+  return nullptr;  // success
+}
+
 TRITONSERVER_Error*
 IsDirectory(const std::string& path, bool* is_dir)
 {
@@ -714,45 +1018,137 @@ JoinPath(std::initializer_list<std::string> segments)
   return joined;
 }
 
+namespace {
+
+// An entry of a directory and whether it is a directory, if known.
+struct DirectoryEntry {
+  explicit DirectoryEntry(const std::string& name)
+      : name_(name), type_known_(false), is_dir_(false)
+  {
+  }
+
+  std::string name_;
+  bool type_known_;
+  bool is_dir_;
+};
+
+// Get the entries of directory 'path'. The type of the entries is
+// taken from the directory itself when the file system reports it, so
+// that it doesn't need a stat() call for each entry.
+TRITONSERVER_Error*
+GetDirectoryEntries(
+    const std::string& path, std::vector<DirectoryEntry>* entries)
+{
+#ifdef _WIN32
+  std::set<std::string> contents;
+  RETURN_IF_ERROR(GetDirectoryContents(path, &contents));
+  for (const auto& name : contents) {
+    entries->emplace_back(name);
+  }
+#else
+  DIR* dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("failed to open directory: ") + path).c_str());
+  }
+
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    std::string entryname = entry->d_name;
+    if ((entryname != ".") && (entryname != "..")) {
+      entries->emplace_back(entryname);
+#ifdef _DIRENT_HAVE_D_TYPE
+      // Symbolic links are resolved with stat() like the unknown types.
+      if ((entry->d_type != DT_UNKNOWN) && (entry->d_type != DT_LNK)) {
+        entries->back().type_known_ = true;
+        entries->back().is_dir_ = (entry->d_type == DT_DIR);
+      }
+#endif  // _DIRENT_HAVE_D_TYPE
+    }
+  }
+
+  closedir(dir);
+#endif  // _WIN32
+  return nullptr;  // success
+}
+
+// Find the type of the entries of directory 'path' whose type is not
+// known. The entries are checked in parallel when there are many of
+// them, as each check is a round trip on network file systems.
+TRITONSERVER_Error*
+ResolveDirectoryEntries(
+    const std::string& path, std::vector<DirectoryEntry>* entries)
+{
+  std::vector<DirectoryEntry*> unknown;
+  for (auto& entry : *entries) {
+    if (!entry.type_known_) {
+      unknown.push_back(&entry);
+    }
+  }
+
+  constexpr size_t kMinEntriesPerThread = 16;
+  constexpr size_t kMaxThreads = 8;
+  const size_t thread_count = std::max(
+      size_t(1), std::min(kMaxThreads, unknown.size() / kMinEntriesPerThread));
+
+  std::vector<TRITONSERVER_Error*> errors(thread_count, nullptr);
+  auto resolve = [&](const size_t thread_idx) {
+    for (size_t idx = thread_idx; idx < unknown.size(); idx += thread_count) {
+      auto entry = unknown[idx];
+      errors[thread_idx] =
+          IsDirectory(JoinPath({path, entry->name_}), &entry->is_dir_);
+      if (errors[thread_idx] != nullptr) {
+        return;
+      }
+      entry->type_known_ = true;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t thread_idx = 1; thread_idx < thread_count; ++thread_idx) {
+    threads.emplace_back(resolve, thread_idx);
+  }
+  resolve(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  TRITONSERVER_Error* err = nullptr;
+  for (auto thread_err : errors) {
+    if (err == nullptr) {
+      err = thread_err;
+    } else if (thread_err != nullptr) {
+      TRITONSERVER_ErrorDelete(thread_err);
+    }
+  }
+  return err;
+}
+
+}  // namespace
+
 TRITONSERVER_Error*
 ModelPaths(
     const std::string& model_repository_path, uint64_t version,
     const bool ignore_directories, const bool ignore_files,
     std::unordered_map<std::string, std::string>* model_paths)
 {
-  std::set<std::string> model_files;
+  std::vector<DirectoryEntry> entries;
   // Read all the files in 'path' and filter by type for different requirements
   auto path = JoinPath({model_repository_path, std::to_string(version)});
-  RETURN_IF_ERROR(GetDirectoryContents(path, &model_files));
-  if (ignore_directories) {
-    // Erase directory entries...
-    for (auto iter = model_files.begin(); iter != model_files.end();) {
-      bool is_dir;
-      RETURN_IF_ERROR(IsDirectory(JoinPath({path, *iter}), &is_dir));
-      if (is_dir) {
-        iter = model_files.erase(iter);
-      } else {
-        ++iter;
-      }
-    }
-  }
-  if (ignore_files) {
-    // Erase non-directory entries...
-    for (auto iter = model_files.begin(); iter != model_files.end();) {
-      bool is_dir;
-      RETURN_IF_ERROR(IsDirectory(JoinPath({path, *iter}), &is_dir));
-      if (!is_dir) {
-        iter = model_files.erase(iter);
-      } else {
-        ++iter;
-      }
-    }
+  RETURN_IF_ERROR(GetDirectoryEntries(path, &entries));
+  if (ignore_directories || ignore_files) {
+    RETURN_IF_ERROR(ResolveDirectoryEntries(path, &entries));
   }
 
-  for (const auto& filename : model_files) {
-    const auto model_path = JoinPath({path, filename});
+  for (const auto& entry : entries) {
+    if ((ignore_directories && entry.is_dir_) ||
+        (ignore_files && !entry.is_dir_)) {
+      continue;
+    }
+    const auto model_path = JoinPath({path, entry.name_});
     model_paths->emplace(
-        std::piecewise_construct, std::make_tuple(filename),
+        std::piecewise_construct, std::make_tuple(entry.name_),
         std::make_tuple(model_path));
   }
 
@@ -799,6 +1195,69 @@ CreateCudaStream(
   return nullptr;  // success
 }
 
+TRITONSERVER_Error*
+GetCudaStreamDevice(cudaStream_t stream, int* device_id)
+{
+#ifdef TRITON_ENABLE_GPU
+#if CUDART_VERSION >= 12080
+  if (stream != nullptr) {
+    RETURN_IF_CUDA_ERROR(
+        cudaStreamGetDevice(stream, device_id), TRITONSERVER_ERROR_INTERNAL,
+        std::string("unable to get the device of stream"));
+    return nullptr;  // success
+  }
+#endif  // CUDART_VERSION >= 12080
+  RETURN_IF_CUDA_ERROR(
+      cudaGetDevice(device_id), TRITONSERVER_ERROR_INTERNAL,
+      std::string("failed to get device"));
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "GPU streams not supported");
+#endif  // TRITON_ENABLE_GPU
+}
+
+TRITONSERVER_Error*
+GetDeviceComputeCapability(const int device_id, std::string* cc)
+{
+  cc->clear();
+
+#ifdef TRITON_ENABLE_GPU
+  static std::mutex mu;
+  static std::unordered_map<int, std::string> device_ccs;
+
+  std::lock_guard<std::mutex> lk(mu);
+  auto it = device_ccs.find(device_id);
+  if (it == device_ccs.end()) {
+    // Query only the attributes needed instead of all the device
+    // properties, which can take tens of milliseconds.
+    int major, minor;
+    RETURN_IF_CUDA_ERROR(
+        cudaDeviceGetAttribute(
+            &major, cudaDevAttrComputeCapabilityMajor, device_id),
+        TRITONSERVER_ERROR_INTERNAL,
+        std::string("unable to get compute capability of GPU ") +
+            std::to_string(device_id));
+    RETURN_IF_CUDA_ERROR(
+        cudaDeviceGetAttribute(
+            &minor, cudaDevAttrComputeCapabilityMinor, device_id),
+        TRITONSERVER_ERROR_INTERNAL,
+        std::string("unable to get compute capability of GPU ") +
+            std::to_string(device_id));
+    it = device_ccs
+             .emplace(
+                 device_id, std::to_string(major) + "." + std::to_string(minor))
+             .first;
+  }
+  *cc = it->second;
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "GPU compute capability not supported");
+#endif  // TRITON_ENABLE_GPU
+}
+
 TRITONSERVER_Error*
 ParseLongLongValue(const std::string& value, int64_t* parsed_value)
 {
@@ -883,4 +1342,103 @@ GetParameterValue(
   return nullptr;  // success
 }
 
+TRITONSERVER_DataType
+ModelConfigDataTypeToTritonServerDataType(const std::string& data_type_str)
+{
+  // Must start with "TYPE_".
+  if (data_type_str.rfind("TYPE_", 0) != 0) {
+    return TRITONSERVER_TYPE_INVALID;
+  }
+
+  const std::string dtype = data_type_str.substr(strlen("TYPE_"));
+  if (dtype == "STRING") {
+    return TRITONSERVER_TYPE_BYTES;
+  }
+
+  return TRITONSERVER_StringToDataType(dtype.c_str());
+}
+
+//
+// BatchInput
+//
+TRITONSERVER_Error*
+BatchInput::ParseFromModelConfig(
+    common::TritonJson::Value& config, std::vector<BatchInput>* batch_inputs)
+{
+  batch_inputs->clear();
+  common::TritonJson::Value bis;
+  if (config.Find("batch_input", &bis)) {
+    for (size_t i = 0; i < bis.ArraySize(); ++i) {
+      common::TritonJson::Value bi;
+      RETURN_IF_ERROR(bis.IndexAsObject(i, &bi));
+      batch_inputs->emplace_back();
+      RETURN_IF_ERROR(batch_inputs->back().Init(bi));
+    }
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BatchInput::Init(common::TritonJson::Value& bi_config)
+{
+  RETURN_IF_ERROR(bi_config.MemberAsString("kind", &kind_str_));
+  if (kind_str_ == "BATCH_ELEMENT_COUNT") {
+    kind_ = Kind::BATCH_ELEMENT_COUNT;
+  } else if (kind_str_ == "BATCH_ACCUMULATED_ELEMENT_COUNT") {
+    kind_ = Kind::BATCH_ACCUMULATED_ELEMENT_COUNT;
+  } else if (kind_str_ == "BATCH_ACCUMULATED_ELEMENT_COUNT_WITH_ZERO") {
+    kind_ = Kind::BATCH_ACCUMULATED_ELEMENT_COUNT_WITH_ZERO;
+  } else if (kind_str_ == "BATCH_MAX_ELEMENT_COUNT_AS_SHAPE") {
+    kind_ = Kind::BATCH_MAX_ELEMENT_COUNT_AS_SHAPE;
+  } else if (kind_str_ == "BATCH_ITEM_SHAPE") {
+    kind_ = Kind::BATCH_ITEM_SHAPE;
+  } else {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("unexpected batch input kind '") + kind_str_ + "'")
+            .c_str());
+  }
+
+  std::string data_type_str;
+  RETURN_IF_ERROR(bi_config.MemberAsString("data_type", &data_type_str));
+  data_type_ = ModelConfigDataTypeToTritonServerDataType(data_type_str);
+  if ((data_type_ != TRITONSERVER_TYPE_INT32) &&
+      (data_type_ != TRITONSERVER_TYPE_INT64) &&
+      (data_type_ != TRITONSERVER_TYPE_FP32)) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("unexpected data type '") + data_type_str +
+         "' for batch input of kind '" + kind_str_ +
+         "', expecting TYPE_INT32, TYPE_INT64 or TYPE_FP32")
+            .c_str());
+  }
+
+  common::TritonJson::Value bi_target_names;
+  RETURN_IF_ERROR(bi_config.MemberAsArray("target_name", &bi_target_names));
+  for (size_t i = 0; i < bi_target_names.ArraySize(); ++i) {
+    std::string tn;
+    RETURN_IF_ERROR(bi_target_names.IndexAsString(i, &tn));
+    target_names_.emplace_back(std::move(tn));
+  }
+
+  common::TritonJson::Value bi_source_inputs;
+  RETURN_IF_ERROR(bi_config.MemberAsArray("source_input", &bi_source_inputs));
+  for (size_t i = 0; i < bi_source_inputs.ArraySize(); ++i) {
+    std::string si;
+    RETURN_IF_ERROR(bi_source_inputs.IndexAsString(i, &si));
+    source_inputs_.emplace_back(std::move(si));
+  }
+  if (source_inputs_.size() != 1) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("batch input of kind '") + kind_str_ +
+         "' expects exactly 1 source input, got " +
+         std::to_string(source_inputs_.size()))
+            .c_str());
+  }
+
+  return nullptr;  // success
+}
+
 }}  // namespace triton::backend
@@ -0,0 +1,273 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_copy_graph.h"
+
+#include <algorithm>
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend {
+
+namespace {
+
+#ifdef TRITON_ENABLE_GPU
+cudaMemcpyKind
+CopyKind(
+    const TRITONSERVER_MemoryType src_memory_type,
+    const TRITONSERVER_MemoryType dst_memory_type)
+{
+  if (src_memory_type != TRITONSERVER_MEMORY_GPU) {
+    return cudaMemcpyHostToDevice;
+  } else if (dst_memory_type != TRITONSERVER_MEMORY_GPU) {
+    return cudaMemcpyDeviceToHost;
+  }
+  return cudaMemcpyDeviceToDevice;
+}
+#endif  // TRITON_ENABLE_GPU
+
+}  // namespace
+
+//
+// BackendCopyGraph::Graph
+//
+#ifdef TRITON_ENABLE_GPU
+struct BackendCopyGraph::Graph {
+  Graph() : graph_(nullptr), exec_(nullptr) {}
+  ~Graph()
+  {
+    if (exec_ != nullptr) {
+      cudaGraphExecDestroy(exec_);
+    }
+    if (graph_ != nullptr) {
+      cudaGraphDestroy(graph_);
+    }
+  }
+
+  // Build and instantiate a graph with one memcpy node per copy. The
+  // copies are to disjoint buffers so the nodes have no dependencies.
+  bool Build(const std::vector<Copy>& copies)
+  {
+    if (cudaGraphCreate(&graph_, 0) != cudaSuccess) {
+      graph_ = nullptr;
+      return false;
+    }
+
+    nodes_.resize(copies.size());
+    for (size_t idx = 0; idx < copies.size(); ++idx) {
+      const Copy& copy = copies[idx];
+      if (cudaGraphAddMemcpyNode1D(
+              &nodes_[idx], graph_, nullptr, 0, copy.dst_, copy.src_,
+              copy.byte_size_,
+              CopyKind(copy.src_memory_type_, copy.dst_memory_type_)) !=
+          cudaSuccess) {
+        return false;
+      }
+    }
+
+    if (cudaGraphInstantiateWithFlags(&exec_, graph_, 0) != cudaSuccess) {
+      exec_ = nullptr;
+      return false;
+    }
+
+    copies_ = copies;
+    return true;
+  }
+
+  // Update the addresses of the copies that changed since the last
+  // launch, the key guarantees that the directions and the byte sizes
+  // are the same.
+  bool Update(const std::vector<Copy>& copies)
+  {
+    for (size_t idx = 0; idx < copies.size(); ++idx) {
+      const Copy& copy = copies[idx];
+      Copy& last_copy = copies_[idx];
+      if ((copy.src_ == last_copy.src_) && (copy.dst_ == last_copy.dst_)) {
+        continue;
+      }
+
+      if (cudaGraphExecMemcpyNodeSetParams1D(
+              exec_, nodes_[idx], copy.dst_, copy.src_, copy.byte_size_,
+              CopyKind(copy.src_memory_type_, copy.dst_memory_type_)) !=
+          cudaSuccess) {
+        return false;
+      }
+      last_copy = copy;
+    }
+
+    return true;
+  }
+
+  cudaGraph_t graph_;
+  cudaGraphExec_t exec_;
+  std::vector<cudaGraphNode_t> nodes_;
+  // The copies the graph was last launched with.
+  std::vector<Copy> copies_;
+};
+#else
+struct BackendCopyGraph::Graph {
+};
+#endif  // TRITON_ENABLE_GPU
+
+//
+// BackendCopyGraph
+//
+constexpr size_t BackendCopyGraph::kDefaultMaxGraphCount;
+
+BackendCopyGraph::BackendCopyGraph(
+    const size_t min_copy_count, const size_t max_graph_count)
+    : min_copy_count_(min_copy_count),
+      max_graph_count_(std::max(max_graph_count, size_t(1)))
+{
+}
+
+BackendCopyGraph::~BackendCopyGraph() = default;
+
+bool
+BackendCopyGraph::IsGraphCopy(
+    const TRITONSERVER_MemoryType src_memory_type,
+    const int64_t src_memory_type_id,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id)
+{
+#ifdef TRITON_ENABLE_GPU
+  if ((src_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (dst_memory_type == TRITONSERVER_MEMORY_GPU)) {
+    return src_memory_type_id == dst_memory_type_id;
+  }
+  return ((src_memory_type == TRITONSERVER_MEMORY_GPU) &&
+          (dst_memory_type == TRITONSERVER_MEMORY_CPU_PINNED)) ||
+         ((src_memory_type == TRITONSERVER_MEMORY_CPU_PINNED) &&
+          (dst_memory_type == TRITONSERVER_MEMORY_GPU));
+#else
+  return false;
+#endif  // TRITON_ENABLE_GPU
+}
+
+void
+BackendCopyGraph::AddCopy(
+    const void* src, const TRITONSERVER_MemoryType src_memory_type,
+    const int64_t src_memory_type_id, void* dst,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, const size_t byte_size)
+{
+  Copy copy;
+  copy.src_ = src;
+  copy.src_memory_type_ = src_memory_type;
+  copy.dst_ = dst;
+  copy.dst_memory_type_ = dst_memory_type;
+  copy.device_id_ = (src_memory_type == TRITONSERVER_MEMORY_GPU)
+                        ? src_memory_type_id
+                        : dst_memory_type_id;
+  copy.byte_size_ = byte_size;
+  pending_copies_.push_back(copy);
+}
+
+TRITONSERVER_Error*
+BackendCopyGraph::Launch(cudaStream_t stream, bool* cuda_used)
+{
+  *cuda_used = false;
+  if (pending_copies_.empty()) {
+    return nullptr;  // success
+  }
+
+  TRITONSERVER_Error* err = nullptr;
+#ifdef TRITON_ENABLE_GPU
+  if ((pending_copies_.size() < min_copy_count_) || !LaunchGraph(stream)) {
+    err = LaunchCopies(stream);
+  }
+  *cuda_used = true;
+#else
+  err = TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_INTERNAL,
+      "copy graph: try to use CUDA copy while GPU is not supported");
+#endif  // TRITON_ENABLE_GPU
+
+  pending_copies_.clear();
+  return err;
+}
+
+#ifdef TRITON_ENABLE_GPU
+bool
+BackendCopyGraph::LaunchGraph(cudaStream_t stream)
+{
+  key_.clear();
+  for (const auto& copy : pending_copies_) {
+    key_.push_back(
+        static_cast<int64_t>(
+            CopyKind(copy.src_memory_type_, copy.dst_memory_type_)));
+    key_.push_back(copy.device_id_);
+    key_.push_back(static_cast<int64_t>(copy.byte_size_));
+  }
+
+  auto it = graphs_.find(&key_);
+  if (it == graphs_.end()) {
+    std::unique_ptr<Graph> graph(new Graph());
+    if (!graph->Build(pending_copies_)) {
+      return false;
+    }
+    if (lru_.size() >= max_graph_count_) {
+      graphs_.erase(&lru_.back().first);
+      lru_.pop_back();
+    }
+    lru_.emplace_front(key_, std::move(graph));
+    it = graphs_.emplace(&lru_.front().first, lru_.begin()).first;
+  } else {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    if (!it->second->second->Update(pending_copies_)) {
+      lru_.erase(it->second);
+      graphs_.erase(it);
+      return false;
+    }
+  }
+
+  // A graph that fails to launch is not kept, the copies are then
+  // issued one by one.
+  if (cudaGraphLaunch(it->second->second->exec_, stream) != cudaSuccess) {
+    lru_.erase(it->second);
+    graphs_.erase(it);
+    return false;
+  }
+
+  return true;
+}
+
+TRITONSERVER_Error*
+BackendCopyGraph::LaunchCopies(cudaStream_t stream)
+{
+  for (const auto& copy : pending_copies_) {
+    RETURN_IF_CUDA_ERROR(
+        cudaMemcpyAsync(
+            copy.dst_, copy.src_, copy.byte_size_,
+            CopyKind(copy.src_memory_type_, copy.dst_memory_type_), stream),
+        TRITONSERVER_ERROR_INTERNAL,
+        std::string("copy graph: failed to perform CUDA copy"));
+  }
+
+  return nullptr;  // success
+}
+
+#endif  // TRITON_ENABLE_GPU
+
+}}  // namespace triton::backend
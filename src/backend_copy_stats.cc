@@ -0,0 +1,191 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_copy_stats.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendCopyStats
+//
+constexpr size_t BackendCopyStats::kStageCount;
+constexpr size_t BackendCopyStats::kHistogramBucketCount;
+constexpr size_t BackendCopyStats::kMemoryTypeCount;
+
+BackendCopyStats::BackendCopyStats()
+{
+  Reset();
+}
+
+void
+BackendCopyStats::RecordStage(const Stage stage, const uint64_t duration_ns)
+{
+  StageStats& stats = stages_[static_cast<size_t>(stage)];
+  stats.count_.fetch_add(1, std::memory_order_relaxed);
+  stats.total_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+
+  uint64_t max_ns = stats.max_ns_.load(std::memory_order_relaxed);
+  while ((duration_ns > max_ns) &&
+         !stats.max_ns_.compare_exchange_weak(
+             max_ns, duration_ns, std::memory_order_relaxed)) {
+  }
+
+  size_t bucket = 0;
+  uint64_t duration_us = duration_ns / 1000;
+  while ((duration_us > 0) && (bucket < (kHistogramBucketCount - 1))) {
+    duration_us >>= 1;
+    bucket++;
+  }
+  stats.histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+BackendCopyStats::RecordCopy(
+    const TRITONSERVER_MemoryType src_memory_type,
+    const TRITONSERVER_MemoryType dst_memory_type, const uint64_t byte_size)
+{
+  const size_t src = static_cast<size_t>(src_memory_type);
+  const size_t dst = static_cast<size_t>(dst_memory_type);
+  if ((src < kMemoryTypeCount) && (dst < kMemoryTypeCount)) {
+    copy_bytes_[src][dst].fetch_add(byte_size, std::memory_order_relaxed);
+    copy_count_[src][dst].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void
+BackendCopyStats::RecordZeroCopy(const bool hit)
+{
+  if (hit) {
+    zero_copy_hits_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    zero_copy_misses_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void
+BackendCopyStats::RecordPinnedFallback()
+{
+  pinned_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+BackendCopyStats::RecordPinnedDecision(const bool staged)
+{
+  if (staged) {
+    pinned_staged_tensors_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    pinned_direct_tensors_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void
+BackendCopyStats::GetSnapshot(Snapshot* snapshot) const
+{
+  for (size_t s = 0; s < kStageCount; ++s) {
+    const StageStats& stats = stages_[s];
+    StageSnapshot& stage_snapshot = snapshot->stages_[s];
+    stage_snapshot.count_ = stats.count_.load(std::memory_order_relaxed);
+    stage_snapshot.total_ns_ = stats.total_ns_.load(std::memory_order_relaxed);
+    stage_snapshot.max_ns_ = stats.max_ns_.load(std::memory_order_relaxed);
+    for (size_t b = 0; b < kHistogramBucketCount; ++b) {
+      stage_snapshot.histogram_[b] =
+          stats.histogram_[b].load(std::memory_order_relaxed);
+    }
+  }
+
+  for (size_t src = 0; src < kMemoryTypeCount; ++src) {
+    for (size_t dst = 0; dst < kMemoryTypeCount; ++dst) {
+      snapshot->copy_bytes_[src][dst] =
+          copy_bytes_[src][dst].load(std::memory_order_relaxed);
+      snapshot->copy_count_[src][dst] =
+          copy_count_[src][dst].load(std::memory_order_relaxed);
+    }
+  }
+
+  snapshot->zero_copy_hits_ = zero_copy_hits_.load(std::memory_order_relaxed);
+  snapshot->zero_copy_misses_ =
+      zero_copy_misses_.load(std::memory_order_relaxed);
+  snapshot->pinned_fallbacks_ =
+      pinned_fallbacks_.load(std::memory_order_relaxed);
+  snapshot->pinned_staged_tensors_ =
+      pinned_staged_tensors_.load(std::memory_order_relaxed);
+  snapshot->pinned_direct_tensors_ =
+      pinned_direct_tensors_.load(std::memory_order_relaxed);
+}
+
+void
+BackendCopyStats::Reset()
+{
+  for (auto& stats : stages_) {
+    stats.count_ = 0;
+    stats.total_ns_ = 0;
+    stats.max_ns_ = 0;
+    for (auto& bucket : stats.histogram_) {
+      bucket = 0;
+    }
+  }
+
+  for (size_t src = 0; src < kMemoryTypeCount; ++src) {
+    for (size_t dst = 0; dst < kMemoryTypeCount; ++dst) {
+      copy_bytes_[src][dst] = 0;
+      copy_count_[src][dst] = 0;
+    }
+  }
+
+  zero_copy_hits_ = 0;
+  zero_copy_misses_ = 0;
+  pinned_fallbacks_ = 0;
+  pinned_staged_tensors_ = 0;
+  pinned_direct_tensors_ = 0;
+}
+
+const char*
+BackendCopyStats::StageString(const Stage stage)
+{
+  switch (stage) {
+    case Stage::COLLECTOR_PROCESS:
+      return "COLLECTOR_PROCESS";
+    case Stage::COLLECTOR_PINNED_FLUSH:
+      return "COLLECTOR_PINNED_FLUSH";
+    case Stage::COLLECTOR_SYNC_WAIT:
+      return "COLLECTOR_SYNC_WAIT";
+    case Stage::COLLECTOR_FINALIZE:
+      return "COLLECTOR_FINALIZE";
+    case Stage::RESPONDER_PROCESS:
+      return "RESPONDER_PROCESS";
+    case Stage::RESPONDER_PINNED_FLUSH:
+      return "RESPONDER_PINNED_FLUSH";
+    case Stage::RESPONDER_SYNC_WAIT:
+      return "RESPONDER_SYNC_WAIT";
+    case Stage::RESPONDER_FINALIZE:
+      return "RESPONDER_FINALIZE";
+    default:
+      break;
+  }
+
+  return "<invalid>";
+}
+
+}}  // namespace triton::backend
@@ -0,0 +1,416 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_fixed_shape.h"
+
+#include <algorithm>
+#include <cstring>
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend {
+
+namespace {
+
+// Get the byte size of a batch item of 'tensor' and of a batch of
+// 'max_batch_size' items, or an UNSUPPORTED error if the tensor
+// doesn't have a fixed byte size.
+TRITONSERVER_Error*
+FixedByteSizes(
+    const BackendModelConfig::Tensor& tensor, const char* tensor_kind,
+    const int max_batch_size, size_t* item_byte_size, size_t* max_byte_size)
+{
+  RETURN_ERROR_IF_TRUE(
+      (tensor.byte_size_ < 0) || tensor.is_shape_tensor_ ||
+          (tensor.has_reshape_ && (GetElementCount(tensor.reshape_) < 0)),
+      TRITONSERVER_ERROR_UNSUPPORTED,
+      std::string(
+          std::string(tensor_kind) + " '" + tensor.name_ +
+          "' does not have a fixed shape and data type"));
+  *item_byte_size = tensor.byte_size_;
+  *max_byte_size = tensor.byte_size_ * std::max(max_batch_size, 1);
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+CreateStagingBuffer(
+    TRITONBACKEND_MemoryManager* memory_manager, const size_t byte_size,
+    std::unique_ptr<BackendMemory>* staging)
+{
+  BackendMemory* memory = nullptr;
+  RETURN_IF_ERROR(BackendMemory::Create(
+      memory_manager,
+      {BackendMemory::AllocationType::CPU_PINNED_POOL,
+       BackendMemory::AllocationType::CPU_PINNED},
+      0 /* memory_type_id */, byte_size, &memory));
+  staging->reset(memory);
+  return nullptr;  // success
+}
+
+}  // namespace
+
+//
+// BackendFixedShapeCollector
+//
+TRITONSERVER_Error*
+BackendFixedShapeCollector::Create(
+    const BackendModelConfig::Tensor& input, const int max_batch_size,
+    TRITONBACKEND_MemoryManager* memory_manager,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    const bool pinned_enabled,
+    std::unique_ptr<BackendFixedShapeCollector>* collector)
+{
+  size_t item_byte_size, max_byte_size;
+  RETURN_IF_ERROR(FixedByteSizes(
+      input, "input", max_batch_size, &item_byte_size, &max_byte_size));
+
+  std::unique_ptr<BackendFixedShapeCollector> fc(
+      new BackendFixedShapeCollector(
+          input.name_, item_byte_size, max_byte_size, memory_type,
+          memory_type_id));
+  if (pinned_enabled && (memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (max_byte_size > 0)) {
+    RETURN_IF_ERROR(
+        CreateStagingBuffer(memory_manager, max_byte_size, &fc->staging_));
+  }
+
+  *collector = std::move(fc);
+  return nullptr;  // success
+}
+
+bool
+BackendFixedShapeCollector::Process(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<TRITONBACKEND_Response*>* responses, char* buffer,
+    cudaStream_t stream, size_t* byte_size)
+{
+  // The type of the destination is fixed for the collector, so pick
+  // the gather loop once instead of checking it for every buffer.
+  if (memory_type_ == TRITONSERVER_MEMORY_GPU) {
+    return Gather<false>(
+        requests, request_count, responses, buffer, stream, byte_size);
+  }
+  return Gather<true>(
+      requests, request_count, responses, buffer, stream, byte_size);
+}
+
+template <bool kHostTensor>
+bool
+BackendFixedShapeCollector::Gather(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<TRITONBACKEND_Response*>* responses, char* buffer,
+    cudaStream_t stream, size_t* byte_size)
+{
+  // Host buffers are copied with memcpy into the tensor, or into the
+  // staging buffer at the same offset. The staged bytes form runs that
+  // are copied to the tensor when a run ends.
+  char* host_buffer =
+      kHostTensor ? buffer
+                  : ((staging_ != nullptr) ? staging_->MemoryPtr() : nullptr);
+  size_t staged_begin = 0;
+  size_t staged_end = 0;
+  staged_responses_.clear();
+
+  bool cuda_copy = false;
+  size_t offset = 0;
+  for (uint32_t idx = 0; idx < request_count; idx++) {
+    auto& response = (*responses)[idx];
+
+    TRITONBACKEND_Input* input = nullptr;
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        &response,
+        TRITONBACKEND_RequestInput(requests[idx], name_.c_str(), &input));
+    uint64_t request_byte_size = 0;
+    uint32_t buffer_count = 0;
+    if (input != nullptr) {
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, TRITONBACKEND_InputProperties(
+                         input, nullptr, nullptr, nullptr, nullptr,
+                         &request_byte_size, &buffer_count));
+    }
+    if ((response != nullptr) &&
+        (((request_byte_size % item_byte_size_) != 0) ||
+         ((offset + request_byte_size) > max_byte_size_))) {
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response,
+          TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INVALID_ARG,
+              (std::string("unexpected byte size ") +
+               std::to_string(request_byte_size) + " for input '" + name_ +
+               "', expecting a multiple of " +
+               std::to_string(item_byte_size_) + " within the " +
+               std::to_string(max_byte_size_) + " bytes of the batch")
+                  .c_str()));
+    }
+    if (response == nullptr) {
+      offset += request_byte_size;
+      continue;
+    }
+
+    size_t buffer_offset = offset;
+    for (uint32_t buffer_idx = 0; buffer_idx < buffer_count; ++buffer_idx) {
+      const void* src_buffer;
+      size_t src_byte_size;
+      TRITONSERVER_MemoryType src_memory_type;
+      int64_t src_memory_type_id;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, TRITONBACKEND_InputBuffer(
+                         input, buffer_idx, &src_buffer, &src_byte_size,
+                         &src_memory_type, &src_memory_type_id));
+      if (response == nullptr) {
+        break;
+      }
+
+      if ((host_buffer != nullptr) &&
+          (src_memory_type != TRITONSERVER_MEMORY_GPU)) {
+        std::memcpy(host_buffer + buffer_offset, src_buffer, src_byte_size);
+        if (!kHostTensor) {
+          if (staged_end != buffer_offset) {
+            cuda_copy |= FlushStaged(
+                staged_begin, staged_end, buffer, stream, responses);
+            staged_begin = buffer_offset;
+          }
+          staged_end = buffer_offset + src_byte_size;
+          if (staged_responses_.empty() || (staged_responses_.back() != idx)) {
+            staged_responses_.push_back(idx);
+          }
+        }
+      } else {
+        bool cuda_used = false;
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &response, CopyBuffer(
+                           name_, src_memory_type, src_memory_type_id,
+                           memory_type_, memory_type_id_, src_byte_size,
+                           src_buffer, buffer + buffer_offset, stream,
+                           &cuda_used));
+        cuda_copy |= cuda_used;
+      }
+      buffer_offset += src_byte_size;
+    }
+    offset += request_byte_size;
+  }
+  if (!kHostTensor) {
+    cuda_copy |=
+        FlushStaged(staged_begin, staged_end, buffer, stream, responses);
+  }
+
+  *byte_size = offset;
+  return cuda_copy;
+}
+
+bool
+BackendFixedShapeCollector::FlushStaged(
+    const size_t begin, const size_t end, char* buffer, cudaStream_t stream,
+    std::vector<TRITONBACKEND_Response*>* responses)
+{
+  if (begin == end) {
+    staged_responses_.clear();
+    return false;
+  }
+
+  // The requests with bytes in the run don't have their input if the
+  // copy fails.
+  bool cuda_used = false;
+  TRITONSERVER_Error* err = CopyBuffer(
+      name_, staging_->MemoryType(), 0 /* memory_type_id */, memory_type_,
+      memory_type_id_, end - begin, staging_->MemoryPtr() + begin,
+      buffer + begin, stream, &cuda_used);
+  if (err != nullptr) {
+    for (const auto idx : staged_responses_) {
+      auto& response = (*responses)[idx];
+      if (response != nullptr) {
+        LOG_IF_ERROR(
+            TRITONBACKEND_ResponseSend(
+                response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+            "failed to send error response");
+        response = nullptr;
+      }
+    }
+    TRITONSERVER_ErrorDelete(err);
+  }
+
+  staged_responses_.clear();
+  return cuda_used;
+}
+
+//
+// BackendFixedShapeResponder
+//
+BackendFixedShapeResponder::BackendFixedShapeResponder(
+    const BackendModelConfig::Tensor& output, const bool batching,
+    const size_t item_byte_size, const size_t max_byte_size,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
+    : name_(output.name_), datatype_(output.datatype_), batching_(batching),
+      item_byte_size_(item_byte_size), max_byte_size_(max_byte_size),
+      memory_type_(memory_type), memory_type_id_(memory_type_id)
+{
+  if (batching_) {
+    shape_.push_back(1);
+  }
+  shape_.insert(shape_.end(), output.dims_.begin(), output.dims_.end());
+}
+
+TRITONSERVER_Error*
+BackendFixedShapeResponder::Create(
+    const BackendModelConfig::Tensor& output, const int max_batch_size,
+    TRITONBACKEND_MemoryManager* memory_manager,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    const bool pinned_enabled,
+    std::unique_ptr<BackendFixedShapeResponder>* responder)
+{
+  size_t item_byte_size, max_byte_size;
+  RETURN_IF_ERROR(FixedByteSizes(
+      output, "output", max_batch_size, &item_byte_size, &max_byte_size));
+
+  std::unique_ptr<BackendFixedShapeResponder> fr(
+      new BackendFixedShapeResponder(
+          output, (max_batch_size != 0), item_byte_size, max_byte_size,
+          memory_type, memory_type_id));
+  if (pinned_enabled && (memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (max_byte_size > 0)) {
+    RETURN_IF_ERROR(
+        CreateStagingBuffer(memory_manager, max_byte_size, &fr->staging_));
+  }
+
+  *responder = std::move(fr);
+  return nullptr;  // success
+}
+
+bool
+BackendFixedShapeResponder::ProcessTensor(
+    const BackendRequestMetadata& metadata,
+    std::vector<TRITONBACKEND_Response*>* responses, const char* buffer,
+    cudaStream_t stream)
+{
+  const size_t output_index = metadata.OutputIndex(name_);
+  if (output_index == BackendRequestMetadata::kNoOutput) {
+    return false;
+  }
+
+  const size_t item_count =
+      batching_ ? metadata.TotalBatchSize() : metadata.RequestCount();
+  const size_t byte_size =
+      std::min(item_count * item_byte_size_, max_byte_size_);
+
+  // Bring the whole output to the host with one copy, so the
+  // responses are set from host memory. The copies of the staged
+  // output to host response buffers wait for Finalize().
+  bool cuda_copy = false;
+  bool staged = false;
+  const char* src = buffer;
+  TRITONSERVER_MemoryType src_memory_type = memory_type_;
+  int64_t src_memory_type_id = memory_type_id_;
+  if ((staging_ != nullptr) && (byte_size > 0)) {
+    bool cuda_used = false;
+    TRITONSERVER_Error* err = CopyBuffer(
+        name_, memory_type_, memory_type_id_, staging_->MemoryType(),
+        0 /* memory_type_id */, byte_size, buffer, staging_->MemoryPtr(),
+        stream, &cuda_used);
+    if (err == nullptr) {
+      cuda_copy |= cuda_used;
+      staged = cuda_used;
+      src = staging_->MemoryPtr();
+      src_memory_type = staging_->MemoryType();
+      src_memory_type_id = 0;
+    } else {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("failed to stage output '") + name_ +
+           "': " + TRITONSERVER_ErrorMessage(err))
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+    }
+  }
+
+  size_t offset = 0;
+  for (size_t idx = 0; idx < responses->size(); idx++) {
+    auto& response = (*responses)[idx];
+    const size_t response_byte_size =
+        batching_ ? (metadata.BatchSize(idx) * item_byte_size_)
+                  : item_byte_size_;
+    if ((offset + response_byte_size) > byte_size) {
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response,
+          TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INTERNAL,
+              (std::string("output '") + name_ +
+               "' of the batch is too small for the response")
+                  .c_str()));
+      offset += response_byte_size;
+      continue;
+    }
+    if ((response == nullptr) ||
+        !metadata.IsOutputRequested(idx, output_index)) {
+      offset += response_byte_size;
+      continue;
+    }
+
+    if (batching_) {
+      shape_[0] = metadata.BatchSize(idx);
+    }
+    TRITONBACKEND_Output* response_output;
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        &response, TRITONBACKEND_ResponseOutput(
+                       response, &response_output, name_.c_str(), datatype_,
+                       shape_.data(), shape_.size()));
+    void* dst = nullptr;
+    TRITONSERVER_MemoryType dst_memory_type = src_memory_type;
+    int64_t dst_memory_type_id = src_memory_type_id;
+    if (response != nullptr) {
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, TRITONBACKEND_OutputBuffer(
+                         response_output, &dst, response_byte_size,
+                         &dst_memory_type, &dst_memory_type_id));
+    }
+    if ((response != nullptr) && staged &&
+        (dst_memory_type != TRITONSERVER_MEMORY_GPU)) {
+      deferred_copies_.emplace_back(
+          reinterpret_cast<char*>(dst), offset, response_byte_size);
+    } else if (response != nullptr) {
+      bool cuda_used = false;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, CopyBuffer(
+                         name_, src_memory_type, src_memory_type_id,
+                         dst_memory_type, dst_memory_type_id,
+                         response_byte_size, src + offset, dst, stream,
+                         &cuda_used));
+      cuda_copy |= cuda_used;
+    }
+    offset += response_byte_size;
+  }
+
+  return cuda_copy;
+}
+
+void
+BackendFixedShapeResponder::Finalize()
+{
+  for (const auto& copy : deferred_copies_) {
+    std::memcpy(
+        copy.dst_, staging_->MemoryPtr() + copy.offset_, copy.byte_size_);
+  }
+  deferred_copies_.clear();
+}
+
+}}  // namespace triton::backend
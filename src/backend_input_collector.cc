@@ -26,13 +26,305 @@
 
 #include "triton/backend/backend_input_collector.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include "triton/backend/backend_common.h"
 
+#ifdef TRITON_ENABLE_GPU
+#include "kernel.h"
+#endif  // TRITON_ENABLE_GPU
+
 namespace triton { namespace backend {
 
+namespace {
+
+template <typename T>
+void
+WriteBatchInputValues(const std::vector<int64_t>& values, char* buffer)
+{
+  T* dst = reinterpret_cast<T*>(buffer);
+  for (size_t idx = 0; idx < values.size(); ++idx) {
+    dst[idx] = static_cast<T>(values[idx]);
+  }
+}
+
+// Write a sequence control tensor of 'slot_count' slots. 'values' has
+// the value of each occupied slot, which for a boolean control is
+// non-zero if the slot holds 'true_value'. The unoccupied slots hold
+// 'false_value'.
+template <typename T>
+void
+WriteSequenceControlValues(
+    const std::vector<uint64_t>& values, const size_t slot_count,
+    const bool boolean, const T false_value, const T true_value, char* buffer)
+{
+  T* dst = reinterpret_cast<T*>(buffer);
+  if (boolean) {
+    std::fill_n(dst, slot_count, false_value);
+    for (size_t idx = 0; idx < values.size(); ++idx) {
+      if (values[idx] != 0) {
+        dst[idx] = true_value;
+      }
+    }
+  } else {
+    for (size_t idx = 0; idx < values.size(); ++idx) {
+      dst[idx] = static_cast<T>(values[idx]);
+    }
+    std::fill_n(dst + values.size(), slot_count - values.size(), false_value);
+  }
+}
+
+// IEEE 754 half precision element, converted on the host with
+// round to nearest even.
+struct Half {
+  uint16_t bits_;
+};
+
+float
+HalfToFloat(const uint16_t half)
+{
+  constexpr uint32_t kShiftedExponent = 0x7c00 << 13;
+  uint32_t bits = (half & 0x7fff) << 13;
+  const uint32_t exponent = bits & kShiftedExponent;
+  bits += (127 - 15) << 23;
+  if (exponent == kShiftedExponent) {
+    // Inf or NaN
+    bits += (128 - 16) << 23;
+  } else if (exponent == 0) {
+    // Zero or subnormal, renormalize
+    constexpr uint32_t kMagicBits = 113 << 23;
+    float magic, value;
+    std::memcpy(&magic, &kMagicBits, sizeof(magic));
+    bits += 1 << 23;
+    std::memcpy(&value, &bits, sizeof(value));
+    value -= magic;
+    std::memcpy(&bits, &value, sizeof(bits));
+  }
+  bits |= static_cast<uint32_t>(half & 0x8000) << 16;
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+uint16_t
+FloatToHalf(const float value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  bits &= 0x7fffffff;
+
+  if (bits >= (143 << 23)) {
+    // Overflow to Inf, or NaN
+    return sign | ((bits > (255 << 23)) ? 0x7e00 : 0x7c00);
+  }
+  if (bits < (113 << 23)) {
+    // Zero or subnormal, round by adding 0.5 which aligns the mantissa
+    constexpr uint32_t kMagicBits = 126 << 23;
+    float magic, rounded;
+    std::memcpy(&magic, &kMagicBits, sizeof(magic));
+    std::memcpy(&rounded, &bits, sizeof(rounded));
+    rounded += magic;
+    std::memcpy(&bits, &rounded, sizeof(bits));
+    return sign | static_cast<uint16_t>(bits - kMagicBits);
+  }
+  // Rebias the exponent and round the mantissa to nearest even
+  const uint32_t odd_mantissa = (bits >> 13) & 1;
+  bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xfff + odd_mantissa;
+  return sign | static_cast<uint16_t>(bits >> 13);
+}
+
+template <typename T>
+float
+LoadElement(const T value)
+{
+  return static_cast<float>(value);
+}
+
+float
+LoadElement(const Half value)
+{
+  return HalfToFloat(value.bits_);
+}
+
+void
+StoreElement(const float value, float* dst)
+{
+  *dst = value;
+}
+
+void
+StoreElement(const float value, Half* dst)
+{
+  dst->bits_ = FloatToHalf(value);
+}
+
+// Convert the 'count' elements of 'src', which are the elements of
+// the batch starting at 'element_offset', into the tensor 'dst'.
+// Without a layout change the loop has no dependencies between
+// elements so the compiler can vectorize it.
+template <typename S, typename D>
+void
+ConvertElements(
+    const S* src, const size_t count, const size_t element_offset,
+    const BackendInputCollector::InputConversion& conversion, D* dst)
+{
+  const float scale = conversion.scale_;
+  const float bias = conversion.bias_;
+  if (!conversion.nhwc_to_nchw_) {
+    D* out = dst + element_offset;
+    for (size_t idx = 0; idx < count; ++idx) {
+      StoreElement(LoadElement(src[idx]) * scale + bias, out + idx);
+    }
+    return;
+  }
+
+  // Walk the source in HWC order, tracking the position so that the
+  // CHW index doesn't need a division per element.
+  const size_t channels = conversion.channels_;
+  const size_t pixels = conversion.height_ * conversion.width_;
+  const size_t item_size = pixels * channels;
+  size_t item = element_offset / item_size;
+  size_t pixel = (element_offset % item_size) / channels;
+  size_t channel = element_offset % channels;
+  for (size_t idx = 0; idx < count; ++idx) {
+    StoreElement(
+        LoadElement(src[idx]) * scale + bias,
+        dst + (item * item_size) + (channel * pixels) + pixel);
+    if (++channel == channels) {
+      channel = 0;
+      if (++pixel == pixels) {
+        pixel = 0;
+        ++item;
+      }
+    }
+  }
+}
+
+template <typename D>
+void
+ConvertBuffer(
+    const char* src, const TRITONSERVER_DataType src_datatype,
+    const size_t count, const size_t element_offset,
+    const BackendInputCollector::InputConversion& conversion, D* dst)
+{
+  switch (src_datatype) {
+    case TRITONSERVER_TYPE_UINT8:
+      ConvertElements(
+          reinterpret_cast<const uint8_t*>(src), count, element_offset,
+          conversion, dst);
+      break;
+    case TRITONSERVER_TYPE_INT8:
+      ConvertElements(
+          reinterpret_cast<const int8_t*>(src), count, element_offset,
+          conversion, dst);
+      break;
+    case TRITONSERVER_TYPE_INT16:
+      ConvertElements(
+          reinterpret_cast<const int16_t*>(src), count, element_offset,
+          conversion, dst);
+      break;
+    case TRITONSERVER_TYPE_INT32:
+      ConvertElements(
+          reinterpret_cast<const int32_t*>(src), count, element_offset,
+          conversion, dst);
+      break;
+    case TRITONSERVER_TYPE_FP16:
+      ConvertElements(
+          reinterpret_cast<const Half*>(src), count, element_offset,
+          conversion, dst);
+      break;
+    default:
+      ConvertElements(
+          reinterpret_cast<const float*>(src), count, element_offset,
+          conversion, dst);
+      break;
+  }
+}
+
+bool
+IsConvertibleType(const TRITONSERVER_DataType datatype)
+{
+  switch (datatype) {
+    case TRITONSERVER_TYPE_UINT8:
+    case TRITONSERVER_TYPE_INT8:
+    case TRITONSERVER_TYPE_INT16:
+    case TRITONSERVER_TYPE_INT32:
+    case TRITONSERVER_TYPE_FP16:
+    case TRITONSERVER_TYPE_FP32:
+      return true;
+    default:
+      return false;
+  }
+}
+
+#ifdef TRITON_ENABLE_GPU
+ConvertType
+ToConvertType(const TRITONSERVER_DataType datatype)
+{
+  switch (datatype) {
+    case TRITONSERVER_TYPE_UINT8:
+      return ConvertType::UINT8;
+    case TRITONSERVER_TYPE_INT8:
+      return ConvertType::INT8;
+    case TRITONSERVER_TYPE_INT16:
+      return ConvertType::INT16;
+    case TRITONSERVER_TYPE_INT32:
+      return ConvertType::INT32;
+    case TRITONSERVER_TYPE_FP16:
+      return ConvertType::FP16;
+    default:
+      return ConvertType::FP32;
+  }
+}
+#endif  // TRITON_ENABLE_GPU
+
+}  // namespace
+
 //
 // BackendInputCollector
 //
+BackendInputCollector::~BackendInputCollector()
+{
+  ReleaseBatchMemories();
+}
+
+void
+BackendInputCollector::Reset(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<TRITONBACKEND_Response*>* responses)
+{
+  ReleaseBatchMemories();
+  requests_ = requests;
+  request_count_ = request_count;
+  responses_ = responses;
+  need_sync_ = false;
+
+  pending_pinned_byte_size_ = 0;
+  pending_pinned_offset_ = 0;
+  pending_pinned_inputs_.clear();
+  pending_host_byte_size_ = 0;
+  pending_host_copies_.clear();
+  staged_h2d_copies_.clear();
+  staged_d2h_copies_.clear();
+  pending_kernel_copies_.clear();
+  resident_keys_.clear();
+  resident_memories_.clear();
+  deferred_pinned_.clear();
+  deferred_inputs_.clear();
+}
+
+void
+BackendInputCollector::ReleaseBatchMemories()
+{
+  for (auto& arena_memory : arena_memories_) {
+    pinned_arena_->Return(arena_memory);
+  }
+  arena_memories_.clear();
+  backend_memories_.clear();
+}
+
 
 bool
 BackendInputCollector::GetInputBufferIfContiguous(
@@ -93,6 +385,11 @@ BackendInputCollector::ProcessTensor(
     const char* input_name, char* buffer, const size_t buffer_byte_size,
     const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
 {
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::COLLECTOR_PROCESS);
+#endif  // TRITON_ENABLE_STATS
+
   // A value of CPU_PINNED indicates that pinned memory buffer is not
   // needed for this tensor. Any other value indicates that a pinned
   // memory buffer is needed when the target memory type matches
@@ -104,6 +401,8 @@ BackendInputCollector::ProcessTensor(
                                  ? TRITONSERVER_MEMORY_GPU
                                  : TRITONSERVER_MEMORY_CPU;
   }
+  use_pinned_memory_type =
+      ApplyPinnedPolicy(use_pinned_memory_type, buffer_byte_size);
 
   size_t buffer_offset = 0;
 
@@ -143,9 +442,94 @@ BackendInputCollector::ProcessTensor(
     buffer_offset += byte_size;
   }
 
-  // Done with the tensor, flush any pending pinned copies.
+  // Done with the tensor, flush any pending pinned copies and the CPU
+  // copies directly into the tensor, and launch the queued copies.
   need_sync_ |=
       FlushPendingPinned(buffer, buffer_byte_size, memory_type, memory_type_id);
+  FlushPendingHostCopies();
+  need_sync_ |= FlushQueuedCopies();
+#ifdef TRITON_ENABLE_GPU
+  if (need_sync_ && (event_ != nullptr)) {
+    cudaEventRecord(event_, stream_);
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+void
+BackendInputCollector::ProcessTensors(const std::vector<InputTensor>& tensors)
+{
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::COLLECTOR_PROCESS);
+#endif  // TRITON_ENABLE_STATS
+
+  // See ProcessTensor() for the meaning of 'use_pinned_memory_types'.
+  std::vector<TRITONSERVER_MemoryType> use_pinned_memory_types;
+  for (const auto& tensor : tensors) {
+    TRITONSERVER_MemoryType use_pinned_memory_type =
+        TRITONSERVER_MEMORY_CPU_PINNED;
+    if (pinned_enabled_ &&
+        (tensor.memory_type_ != TRITONSERVER_MEMORY_CPU_PINNED)) {
+      use_pinned_memory_type = (tensor.memory_type_ == TRITONSERVER_MEMORY_CPU)
+                                   ? TRITONSERVER_MEMORY_GPU
+                                   : TRITONSERVER_MEMORY_CPU;
+    }
+    use_pinned_memory_types.push_back(
+        ApplyPinnedPolicy(use_pinned_memory_type, tensor.buffer_byte_size_));
+  }
+
+  std::vector<size_t> buffer_offsets(tensors.size(), 0);
+  for (size_t idx = 0; idx < request_count_; idx++) {
+    auto& request = requests_[idx];
+    auto& response = (*responses_)[idx];
+
+    for (size_t tidx = 0; tidx < tensors.size(); ++tidx) {
+      const auto& tensor = tensors[tidx];
+
+      // The properties are needed even if the response has already
+      // failed so that the following requests are placed at the right
+      // offset.
+      TRITONBACKEND_Input* input = nullptr;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response,
+          TRITONBACKEND_RequestInput(request, tensor.input_name_, &input));
+      uint64_t byte_size = 0;
+      uint32_t buffer_count = 0;
+      if (input != nullptr) {
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &response, TRITONBACKEND_InputProperties(
+                           input, nullptr, nullptr, nullptr, nullptr,
+                           &byte_size, &buffer_count));
+      }
+
+      if ((buffer_offsets[tidx] + byte_size) > tensor.buffer_byte_size_) {
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &response,
+            TRITONSERVER_ErrorNew(
+                TRITONSERVER_ERROR_INVALID_ARG,
+                std::string(
+                    "unexpected total byte size " +
+                    std::to_string(buffer_offsets[tidx] + byte_size) +
+                    " for input '" + tensor.input_name_ + "', expecting " +
+                    std::to_string(tensor.buffer_byte_size_))
+                    .c_str()));
+      }
+
+      if (response != nullptr) {
+        CollectInputBuffers(
+            input, buffer_count, tensor, buffer_offsets[tidx],
+            use_pinned_memory_types[tidx], &response);
+      }
+
+      buffer_offsets[tidx] += byte_size;
+    }
+  }
+
+  // All requests are walked, perform the copies that were delayed.
+  FlushPendingHostCopies();
+  need_sync_ |= FlushStagedCopies(true /* to_gpu */);
+  need_sync_ |= FlushStagedCopies(false /* to_gpu */);
+  need_sync_ |= FlushQueuedCopies();
 #ifdef TRITON_ENABLE_GPU
   if (need_sync_ && (event_ != nullptr)) {
     cudaEventRecord(event_, stream_);
@@ -178,83 +562,1192 @@ BackendInputCollector::ProcessTensor(
         for (const auto& allowed_type : allowed_input_types) {
           if ((*dst_memory_type == allowed_type.first) &&
               ((*dst_memory_type_id == allowed_type.second))) {
+#ifdef TRITON_ENABLE_STATS
+            if (stats_ != nullptr) {
+              stats_->RecordZeroCopy(true /* hit */);
+            }
+#endif  // TRITON_ENABLE_STATS
             return nullptr;  // success
           }
         }
       }
     }
+#ifdef TRITON_ENABLE_STATS
+    if (stats_ != nullptr) {
+      stats_->RecordZeroCopy(false /* hit */);
+    }
+#endif  // TRITON_ENABLE_STATS
+    if (ProcessResidentTensor(
+            input_name, *dst_buffer_byte_size, allowed_input_types,
+            dst_buffer, dst_memory_type, dst_memory_type_id)) {
+      return nullptr;  // success
+    }
+
     // A separate buffer is needed
     BackendMemory* backend_memory = nullptr;
-    for (const auto& allowed_type : allowed_input_types) {
-      std::vector<BackendMemory::AllocationType> alloc_types;
-      const int64_t memory_type_id = allowed_type.second;
-      switch (allowed_type.first) {
-        case TRITONSERVER_MEMORY_GPU:
-          alloc_types = {BackendMemory::AllocationType::GPU_POOL,
-                         BackendMemory::AllocationType::GPU};
-          break;
-        case TRITONSERVER_MEMORY_CPU_PINNED:
-          alloc_types = {BackendMemory::AllocationType::CPU_PINNED_POOL,
-                         BackendMemory::AllocationType::CPU_PINNED};
+    RETURN_IF_ERROR(AllocateInputBuffer(
+        input_name, *dst_buffer_byte_size, allowed_input_types,
+        &backend_memory));
+    buffer = backend_memory->MemoryPtr();
+    *dst_buffer = backend_memory->MemoryPtr();
+    *dst_buffer_byte_size = backend_memory->ByteSize();
+    *dst_memory_type = backend_memory->MemoryType();
+    *dst_memory_type_id = backend_memory->MemoryTypeId();
+  } else {
+    if (allowed_input_types.size() != 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          "'allowed_input_types' must only contain the memory type and id of "
+          "'buffer'");
+    }
+    *dst_buffer = buffer;
+    *dst_buffer_byte_size = buffer_byte_size;
+    *dst_memory_type = allowed_input_types[0].first;
+    *dst_memory_type_id = allowed_input_types[0].second;
+  }
+  if (*dst_buffer_byte_size != 0) {
+    ProcessTensor(
+        input_name, buffer, *dst_buffer_byte_size, *dst_memory_type,
+        *dst_memory_type_id);
+  }
+  return nullptr;  // success
+}
+
+bool
+BackendInputCollector::ProcessResidentTensor(
+    const char* input_name, const size_t byte_size,
+    const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+        allowed_input_types,
+    const char** dst_buffer, TRITONSERVER_MemoryType* dst_memory_type,
+    int64_t* dst_memory_type_id)
+{
+  if ((residency_cache_ == nullptr) || (byte_size == 0) ||
+      !residency_cache_->IsCachedInput(input_name)) {
+    return false;
+  }
+
+  const int64_t device_id = residency_cache_->DeviceId();
+  bool allowed = false;
+  for (const auto& allowed_type : allowed_input_types) {
+    allowed |=
+        ((allowed_type.first == TRITONSERVER_MEMORY_GPU) &&
+         (allowed_type.second == device_id));
+  }
+  if (!allowed) {
+    return false;
+  }
+
+  std::string key(input_name);
+  key += '\0';
+  key += std::to_string(byte_size);
+  key += '\0';
+  auto kit = resident_keys_.find(input_name);
+  const bool hashed = (kit == resident_keys_.end());
+  if (!hashed) {
+    key += kit->second;
+  } else {
+    if (!ResidentInputBuffers(input_name, byte_size)) {
+      return false;
+    }
+    uint64_t hash = 0;
+    for (const auto& buffer : resident_buffers_) {
+      hash = BackendResidencyCache::Hash(buffer.first, buffer.second, hash);
+    }
+    key += std::to_string(hash);
+  }
+
+  // A copy found by hash is only used if the batch has the contents it
+  // was made from, otherwise it is replaced by a copy of this batch.
+  std::shared_ptr<BackendMemory> memory;
+  std::shared_ptr<const std::string> contents;
+  bool found = residency_cache_->Find(key, &memory, &contents);
+  if (found && hashed) {
+    found = (contents != nullptr);
+    size_t offset = 0;
+    for (const auto& buffer : resident_buffers_) {
+      if (!found) {
+        break;
+      }
+      found =
+          (memcmp(contents->data() + offset, buffer.first, buffer.second) ==
+           0);
+      offset += buffer.second;
+    }
+  }
+
+  if (!found) {
+    TRITONSERVER_Error* err = residency_cache_->Allocate(byte_size, &memory);
+    if (err != nullptr) {
+      TRITONSERVER_ErrorDelete(err);
+      return false;
+    }
+
+    contents.reset();
+    if (hashed) {
+      std::unique_ptr<std::string> host_copy(new std::string());
+      host_copy->reserve(byte_size);
+      for (const auto& buffer : resident_buffers_) {
+        host_copy->append(buffer.first, buffer.second);
+      }
+      contents.reset(host_copy.release());
+    }
+
+    // Only cache the copy if it is complete, that is no request failed
+    // to be copied.
+    auto failed_count = [this]() {
+      return std::count(responses_->begin(), responses_->end(), nullptr);
+    };
+    const auto failed_before = failed_count();
+    ProcessTensor(
+        input_name, memory->MemoryPtr(), byte_size, TRITONSERVER_MEMORY_GPU,
+        device_id);
+    if (failed_count() == failed_before) {
+      residency_cache_->Insert(key, memory, contents);
+    }
+  }
+
+  resident_memories_.push_back(memory);
+  *dst_buffer = memory->MemoryPtr();
+  *dst_memory_type = TRITONSERVER_MEMORY_GPU;
+  *dst_memory_type_id = device_id;
+  return true;
+}
+
+bool
+BackendInputCollector::ResidentInputBuffers(
+    const char* input_name, const size_t byte_size)
+{
+  resident_buffers_.clear();
+  size_t total_byte_size = 0;
+  for (size_t idx = 0; idx < request_count_; idx++) {
+    TRITONBACKEND_Input* input;
+    uint32_t buffer_count;
+    TRITONSERVER_Error* err =
+        TRITONBACKEND_RequestInput(requests_[idx], input_name, &input);
+    if (err == nullptr) {
+      err = TRITONBACKEND_InputProperties(
+          input, nullptr, nullptr, nullptr, nullptr, nullptr, &buffer_count);
+    }
+    for (uint32_t b = 0; (err == nullptr) && (b < buffer_count); ++b) {
+      const void* buffer;
+      uint64_t buffer_byte_size;
+      TRITONSERVER_MemoryType memory_type;
+      int64_t memory_type_id;
+      err = TRITONBACKEND_InputBuffer(
+          input, b, &buffer, &buffer_byte_size, &memory_type,
+          &memory_type_id);
+      if (err == nullptr) {
+        if (memory_type == TRITONSERVER_MEMORY_GPU) {
+          return false;
+        }
+        resident_buffers_.emplace_back(
+            reinterpret_cast<const char*>(buffer), buffer_byte_size);
+        total_byte_size += buffer_byte_size;
+      }
+    }
+
+    // Let the copy report the error to the response.
+    if (err != nullptr) {
+      TRITONSERVER_ErrorDelete(err);
+      return false;
+    }
+  }
+
+  // The buffers are compared against cached contents of 'byte_size'.
+  return (total_byte_size == byte_size);
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::AllocateStagingBuffer(
+    const size_t byte_size, const bool allow_cpu, char** buffer,
+    TRITONSERVER_MemoryType* memory_type)
+{
+  *buffer = nullptr;
+
+  BackendMemory* backend_memory = nullptr;
+  TRITONSERVER_Error* err = nullptr;
+  if (pinned_arena_ != nullptr) {
+    err = pinned_arena_->Borrow(byte_size, &backend_memory);
+    if (err == nullptr) {
+      arena_memories_.push_back(backend_memory);
+    }
+  } else {
+    err = BackendMemory::Create(
+        memory_manager_,
+        {BackendMemory::AllocationType::CPU_PINNED_POOL,
+         BackendMemory::AllocationType::CPU_PINNED},
+        0 /* memory_type_id */, byte_size, &backend_memory);
+    if (err == nullptr) {
+      backend_memories_.emplace_back(backend_memory);
+    }
+  }
+
+  // Fall back to CPU memory if pinned memory is not required.
+  if ((err != nullptr) && allow_cpu) {
+    RecordPinnedFallback();
+    TRITONSERVER_ErrorDelete(err);
+    err = BackendMemory::Create(
+        memory_manager_, BackendMemory::AllocationType::CPU,
+        0 /* memory_type_id */, byte_size, &backend_memory);
+    if (err == nullptr) {
+      backend_memories_.emplace_back(backend_memory);
+    }
+  }
+  RETURN_IF_ERROR(err);
+
+  *buffer = backend_memory->MemoryPtr();
+  *memory_type = backend_memory->MemoryType();
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::AllocateInputBuffer(
+    const char* input_name, const size_t byte_size,
+    const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+        allowed_input_types,
+    BackendMemory** backend_memory)
+{
+  *backend_memory = nullptr;
+  for (const auto& allowed_type : allowed_input_types) {
+    std::vector<BackendMemory::AllocationType> alloc_types;
+    const int64_t memory_type_id = allowed_type.second;
+    switch (allowed_type.first) {
+      case TRITONSERVER_MEMORY_GPU:
+        alloc_types = {BackendMemory::AllocationType::GPU_POOL,
+                       BackendMemory::AllocationType::GPU_ASYNC,
+                       BackendMemory::AllocationType::GPU};
+        break;
+      case TRITONSERVER_MEMORY_CPU_PINNED:
+        alloc_types = {BackendMemory::AllocationType::CPU_PINNED_POOL,
+                       BackendMemory::AllocationType::CPU_PINNED};
+        break;
+      case TRITONSERVER_MEMORY_CPU:
+        alloc_types = {BackendMemory::AllocationType::CPU};
+        break;
+    }
+    auto err = BackendMemory::Create(
+        memory_manager_, alloc_types, memory_type_id, byte_size, stream_,
+        backend_memory);
+    if (err != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("unable to create backend memory for type: ") +
+           TRITONSERVER_MemoryTypeString(allowed_type.first) +
+           " id: " + std::to_string(memory_type_id) + ": " +
+           TRITONSERVER_ErrorMessage(err))
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+    } else {
+      backend_memories_.emplace_back(*backend_memory);
+      break;
+    }
+  }
+  if (*backend_memory == nullptr) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("failed to allocate contiguous buffer for input '") +
+         input_name + "'")
+            .c_str());
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::ProcessTensor(
+    const char* input_name, const InputConversion& conversion, char* buffer,
+    const size_t buffer_byte_size,
+    const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+        allowed_input_types,
+    const char** dst_buffer, size_t* dst_buffer_byte_size,
+    TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id)
+{
+  RETURN_ERROR_IF_TRUE(
+      (conversion.datatype_ != TRITONSERVER_TYPE_FP32) &&
+          (conversion.datatype_ != TRITONSERVER_TYPE_FP16),
+      TRITONSERVER_ERROR_UNSUPPORTED,
+      std::string(
+          std::string("unable to convert input '") + input_name + "' to " +
+          TRITONSERVER_DataTypeString(conversion.datatype_)));
+
+  const int64_t item_size =
+      conversion.nhwc_to_nchw_
+          ? (conversion.height_ * conversion.width_ * conversion.channels_)
+          : 1;
+  RETURN_ERROR_IF_TRUE(
+      item_size <= 0, TRITONSERVER_ERROR_INVALID_ARG,
+      std::string(
+          std::string("unable to transpose input '") + input_name +
+          "' as images of " + std::to_string(item_size) + " elements"));
+
+  // The data type of the batch is that of the first request with a
+  // convertible input. A request whose input can't be converted gets
+  // an error response, and its elements still take their place in
+  // the tensor so that the other requests keep their offsets.
+  TRITONSERVER_DataType src_datatype = TRITONSERVER_TYPE_INVALID;
+  size_t element_count = 0;
+  bool all_converted = true;
+  convert_element_offsets_.clear();
+  for (size_t idx = 0; idx < request_count_; idx++) {
+    auto& response = (*responses_)[idx];
+    convert_element_offsets_.push_back(element_count);
+
+    TRITONBACKEND_Input* input = nullptr;
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        &response,
+        TRITONBACKEND_RequestInput(requests_[idx], input_name, &input));
+    TRITONSERVER_DataType datatype = TRITONSERVER_TYPE_INVALID;
+    uint64_t byte_size = 0;
+    if (input != nullptr) {
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, TRITONBACKEND_InputProperties(
+                         input, nullptr, &datatype, nullptr, nullptr,
+                         &byte_size, nullptr));
+    }
+
+    const size_t element_byte_size = TRITONSERVER_DataTypeByteSize(datatype);
+    const size_t request_element_count =
+        (element_byte_size == 0) ? 0 : (byte_size / element_byte_size);
+    TRITONSERVER_Error* err = nullptr;
+    if (input == nullptr) {
+      // The error is already sent
+    } else if (!IsConvertibleType(datatype)) {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_UNSUPPORTED,
+          (std::string("unable to convert input '") + input_name + "' from " +
+           TRITONSERVER_DataTypeString(datatype))
+              .c_str());
+    } else if (
+        (src_datatype != TRITONSERVER_TYPE_INVALID) &&
+        (datatype != src_datatype)) {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("input '") + input_name +
+           "' must have the same data type in all requests to be converted")
+              .c_str());
+    } else if ((byte_size % element_byte_size) != 0) {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("input '") + input_name + "' of " +
+           std::to_string(byte_size) + " bytes is not a whole number of " +
+           TRITONSERVER_DataTypeString(datatype) + " elements")
+              .c_str());
+    } else if (
+        (request_element_count % static_cast<size_t>(item_size)) != 0) {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("input '") + input_name + "' with " +
+           std::to_string(request_element_count) +
+           " elements can't be transposed as images of " +
+           std::to_string(item_size) + " elements")
+              .c_str());
+    } else if (src_datatype == TRITONSERVER_TYPE_INVALID) {
+      src_datatype = datatype;
+    }
+    RESPOND_AND_SET_NULL_IF_ERROR(&response, err);
+    all_converted &= (response != nullptr);
+    element_count += request_element_count;
+  }
+  if (src_datatype == TRITONSERVER_TYPE_INVALID) {
+    src_datatype = conversion.datatype_;
+  }
+
+  const size_t dst_element_byte_size =
+      TRITONSERVER_DataTypeByteSize(conversion.datatype_);
+
+  const size_t byte_size = element_count * dst_element_byte_size;
+  RETURN_IF_ERROR(AcquireTensorBuffer(
+      input_name, "input", byte_size, buffer, buffer_byte_size,
+      allowed_input_types, dst_buffer, dst_buffer_byte_size, dst_memory_type,
+      dst_memory_type_id));
+  char* tensor_buffer = const_cast<char*>(*dst_buffer);
+
+#ifdef TRITON_ENABLE_GPU
+  const size_t src_element_byte_size =
+      TRITONSERVER_DataTypeByteSize(src_datatype);
+  if ((*dst_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (src_element_byte_size < dst_element_byte_size) && (byte_size > 0) &&
+      all_converted) {
+    // Gathering the unconverted elements moves fewer bytes to the GPU
+    // than the converted ones, so convert them there. The gather is
+    // timed by the ProcessTensor() it is done with. The gather places
+    // the requests by their byte size, so it is only used if all the
+    // requests have the data type of the batch.
+    const size_t src_byte_size = element_count * src_element_byte_size;
+    BackendMemory* src_memory = nullptr;
+    RETURN_IF_ERROR(AllocateInputBuffer(
+        input_name, src_byte_size,
+        {{TRITONSERVER_MEMORY_GPU, *dst_memory_type_id}}, &src_memory));
+    // The gather reports its failures to the responses and leaves its
+    // copies on 'stream_', which orders them before the kernel. There
+    // is nothing to convert if no request was gathered.
+    ProcessTensor(
+        input_name, src_memory->MemoryPtr(), src_byte_size,
+        TRITONSERVER_MEMORY_GPU, *dst_memory_type_id);
+    if (std::count(responses_->begin(), responses_->end(), nullptr) ==
+        static_cast<std::ptrdiff_t>(responses_->size())) {
+      return nullptr;  // success
+    }
+
+    ConvertDescriptor desc;
+    desc.src_type_ = ToConvertType(src_datatype);
+    desc.dst_type_ = ToConvertType(conversion.datatype_);
+    desc.scale_ = conversion.scale_;
+    desc.bias_ = conversion.bias_;
+    desc.item_size_ = 0;
+    desc.channels_ = 0;
+    if (conversion.nhwc_to_nchw_) {
+      desc.item_size_ =
+          conversion.height_ * conversion.width_ * conversion.channels_;
+      desc.channels_ = conversion.channels_;
+    }
+    cudaError_t err = RunConvertKernel(
+        src_memory->MemoryPtr(), tensor_buffer, element_count, desc, stream_);
+    if ((err == cudaSuccess) && (event_ != nullptr)) {
+      err = cudaEventRecord(event_, stream_);
+    }
+    need_sync_ = true;
+
+    // None of the requests has its input if the conversion fails.
+    if (err != cudaSuccess) {
+      const std::string msg = std::string("failed to convert input '") +
+                              input_name + "': " + cudaGetErrorString(err);
+      for (auto& response : *responses_) {
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &response,
+            TRITONSERVER_ErrorNew(TRITONSERVER_ERROR_INTERNAL, msg.c_str()));
+      }
+    }
+    return nullptr;  // success
+  }
+#endif  // TRITON_ENABLE_GPU
+
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::COLLECTOR_PROCESS);
+#endif  // TRITON_ENABLE_STATS
+
+  return WriteGeneratedTensor(
+      input_name, byte_size,
+      [this, input_name, src_datatype,
+       &conversion](char* host_buffer) -> TRITONSERVER_Error* {
+        return ConvertRequestInputs(
+            input_name, src_datatype, conversion, host_buffer);
+      },
+      tensor_buffer, *dst_memory_type, *dst_memory_type_id);
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::ConvertRequestInputs(
+    const char* input_name, const TRITONSERVER_DataType src_datatype,
+    const InputConversion& conversion, char* host_buffer)
+{
+  // The elements are converted on the host, so first bring the request
+  // buffers in GPU memory to the host, waiting once for all of them.
+  // The requests that failed in ProcessTensor() are skipped.
+  bool cuda_copy = false;
+  convert_sources_.clear();
+  for (size_t idx = 0; idx < request_count_; idx++) {
+    auto& response = (*responses_)[idx];
+    if (response == nullptr) {
+      continue;
+    }
+
+    TRITONBACKEND_Input* input = nullptr;
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        &response,
+        TRITONBACKEND_RequestInput(requests_[idx], input_name, &input));
+    uint32_t buffer_count = 0;
+    if (response != nullptr) {
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, TRITONBACKEND_InputProperties(
+                         input, nullptr, nullptr, nullptr, nullptr, nullptr,
+                         &buffer_count));
+    }
+    for (uint32_t buffer_idx = 0;
+         (response != nullptr) && (buffer_idx < buffer_count); ++buffer_idx) {
+      const void* src_buffer;
+      size_t src_byte_size;
+      TRITONSERVER_MemoryType src_memory_type;
+      int64_t src_memory_type_id;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response, TRITONBACKEND_InputBuffer(
+                         input, buffer_idx, &src_buffer, &src_byte_size,
+                         &src_memory_type, &src_memory_type_id));
+      if (response == nullptr) {
+        break;
+      }
+
+      const char* src = reinterpret_cast<const char*>(src_buffer);
+      if (src_memory_type == TRITONSERVER_MEMORY_GPU) {
+        char* staging_buffer = nullptr;
+        TRITONSERVER_MemoryType staging_memory_type;
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            &response, AllocateStagingBuffer(
+                           src_byte_size, true /* allow_cpu */,
+                           &staging_buffer, &staging_memory_type));
+        bool cuda_used = false;
+        if (response != nullptr) {
+          RESPOND_AND_SET_NULL_IF_ERROR(
+              &response, CopyBuffer(
+                             input_name, src_memory_type, src_memory_type_id,
+                             staging_memory_type, 0 /* memory_type_id */,
+                             src_byte_size, src, staging_buffer, stream_,
+                             &cuda_used));
+        }
+        cuda_copy |= cuda_used;
+        if (response == nullptr) {
           break;
-        case TRITONSERVER_MEMORY_CPU:
-          alloc_types = {BackendMemory::AllocationType::CPU};
+        }
+        RecordCopy(src_memory_type, staging_memory_type, src_byte_size);
+        src = staging_buffer;
+      }
+      convert_sources_.emplace_back(idx, src, src_byte_size);
+    }
+  }
+#ifdef TRITON_ENABLE_GPU
+  if (cuda_copy) {
+    cudaStreamSynchronize(stream_);
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  const size_t element_byte_size = TRITONSERVER_DataTypeByteSize(src_datatype);
+  auto convert = [&](const char* src, const size_t count,
+                     const size_t element_offset) {
+    if (conversion.datatype_ == TRITONSERVER_TYPE_FP16) {
+      ConvertBuffer(
+          src, src_datatype, count, element_offset, conversion,
+          reinterpret_cast<Half*>(host_buffer));
+    } else {
+      ConvertBuffer(
+          src, src_datatype, count, element_offset, conversion,
+          reinterpret_cast<float*>(host_buffer));
+    }
+  };
+
+  // A buffer may end within an element, the bytes of the element are
+  // then carried over to the next buffer of the request. The offset of
+  // each request was computed in ProcessTensor().
+  char partial[sizeof(float)];  // the widest convertible element
+  size_t partial_byte_size = 0;
+  size_t element_offset = 0;
+  size_t request_idx = request_count_;
+  for (const auto& source : convert_sources_) {
+    if ((*responses_)[source.request_index_] == nullptr) {
+      continue;
+    }
+    if (source.request_index_ != request_idx) {
+      request_idx = source.request_index_;
+      element_offset = convert_element_offsets_[request_idx];
+      partial_byte_size = 0;
+    }
+
+    const char* src = source.buffer_;
+    size_t remaining = source.byte_size_;
+    if (partial_byte_size > 0) {
+      const size_t fill =
+          std::min(element_byte_size - partial_byte_size, remaining);
+      memcpy(partial + partial_byte_size, src, fill);
+      partial_byte_size += fill;
+      src += fill;
+      remaining -= fill;
+      if (partial_byte_size == element_byte_size) {
+        convert(partial, 1, element_offset);
+        element_offset++;
+        partial_byte_size = 0;
+      }
+    }
+
+    const size_t count = remaining / element_byte_size;
+    convert(src, count, element_offset);
+    element_offset += count;
+    const size_t tail_byte_size = remaining - (count * element_byte_size);
+    if (tail_byte_size > 0) {
+      memcpy(partial, src + (count * element_byte_size), tail_byte_size);
+      partial_byte_size = tail_byte_size;
+    }
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::ProcessBytesTensor(
+    const char* input_name,
+    const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+        allowed_input_types,
+    const char** dst_buffer, size_t* dst_buffer_byte_size,
+    TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id,
+    std::vector<uint64_t>* offsets)
+{
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::COLLECTOR_PROCESS);
+#endif  // TRITON_ENABLE_STATS
+
+  if (allowed_input_types.size() == 0) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        "'allowed_input_types' must contain at least one pair of memory type "
+        "and id");
+  }
+
+  // First pass over the requests to find the number of elements and
+  // the maximum size of the string data, this is the total byte size
+  // of the inputs minus the 4-byte length prefix of each element.
+  struct RequestBytesInput {
+    TRITONBACKEND_Input* input_;
+    uint32_t buffer_count_;
+    int64_t element_count_;
+  };
+  std::vector<RequestBytesInput> request_inputs(request_count_);
+  size_t total_element_count = 0;
+  size_t max_data_byte_size = 0;
+  for (size_t idx = 0; idx < request_count_; idx++) {
+    auto& request = requests_[idx];
+    auto& response = (*responses_)[idx];
+    auto& request_input = request_inputs[idx];
+    request_input.input_ = nullptr;
+    request_input.buffer_count_ = 0;
+    request_input.element_count_ = 0;
+
+    TRITONBACKEND_Input* input;
+    TRITONSERVER_DataType datatype;
+    const int64_t* shape;
+    uint32_t dims_count;
+    uint64_t byte_size;
+    uint32_t buffer_count;
+    auto err = TRITONBACKEND_RequestInput(request, input_name, &input);
+    if (err == nullptr) {
+      err = TRITONBACKEND_InputProperties(
+          input, nullptr, &datatype, &shape, &dims_count, &byte_size,
+          &buffer_count);
+    }
+    if (err != nullptr) {
+      RESPOND_AND_SET_NULL_IF_ERROR(&response, err);
+      continue;
+    }
+
+    // The element count is recorded even if the request has already
+    // failed so that its elements can still be represented.
+    const int64_t element_count = GetElementCount(shape, dims_count);
+    if (element_count > 0) {
+      request_input.element_count_ = element_count;
+      total_element_count += element_count;
+    }
+    if (response == nullptr) {
+      continue;
+    }
+
+    if ((datatype != TRITONSERVER_TYPE_BYTES) || (element_count < 0)) {
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response,
+          TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INVALID_ARG,
+              (std::string("expected BYTES input '") + input_name +
+               "' with a fully-specified shape, got " +
+               TRITONSERVER_DataTypeString(datatype) + " " +
+               ShapeToString(shape, dims_count))
+                  .c_str()));
+      continue;
+    }
+
+    request_input.input_ = input;
+    request_input.buffer_count_ = buffer_count;
+    const size_t prefix_byte_size = element_count * sizeof(uint32_t);
+    if (byte_size > prefix_byte_size) {
+      max_data_byte_size += byte_size - prefix_byte_size;
+    }
+  }
+
+  BackendMemory* backend_memory = nullptr;
+  RETURN_IF_ERROR(AllocateInputBuffer(
+      input_name, max_data_byte_size, allowed_input_types, &backend_memory));
+  *dst_buffer = backend_memory->MemoryPtr();
+  *dst_memory_type = backend_memory->MemoryType();
+  *dst_memory_type_id = backend_memory->MemoryTypeId();
+
+  // The string data must be parsed on the host, so if the returned
+  // buffer is in GPU memory gather into a host staging buffer first.
+  char* data_buffer = backend_memory->MemoryPtr();
+  TRITONSERVER_MemoryType data_memory_type = backend_memory->MemoryType();
+  if ((data_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (max_data_byte_size > 0)) {
+    RETURN_IF_ERROR(AllocateStagingBuffer(
+        max_data_byte_size, true /* allow_cpu */, &data_buffer,
+        &data_memory_type));
+  }
+
+  offsets->clear();
+  offsets->reserve(total_element_count + 1);
+  offsets->push_back(0);
+
+  size_t data_offset = 0;
+  for (size_t idx = 0; idx < request_count_; idx++) {
+    auto& response = (*responses_)[idx];
+    const auto& request_input = request_inputs[idx];
+    const size_t request_data_offset = data_offset;
+    const size_t request_offset_count = offsets->size();
+    if (response != nullptr) {
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          &response,
+          SetBytesInputTensor(
+              request_input.input_, request_input.buffer_count_,
+              request_input.element_count_, data_buffer, max_data_byte_size,
+              &data_offset, offsets));
+      if (response != nullptr) {
+        continue;
+      }
+    }
+
+    // Discard anything gathered for a failed request and represent
+    // its elements as empty strings.
+    data_offset = request_data_offset;
+    offsets->resize(request_offset_count);
+    offsets->resize(
+        request_offset_count + request_input.element_count_, data_offset);
+  }
+
+  *dst_buffer_byte_size = data_offset;
+
+  if ((data_buffer != *dst_buffer) && (data_offset > 0)) {
+    bool cuda_used = false;
+    auto err = CopyBuffer(
+        input_name, data_memory_type, 0 /* memory_type_id */,
+        *dst_memory_type, *dst_memory_type_id, data_offset, data_buffer,
+        backend_memory->MemoryPtr(), stream_, &cuda_used);
+    need_sync_ |= cuda_used;
+    RecordCopy(data_memory_type, *dst_memory_type, data_offset);
+    // If something goes wrong with the copy all the pending
+    // responses fail...
+    if (err != nullptr) {
+      for (size_t idx = 0; idx < request_count_; idx++) {
+        auto& response = (*responses_)[idx];
+        if (response != nullptr) {
+          LOG_IF_ERROR(
+              TRITONBACKEND_ResponseSend(
+                  response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+              "failed to send error response");
+          response = nullptr;
+        }
+      }
+      TRITONSERVER_ErrorDelete(err);
+    }
+  }
+#ifdef TRITON_ENABLE_GPU
+  if (need_sync_ && (event_ != nullptr)) {
+    cudaEventRecord(event_, stream_);
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::BatchInputShape(
+    const BatchInput& batch_input, std::vector<int64_t>* shape)
+{
+  std::vector<int64_t> values;
+  return BatchInputValues(batch_input, &values, shape);
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::ProcessBatchInput(
+    const BatchInput& batch_input, char* buffer, const size_t buffer_byte_size,
+    const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+        allowed_input_types,
+    const char** dst_buffer, size_t* dst_buffer_byte_size,
+    TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id)
+{
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::COLLECTOR_PROCESS);
+#endif  // TRITON_ENABLE_STATS
+
+  const std::string& name = batch_input.TargetNames().empty()
+                                ? batch_input.BatchInputKindString()
+                                : batch_input.TargetNames()[0];
+
+  std::vector<int64_t> values, shape;
+  RETURN_IF_ERROR(BatchInputValues(batch_input, &values, &shape));
+  const size_t byte_size =
+      values.size() * TRITONSERVER_DataTypeByteSize(batch_input.DataType());
+
+  return ProcessGeneratedTensor(
+      name, "batch input", byte_size,
+      [&batch_input, &name, &values](char* host_buffer) -> TRITONSERVER_Error* {
+        switch (batch_input.DataType()) {
+          case TRITONSERVER_TYPE_INT32:
+            WriteBatchInputValues<int32_t>(values, host_buffer);
+            break;
+          case TRITONSERVER_TYPE_INT64:
+            WriteBatchInputValues<int64_t>(values, host_buffer);
+            break;
+          case TRITONSERVER_TYPE_FP32:
+            WriteBatchInputValues<float>(values, host_buffer);
+            break;
+          default:
+            return TRITONSERVER_ErrorNew(
+                TRITONSERVER_ERROR_INVALID_ARG,
+                (std::string("unexpected data type ") +
+                 TRITONSERVER_DataTypeString(batch_input.DataType()) +
+                 " for batch input '" + name + "'")
+                    .c_str());
+        }
+        return nullptr;  // success
+      },
+      buffer, buffer_byte_size, allowed_input_types, dst_buffer,
+      dst_buffer_byte_size, dst_memory_type, dst_memory_type_id);
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::ProcessSequenceControl(
+    const BackendModelConfig::ControlKind kind,
+    const BackendModelConfig::SequenceControl& control,
+    const size_t slot_count, char* buffer, const size_t buffer_byte_size,
+    const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+        allowed_input_types,
+    const char** dst_buffer, size_t* dst_buffer_byte_size,
+    TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id)
+{
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::COLLECTOR_PROCESS);
+#endif  // TRITON_ENABLE_STATS
+
+  const std::string& name = control.tensor_name_;
+  RETURN_ERROR_IF_TRUE(
+      slot_count < request_count_, TRITONSERVER_ERROR_INVALID_ARG,
+      std::string(
+          "sequence control '" + name + "' has " + std::to_string(slot_count) +
+          " slots for " + std::to_string(request_count_) + " requests"));
+
+  const bool boolean = (kind != BackendModelConfig::ControlKind::CORRID);
+  RETURN_ERROR_IF_TRUE(
+      (boolean && (control.datatype_ != TRITONSERVER_TYPE_INT32) &&
+       (control.datatype_ != TRITONSERVER_TYPE_FP32)) ||
+          (!boolean && (control.datatype_ != TRITONSERVER_TYPE_INT32) &&
+           (control.datatype_ != TRITONSERVER_TYPE_UINT32) &&
+           (control.datatype_ != TRITONSERVER_TYPE_INT64) &&
+           (control.datatype_ != TRITONSERVER_TYPE_UINT64)),
+      TRITONSERVER_ERROR_UNSUPPORTED,
+      std::string(
+          std::string("unexpected data type ") +
+          TRITONSERVER_DataTypeString(control.datatype_) +
+          " for sequence control '" + name + "'"));
+
+  // A request whose flags or correlation ID can't be read gets an
+  // error response and its slot holds the false value, or 0.
+  std::vector<uint64_t>& values = sequence_control_values_;
+  values.assign(request_count_, 0);
+  for (size_t idx = 0; idx < request_count_; ++idx) {
+    auto& response = (*responses_)[idx];
+    switch (kind) {
+      case BackendModelConfig::ControlKind::START:
+      case BackendModelConfig::ControlKind::END: {
+        uint32_t flags = 0;
+        TRITONSERVER_Error* err =
+            TRITONBACKEND_RequestFlags(requests_[idx], &flags);
+        if (err != nullptr) {
+          RESPOND_AND_SET_NULL_IF_ERROR(&response, err);
           break;
+        }
+        values[idx] =
+            flags & ((kind == BackendModelConfig::ControlKind::START)
+                         ? TRITONSERVER_REQUEST_FLAG_SEQUENCE_START
+                         : TRITONSERVER_REQUEST_FLAG_SEQUENCE_END);
+        break;
       }
-      auto err = BackendMemory::Create(
-          memory_manager_, alloc_types, memory_type_id, *dst_buffer_byte_size,
-          &backend_memory);
-      if (err != nullptr) {
-        LOG_MESSAGE(
-            TRITONSERVER_LOG_VERBOSE,
-            (std::string("unable to create backend memory for type: ") +
-             TRITONSERVER_MemoryTypeString(allowed_type.first) +
-             " id: " + std::to_string(memory_type_id) + ": " +
-             TRITONSERVER_ErrorMessage(err))
-                .c_str());
-        TRITONSERVER_ErrorDelete(err);
-      } else {
-        backend_memories_.emplace_back(backend_memory);
+      case BackendModelConfig::ControlKind::READY:
+        values[idx] = 1;
+        break;
+      case BackendModelConfig::ControlKind::CORRID: {
+        TRITONSERVER_Error* err =
+            TRITONBACKEND_RequestCorrelationId(requests_[idx], &values[idx]);
+        if (err != nullptr) {
+          values[idx] = 0;
+          RESPOND_AND_SET_NULL_IF_ERROR(&response, err);
+        }
+        break;
+      }
+    }
+  }
+
+  const size_t byte_size =
+      slot_count * TRITONSERVER_DataTypeByteSize(control.datatype_);
+  RETURN_IF_ERROR(AcquireTensorBuffer(
+      name, "sequence control", byte_size, buffer, buffer_byte_size,
+      allowed_input_types, dst_buffer, dst_buffer_byte_size, dst_memory_type,
+      dst_memory_type_id));
+  if (byte_size == 0) {
+    return nullptr;  // success
+  }
+
+  char* tensor_buffer = const_cast<char*>(*dst_buffer);
+  char* host_buffer;
+  TRITONSERVER_MemoryType host_memory_type;
+  RETURN_IF_ERROR(HostGeneratedBuffer(
+      byte_size, tensor_buffer, *dst_memory_type, &host_buffer,
+      &host_memory_type));
+  switch (control.datatype_) {
+    case TRITONSERVER_TYPE_INT32:
+      WriteSequenceControlValues<int32_t>(
+          values, slot_count, boolean, control.int32_false_value_,
+          control.int32_true_value_, host_buffer);
+      break;
+    case TRITONSERVER_TYPE_FP32:
+      WriteSequenceControlValues<float>(
+          values, slot_count, boolean, control.fp32_false_value_,
+          control.fp32_true_value_, host_buffer);
+      break;
+    case TRITONSERVER_TYPE_UINT32:
+      WriteSequenceControlValues<uint32_t>(
+          values, slot_count, boolean, 0, 0, host_buffer);
+      break;
+    case TRITONSERVER_TYPE_INT64:
+      WriteSequenceControlValues<int64_t>(
+          values, slot_count, boolean, 0, 0, host_buffer);
+      break;
+    default:
+      WriteSequenceControlValues<uint64_t>(
+          values, slot_count, boolean, 0, 0, host_buffer);
+      break;
+  }
+  return CopyGeneratedBuffer(
+      name, byte_size, host_buffer, host_memory_type, tensor_buffer,
+      *dst_memory_type, *dst_memory_type_id);
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::ProcessGeneratedTensor(
+    const std::string& name, const char* tensor_kind, const size_t byte_size,
+    const std::function<TRITONSERVER_Error*(char*)>& generate, char* buffer,
+    const size_t buffer_byte_size,
+    const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+        allowed_input_types,
+    const char** dst_buffer, size_t* dst_buffer_byte_size,
+    TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id)
+{
+  RETURN_IF_ERROR(AcquireTensorBuffer(
+      name, tensor_kind, byte_size, buffer, buffer_byte_size,
+      allowed_input_types, dst_buffer, dst_buffer_byte_size, dst_memory_type,
+      dst_memory_type_id));
+  return WriteGeneratedTensor(
+      name, byte_size, generate, const_cast<char*>(*dst_buffer),
+      *dst_memory_type, *dst_memory_type_id);
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::AcquireTensorBuffer(
+    const std::string& name, const char* tensor_kind, const size_t byte_size,
+    char* buffer, const size_t buffer_byte_size,
+    const std::vector<std::pair<TRITONSERVER_MemoryType, int64_t>>&
+        allowed_input_types,
+    const char** dst_buffer, size_t* dst_buffer_byte_size,
+    TRITONSERVER_MemoryType* dst_memory_type, int64_t* dst_memory_type_id)
+{
+  if (buffer == nullptr) {
+    if (allowed_input_types.size() == 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          "'allowed_input_types' must contain at least one pair of memory "
+          "type and id");
+    }
+    BackendMemory* backend_memory = nullptr;
+    RETURN_IF_ERROR(AllocateInputBuffer(
+        name.c_str(), byte_size, allowed_input_types, &backend_memory));
+    buffer = backend_memory->MemoryPtr();
+    *dst_memory_type = backend_memory->MemoryType();
+    *dst_memory_type_id = backend_memory->MemoryTypeId();
+  } else {
+    if (allowed_input_types.size() != 1) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          "'allowed_input_types' must only contain the memory type and id of "
+          "'buffer'");
+    }
+    RETURN_ERROR_IF_TRUE(
+        byte_size > buffer_byte_size, TRITONSERVER_ERROR_INVALID_ARG,
+        std::string(
+            "unexpected total byte size " + std::to_string(byte_size) +
+            " for " + tensor_kind + " '" + name + "', expecting " +
+            std::to_string(buffer_byte_size)));
+    *dst_memory_type = allowed_input_types[0].first;
+    *dst_memory_type_id = allowed_input_types[0].second;
+  }
+  *dst_buffer = buffer;
+  *dst_buffer_byte_size = byte_size;
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::WriteGeneratedTensor(
+    const std::string& name, const size_t byte_size,
+    const std::function<TRITONSERVER_Error*(char*)>& generate, char* buffer,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
+{
+  if (byte_size == 0) {
+    return nullptr;  // success
+  }
+
+  char* host_buffer;
+  TRITONSERVER_MemoryType host_memory_type;
+  RETURN_IF_ERROR(HostGeneratedBuffer(
+      byte_size, buffer, memory_type, &host_buffer, &host_memory_type));
+  RETURN_IF_ERROR(generate(host_buffer));
+  return CopyGeneratedBuffer(
+      name, byte_size, host_buffer, host_memory_type, buffer, memory_type,
+      memory_type_id);
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::HostGeneratedBuffer(
+    const size_t byte_size, char* buffer,
+    const TRITONSERVER_MemoryType memory_type, char** host_buffer,
+    TRITONSERVER_MemoryType* host_memory_type)
+{
+  // The values are generated on the host, so if the tensor is in GPU
+  // memory generate into a host staging buffer first.
+  *host_buffer = buffer;
+  *host_memory_type = memory_type;
+  if (memory_type == TRITONSERVER_MEMORY_GPU) {
+    RETURN_IF_ERROR(AllocateStagingBuffer(
+        byte_size, true /* allow_cpu */, host_buffer, host_memory_type));
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::CopyGeneratedBuffer(
+    const std::string& name, const size_t byte_size, char* host_buffer,
+    const TRITONSERVER_MemoryType host_memory_type, char* buffer,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
+{
+  if (host_buffer != buffer) {
+    bool cuda_used = false;
+    RETURN_IF_ERROR(CopyBuffer(
+        name, host_memory_type, 0 /* memory_type_id */, memory_type,
+        memory_type_id, byte_size, host_buffer, buffer, stream_, &cuda_used));
+    need_sync_ |= cuda_used;
+    RecordCopy(host_memory_type, memory_type, byte_size);
+  }
+#ifdef TRITON_ENABLE_GPU
+  if (need_sync_ && (event_ != nullptr)) {
+    cudaEventRecord(event_, stream_);
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::BatchInputValues(
+    const BatchInput& batch_input, std::vector<int64_t>* values,
+    std::vector<int64_t>* shape)
+{
+  values->clear();
+  shape->clear();
+  if (batch_input.SourceInputs().empty()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("batch input of kind '") +
+         batch_input.BatchInputKindString() + "' has no source input")
+            .c_str());
+  }
+
+  const std::string& source_input = batch_input.SourceInputs()[0];
+  const BatchInput::Kind kind = batch_input.BatchInputKind();
+  if (kind == BatchInput::Kind::BATCH_ACCUMULATED_ELEMENT_COUNT_WITH_ZERO) {
+    values->push_back(0);
+  }
+
+  int64_t accumulated_element_count = 0;
+  int64_t max_element_count = 0;
+  int64_t item_count = 0;
+  size_t item_dims_count = 0;
+  for (size_t idx = 0; idx < request_count_; idx++) {
+    TRITONBACKEND_Input* input;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestInput(
+        requests_[idx], source_input.c_str(), &input));
+    const int64_t* shape_dims;
+    uint32_t dims_count;
+    RETURN_IF_ERROR(TRITONBACKEND_InputProperties(
+        input, nullptr, nullptr, &shape_dims, &dims_count, nullptr, nullptr));
+    const int64_t element_count = GetElementCount(shape_dims, dims_count);
+
+    switch (kind) {
+      case BatchInput::Kind::BATCH_ELEMENT_COUNT:
+        values->push_back(element_count);
+        break;
+      case BatchInput::Kind::BATCH_ACCUMULATED_ELEMENT_COUNT:
+      case BatchInput::Kind::BATCH_ACCUMULATED_ELEMENT_COUNT_WITH_ZERO:
+        accumulated_element_count += element_count;
+        values->push_back(accumulated_element_count);
+        break;
+      case BatchInput::Kind::BATCH_MAX_ELEMENT_COUNT_AS_SHAPE:
+        max_element_count = std::max(max_element_count, element_count);
+        break;
+      case BatchInput::Kind::BATCH_ITEM_SHAPE: {
+        RETURN_ERROR_IF_TRUE(
+            dims_count == 0, TRITONSERVER_ERROR_INVALID_ARG,
+            std::string(
+                "batch input of kind '" + batch_input.BatchInputKindString() +
+                "' expects source input '" + source_input +
+                "' to have a batch dimension"));
+        if (idx == 0) {
+          item_dims_count = dims_count - 1;
+        }
+        RETURN_ERROR_IF_TRUE(
+            (dims_count - 1) != item_dims_count,
+            TRITONSERVER_ERROR_INVALID_ARG,
+            std::string(
+                "batch input of kind '" + batch_input.BatchInputKindString() +
+                "' expects source input '" + source_input +
+                "' to have the same rank in all requests"));
+        for (int64_t item = 0; item < shape_dims[0]; ++item) {
+          values->insert(values->end(), shape_dims + 1, shape_dims + dims_count);
+        }
+        item_count += shape_dims[0];
         break;
       }
     }
-    if (backend_memory == nullptr) {
-      return TRITONSERVER_ErrorNew(
-          TRITONSERVER_ERROR_INTERNAL,
-          (std::string("failed to allocate contiguous buffer for input '") +
-           input_name + "'")
-              .c_str());
-    }
-    buffer = backend_memory->MemoryPtr();
-    *dst_buffer = backend_memory->MemoryPtr();
-    *dst_buffer_byte_size = backend_memory->ByteSize();
-    *dst_memory_type = backend_memory->MemoryType();
-    *dst_memory_type_id = backend_memory->MemoryTypeId();
-  } else {
-    if (allowed_input_types.size() != 0) {
-      return TRITONSERVER_ErrorNew(
-          TRITONSERVER_ERROR_INTERNAL,
-          "'allowed_input_types' must only contain the memory type and id of "
-          "'buffer'");
-    }
-    *dst_buffer = buffer;
-    *dst_buffer_byte_size = buffer_byte_size;
-    *dst_memory_type = allowed_input_types[0].first;
-    *dst_memory_type_id = allowed_input_types[0].second;
   }
-  if (*dst_buffer_byte_size != 0) {
-    ProcessTensor(
-        input_name, buffer, *dst_buffer_byte_size, *dst_memory_type,
-        *dst_memory_type_id);
+
+  switch (kind) {
+    case BatchInput::Kind::BATCH_MAX_ELEMENT_COUNT_AS_SHAPE:
+      shape->push_back(max_element_count);
+      break;
+    case BatchInput::Kind::BATCH_ITEM_SHAPE:
+      shape->push_back(item_count);
+      shape->push_back(item_dims_count);
+      break;
+    default:
+      shape->push_back(values->size());
+      break;
   }
+
   return nullptr;  // success
 }
 
 bool
 BackendInputCollector::Finalize()
 {
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::COLLECTOR_FINALIZE);
+#endif  // TRITON_ENABLE_STATS
+
+  // Every Process*() function launches the copies it queues, this only
+  // guards against a copy being left in the graph.
+  need_sync_ |= LaunchCopyGraph();
+
 #ifdef TRITON_ENABLE_GPU
   if ((!deferred_pinned_.empty()) && need_sync_) {
+#ifdef TRITON_ENABLE_STATS
+    BackendCopyStats::ScopedTimer sync_timer(
+        stats_, BackendCopyStats::Stage::COLLECTOR_SYNC_WAIT);
+#endif  // TRITON_ENABLE_STATS
     if (event_ != nullptr) {
       cudaEventSynchronize(event_);
     } else {
@@ -274,12 +1767,15 @@ BackendInputCollector::Finalize()
         def.pinned_memory_, def.tensor_buffer_ + def.tensor_buffer_offset_,
         stream_, &cuda_used);
     need_sync_ |= cuda_used;
+    RecordCopy(
+        TRITONSERVER_MEMORY_CPU_PINNED, def.tensor_memory_type_,
+        def.pinned_memory_size_);
 
     // If something goes wrong with the copy all the pending
     // responses fail...
     if (err != nullptr) {
-      for (auto& pr : def.requests_) {
-        auto& response = pr.first;
+      for (size_t idx = def.requests_begin_; idx < def.requests_end_; ++idx) {
+        auto& response = deferred_inputs_[idx].first;
         if (*response != nullptr) {
           LOG_IF_ERROR(
               TRITONBACKEND_ResponseSend(
@@ -297,8 +1793,16 @@ BackendInputCollector::Finalize()
   if ((!deferred_pinned_.empty()) && need_sync_ && (event_ != nullptr)) {
     cudaEventRecord(event_, stream_);
   }
+
+  // The copies are on a different stream than the computation using
+  // them so make the computation wait for them.
+  if ((compute_stream_ != stream_) && (compute_event_ != nullptr)) {
+    cudaEventRecord(compute_event_, stream_);
+    cudaStreamWaitEvent(compute_stream_, compute_event_, 0);
+  }
 #endif  // TRITON_ENABLE_GPU
   deferred_pinned_.clear();
+  deferred_inputs_.clear();
 
   return need_sync_;
 }
@@ -392,16 +1896,52 @@ BackendInputCollector::SetFixedSizeInputTensor(
       return cuda_copy;
     }
 
+    // GPU to GPU copies can be delayed and performed by one kernel
+    // launch with the other GPU copies of the tensor.
+    if (UseCopyKernel(
+            src_memory_type, src_memory_type_id, tensor_memory_type,
+            tensor_memory_type_id)) {
+      pending_kernel_copies_.emplace_back(
+          reinterpret_cast<const char*>(src_buffer), src_memory_type,
+          src_memory_type_id,
+          tensor_buffer + tensor_buffer_offset + input_offset,
+          tensor_memory_type, tensor_memory_type_id, src_byte_size, response,
+          request_input);
+      RecordCopy(src_memory_type, tensor_memory_type, src_byte_size);
+      input_offset += src_byte_size;
+      continue;
+    }
+
+    // CPU to CPU copies can be delayed and performed in parallel with
+    // the other CPU copies of the tensor.
+    if ((gather_thread_pool_ != nullptr) &&
+        (src_memory_type != TRITONSERVER_MEMORY_GPU) &&
+        (tensor_memory_type != TRITONSERVER_MEMORY_GPU)) {
+      pending_host_copies_.emplace_back(
+          reinterpret_cast<const char*>(src_buffer),
+          tensor_buffer + tensor_buffer_offset + input_offset, src_byte_size);
+      pending_host_byte_size_ += src_byte_size;
+      RecordCopy(src_memory_type, tensor_memory_type, src_byte_size);
+      input_offset += src_byte_size;
+      continue;
+    }
+
     // Direct copy without intermediate pinned memory.
     bool cuda_used = false;
-    RESPOND_AND_SET_NULL_IF_ERROR(
-        response,
-        CopyBuffer(
-            name, src_memory_type, src_memory_type_id, tensor_memory_type,
-            tensor_memory_type_id, src_byte_size, src_buffer,
-            tensor_buffer + tensor_buffer_offset + input_offset, stream_,
-            &cuda_used));
+    {
+      BackendPinnedPolicy::CopyTimer policy_timer(
+          TransferPolicy(src_memory_type, tensor_memory_type), stream_,
+          src_byte_size);
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          response,
+          IssueCopy(
+              name, src_memory_type, src_memory_type_id, tensor_memory_type,
+              tensor_memory_type_id, src_byte_size, src_buffer,
+              tensor_buffer + tensor_buffer_offset + input_offset,
+              &cuda_used));
+    }
     cuda_copy |= cuda_used;
+    RecordCopy(src_memory_type, tensor_memory_type, src_byte_size);
     if (*response == nullptr) {
       return cuda_copy;
     }
@@ -412,12 +1952,552 @@ BackendInputCollector::SetFixedSizeInputTensor(
   return cuda_copy;
 }
 
+void
+BackendInputCollector::CollectInputBuffers(
+    TRITONBACKEND_Input* request_input, const uint32_t buffer_count,
+    const InputTensor& tensor, const size_t tensor_buffer_offset,
+    const TRITONSERVER_MemoryType use_pinned_memory_type,
+    TRITONBACKEND_Response** response)
+{
+  bool staged = false;
+  size_t input_offset = 0;
+  for (size_t idx = 0; idx < buffer_count; ++idx) {
+    const void* src_buffer;
+    size_t src_byte_size;
+    TRITONSERVER_MemoryType src_memory_type;
+    int64_t src_memory_type_id;
+
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        response, TRITONBACKEND_InputBuffer(
+                      request_input, idx, &src_buffer, &src_byte_size,
+                      &src_memory_type, &src_memory_type_id));
+    if (*response == nullptr) {
+      return;
+    }
+
+    char* dst = tensor.buffer_ + tensor_buffer_offset + input_offset;
+    input_offset += src_byte_size;
+
+    // Same policy as SetFixedSizeInputTensor(), the first buffer of
+    // the input decides whether all its buffers are staged through
+    // pinned memory.
+    if (idx == 0) {
+      staged = (use_pinned_memory_type != TRITONSERVER_MEMORY_CPU_PINNED) &&
+               (src_memory_type == use_pinned_memory_type);
+    }
+
+    if (staged) {
+      auto& staged_copies = (tensor.memory_type_ == TRITONSERVER_MEMORY_GPU)
+                                ? staged_h2d_copies_
+                                : staged_d2h_copies_;
+      staged_copies.emplace_back(
+          reinterpret_cast<const char*>(src_buffer), src_memory_type,
+          src_memory_type_id, dst, tensor.memory_type_, tensor.memory_type_id_,
+          src_byte_size, response, request_input);
+      continue;
+    }
+
+    if (UseCopyKernel(
+            src_memory_type, src_memory_type_id, tensor.memory_type_,
+            tensor.memory_type_id_)) {
+      pending_kernel_copies_.emplace_back(
+          reinterpret_cast<const char*>(src_buffer), src_memory_type,
+          src_memory_type_id, dst, tensor.memory_type_, tensor.memory_type_id_,
+          src_byte_size, response, request_input);
+      RecordCopy(src_memory_type, tensor.memory_type_, src_byte_size);
+      continue;
+    }
+
+    if ((gather_thread_pool_ != nullptr) &&
+        (src_memory_type != TRITONSERVER_MEMORY_GPU) &&
+        (tensor.memory_type_ != TRITONSERVER_MEMORY_GPU)) {
+      pending_host_copies_.emplace_back(
+          reinterpret_cast<const char*>(src_buffer), dst, src_byte_size);
+      pending_host_byte_size_ += src_byte_size;
+      RecordCopy(src_memory_type, tensor.memory_type_, src_byte_size);
+      continue;
+    }
+
+    bool cuda_used = false;
+    {
+      BackendPinnedPolicy::CopyTimer policy_timer(
+          TransferPolicy(src_memory_type, tensor.memory_type_), stream_,
+          src_byte_size);
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          response,
+          IssueCopy(
+              tensor.input_name_, src_memory_type, src_memory_type_id,
+              tensor.memory_type_, tensor.memory_type_id_, src_byte_size,
+              src_buffer, dst, &cuda_used));
+    }
+    need_sync_ |= cuda_used;
+    RecordCopy(src_memory_type, tensor.memory_type_, src_byte_size);
+    if (*response == nullptr) {
+      return;
+    }
+  }
+}
+
+bool
+BackendInputCollector::FlushStagedCopies(const bool to_gpu)
+{
+  bool cuda_copy = false;
+
+  auto& staged_copies = to_gpu ? staged_h2d_copies_ : staged_d2h_copies_;
+  staged_copies.erase(
+      std::remove_if(
+          staged_copies.begin(), staged_copies.end(),
+          [](const StagedCopy& copy) { return *copy.response_ == nullptr; }),
+      staged_copies.end());
+  if (staged_copies.empty()) {
+    return cuda_copy;
+  }
+
+  // Order the copies by destination so that the copies into adjacent
+  // destinations are also adjacent in the pinned buffer and can be
+  // merged.
+  std::sort(
+      staged_copies.begin(), staged_copies.end(),
+      [](const StagedCopy& lhs, const StagedCopy& rhs) {
+        if (lhs.dst_memory_type_id_ != rhs.dst_memory_type_id_) {
+          return lhs.dst_memory_type_id_ < rhs.dst_memory_type_id_;
+        }
+        return lhs.dst_ < rhs.dst_;
+      });
+
+  size_t pinned_byte_size = 0;
+  for (const auto& copy : staged_copies) {
+    pinned_byte_size += copy.byte_size_;
+  }
+
+  char* pinned_memory = nullptr;
+  TRITONSERVER_MemoryType pinned_memory_type;
+  TRITONSERVER_Error* err = AllocateStagingBuffer(
+      pinned_byte_size, false /* allow_cpu */, &pinned_memory,
+      &pinned_memory_type);
+
+  // If the pinned buffer can't be allocated then just perform direct
+  // copies.
+  if (err != nullptr) {
+    TRITONSERVER_ErrorDelete(err);
+    RecordPinnedFallback();
+    for (auto& copy : staged_copies) {
+      bool cuda_used = false;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          copy.response_,
+          CopyBuffer(
+              "staged input", copy.src_memory_type_, copy.src_memory_type_id_,
+              copy.dst_memory_type_, copy.dst_memory_type_id_, copy.byte_size_,
+              copy.src_, copy.dst_, stream_, &cuda_used));
+      cuda_copy |= cuda_used;
+      RecordCopy(
+          copy.src_memory_type_, copy.dst_memory_type_, copy.byte_size_);
+    }
+    staged_copies.clear();
+    return cuda_copy;
+  }
+
+  // Copy the request buffers into the pinned buffer.
+  size_t pinned_offset = 0;
+  for (auto& copy : staged_copies) {
+    if (to_gpu) {
+      pending_host_copies_.emplace_back(
+          copy.src_, pinned_memory + pinned_offset, copy.byte_size_);
+      pending_host_byte_size_ += copy.byte_size_;
+    } else {
+      bool cuda_used = false;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          copy.response_,
+          CopyBuffer(
+              "staged input", copy.src_memory_type_, copy.src_memory_type_id_,
+              TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */,
+              copy.byte_size_, copy.src_, pinned_memory + pinned_offset,
+              stream_, &cuda_used));
+      cuda_copy |= cuda_used;
+    }
+    RecordCopy(
+        copy.src_memory_type_, TRITONSERVER_MEMORY_CPU_PINNED,
+        copy.byte_size_);
+    pinned_offset += copy.byte_size_;
+  }
+  FlushPendingHostCopies();
+
+  // Copy each run of adjacent destinations out of the pinned buffer.
+  // The GPU->pinned copies are in flight so the pinned->CPU copies are
+  // deferred to Finalize().
+  size_t run_begin = 0;
+  size_t run_offset = 0;
+  while (run_begin < staged_copies.size()) {
+    const auto& first = staged_copies[run_begin];
+    size_t run_end = run_begin + 1;
+    size_t run_byte_size = first.byte_size_;
+    while ((run_end < staged_copies.size()) &&
+           (staged_copies[run_end].dst_memory_type_id_ ==
+            first.dst_memory_type_id_) &&
+           (staged_copies[run_end].dst_ == (first.dst_ + run_byte_size))) {
+      run_byte_size += staged_copies[run_end].byte_size_;
+      run_end++;
+    }
+
+    if (to_gpu) {
+      bool cuda_used = false;
+      err = CopyBuffer(
+          "pinned buffer", TRITONSERVER_MEMORY_CPU_PINNED,
+          0 /* memory_type_id */, first.dst_memory_type_,
+          first.dst_memory_type_id_, run_byte_size, pinned_memory + run_offset,
+          first.dst_, stream_, &cuda_used);
+      cuda_copy |= cuda_used;
+      RecordCopy(
+          TRITONSERVER_MEMORY_CPU_PINNED, first.dst_memory_type_,
+          run_byte_size);
+
+      // If something goes wrong with the copy all the responses of the
+      // run fail...
+      if (err != nullptr) {
+        for (size_t idx = run_begin; idx < run_end; ++idx) {
+          auto& response = staged_copies[idx].response_;
+          if (*response != nullptr) {
+            LOG_IF_ERROR(
+                TRITONBACKEND_ResponseSend(
+                    *response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+                "failed to send error response");
+            *response = nullptr;
+          }
+        }
+        TRITONSERVER_ErrorDelete(err);
+      }
+    } else {
+      deferred_pinned_.emplace_back(
+          pinned_memory + run_offset, run_byte_size, first.dst_,
+          0 /* tensor_buffer_offset */, first.dst_memory_type_,
+          first.dst_memory_type_id_, deferred_inputs_.size(),
+          deferred_inputs_.size() + (run_end - run_begin));
+      for (size_t idx = run_begin; idx < run_end; ++idx) {
+        deferred_inputs_.emplace_back(
+            staged_copies[idx].response_, staged_copies[idx].request_input_);
+      }
+    }
+
+    run_offset += run_byte_size;
+    run_begin = run_end;
+  }
+
+  staged_copies.clear();
+  return cuda_copy;
+}
+
+void
+BackendInputCollector::FlushPendingHostCopies()
+{
+  if (pending_host_copies_.empty()) {
+    return;
+  }
+
+  if ((gather_thread_pool_ == nullptr) ||
+      (pending_host_byte_size_ < gather_min_byte_size_)) {
+    for (const auto& copy : pending_host_copies_) {
+      memcpy(copy.dst_, copy.src_, copy.byte_size_);
+    }
+  } else {
+    // Split the copies into chunks so that a few large copies are
+    // still shared among all the threads.
+    const size_t thread_count = gather_thread_pool_->ThreadCount() + 1;
+    const size_t chunk_byte_size = std::max(
+        (pending_host_byte_size_ + thread_count - 1) / thread_count,
+        size_t(64 * 1024));
+    host_copy_chunks_.clear();
+    for (const auto& copy : pending_host_copies_) {
+      for (size_t offset = 0; offset < copy.byte_size_;
+           offset += chunk_byte_size) {
+        host_copy_chunks_.emplace_back(
+            copy.src_ + offset, copy.dst_ + offset,
+            std::min(chunk_byte_size, copy.byte_size_ - offset));
+      }
+    }
+
+    const std::vector<HostCopy>& chunks = host_copy_chunks_;
+    gather_thread_pool_->ParallelFor(chunks.size(), [&chunks](size_t idx) {
+      memcpy(chunks[idx].dst_, chunks[idx].src_, chunks[idx].byte_size_);
+    });
+  }
+
+  pending_host_byte_size_ = 0;
+  pending_host_copies_.clear();
+}
+
+bool
+BackendInputCollector::UseCopyKernel(
+    const TRITONSERVER_MemoryType src_memory_type,
+    const int64_t src_memory_type_id,
+    const TRITONSERVER_MemoryType tensor_memory_type,
+    const int64_t tensor_memory_type_id) const
+{
+#ifdef TRITON_ENABLE_GPU
+  return (copy_kernel_threshold_ > 0) &&
+         (src_memory_type == TRITONSERVER_MEMORY_GPU) &&
+         (tensor_memory_type == TRITONSERVER_MEMORY_GPU) &&
+         (src_memory_type_id == tensor_memory_type_id);
+#else
+  return false;
+#endif  // TRITON_ENABLE_GPU
+}
+
+bool
+BackendInputCollector::FlushPendingKernelCopies()
+{
+  bool cuda_copy = false;
+  if (pending_kernel_copies_.empty()) {
+    return cuda_copy;
+  }
+
+#ifdef TRITON_ENABLE_GPU
+  // The kernel runs on 'stream_', so it is only launched for the copies
+  // to the device of 'stream_', the copies to other devices are done
+  // one by one.
+  int stream_device = -1;
+  TRITONSERVER_Error* stream_err = GetCudaStreamDevice(stream_, &stream_device);
+  if (stream_err != nullptr) {
+    TRITONSERVER_ErrorDelete(stream_err);
+    stream_device = -1;
+  }
+
+  // The copies of a single launch must target the same device.
+  std::stable_sort(
+      pending_kernel_copies_.begin(), pending_kernel_copies_.end(),
+      [](const StagedCopy& lhs, const StagedCopy& rhs) {
+        return lhs.dst_memory_type_id_ < rhs.dst_memory_type_id_;
+      });
+
+  size_t group_begin = 0;
+  while (group_begin < pending_kernel_copies_.size()) {
+    const int64_t device_id =
+        pending_kernel_copies_[group_begin].dst_memory_type_id_;
+    size_t group_end = group_begin + 1;
+    while ((group_end < pending_kernel_copies_.size()) &&
+           (pending_kernel_copies_[group_end].dst_memory_type_id_ ==
+            device_id)) {
+      group_end++;
+    }
+    const size_t count = group_end - group_begin;
+
+    bool launched = false;
+    if ((count >= copy_kernel_threshold_) && (device_id == stream_device)) {
+      // Both tables must live until the kernel completes, they are
+      // released with this object.
+      const size_t table_byte_size = count * sizeof(CopyDescriptor);
+      char* host_table = nullptr;
+      TRITONSERVER_MemoryType host_table_memory_type;
+      TRITONSERVER_Error* err = AllocateStagingBuffer(
+          table_byte_size, true /* allow_cpu */, &host_table,
+          &host_table_memory_type);
+      BackendMemory* device_table = nullptr;
+      if (err == nullptr) {
+        err = BackendMemory::Create(
+            memory_manager_,
+            {BackendMemory::AllocationType::GPU_POOL,
+             BackendMemory::AllocationType::GPU_ASYNC,
+             BackendMemory::AllocationType::GPU},
+            device_id, table_byte_size, stream_, &device_table);
+      }
+      if (err == nullptr) {
+        backend_memories_.push_back(
+            std::unique_ptr<BackendMemory>(device_table));
+        CopyDescriptor* descriptors =
+            reinterpret_cast<CopyDescriptor*>(host_table);
+        for (size_t idx = 0; idx < count; ++idx) {
+          const auto& copy = pending_kernel_copies_[group_begin + idx];
+          descriptors[idx].src_ = copy.src_;
+          descriptors[idx].dst_ = copy.dst_;
+          descriptors[idx].byte_size_ = copy.byte_size_;
+        }
+        // The kernel is launched on the current device, which must be
+        // the device of 'stream_'.
+        int current_device = -1;
+        const bool overridden =
+            (cudaGetDevice(&current_device) == cudaSuccess) &&
+            (current_device != device_id) &&
+            (cudaSetDevice(device_id) == cudaSuccess);
+        launched =
+            (RunCopyKernel(
+                 descriptors,
+                 reinterpret_cast<CopyDescriptor*>(device_table->MemoryPtr()),
+                 count, stream_) == cudaSuccess);
+        if (overridden) {
+          LOG_IF_CUDA_ERROR(
+              cudaSetDevice(current_device), "failed to set CUDA device");
+        }
+        cuda_copy |= launched;
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+
+    // Too few copies to be worth a launch, or the launch could not be
+    // done, so just perform the copies one by one.
+    if (!launched) {
+      for (size_t idx = group_begin; idx < group_end; ++idx) {
+        auto& copy = pending_kernel_copies_[idx];
+        bool cuda_used = false;
+        RESPOND_AND_SET_NULL_IF_ERROR(
+            copy.response_,
+            CopyBuffer(
+                "input buffer", copy.src_memory_type_, copy.src_memory_type_id_,
+                copy.dst_memory_type_, copy.dst_memory_type_id_,
+                copy.byte_size_, copy.src_, copy.dst_, stream_, &cuda_used));
+        cuda_copy |= cuda_used;
+      }
+    }
+
+    group_begin = group_end;
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  pending_kernel_copies_.clear();
+  return cuda_copy;
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::IssueCopy(
+    const char* msg, const TRITONSERVER_MemoryType src_memory_type,
+    const int64_t src_memory_type_id,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, const size_t byte_size, const void* src,
+    void* dst, bool* cuda_used)
+{
+  if ((copy_graph_ != nullptr) &&
+      BackendCopyGraph::IsGraphCopy(
+          src_memory_type, src_memory_type_id, dst_memory_type,
+          dst_memory_type_id)) {
+    copy_graph_->AddCopy(
+        src, src_memory_type, src_memory_type_id, dst, dst_memory_type,
+        dst_memory_type_id, byte_size);
+    *cuda_used = true;
+    return nullptr;  // success
+  }
+
+  if ((src_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (dst_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (src_memory_type_id != dst_memory_type_id)) {
+    return IssueCopyBetweenGpus(
+        msg, src_memory_type_id, dst_memory_type_id, byte_size, src, dst,
+        cuda_used);
+  }
+
+  return CopyBuffer(
+      msg, src_memory_type, src_memory_type_id, dst_memory_type,
+      dst_memory_type_id, byte_size, src, dst, stream_, cuda_used);
+}
+
+TRITONSERVER_Error*
+BackendInputCollector::IssueCopyBetweenGpus(
+    const char* msg, const int64_t src_device_id, const int64_t dst_device_id,
+    const size_t byte_size, const void* src, void* dst, bool* cuda_used)
+{
+  // With peer access enabled the copy goes directly between the GPUs.
+  // Otherwise it is staged through a pinned buffer owned by this object
+  // instead of the small buffers of the driver. The copy into the
+  // buffer and the copy out of it are both on 'stream_' so they are
+  // ordered.
+  GpuCopyPath path = GpuCopyPath::DRIVER_STAGED;
+  TRITONSERVER_Error* err = GetGpuCopyPath(src_device_id, dst_device_id, &path);
+  if (err != nullptr) {
+    TRITONSERVER_ErrorDelete(err);
+    path = GpuCopyPath::DRIVER_STAGED;
+  }
+
+  char* staging_buffer = nullptr;
+  if (path == GpuCopyPath::DRIVER_STAGED) {
+    TRITONSERVER_MemoryType staging_memory_type;
+    err = AllocateStagingBuffer(
+        byte_size, false /* allow_cpu */, &staging_buffer,
+        &staging_memory_type);
+    if (err != nullptr) {
+      TRITONSERVER_ErrorDelete(err);
+      staging_buffer = nullptr;
+    }
+  }
+
+  // The driver still stages the copy if no pinned buffer is available.
+  if (staging_buffer == nullptr) {
+    return CopyBuffer(
+        msg, TRITONSERVER_MEMORY_GPU, src_device_id, TRITONSERVER_MEMORY_GPU,
+        dst_device_id, byte_size, src, dst, stream_, cuda_used);
+  }
+
+  RETURN_IF_ERROR(CopyBuffer(
+      msg, TRITONSERVER_MEMORY_GPU, src_device_id,
+      TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */, byte_size, src,
+      staging_buffer, stream_, cuda_used));
+  return CopyBuffer(
+      msg, TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */,
+      TRITONSERVER_MEMORY_GPU, dst_device_id, byte_size, staging_buffer, dst,
+      stream_, cuda_used);
+}
+
+bool
+BackendInputCollector::FlushQueuedCopies()
+{
+  bool cuda_copy = FlushPendingKernelCopies();
+  cuda_copy |= LaunchCopyGraph();
+  return cuda_copy;
+}
+
+bool
+BackendInputCollector::LaunchCopyGraph()
+{
+  bool cuda_used = false;
+  if ((copy_graph_ == nullptr) || (copy_graph_->PendingCount() == 0)) {
+    return cuda_used;
+  }
+
+  // The queued copies are for all the requests so if they can't be
+  // issued all the responses fail.
+  TRITONSERVER_Error* err = copy_graph_->Launch(stream_, &cuda_used);
+  if (err != nullptr) {
+    for (auto& response : *responses_) {
+      if (response != nullptr) {
+        LOG_IF_ERROR(
+            TRITONBACKEND_ResponseSend(
+                response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+            "failed to send error response");
+        response = nullptr;
+      }
+    }
+    TRITONSERVER_ErrorDelete(err);
+  }
+
+  return cuda_used;
+}
+
+TRITONSERVER_MemoryType
+BackendInputCollector::ApplyPinnedPolicy(
+    const TRITONSERVER_MemoryType use_pinned_memory_type,
+    const size_t byte_size)
+{
+  if ((pinned_policy_ == nullptr) ||
+      (use_pinned_memory_type == TRITONSERVER_MEMORY_CPU_PINNED)) {
+    return use_pinned_memory_type;
+  }
+
+  // The decision is made before the requests are walked, so the byte
+  // size of the tensor stands in for the bytes to copy and the request
+  // count for the buffer count, most requests having a single buffer.
+  const bool staged = pinned_policy_->UseStaging(request_count_, byte_size);
+  RecordPinnedDecision(staged);
+  return staged ? use_pinned_memory_type : TRITONSERVER_MEMORY_CPU_PINNED;
+}
+
 bool
 BackendInputCollector::FlushPendingPinned(
     char* tensor_buffer, const size_t tensor_buffer_byte_size,
     const TRITONSERVER_MemoryType tensor_memory_type,
     const int64_t tensor_memory_type_id)
 {
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      pending_pinned_inputs_.empty() ? nullptr : stats_,
+      BackendCopyStats::Stage::COLLECTOR_PINNED_FLUSH);
+#endif  // TRITON_ENABLE_STATS
   bool cuda_copy = false;
 
   // Will be copying from CPU->pinned->GPU or GPU->pinned->CPU
@@ -427,19 +2507,16 @@ BackendInputCollector::FlushPendingPinned(
   // directly go CPU->GPU or GPU->CPU.
   char* pinned_memory = nullptr;
   if (pending_pinned_byte_size_ > 0) {
-    BackendMemory* backend_memory;
-    TRITONSERVER_Error* err = BackendMemory::Create(
-        memory_manager_,
-        {BackendMemory::AllocationType::CPU_PINNED_POOL,
-         BackendMemory::AllocationType::CPU_PINNED},
-        0 /* memory_type_id */, pending_pinned_byte_size_, &backend_memory);
+    // The pinned buffer is held for the lifetime of this object as
+    // there will be copies in flight.
+    TRITONSERVER_MemoryType pinned_memory_type;
+    TRITONSERVER_Error* err = AllocateStagingBuffer(
+        pending_pinned_byte_size_, false /* allow_cpu */, &pinned_memory,
+        &pinned_memory_type);
     if (err != nullptr) {
+      pinned_memory = nullptr;
       TRITONSERVER_ErrorDelete(err);
-    } else {
-      // Need to hold on to the allocated pinned buffer as there will be
-      // copies in flight. Will delete it in finalize.
-      backend_memories_.emplace_back(backend_memory);
-      pinned_memory = backend_memory->MemoryPtr();
+      RecordPinnedFallback();
     }
   }
 
@@ -467,6 +2544,7 @@ BackendInputCollector::FlushPendingPinned(
   // We have a pinned buffer so copy the pending input buffer(s) into
   // the pinned memory.
   else {
+    const auto staging_start = std::chrono::steady_clock::now();
     bool cuda_used = false;
     size_t offset = 0;
     for (auto& pr : pending_pinned_inputs_) {
@@ -488,6 +2566,17 @@ BackendInputCollector::FlushPendingPinned(
 
     cuda_copy |= cuda_used;
 
+    // The CPU->CPU-PINNED copies above may have been delayed, they must
+    // complete before the pinned buffer is used.
+    FlushPendingHostCopies();
+    if ((pinned_policy_ != nullptr) && !cuda_used) {
+      pinned_policy_->RecordStagingCopy(
+          pending_pinned_byte_size_,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - staging_start)
+              .count());
+    }
+
     // If the copy was not async (i.e. if request input was in CPU so
     // a CPU->CPU-PINNED copy was performed above), then the pinned
     // buffer now holds the tensor contents and we can immediately
@@ -498,12 +2587,15 @@ BackendInputCollector::FlushPendingPinned(
     // request inputs so that we can do the pinned->CPU copies in
     // finalize after we have waited for all async copies to complete.
     if (!cuda_used) {
-      auto err = CopyBuffer(
+      auto err = IssueCopy(
           "pinned buffer", TRITONSERVER_MEMORY_CPU_PINNED,
           0 /* memory_type_id */, tensor_memory_type, tensor_memory_type_id,
           pending_pinned_byte_size_, pinned_memory,
-          tensor_buffer + pending_pinned_offset_, stream_, &cuda_used);
+          tensor_buffer + pending_pinned_offset_, &cuda_used);
       cuda_copy |= cuda_used;
+      RecordCopy(
+          TRITONSERVER_MEMORY_CPU_PINNED, tensor_memory_type,
+          pending_pinned_byte_size_);
 
       // If something goes wrong with the copy all the pending
       // responses fail...
@@ -524,7 +2616,11 @@ BackendInputCollector::FlushPendingPinned(
       deferred_pinned_.emplace_back(
           pinned_memory, pending_pinned_byte_size_, tensor_buffer,
           pending_pinned_offset_, tensor_memory_type, tensor_memory_type_id,
-          std::move(pending_pinned_inputs_));
+          deferred_inputs_.size(),
+          deferred_inputs_.size() + pending_pinned_inputs_.size());
+      deferred_inputs_.insert(
+          deferred_inputs_.end(), pending_pinned_inputs_.begin(),
+          pending_pinned_inputs_.end());
     }
   }
 
@@ -536,4 +2632,94 @@ BackendInputCollector::FlushPendingPinned(
   return cuda_copy;
 }
 
+TRITONSERVER_Error*
+BackendInputCollector::SetBytesInputTensor(
+    TRITONBACKEND_Input* request_input, const uint32_t buffer_count,
+    const int64_t element_count, char* data_buffer,
+    const size_t data_buffer_byte_size, size_t* data_offset,
+    std::vector<uint64_t>* offsets)
+{
+  // Each element is a 4-byte length followed by that many bytes of
+  // string data. The input may be split over multiple buffers at any
+  // byte so both the length and the data of an element can straddle
+  // buffers.
+  int64_t parsed_count = 0;
+  uint32_t element_byte_size = 0;
+  size_t length_byte_count = 0;
+  size_t remaining_byte_size = 0;
+  bool in_element = false;
+  for (uint32_t idx = 0; idx < buffer_count; ++idx) {
+    const void* src_buffer;
+    size_t src_byte_size;
+    TRITONSERVER_MemoryType src_memory_type;
+    int64_t src_memory_type_id;
+    RETURN_IF_ERROR(TRITONBACKEND_InputBuffer(
+        request_input, idx, &src_buffer, &src_byte_size, &src_memory_type,
+        &src_memory_type_id));
+    RETURN_ERROR_IF_TRUE(
+        src_memory_type == TRITONSERVER_MEMORY_GPU,
+        TRITONSERVER_ERROR_INVALID_ARG,
+        std::string("expected BYTES input tensor in CPU memory"));
+
+    const char* src = reinterpret_cast<const char*>(src_buffer);
+    const char* src_end = src + src_byte_size;
+    while (src < src_end) {
+      if (!in_element) {
+        RETURN_ERROR_IF_TRUE(
+            parsed_count == element_count, TRITONSERVER_ERROR_INVALID_ARG,
+            std::string(
+                "unexpected data after the last element, expecting " +
+                std::to_string(element_count) + " elements"));
+        const size_t byte_count = std::min(
+            sizeof(uint32_t) - length_byte_count, size_t(src_end - src));
+        memcpy(
+            reinterpret_cast<char*>(&element_byte_size) + length_byte_count,
+            src, byte_count);
+        length_byte_count += byte_count;
+        src += byte_count;
+        if (length_byte_count < sizeof(uint32_t)) {
+          continue;
+        }
+
+        RETURN_ERROR_IF_TRUE(
+            (*data_offset + element_byte_size) > data_buffer_byte_size,
+            TRITONSERVER_ERROR_INVALID_ARG,
+            std::string(
+                "element " + std::to_string(parsed_count) + " of size " +
+                std::to_string(element_byte_size) +
+                " exceeds the size of the input"));
+        in_element = true;
+        remaining_byte_size = element_byte_size;
+      } else {
+        const size_t byte_count =
+            std::min(remaining_byte_size, size_t(src_end - src));
+        memcpy(data_buffer + *data_offset, src, byte_count);
+        *data_offset += byte_count;
+        remaining_byte_size -= byte_count;
+        src += byte_count;
+      }
+
+      if (in_element && (remaining_byte_size == 0)) {
+        offsets->push_back(*data_offset);
+        parsed_count++;
+        in_element = false;
+        element_byte_size = 0;
+        length_byte_count = 0;
+      }
+    }
+  }
+
+  RETURN_ERROR_IF_TRUE(
+      in_element || (length_byte_count != 0) ||
+          (parsed_count != element_count),
+      TRITONSERVER_ERROR_INVALID_ARG,
+      std::string(
+          "expected " + std::to_string(element_count) + " elements, got " +
+          std::to_string(parsed_count) +
+          (in_element || (length_byte_count != 0) ? " and a truncated element"
+                                                  : "")));
+
+  return nullptr;  // success
+}
+
 }}  // namespace triton::backend
@@ -0,0 +1,284 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_input_pipeline.h"
+
+#include "triton/backend/backend_common.h"
+#include "triton/backend/backend_model.h"
+
+namespace triton { namespace backend {
+
+namespace {
+
+#ifdef TRITON_ENABLE_GPU
+TRITONSERVER_Error*
+CudaError(const cudaError_t cuerr, const char* msg)
+{
+  if (cuerr != cudaSuccess) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string(msg) + ": " + cudaGetErrorString(cuerr)).c_str());
+  }
+  return nullptr;  // success
+}
+#endif  // TRITON_ENABLE_GPU
+
+}  // namespace
+
+//
+// BackendInputPipeline::Stage
+//
+BackendInputPipeline::Stage::~Stage()
+{
+  LOG_IF_ERROR(Wait(), "failed to wait for input pipeline stage");
+#ifdef TRITON_ENABLE_GPU
+  if (ready_event_ != nullptr) {
+    cudaEventDestroy(ready_event_);
+  }
+  if (consumed_event_ != nullptr) {
+    cudaEventDestroy(consumed_event_);
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+TRITONSERVER_Error*
+BackendInputPipeline::Stage::Wait()
+{
+  if (!begun_) {
+    return nullptr;  // success
+  }
+
+  // The stream given to Release() is not required to have waited for
+  // the input copies, so the copies are waited for on their own before
+  // the work that consumed the input buffers.
+#ifdef TRITON_ENABLE_GPU
+  if (ready_event_ != nullptr) {
+    RETURN_IF_ERROR(CudaError(
+        cudaEventSynchronize(ready_event_),
+        "failed to wait for input pipeline ready event"));
+  }
+  if (consumed_) {
+    RETURN_IF_ERROR(CudaError(
+        cudaEventSynchronize(consumed_event_),
+        "failed to wait for input pipeline consumed event"));
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  consumed_ = false;
+  begun_ = false;
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputPipeline::Stage::InputBuffer(
+    const std::string& name, const size_t byte_size,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    char** buffer)
+{
+  auto& backend_memory = buffers_[name];
+  if ((backend_memory == nullptr) || (backend_memory->ByteSize() < byte_size) ||
+      (backend_memory->MemoryType() != memory_type) ||
+      (backend_memory->MemoryTypeId() != memory_type_id)) {
+    std::vector<BackendMemory::AllocationType> alloc_types;
+    switch (memory_type) {
+      case TRITONSERVER_MEMORY_GPU:
+        alloc_types = {
+            BackendMemory::AllocationType::GPU_POOL,
+            BackendMemory::AllocationType::GPU_ASYNC,
+            BackendMemory::AllocationType::GPU};
+        break;
+      case TRITONSERVER_MEMORY_CPU_PINNED:
+        alloc_types = {
+            BackendMemory::AllocationType::CPU_PINNED_POOL,
+            BackendMemory::AllocationType::CPU_PINNED};
+        break;
+      case TRITONSERVER_MEMORY_CPU:
+        alloc_types = {BackendMemory::AllocationType::CPU};
+        break;
+    }
+
+    // Free the old buffer first so that it can be reused by the
+    // allocation.
+    backend_memory.reset();
+    BackendMemory* new_memory;
+    RETURN_IF_ERROR(BackendMemory::Create(
+        pipeline_->memory_manager_, alloc_types, memory_type_id, byte_size,
+        pipeline_->stream_, &new_memory));
+    backend_memory.reset(new_memory);
+  }
+
+  *buffer = backend_memory->MemoryPtr();
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputPipeline::Stage::Submit()
+{
+  if (!begun_) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        "input pipeline stage submitted without beginning a batch");
+  }
+
+  collector_->Finalize();
+#ifdef TRITON_ENABLE_GPU
+  if (ready_event_ != nullptr) {
+    RETURN_IF_ERROR(CudaError(
+        cudaEventRecord(ready_event_, pipeline_->stream_),
+        "failed to record input pipeline ready event"));
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  return nullptr;  // success
+}
+
+bool
+BackendInputPipeline::Stage::IsReady()
+{
+#ifdef TRITON_ENABLE_GPU
+  if (ready_event_ != nullptr) {
+    return (cudaEventQuery(ready_event_) == cudaSuccess);
+  }
+#endif  // TRITON_ENABLE_GPU
+  return true;
+}
+
+TRITONSERVER_Error*
+BackendInputPipeline::Stage::WaitReady(cudaStream_t stream)
+{
+#ifdef TRITON_ENABLE_GPU
+  if ((ready_event_ != nullptr) && (stream != pipeline_->stream_)) {
+    RETURN_IF_ERROR(CudaError(
+        cudaStreamWaitEvent(stream, ready_event_, 0),
+        "failed to wait for input pipeline ready event"));
+  }
+#endif  // TRITON_ENABLE_GPU
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputPipeline::Stage::SynchronizeReady()
+{
+#ifdef TRITON_ENABLE_GPU
+  if (ready_event_ != nullptr) {
+    RETURN_IF_ERROR(CudaError(
+        cudaEventSynchronize(ready_event_),
+        "failed to wait for input pipeline ready event"));
+  }
+#endif  // TRITON_ENABLE_GPU
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputPipeline::Stage::Release(cudaStream_t stream)
+{
+#ifdef TRITON_ENABLE_GPU
+  if (consumed_event_ != nullptr) {
+    RETURN_IF_ERROR(CudaError(
+        cudaEventRecord(consumed_event_, stream),
+        "failed to record input pipeline consumed event"));
+    consumed_ = true;
+  }
+#endif  // TRITON_ENABLE_GPU
+  return nullptr;  // success
+}
+
+//
+// BackendInputPipeline
+//
+TRITONSERVER_Error*
+BackendInputPipeline::Create(
+    BackendModelInstance* instance, const size_t stage_count,
+    std::unique_ptr<BackendInputPipeline>* pipeline)
+{
+  return Create(
+      instance->Model()->TritonMemoryManager(),
+      instance->Model()->EnablePinnedInput(), instance->InputCopyStream(),
+      instance->PinnedArena(), stage_count, pipeline);
+}
+
+TRITONSERVER_Error*
+BackendInputPipeline::Create(
+    TRITONBACKEND_MemoryManager* memory_manager, const bool pinned_enabled,
+    cudaStream_t stream, BackendPinnedArena* pinned_arena,
+    const size_t stage_count, std::unique_ptr<BackendInputPipeline>* pipeline)
+{
+  if (stage_count == 0) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "input pipeline must have at least one stage");
+  }
+
+  std::unique_ptr<BackendInputPipeline> lpipeline(new BackendInputPipeline(
+      memory_manager, pinned_enabled, stream, pinned_arena));
+  for (size_t i = 0; i < stage_count; ++i) {
+    std::unique_ptr<Stage> stage(new Stage(lpipeline.get()));
+#ifdef TRITON_ENABLE_GPU
+    if (stream != nullptr) {
+      RETURN_IF_ERROR(CudaError(
+          cudaEventCreateWithFlags(
+              &stage->ready_event_, cudaEventDisableTiming),
+          "failed to create input pipeline ready event"));
+      RETURN_IF_ERROR(CudaError(
+          cudaEventCreateWithFlags(
+              &stage->consumed_event_, cudaEventDisableTiming),
+          "failed to create input pipeline consumed event"));
+    }
+#endif  // TRITON_ENABLE_GPU
+    lpipeline->stages_.emplace_back(std::move(stage));
+  }
+
+  *pipeline = std::move(lpipeline);
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendInputPipeline::BeginBatch(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<TRITONBACKEND_Response*>* responses, Stage** stage)
+{
+  Stage* lstage = stages_[next_stage_].get();
+  RETURN_IF_ERROR(lstage->Wait());
+  next_stage_ = (next_stage_ + 1) % stages_.size();
+
+  // The ready event is given to the collector so that any
+  // synchronization needed in Finalize() only waits for the copies of
+  // this stage and not for the whole stream. The collector is kept by
+  // the stage and reset for each batch so that its containers are
+  // reused.
+  if (lstage->collector_ == nullptr) {
+    lstage->collector_.reset(new BackendInputCollector(
+        requests, request_count, responses, memory_manager_, pinned_enabled_,
+        stream_, lstage->ready_event_, pinned_arena_));
+  } else {
+    lstage->collector_->Reset(requests, request_count, responses);
+  }
+  lstage->begun_ = true;
+
+  *stage = lstage;
+  return nullptr;  // success
+}
+
+}}  // namespace triton::backend
@@ -26,64 +26,762 @@
 
 #include "triton/backend/backend_memory.h"
 
+#include <algorithm>
 #include <map>
+#include <mutex>
+#include <utility>
 #include "triton/backend/backend_common.h"
+#include "triton/backend/backend_numa.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // __linux__
+
+// Stream-ordered allocation was added in CUDA 11.2.
+#if defined(TRITON_ENABLE_GPU) && (CUDART_VERSION >= 11020)
+#define TRITON_ENABLE_GPU_ASYNC_ALLOC
+#endif
 
 namespace triton { namespace backend {
 
+namespace {
+
+//
+// Direct allocation of pinned and GPU memory, used by the CPU_PINNED
+// and GPU allocation types and by the block cache of the CACHED
+// allocation types.
+//
 TRITONSERVER_Error*
-BackendMemory::Create(
-    TRITONBACKEND_MemoryManager* manager, const AllocationType alloc_type,
-    const int64_t memory_type_id, const size_t byte_size, BackendMemory** mem)
+RawAllocate(
+    const bool gpu, const int64_t memory_type_id, const size_t byte_size,
+    void** ptr)
 {
-  *mem = nullptr;
+  *ptr = nullptr;
 
-  void* ptr = nullptr;
-  switch (alloc_type) {
-    case AllocationType::CPU_PINNED: {
 #ifdef TRITON_ENABLE_GPU
-      RETURN_IF_CUDA_ERROR(
-          cudaHostAlloc(&ptr, byte_size, cudaHostAllocPortable),
+  if (!gpu) {
+    RETURN_IF_CUDA_ERROR(
+        cudaHostAlloc(ptr, byte_size, cudaHostAllocPortable),
+        TRITONSERVER_ERROR_UNAVAILABLE,
+        std::string("failed to allocate pinned system memory"));
+    return nullptr;  // success
+  }
+
+  int current_device;
+  RETURN_IF_CUDA_ERROR(
+      cudaGetDevice(&current_device), TRITONSERVER_ERROR_INTERNAL,
+      std::string("failed to get device"));
+  bool overridden = (current_device != memory_type_id);
+  if (overridden) {
+    RETURN_IF_CUDA_ERROR(
+        cudaSetDevice(memory_type_id), TRITONSERVER_ERROR_INTERNAL,
+        std::string("failed to set device"));
+  }
+
+  auto err = cudaMalloc(ptr, byte_size);
+
+  if (overridden) {
+    LOG_IF_CUDA_ERROR(
+        cudaSetDevice(current_device), "failed to set CUDA device");
+  }
+
+  RETURN_ERROR_IF_FALSE(
+      err == cudaSuccess, TRITONSERVER_ERROR_UNAVAILABLE,
+      std::string("failed to allocate GPU memory: ") +
+          cudaGetErrorString(err));
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED,
+      gpu ? "GPU allocation not supported"
+          : "pinned-memory allocation not supported");
+#endif  // TRITON_ENABLE_GPU
+}
+
+void
+RawFree(const bool gpu, void* ptr)
+{
+#ifdef TRITON_ENABLE_GPU
+  if (ptr != nullptr) {
+    if (gpu) {
+      LOG_IF_CUDA_ERROR(cudaFree(ptr), "failed to free CUDA memory");
+    } else {
+      LOG_IF_CUDA_ERROR(cudaFreeHost(ptr), "failed to free pinned memory");
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+#ifdef TRITON_ENABLE_GPU_ASYNC_ALLOC
+// The devices that have been checked for stream-ordered allocation
+// support, and whether they support it.
+std::mutex async_devices_mu_;
+std::map<int64_t, bool> async_devices_;
+
+// Return true if 'device' supports stream-ordered allocation. The
+// first call for a device also sets the release threshold of its
+// default memory pool so that the memory freed to the pool is kept
+// for reuse instead of being released at each synchronization.
+bool
+AsyncAllocSupported(const int64_t device)
+{
+  std::lock_guard<std::mutex> lk(async_devices_mu_);
+  auto it = async_devices_.find(device);
+  if (it != async_devices_.end()) {
+    return it->second;
+  }
+
+  int supported = 0;
+  cudaMemPool_t pool;
+  if ((cudaDeviceGetAttribute(
+           &supported, cudaDevAttrMemoryPoolsSupported, device) !=
+       cudaSuccess) ||
+      (supported == 0) ||
+      (cudaDeviceGetDefaultMemPool(&pool, device) != cudaSuccess)) {
+    cudaGetLastError();  // clear the error
+    async_devices_.emplace(device, false);
+    return false;
+  }
+
+  uint64_t threshold = UINT64_MAX;
+  LOG_IF_CUDA_ERROR(
+      cudaMemPoolSetAttribute(
+          pool, cudaMemPoolAttrReleaseThreshold, &threshold),
+      "failed to set release threshold of CUDA memory pool");
+  async_devices_.emplace(device, true);
+  return true;
+}
+#endif  // TRITON_ENABLE_GPU_ASYNC_ALLOC
+
+TRITONSERVER_Error*
+RawAllocateAsync(
+    const int64_t memory_type_id, const size_t byte_size, cudaStream_t stream,
+    void** ptr)
+{
+  *ptr = nullptr;
+
+#ifdef TRITON_ENABLE_GPU_ASYNC_ALLOC
+  RETURN_ERROR_IF_FALSE(
+      AsyncAllocSupported(memory_type_id), TRITONSERVER_ERROR_UNSUPPORTED,
+      std::string("stream-ordered GPU allocation not supported on device ") +
+          std::to_string(memory_type_id));
+
+  // The pool is that of the current device when 'stream' is the
+  // default stream, so make sure the current device is the requested
+  // one.
+  int current_device;
+  RETURN_IF_CUDA_ERROR(
+      cudaGetDevice(&current_device), TRITONSERVER_ERROR_INTERNAL,
+      std::string("failed to get device"));
+  bool overridden = (current_device != memory_type_id);
+  if (overridden) {
+    RETURN_IF_CUDA_ERROR(
+        cudaSetDevice(memory_type_id), TRITONSERVER_ERROR_INTERNAL,
+        std::string("failed to set device"));
+  }
+
+  auto err = cudaMallocAsync(ptr, byte_size, stream);
+
+  if (overridden) {
+    LOG_IF_CUDA_ERROR(
+        cudaSetDevice(current_device), "failed to set CUDA device");
+  }
+
+  RETURN_ERROR_IF_FALSE(
+      err == cudaSuccess, TRITONSERVER_ERROR_UNAVAILABLE,
+      std::string("failed to allocate stream-ordered GPU memory: ") +
+          cudaGetErrorString(err));
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED,
+      "stream-ordered GPU allocation not supported");
+#endif  // TRITON_ENABLE_GPU_ASYNC_ALLOC
+}
+
+void
+RawFreeAsync(void* ptr, cudaStream_t stream)
+{
+#ifdef TRITON_ENABLE_GPU_ASYNC_ALLOC
+  if (ptr != nullptr) {
+    LOG_IF_CUDA_ERROR(
+        cudaFreeAsync(ptr, stream), "failed to free stream-ordered memory");
+  }
+#endif  // TRITON_ENABLE_GPU_ASYNC_ALLOC
+}
+
+// Release the unused memory of the default memory pools of the
+// devices used for stream-ordered allocation.
+void
+TrimAsyncPools()
+{
+#ifdef TRITON_ENABLE_GPU_ASYNC_ALLOC
+  std::lock_guard<std::mutex> lk(async_devices_mu_);
+  for (const auto& pr : async_devices_) {
+    cudaMemPool_t pool;
+    if (pr.second && (cudaDeviceGetDefaultMemPool(&pool, pr.first) ==
+                      cudaSuccess)) {
+      LOG_IF_CUDA_ERROR(
+          cudaMemPoolTrimTo(pool, 0), "failed to trim CUDA memory pool");
+    }
+  }
+#endif  // TRITON_ENABLE_GPU_ASYNC_ALLOC
+}
+
+#ifdef __linux__
+size_t
+PageAlignedByteSize(const size_t byte_size)
+{
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  return ((std::max(byte_size, size_t(1)) + page_size - 1) / page_size) *
+         page_size;
+}
+#endif  // __linux__
+
+// Allocate CPU memory placed on NUMA node 'numa_node', and pin it if
+// 'pinned'. The pages are mapped directly so that their placement can
+// be set before they are first touched.
+TRITONSERVER_Error*
+NumaAllocate(
+    const bool pinned, const int64_t numa_node, const size_t byte_size,
+    void** ptr)
+{
+  *ptr = nullptr;
+
+#ifdef __linux__
+#ifndef TRITON_ENABLE_GPU
+  RETURN_ERROR_IF_TRUE(
+      pinned, TRITONSERVER_ERROR_UNSUPPORTED,
+      std::string("pinned-memory allocation not supported"));
+#endif  // !TRITON_ENABLE_GPU
+
+  const size_t mapped_byte_size = PageAlignedByteSize(byte_size);
+  void* mapped = mmap(
+      nullptr, mapped_byte_size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  RETURN_ERROR_IF_TRUE(
+      mapped == MAP_FAILED, TRITONSERVER_ERROR_UNAVAILABLE,
+      std::string("failed to map ") + std::to_string(mapped_byte_size) +
+          " bytes of system memory");
+
+  TRITONSERVER_Error* err =
+      BindMemoryToNumaNode(mapped, mapped_byte_size, numa_node);
+#ifdef TRITON_ENABLE_GPU
+  if ((err == nullptr) && pinned) {
+    // Registering faults in the pages, so they are placed on the node.
+    cudaError_t cuerr =
+        cudaHostRegister(mapped, mapped_byte_size, cudaHostRegisterPortable);
+    if (cuerr != cudaSuccess) {
+      err = TRITONSERVER_ErrorNew(
           TRITONSERVER_ERROR_UNAVAILABLE,
-          std::string("failed to allocate pinned system memory"));
+          (std::string("failed to pin system memory: ") +
+           cudaGetErrorString(cuerr))
+              .c_str());
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
+  if (err != nullptr) {
+    munmap(mapped, mapped_byte_size);
+    return err;
+  }
+
+  *ptr = mapped;
+  return nullptr;  // success
 #else
-      return TRITONSERVER_ErrorNew(
-          TRITONSERVER_ERROR_UNSUPPORTED,
-          "pinned-memory allocation not supported");
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "NUMA allocation not supported");
+#endif  // __linux__
+}
+
+void
+NumaFree(const bool pinned, void* ptr, const size_t byte_size)
+{
+#ifdef __linux__
+  if (ptr != nullptr) {
+#ifdef TRITON_ENABLE_GPU
+    if (pinned) {
+      LOG_IF_CUDA_ERROR(
+          cudaHostUnregister(ptr), "failed to unpin system memory");
+    }
 #endif  // TRITON_ENABLE_GPU
-      break;
+    if (munmap(ptr, PageAlignedByteSize(byte_size)) != 0) {
+      LOG_MESSAGE(TRITONSERVER_LOG_ERROR, "failed to unmap system memory");
     }
+  }
+#endif  // __linux__
+}
+
+// The smallest size class of the block cache.
+constexpr size_t kCacheMinClassByteSize = 512;
+
+// Each thread keeps at most this many idle blocks of a size class, and
+// at most this many bytes of idle blocks in total. Blocks beyond that
+// go to the blocks shared by all threads.
+constexpr size_t kThreadCacheMaxClassBlocks = 4;
+constexpr size_t kThreadCacheMaxByteSize = 16 * 1024 * 1024;
+
+// Return the index and byte size of the size class for 'byte_size'.
+// Classes are spaced four per power of 2 so that rounding up never
+// wastes more than 25% of a block.
+void
+CacheSizeClass(
+    const size_t byte_size, size_t* class_index, size_t* class_byte_size)
+{
+  constexpr size_t kMinLog2 = 9;  // log2(kCacheMinClassByteSize)
+  if (byte_size <= kCacheMinClassByteSize) {
+    *class_index = 0;
+    *class_byte_size = kCacheMinClassByteSize;
+    return;
+  }
+
+  // Find 'log2' such that 2^log2 < byte_size <= 2^(log2 + 1) and
+  // round up to the next quarter step between those powers of 2.
+  size_t log2 = kMinLog2;
+  while ((size_t(1) << (log2 + 1)) < byte_size) {
+    log2++;
+  }
+
+  const size_t base = size_t(1) << log2;
+  const size_t step = base / 4;
+  const size_t steps = (byte_size - base + step - 1) / step;
+  *class_index = ((log2 - kMinLog2) * 4) + steps;
+  *class_byte_size = base + (steps * step);
+}
 
-    case AllocationType::GPU: {
+// Return the byte size of the size class at 'class_index', the
+// inverse of CacheSizeClass().
+size_t
+CacheClassByteSize(const size_t class_index)
+{
+  if (class_index == 0) {
+    return kCacheMinClassByteSize;
+  }
+  const size_t base = kCacheMinClassByteSize << ((class_index - 1) / 4);
+  const size_t steps = ((class_index - 1) % 4) + 1;
+  return base + (steps * (base / 4));
+}
+
+// An idle block of the cache. Work still in flight on 'stream_', the
+// stream of the BackendMemory that freed the block, may use the block
+// until 'event_', recorded on 'stream_' when the block is freed,
+// completes. 'event_' is nullptr if no work can be in flight.
+struct CachedBlock {
+  void* ptr_;
+  cudaStream_t stream_;
+#ifdef TRITON_ENABLE_GPU
+  cudaEvent_t event_;
+#else
+  void* event_;
+#endif  // TRITON_ENABLE_GPU
+};
+
+// Return a block freed on 'stream' with an event ordering its reuse
+// after the work in flight on 'stream'. If the event can't be
+// recorded, the stream is synchronized instead.
+CachedBlock
+FreedBlock(
+    const bool gpu, const int64_t memory_type_id, cudaStream_t stream,
+    void* ptr)
+{
+  CachedBlock block{ptr, stream, nullptr};
+#ifdef TRITON_ENABLE_GPU
+  // The event must be created on the device of the stream, which for
+  // a GPU block is the device of the block.
+  int current_device = memory_type_id;
+  bool overridden = false;
+  if (gpu && (cudaGetDevice(&current_device) == cudaSuccess) &&
+      (current_device != memory_type_id)) {
+    overridden = (cudaSetDevice(memory_type_id) == cudaSuccess);
+  }
+
+  if (cudaEventCreateWithFlags(&block.event_, cudaEventDisableTiming) !=
+      cudaSuccess) {
+    block.event_ = nullptr;
+  } else if (cudaEventRecord(block.event_, stream) != cudaSuccess) {
+    cudaEventDestroy(block.event_);
+    block.event_ = nullptr;
+  }
+  if (block.event_ == nullptr) {
+    cudaGetLastError();  // clear the error
+    LOG_IF_CUDA_ERROR(
+        cudaStreamSynchronize(stream),
+        "failed to synchronize stream of freed memory");
+  }
+
+  if (overridden) {
+    LOG_IF_CUDA_ERROR(
+        cudaSetDevice(current_device), "failed to set CUDA device");
+  }
+#endif  // TRITON_ENABLE_GPU
+  return block;
+}
+
+// Return true if 'block' can be reused by a BackendMemory of 'stream',
+// that is the work using the block when it was freed is done or, for
+// a GPU block, is ordered before the work on 'stream'. Pinned blocks
+// are written by the host, so they always wait for the work to be
+// done.
+bool
+BlockReusable(const CachedBlock& block, const bool gpu, cudaStream_t stream)
+{
+#ifdef TRITON_ENABLE_GPU
+  if ((block.event_ == nullptr) || (gpu && (block.stream_ == stream))) {
+    return true;
+  }
+
+  const cudaError_t err = cudaEventQuery(block.event_);
+  if (err != cudaSuccess) {
+    cudaGetLastError();  // clear the error
+    return false;
+  }
+#endif  // TRITON_ENABLE_GPU
+  return true;
+}
+
+// Release the event of a block that is reused or freed.
+void
+ReleaseBlockEvent(const CachedBlock& block)
+{
 #ifdef TRITON_ENABLE_GPU
-      int current_device;
-      RETURN_IF_CUDA_ERROR(
-          cudaGetDevice(&current_device), TRITONSERVER_ERROR_INTERNAL,
-          std::string("failed to get device"));
-      bool overridden = (current_device != memory_type_id);
-      if (overridden) {
-        RETURN_IF_CUDA_ERROR(
-            cudaSetDevice(memory_type_id), TRITONSERVER_ERROR_INTERNAL,
-            std::string("failed to set device"));
+  if (block.event_ != nullptr) {
+    LOG_IF_CUDA_ERROR(
+        cudaEventDestroy(block.event_), "failed to destroy CUDA event");
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+// Release the memory of 'block', freeing the memory waits for the work
+// using it.
+void
+BlockFree(const bool gpu, const CachedBlock& block)
+{
+  ReleaseBlockEvent(block);
+  RawFree(gpu, block.ptr_);
+}
+
+// Take a block that can be reused by a BackendMemory of 'stream' from
+// 'list'. Return false if there is none.
+bool
+TakeReusableBlock(
+    std::vector<CachedBlock>* list, const bool gpu, cudaStream_t stream,
+    void** ptr)
+{
+  for (size_t idx = list->size(); idx > 0; --idx) {
+    auto& block = (*list)[idx - 1];
+    if (BlockReusable(block, gpu, stream)) {
+      ReleaseBlockEvent(block);
+      *ptr = block.ptr_;
+      block = list->back();
+      list->pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+// The idle blocks of one memory type and id, one list per size class.
+struct CacheFreeLists {
+  CacheFreeLists(const bool gpu, const int64_t memory_type_id)
+      : gpu_(gpu), memory_type_id_(memory_type_id)
+  {
+  }
+
+  std::vector<CachedBlock>* List(const size_t class_index)
+  {
+    if (class_index >= lists_.size()) {
+      lists_.resize(class_index + 1);
+    }
+    return &lists_[class_index];
+  }
+
+  const bool gpu_;
+  const int64_t memory_type_id_;
+  std::vector<std::vector<CachedBlock>> lists_;
+};
+
+CacheFreeLists*
+FindFreeLists(
+    std::vector<CacheFreeLists>* free_lists, const bool gpu,
+    const int64_t memory_type_id)
+{
+  for (auto& fl : *free_lists) {
+    if ((fl.gpu_ == gpu) && (fl.memory_type_id_ == memory_type_id)) {
+      return &fl;
+    }
+  }
+  free_lists->emplace_back(gpu, memory_type_id);
+  return &free_lists->back();
+}
+
+//
+// The idle blocks shared by all threads.
+//
+class SharedBlockCache {
+ public:
+  // Never destroyed so that it outlives the caches of the threads that
+  // exit after the static destructors run. The blocks still idle at
+  // process exit are leaked on purpose, as CUDA may already be torn
+  // down, see BackendMemory::TrimCache().
+  static SharedBlockCache* Instance()
+  {
+    static SharedBlockCache* cache = new SharedBlockCache();
+    return cache;
+  }
+
+  bool Acquire(
+      const bool gpu, const int64_t memory_type_id, const size_t class_index,
+      const size_t class_byte_size, cudaStream_t stream, void** ptr)
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto list = FindFreeLists(&free_lists_, gpu, memory_type_id)
+                    ->List(class_index);
+    if (!TakeReusableBlock(list, gpu, stream, ptr)) {
+      return false;
+    }
+    cached_byte_size_ -= class_byte_size;
+    return true;
+  }
+
+  // Keep 'block' for reuse, or free it if the high water mark would be
+  // exceeded and 'may_free'.
+  void Release(
+      const bool gpu, const int64_t memory_type_id, const size_t class_index,
+      const size_t class_byte_size, const CachedBlock& block,
+      const bool may_free = true)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (!may_free ||
+          ((cached_byte_size_ + class_byte_size) <= high_water_mark_)) {
+        FindFreeLists(&free_lists_, gpu, memory_type_id)
+            ->List(class_index)
+            ->push_back(block);
+        cached_byte_size_ += class_byte_size;
+        return;
       }
+    }
+    BlockFree(gpu, block);
+  }
 
-      auto err = cudaMalloc(&ptr, byte_size);
+  void SetHighWaterMark(const size_t byte_size)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      high_water_mark_ = byte_size;
+    }
+    Trim(byte_size);
+  }
 
-      if (overridden) {
-        LOG_IF_CUDA_ERROR(
-            cudaSetDevice(current_device), "failed to set CUDA device");
+  // Release the idle blocks, largest size classes first, until at most
+  // 'byte_size' bytes remain.
+  void Trim(const size_t byte_size)
+  {
+    std::vector<std::pair<bool, CachedBlock>> released;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      for (auto& fl : free_lists_) {
+        for (size_t idx = fl.lists_.size(); idx > 0; --idx) {
+          auto& list = fl.lists_[idx - 1];
+          const size_t class_byte_size = CacheClassByteSize(idx - 1);
+          while (!list.empty() && (cached_byte_size_ > byte_size)) {
+            released.emplace_back(fl.gpu_, list.back());
+            list.pop_back();
+            cached_byte_size_ -= class_byte_size;
+          }
+        }
       }
+    }
 
-      RETURN_ERROR_IF_FALSE(
-          err == cudaSuccess, TRITONSERVER_ERROR_UNAVAILABLE,
-          std::string("failed to allocate GPU memory: ") +
-              cudaGetErrorString(err));
-#else
-      return TRITONSERVER_ErrorNew(
-          TRITONSERVER_ERROR_UNSUPPORTED, "GPU allocation not supported");
-#endif  // TRITON_ENABLE_GPU
-      break;
+    // Free outside of the lock as freeing may synchronize the device.
+    for (const auto& pr : released) {
+      BlockFree(pr.first, pr.second);
+    }
+  }
+
+  size_t CachedByteSize()
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    return cached_byte_size_;
+  }
+
+ private:
+  SharedBlockCache()
+      : cached_byte_size_(0),
+        high_water_mark_(BackendMemory::kDefaultCacheHighWaterMark)
+  {
+  }
+
+  std::mutex mu_;
+  std::vector<CacheFreeLists> free_lists_;
+  size_t cached_byte_size_;
+  size_t high_water_mark_;
+};
+
+//
+// The idle blocks of a thread. Only the owning thread accesses them so
+// reusing a block of the same size class as a block freed earlier by
+// the thread, the common case for an instance thread executing similar
+// batches, takes no lock.
+//
+class ThreadBlockCache {
+ public:
+  ThreadBlockCache() : cached_byte_size_(0) {}
+
+  // A thread may exit after CUDA is torn down, so the blocks are moved
+  // to the shared blocks without releasing any of them.
+  ~ThreadBlockCache() { Flush(false /* may_free */); }
+
+  bool Acquire(
+      const bool gpu, const int64_t memory_type_id, const size_t class_index,
+      const size_t class_byte_size, cudaStream_t stream, void** ptr)
+  {
+    auto list =
+        FindFreeLists(&free_lists_, gpu, memory_type_id)->List(class_index);
+    if (!TakeReusableBlock(list, gpu, stream, ptr)) {
+      return false;
+    }
+    cached_byte_size_ -= class_byte_size;
+    return true;
+  }
+
+  bool Release(
+      const bool gpu, const int64_t memory_type_id, const size_t class_index,
+      const size_t class_byte_size, const CachedBlock& block)
+  {
+    if ((cached_byte_size_ + class_byte_size) > kThreadCacheMaxByteSize) {
+      return false;
+    }
+    auto list =
+        FindFreeLists(&free_lists_, gpu, memory_type_id)->List(class_index);
+    if (list->size() >= kThreadCacheMaxClassBlocks) {
+      return false;
+    }
+    list->push_back(block);
+    cached_byte_size_ += class_byte_size;
+    return true;
+  }
+
+  // Move all the idle blocks to the shared blocks, which free the
+  // blocks beyond their high water mark if 'may_free'.
+  void Flush(const bool may_free = true)
+  {
+    auto shared = SharedBlockCache::Instance();
+    for (auto& fl : free_lists_) {
+      for (size_t idx = 0; idx < fl.lists_.size(); ++idx) {
+        const size_t class_byte_size = CacheClassByteSize(idx);
+        for (const auto& block : fl.lists_[idx]) {
+          shared->Release(
+              fl.gpu_, fl.memory_type_id_, idx, class_byte_size, block,
+              may_free);
+        }
+        fl.lists_[idx].clear();
+      }
     }
+    cached_byte_size_ = 0;
+  }
+
+ private:
+  std::vector<CacheFreeLists> free_lists_;
+  size_t cached_byte_size_;
+};
+
+ThreadBlockCache&
+ThreadCache()
+{
+  static thread_local ThreadBlockCache cache;
+  return cache;
+}
+
+TRITONSERVER_Error*
+CacheAllocate(
+    const bool gpu, const int64_t memory_type_id, const size_t byte_size,
+    cudaStream_t stream, void** ptr)
+{
+  size_t class_index, class_byte_size;
+  CacheSizeClass(byte_size, &class_index, &class_byte_size);
+  if (ThreadCache().Acquire(
+          gpu, memory_type_id, class_index, class_byte_size, stream, ptr) ||
+      SharedBlockCache::Instance()->Acquire(
+          gpu, memory_type_id, class_index, class_byte_size, stream, ptr)) {
+    return nullptr;  // success
+  }
+
+  // Nothing to reuse. If the allocation fails it may be because the
+  // cache is holding the memory, so release the idle blocks and retry.
+  TRITONSERVER_Error* err =
+      RawAllocate(gpu, memory_type_id, class_byte_size, ptr);
+  if ((err != nullptr) &&
+      (TRITONSERVER_ErrorCode(err) == TRITONSERVER_ERROR_UNAVAILABLE)) {
+    TRITONSERVER_ErrorDelete(err);
+    BackendMemory::TrimCache();
+    err = RawAllocate(gpu, memory_type_id, class_byte_size, ptr);
+  }
+  return err;
+}
+
+void
+CacheFree(
+    const bool gpu, const int64_t memory_type_id, const size_t byte_size,
+    cudaStream_t stream, void* ptr)
+{
+  if (ptr == nullptr) {
+    return;
+  }
+
+  size_t class_index, class_byte_size;
+  CacheSizeClass(byte_size, &class_index, &class_byte_size);
+  const CachedBlock block = FreedBlock(gpu, memory_type_id, stream, ptr);
+  if (!ThreadCache().Release(
+          gpu, memory_type_id, class_index, class_byte_size, block)) {
+    SharedBlockCache::Instance()->Release(
+        gpu, memory_type_id, class_index, class_byte_size, block);
+  }
+}
+
+}  // namespace
+
+constexpr size_t BackendMemory::kDefaultCacheHighWaterMark;
+
+TRITONSERVER_Error*
+BackendMemory::Create(
+    TRITONBACKEND_MemoryManager* manager, const AllocationType alloc_type,
+    const int64_t memory_type_id, const size_t byte_size, BackendMemory** mem)
+{
+  return Create(
+      manager, alloc_type, memory_type_id, byte_size, nullptr /* stream */,
+      mem);
+}
+
+TRITONSERVER_Error*
+BackendMemory::Create(
+    TRITONBACKEND_MemoryManager* manager, const AllocationType alloc_type,
+    const int64_t memory_type_id, const size_t byte_size, cudaStream_t stream,
+    BackendMemory** mem)
+{
+  *mem = nullptr;
+
+  void* ptr = nullptr;
+  switch (alloc_type) {
+    case AllocationType::CPU_PINNED:
+    case AllocationType::GPU:
+      RETURN_IF_ERROR(RawAllocate(
+          alloc_type == AllocationType::GPU, memory_type_id, byte_size, &ptr));
+      break;
+
+    case AllocationType::CPU_PINNED_CACHED:
+    case AllocationType::GPU_CACHED:
+      RETURN_IF_ERROR(CacheAllocate(
+          alloc_type == AllocationType::GPU_CACHED, memory_type_id, byte_size,
+          stream, &ptr));
+      break;
+
+    case AllocationType::GPU_ASYNC:
+      RETURN_IF_ERROR(
+          RawAllocateAsync(memory_type_id, byte_size, stream, &ptr));
+      break;
 
     case AllocationType::CPU:
     case AllocationType::CPU_PINNED_POOL:
@@ -92,11 +790,22 @@ BackendMemory::Create(
           manager, &ptr, AllocTypeToMemoryType(alloc_type), memory_type_id,
           byte_size));
       break;
+
+    case AllocationType::CPU_NUMA:
+    case AllocationType::CPU_PINNED_NUMA:
+      RETURN_IF_ERROR(NumaAllocate(
+          alloc_type == AllocationType::CPU_PINNED_NUMA, memory_type_id,
+          byte_size, &ptr));
+      break;
   }
 
+  // 'memory_type_id' of the NUMA allocation types is the NUMA node,
+  // the memory itself is CPU memory with ID 0.
+  const bool numa = (alloc_type == AllocationType::CPU_NUMA) ||
+                    (alloc_type == AllocationType::CPU_PINNED_NUMA);
   *mem = new BackendMemory(
-      manager, alloc_type, memory_type_id, reinterpret_cast<char*>(ptr),
-      byte_size);
+      manager, alloc_type, numa ? 0 : memory_type_id,
+      reinterpret_cast<char*>(ptr), byte_size, stream);
 
   return nullptr;  // success
 }
@@ -106,6 +815,18 @@ BackendMemory::Create(
     TRITONBACKEND_MemoryManager* manager,
     const std::vector<AllocationType>& alloc_types,
     const int64_t memory_type_id, const size_t byte_size, BackendMemory** mem)
+{
+  return Create(
+      manager, alloc_types, memory_type_id, byte_size, nullptr /* stream */,
+      mem);
+}
+
+TRITONSERVER_Error*
+BackendMemory::Create(
+    TRITONBACKEND_MemoryManager* manager,
+    const std::vector<AllocationType>& alloc_types,
+    const int64_t memory_type_id, const size_t byte_size, cudaStream_t stream,
+    BackendMemory** mem)
 {
   *mem = nullptr;
   RETURN_ERROR_IF_TRUE(
@@ -113,17 +834,20 @@ BackendMemory::Create(
       std::string("BackendMemory::Create, at least one allocation type must be "
                   "specified"));
 
+  // The errors are only needed if all allocation types fail so the
+  // common case of the first allocation type succeeding doesn't build
+  // anything.
   bool success = false;
-  std::unordered_map<AllocationType, TRITONSERVER_Error*> errors;
+  std::vector<std::pair<AllocationType, TRITONSERVER_Error*>> errors;
   for (const AllocationType alloc_type : alloc_types) {
     TRITONSERVER_Error* err =
-        Create(manager, alloc_type, memory_type_id, byte_size, mem);
+        Create(manager, alloc_type, memory_type_id, byte_size, stream, mem);
     if (err == nullptr) {
       success = true;
       break;
     }
 
-    errors.insert({alloc_type, err});
+    errors.emplace_back(alloc_type, err);
   }
 
   // If allocation failed for all allocation types then display all
@@ -149,20 +873,25 @@ BackendMemory::~BackendMemory()
 {
   switch (alloctype_) {
     case AllocationType::CPU_PINNED:
-#ifdef TRITON_ENABLE_GPU
-      if (buffer_ != nullptr) {
-        LOG_IF_CUDA_ERROR(
-            cudaFreeHost(buffer_), "failed to free pinned memory");
-      }
-#endif  // TRITON_ENABLE_GPU
+    case AllocationType::GPU:
+      RawFree(alloctype_ == AllocationType::GPU, buffer_);
       break;
 
-    case AllocationType::GPU:
-#ifdef TRITON_ENABLE_GPU
-      if (buffer_ != nullptr) {
-        LOG_IF_CUDA_ERROR(cudaFree(buffer_), "failed to free CUDA memory");
-      }
-#endif  // TRITON_ENABLE_GPU
+    case AllocationType::CPU_PINNED_CACHED:
+    case AllocationType::GPU_CACHED:
+      CacheFree(
+          alloctype_ == AllocationType::GPU_CACHED, memtype_id_, byte_size_,
+          stream_, buffer_);
+      break;
+
+    case AllocationType::GPU_ASYNC:
+      RawFreeAsync(buffer_, stream_);
+      break;
+
+    case AllocationType::CPU_NUMA:
+    case AllocationType::CPU_PINNED_NUMA:
+      NumaFree(
+          alloctype_ == AllocationType::CPU_PINNED_NUMA, buffer_, byte_size_);
       break;
 
     case AllocationType::CPU:
@@ -182,12 +911,17 @@ BackendMemory::AllocTypeToMemoryType(const AllocationType a)
 {
   switch (a) {
     case AllocationType::CPU:
+    case AllocationType::CPU_NUMA:
       return TRITONSERVER_MEMORY_CPU;
     case AllocationType::CPU_PINNED:
+    case AllocationType::CPU_PINNED_NUMA:
     case AllocationType::CPU_PINNED_POOL:
+    case AllocationType::CPU_PINNED_CACHED:
       return TRITONSERVER_MEMORY_CPU_PINNED;
     case AllocationType::GPU:
     case AllocationType::GPU_POOL:
+    case AllocationType::GPU_CACHED:
+    case AllocationType::GPU_ASYNC:
       return TRITONSERVER_MEMORY_GPU;
   }
 
@@ -208,9 +942,39 @@ BackendMemory::AllocTypeString(const AllocationType a)
       return "CPU_PINNED_POOL";
     case AllocationType::GPU_POOL:
       return "GPU_POOL";
+    case AllocationType::CPU_PINNED_CACHED:
+      return "CPU_PINNED_CACHED";
+    case AllocationType::GPU_CACHED:
+      return "GPU_CACHED";
+    case AllocationType::GPU_ASYNC:
+      return "GPU_ASYNC";
+    case AllocationType::CPU_NUMA:
+      return "CPU_NUMA";
+    case AllocationType::CPU_PINNED_NUMA:
+      return "CPU_PINNED_NUMA";
   }
 
   return "<unknown>";
 }
 
+void
+BackendMemory::SetCacheHighWaterMark(const size_t byte_size)
+{
+  SharedBlockCache::Instance()->SetHighWaterMark(byte_size);
+}
+
+void
+BackendMemory::TrimCache(const size_t byte_size)
+{
+  ThreadCache().Flush();
+  SharedBlockCache::Instance()->Trim(byte_size);
+  TrimAsyncPools();
+}
+
+size_t
+BackendMemory::CachedByteSize()
+{
+  return SharedBlockCache::Instance()->CachedByteSize();
+}
+
 }}  // namespace triton::backend
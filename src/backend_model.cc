@@ -26,6 +26,7 @@
 
 #include "triton/backend/backend_model.h"
 
+#include <algorithm>
 #include "triton/backend/backend_common.h"
 
 namespace triton { namespace backend {
@@ -34,8 +35,9 @@ namespace triton { namespace backend {
 // BackendModel
 //
 BackendModel::BackendModel(TRITONBACKEND_Model* triton_model)
-    : triton_model_(triton_model), supports_batching_initialized_(false),
-      supports_batching_(false)
+    : triton_model_(triton_model), max_batch_size_(0),
+      artifacts_resolved_(false),
+      supports_batching_initialized_(false), supports_batching_(false)
 {
   TRITONSERVER_Message* config_message;
   THROW_IF_BACKEND_MODEL_ERROR(TRITONBACKEND_ModelConfig(
@@ -62,6 +64,8 @@ BackendModel::BackendModel(TRITONBACKEND_Model* triton_model)
   THROW_IF_BACKEND_MODEL_ERROR(
       TRITONBACKEND_ModelVersion(triton_model, &version_));
 
+  THROW_IF_BACKEND_MODEL_ERROR(ReparseModelConfig());
+
   int64_t mbs = 0;
   THROW_IF_BACKEND_MODEL_ERROR(
       model_config_.MemberAsInt("max_batch_size", &mbs));
@@ -104,6 +108,107 @@ BackendModel::BackendModel(TRITONBACKEND_Model* triton_model)
       }
     }
   }
+
+  gather_min_byte_size_ = 1024 * 1024;
+  copy_kernel_threshold_ = 0;
+  separate_copy_streams_ = false;
+  residency_cache_byte_size_ = 0;
+  copy_graph_min_copy_count_ = 0;
+  {
+    std::string value;
+    if (parsed_config_->FindParameter("parallel_gather_thread_count", &value)) {
+      int thread_count;
+      THROW_IF_BACKEND_MODEL_ERROR(ParseIntValue(value, &thread_count));
+      if (thread_count > 0) {
+        gather_thread_pool_.reset(new BackendThreadPool(thread_count));
+      }
+    }
+
+    if (parsed_config_->FindParameter(
+            "parallel_gather_min_byte_size", &value)) {
+      int64_t min_byte_size;
+      THROW_IF_BACKEND_MODEL_ERROR(ParseLongLongValue(value, &min_byte_size));
+      gather_min_byte_size_ = std::max(min_byte_size, int64_t(0));
+    }
+
+    if (parsed_config_->FindParameter("copy_kernel_threshold", &value)) {
+      int64_t threshold;
+      THROW_IF_BACKEND_MODEL_ERROR(ParseLongLongValue(value, &threshold));
+      copy_kernel_threshold_ = std::max(threshold, int64_t(0));
+    }
+
+    if (parsed_config_->FindParameter("separate_copy_streams", &value)) {
+      THROW_IF_BACKEND_MODEL_ERROR(
+          ParseBoolValue(value, &separate_copy_streams_));
+    }
+
+    if (parsed_config_->FindParameter("residency_cache_byte_size", &value)) {
+      int64_t byte_size;
+      THROW_IF_BACKEND_MODEL_ERROR(ParseLongLongValue(value, &byte_size));
+      residency_cache_byte_size_ = std::max(byte_size, int64_t(0));
+    }
+
+    if (parsed_config_->FindParameter("copy_graph_min_copy_count", &value)) {
+      int64_t copy_count;
+      THROW_IF_BACKEND_MODEL_ERROR(ParseLongLongValue(value, &copy_count));
+      copy_graph_min_copy_count_ = std::max(copy_count, int64_t(0));
+    }
+
+    if (parsed_config_->FindParameter("residency_cache_inputs", &value)) {
+      size_t begin = 0;
+      while (begin <= value.size()) {
+        size_t end = value.find(',', begin);
+        if (end == std::string::npos) {
+          end = value.size();
+        }
+        const size_t first = value.find_first_not_of(' ', begin);
+        if (first < end) {
+          const size_t last = value.find_last_not_of(' ', end - 1);
+          residency_cache_inputs_.emplace(
+              value.substr(first, last - first + 1));
+        }
+        begin = end + 1;
+      }
+    }
+  }
+}
+
+TRITONSERVER_Error*
+BackendModel::ReparseModelConfig()
+{
+  std::unique_ptr<BackendModelConfig> parsed_config;
+  RETURN_IF_ERROR(
+      BackendModelConfig::Create(model_config_, name_, &parsed_config));
+  parsed_config_.reset(parsed_config.release());
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendModel::ArtifactFilename(const std::string& cc, std::string* filename)
+{
+  std::lock_guard<std::mutex> lk(artifact_mu_);
+  if (!artifacts_resolved_) {
+    RETURN_IF_ERROR(model_config_.MemberAsString(
+        "default_model_filename", &default_model_filename_));
+
+    common::TritonJson::Value cc_names;
+    if (model_config_.Find("cc_model_filenames", &cc_names)) {
+      std::vector<std::string> ccs;
+      RETURN_IF_ERROR(cc_names.Members(&ccs));
+      for (const auto& member : ccs) {
+        std::string cc_filename;
+        RETURN_IF_ERROR(
+            cc_names.MemberAsString(member.c_str(), &cc_filename));
+        cc_model_filenames_.emplace(member, std::move(cc_filename));
+      }
+    }
+    artifacts_resolved_ = true;
+  }
+
+  auto it = cc_model_filenames_.find(cc);
+  *filename =
+      (it != cc_model_filenames_.end()) ? it->second : default_model_filename_;
+  return nullptr;  // success
 }
 
 TRITONSERVER_Error*
@@ -111,16 +216,19 @@ BackendModel::SupportsFirstDimBatching(bool* supports)
 {
   // We can't determine this during model initialization because
   // TRITONSERVER_ServerModelBatchProperties can't be called until the
-  // model is loaded. So we just cache it here.
-  if (!supports_batching_initialized_) {
+  // model is loaded. So we just cache it here. Instances racing on
+  // the first call all get the same answer from the server.
+  if (!supports_batching_initialized_.load(std::memory_order_acquire)) {
     uint32_t flags = 0;
     RETURN_IF_ERROR(TRITONSERVER_ServerModelBatchProperties(
         triton_server_, name_.c_str(), version_, &flags, nullptr /* voidp */));
-    supports_batching_ = ((flags & TRITONSERVER_BATCH_FIRST_DIM) != 0);
-    supports_batching_initialized_ = true;
+    supports_batching_.store(
+        (flags & TRITONSERVER_BATCH_FIRST_DIM) != 0,
+        std::memory_order_relaxed);
+    supports_batching_initialized_.store(true, std::memory_order_release);
   }
 
-  *supports = supports_batching_;
+  *supports = supports_batching_.load(std::memory_order_relaxed);
   return nullptr;  // success
 }
 
@@ -0,0 +1,212 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_model_config.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendModelConfig
+//
+constexpr size_t BackendModelConfig::kControlKindCount;
+
+TRITONSERVER_Error*
+BackendModelConfig::Create(
+    common::TritonJson::Value& config, const std::string& model_name,
+    std::unique_ptr<BackendModelConfig>* model_config)
+{
+  std::unique_ptr<BackendModelConfig> view(new BackendModelConfig());
+  view->has_control_.fill(false);
+
+  RETURN_IF_ERROR(
+      ParseTensors(config, "input", &view->inputs_, &view->input_indices_));
+  RETURN_IF_ERROR(
+      ParseTensors(config, "output", &view->outputs_, &view->output_indices_));
+
+  common::TritonJson::Value batcher;
+  if (config.Find("sequence_batching", &batcher)) {
+    view->has_sequence_batching_ = true;
+    RETURN_IF_ERROR(view->ParseSequenceControls(batcher, model_name));
+  }
+
+  common::TritonJson::Value params;
+  if (config.Find("parameters", &params)) {
+    std::vector<std::string> keys;
+    RETURN_IF_ERROR(params.Members(&keys));
+    for (const auto& key : keys) {
+      std::string value;
+      RETURN_IF_ERROR(GetParameterValue(params, key, &value));
+      view->parameters_.emplace(key, std::move(value));
+    }
+  }
+
+  *model_config = std::move(view);
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendModelConfig::ParseTensors(
+    common::TritonJson::Value& config, const char* member,
+    std::vector<Tensor>* tensors,
+    std::unordered_map<std::string, size_t>* indices)
+{
+  common::TritonJson::Value ios;
+  if (!config.Find(member, &ios)) {
+    return nullptr;  // success
+  }
+
+  tensors->resize(ios.ArraySize());
+  for (size_t i = 0; i < ios.ArraySize(); i++) {
+    common::TritonJson::Value io;
+    RETURN_IF_ERROR(ios.IndexAsObject(i, &io));
+
+    Tensor& tensor = (*tensors)[i];
+    tensor.index_ = i;
+    RETURN_IF_ERROR(io.MemberAsString("name", &tensor.name_));
+
+    std::string datatype_str;
+    RETURN_IF_ERROR(io.MemberAsString("data_type", &datatype_str));
+    tensor.datatype_ = ModelConfigDataTypeToTritonServerDataType(datatype_str);
+
+    RETURN_IF_ERROR(ParseShape(io, "dims", &tensor.dims_));
+
+    common::TritonJson::Value reshape;
+    tensor.has_reshape_ = io.Find("reshape", &reshape);
+    if (tensor.has_reshape_) {
+      RETURN_IF_ERROR(ParseShape(reshape, "shape", &tensor.reshape_));
+    }
+
+    tensor.byte_size_ = GetByteSize(tensor.datatype_, tensor.dims_);
+
+    tensor.is_shape_tensor_ = false;
+    if (io.Find("is_shape_tensor")) {
+      RETURN_IF_ERROR(
+          io.MemberAsBool("is_shape_tensor", &tensor.is_shape_tensor_));
+    }
+    tensor.optional_ = false;
+    if (io.Find("optional")) {
+      RETURN_IF_ERROR(io.MemberAsBool("optional", &tensor.optional_));
+    }
+
+    if (!indices->emplace(tensor.name_, i).second) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("model configuration specifies multiple ") + member +
+           "s named '" + tensor.name_ + "'")
+              .c_str());
+    }
+  }
+
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+BackendModelConfig::ParseSequenceControls(
+    common::TritonJson::Value& batcher, const std::string& model_name)
+{
+  static const char* kControlKindNames[kControlKindCount] = {
+      "CONTROL_SEQUENCE_START", "CONTROL_SEQUENCE_END",
+      "CONTROL_SEQUENCE_READY", "CONTROL_SEQUENCE_CORRID"};
+
+  for (size_t k = 0; k < kControlKindCount; k++) {
+    SequenceControl& control = controls_[k];
+    control.fp32_false_value_ = 0.0f;
+    control.fp32_true_value_ = 0.0f;
+    control.int32_false_value_ = 0;
+    control.int32_true_value_ = 0;
+
+    std::string datatype_str;
+    if (static_cast<ControlKind>(k) == ControlKind::CORRID) {
+      RETURN_IF_ERROR(GetTypedSequenceControlProperties(
+          batcher, model_name, kControlKindNames[k], false /* required */,
+          &control.tensor_name_, &datatype_str));
+    } else {
+      RETURN_IF_ERROR(GetBooleanSequenceControlProperties(
+          batcher, model_name, kControlKindNames[k], false /* required */,
+          &control.tensor_name_, &datatype_str, &control.fp32_false_value_,
+          &control.fp32_true_value_, &control.int32_false_value_,
+          &control.int32_true_value_));
+    }
+
+    has_control_[k] = !control.tensor_name_.empty();
+    control.datatype_ = ModelConfigDataTypeToTritonServerDataType(datatype_str);
+  }
+
+  return nullptr;  // success
+}
+
+bool
+BackendModelConfig::FindInput(
+    const std::string& name, const Tensor** input) const
+{
+  auto it = input_indices_.find(name);
+  if (it == input_indices_.end()) {
+    return false;
+  }
+
+  *input = &inputs_[it->second];
+  return true;
+}
+
+bool
+BackendModelConfig::FindOutput(
+    const std::string& name, const Tensor** output) const
+{
+  auto it = output_indices_.find(name);
+  if (it == output_indices_.end()) {
+    return false;
+  }
+
+  *output = &outputs_[it->second];
+  return true;
+}
+
+bool
+BackendModelConfig::FindSequenceControl(
+    const ControlKind kind, const SequenceControl** control) const
+{
+  const size_t k = static_cast<size_t>(kind);
+  if (!has_control_[k]) {
+    return false;
+  }
+
+  *control = &controls_[k];
+  return true;
+}
+
+bool
+BackendModelConfig::FindParameter(
+    const std::string& key, std::string* value) const
+{
+  auto it = parameters_.find(key);
+  if (it == parameters_.end()) {
+    return false;
+  }
+
+  *value = it->second;
+  return true;
+}
+
+}}  // namespace triton::backend
@@ -29,9 +29,82 @@
 #include <vector>
 #include "triton/backend/backend_common.h"
 #include "triton/backend/backend_model.h"
+#include "triton/backend/backend_numa.h"
 
 namespace triton { namespace backend {
 
+namespace {
+
+#ifdef TRITON_ENABLE_GPU
+// Create on 'device_id' a stream with the greatest priority for
+// copies, and the event used to order it with the compute stream.
+TRITONSERVER_Error*
+CreateCopyStream(
+    const int device_id, cudaStream_t* stream, cudaEvent_t* event)
+{
+  *stream = nullptr;
+  *event = nullptr;
+
+  // Lower numbers are greater priorities.
+  int least_priority, greatest_priority;
+  RETURN_IF_CUDA_ERROR(
+      cudaDeviceGetStreamPriorityRange(&least_priority, &greatest_priority),
+      TRITONSERVER_ERROR_INTERNAL,
+      std::string("unable to get stream priority range"));
+  RETURN_IF_ERROR(CreateCudaStream(device_id, greatest_priority, stream));
+
+  // The event must be created on the device of the stream.
+  int current_device;
+  cudaError_t err = cudaGetDevice(&current_device);
+  const bool overridden = (err == cudaSuccess) && (current_device != device_id);
+  if (overridden) {
+    err = cudaSetDevice(device_id);
+  }
+  if (err == cudaSuccess) {
+    err = cudaEventCreateWithFlags(event, cudaEventDisableTiming);
+  }
+
+  if (overridden) {
+    LOG_IF_CUDA_ERROR(
+        cudaSetDevice(current_device), "failed to set CUDA device");
+  }
+
+  if (err != cudaSuccess) {
+    *event = nullptr;
+    LOG_IF_CUDA_ERROR(
+        cudaStreamDestroy(*stream), "failed to destroy copy stream");
+    *stream = nullptr;
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("unable to create copy event: ") +
+         cudaGetErrorString(err))
+            .c_str());
+  }
+
+  return nullptr;  // success
+}
+
+void
+DestroyCopyStream(
+    const std::string& name, cudaStream_t* stream, cudaEvent_t* event)
+{
+  if (*event != nullptr) {
+    LOG_IF_CUDA_ERROR(
+        cudaEventDestroy(*event),
+        "~BackendModelInstance: " + name + " failed to destroy cuda event");
+    *event = nullptr;
+  }
+  if (*stream != nullptr) {
+    LOG_IF_CUDA_ERROR(
+        cudaStreamDestroy(*stream),
+        "~BackendModelInstance: " + name + " failed to destroy cuda stream");
+    *stream = nullptr;
+  }
+}
+#endif  // TRITON_ENABLE_GPU
+
+}  // namespace
+
 //
 // BackendModelInstance
 //
@@ -52,19 +125,16 @@ BackendModelInstance::BackendModelInstance(
   THROW_IF_BACKEND_INSTANCE_ERROR(
       TRITONBACKEND_ModelInstanceDeviceId(triton_model_instance, &device_id_));
 
-  common::TritonJson::Value& model_config = backend_model->ModelConfig();
-
   // If the model configuration specifies a 'default_model_filename'
   // and/or specifies 'cc_model_filenames' then determine the
   // appropriate 'artifact_filename' value. If model configuration
   // does not specify then just leave 'artifact_filename' empty and
   // the backend can then provide its own logic for determine the
   // filename if that is appropriate.
-  THROW_IF_BACKEND_INSTANCE_ERROR(model_config.MemberAsString(
-      "default_model_filename", &artifact_filename_));
-
   switch (kind_) {
     case TRITONSERVER_INSTANCEGROUPKIND_CPU: {
+      THROW_IF_BACKEND_INSTANCE_ERROR(
+          backend_model->ArtifactFilename("", &artifact_filename_));
       LOG_MESSAGE(
           TRITONSERVER_LOG_VERBOSE,
           (std::string("Creating instance ") + name_ +
@@ -73,6 +143,8 @@ BackendModelInstance::BackendModelInstance(
       break;
     }
     case TRITONSERVER_INSTANCEGROUPKIND_MODEL: {
+      THROW_IF_BACKEND_INSTANCE_ERROR(
+          backend_model->ArtifactFilename("", &artifact_filename_));
       LOG_MESSAGE(
           TRITONSERVER_LOG_VERBOSE,
           (std::string("Creating instance ") + name_ +
@@ -83,24 +155,11 @@ BackendModelInstance::BackendModelInstance(
     }
     case TRITONSERVER_INSTANCEGROUPKIND_GPU: {
 #ifdef TRITON_ENABLE_GPU
-      cudaDeviceProp cuprops;
-      cudaError_t cuerr = cudaGetDeviceProperties(&cuprops, device_id_);
-      if (cuerr != cudaSuccess) {
-        throw BackendModelInstanceException(TRITONSERVER_ErrorNew(
-            TRITONSERVER_ERROR_INTERNAL,
-            (std::string("unable to get CUDA device properties for ") + name_ +
-             ": " + cudaGetErrorString(cuerr))
-                .c_str()));
-      }
-
-      const std::string cc =
-          std::to_string(cuprops.major) + "." + std::to_string(cuprops.minor);
-      common::TritonJson::Value cc_names;
-      common::TritonJson::Value cc_name;
-      if ((model_config.Find("cc_model_filenames", &cc_names)) &&
-          (cc_names.Find(cc.c_str(), &cc_name))) {
-        cc_name.AsString(&artifact_filename_);
-      }
+      std::string cc;
+      THROW_IF_BACKEND_INSTANCE_ERROR(
+          GetDeviceComputeCapability(device_id_, &cc));
+      THROW_IF_BACKEND_INSTANCE_ERROR(
+          backend_model->ArtifactFilename(cc, &artifact_filename_));
 
       LOG_MESSAGE(
           TRITONSERVER_LOG_VERBOSE,
@@ -122,16 +181,97 @@ BackendModelInstance::BackendModelInstance(
   }
 
   stream_ = nullptr;
+  input_copy_stream_ = nullptr;
+  output_copy_stream_ = nullptr;
+  input_copy_event_ = nullptr;
+  output_copy_event_ = nullptr;
+  numa_node_ = -1;
   if (kind_ == TRITONSERVER_INSTANCEGROUPKIND_GPU) {
     THROW_IF_BACKEND_INSTANCE_ERROR(
         CreateCudaStream(device_id_, 0 /* cuda_stream_priority */, &stream_));
+#ifdef TRITON_ENABLE_GPU
+    if (backend_model->SeparateCopyStreams()) {
+      // The destructor doesn't run if the constructor throws, so
+      // destroy the streams created so far before throwing.
+      TRITONSERVER_Error* err = CreateCopyStream(
+          device_id_, &input_copy_stream_, &input_copy_event_);
+      if (err == nullptr) {
+        err = CreateCopyStream(
+            device_id_, &output_copy_stream_, &output_copy_event_);
+      }
+      if (err != nullptr) {
+        DestroyStreams();
+        throw BackendModelInstanceException(err);
+      }
+    }
+
+    EnablePeerCopyPaths();
+#endif  // TRITON_ENABLE_GPU
+
+    // Not knowing the NUMA node only loses the placement of the staging
+    // buffers, so it isn't an error.
+    TRITONSERVER_Error* err = GpuNumaNode(device_id_, &numa_node_);
+    if (err != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("unable to get NUMA node of GPU ") +
+           std::to_string(device_id_) + ": " + TRITONSERVER_ErrorMessage(err))
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+      numa_node_ = -1;
+    }
+  }
+
+  if (input_copy_stream_ == nullptr) {
+    input_copy_stream_ = stream_;
+    output_copy_stream_ = stream_;
+  }
+
+  pinned_arena_.reset(new BackendPinnedArena(
+      backend_model->TritonMemoryManager(),
+      BackendPinnedArena::kDefaultMaxCachedByteSize, numa_node_));
+  copy_stats_.reset(new BackendCopyStats());
+  pinned_policy_.reset(new BackendPinnedPolicy());
+
+  if ((kind_ == TRITONSERVER_INSTANCEGROUPKIND_GPU) &&
+      (backend_model->ResidencyCacheByteSize() > 0) &&
+      !backend_model->ResidencyCacheInputs().empty()) {
+    residency_cache_.reset(new BackendResidencyCache(
+        backend_model->TritonMemoryManager(), device_id_, input_copy_stream_,
+        backend_model->ResidencyCacheByteSize(),
+        backend_model->ResidencyCacheInputs()));
+  }
+
+  if ((kind_ == TRITONSERVER_INSTANCEGROUPKIND_GPU) &&
+      (backend_model->CopyGraphMinCopyCount() > 0)) {
+    input_copy_graph_.reset(
+        new BackendCopyGraph(backend_model->CopyGraphMinCopyCount()));
+    output_copy_graph_.reset(
+        new BackendCopyGraph(backend_model->CopyGraphMinCopyCount()));
   }
 }
 
 
 BackendModelInstance::~BackendModelInstance()
+{
+  // The cached copies are released on the input copy stream, so
+  // release them before the streams are destroyed.
+  residency_cache_.reset();
+  DestroyStreams();
+}
+
+void
+BackendModelInstance::DestroyStreams()
 {
 #ifdef TRITON_ENABLE_GPU
+  // The copy streams are 'stream_' unless separate copy streams were
+  // created.
+  if (input_copy_stream_ != stream_) {
+    DestroyCopyStream(name_, &input_copy_stream_, &input_copy_event_);
+    DestroyCopyStream(name_, &output_copy_stream_, &output_copy_event_);
+  }
+  input_copy_stream_ = nullptr;
+  output_copy_stream_ = nullptr;
   if (stream_ != nullptr) {
     cudaError_t err = cudaStreamDestroy(stream_);
     if (err != cudaSuccess) {
@@ -146,4 +286,39 @@ BackendModelInstance::~BackendModelInstance()
 #endif  // TRITON_ENABLE_GPU
 }
 
+void
+BackendModelInstance::EnablePeerCopyPaths()
+{
+#ifdef TRITON_ENABLE_GPU
+  int device_count = 0;
+  if (cudaGetDeviceCount(&device_count) != cudaSuccess) {
+    // Clear the sticky error so it isn't reported by a later call.
+    cudaGetLastError();
+    return;
+  }
+
+  // A GPU that peer access can't be enabled with is still reachable
+  // through the staged path, so it isn't an error.
+  peer_copy_paths_.assign(device_count, GpuCopyPath::DRIVER_STAGED);
+  for (int device_id = 0; device_id < device_count; ++device_id) {
+    if (device_id == device_id_) {
+      peer_copy_paths_[device_id] = GpuCopyPath::SAME_DEVICE;
+      continue;
+    }
+    TRITONSERVER_Error* err = EnableGpuPeerAccess(
+        device_id_, device_id, &peer_copy_paths_[device_id]);
+    if (err != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("unable to enable peer access between GPU ") +
+           std::to_string(device_id_) + " and GPU " +
+           std::to_string(device_id) + ": " + TRITONSERVER_ErrorMessage(err))
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+      peer_copy_paths_[device_id] = GpuCopyPath::DRIVER_STAGED;
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
 }}  // namespace triton::backend
@@ -0,0 +1,211 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_numa.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "triton/backend/backend_common.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // __linux__
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend {
+
+namespace {
+
+#ifdef __linux__
+// The mbind() memory policy and the size of the node mask, defined here
+// so that libnuma is not required.
+constexpr int kMpolPreferred = 1;
+constexpr size_t kMaxNumaNodes = 1024;
+#endif  // __linux__
+
+}  // namespace
+
+TRITONSERVER_Error*
+GpuNumaNode(const int device_id, int* numa_node)
+{
+  *numa_node = -1;
+
+#if defined(__linux__) && defined(TRITON_ENABLE_GPU)
+  char bus_id[32];
+  RETURN_IF_CUDA_ERROR(
+      cudaDeviceGetPCIBusId(bus_id, sizeof(bus_id), device_id),
+      TRITONSERVER_ERROR_INTERNAL,
+      std::string("failed to get PCI bus ID of GPU ") +
+          std::to_string(device_id));
+
+  // sysfs uses lower case hex digits in the device names.
+  std::string device_name(bus_id);
+  for (auto& c : device_name) {
+    c = std::tolower(c);
+  }
+
+  std::ifstream file("/sys/bus/pci/devices/" + device_name + "/numa_node");
+  if (file) {
+    file >> *numa_node;
+    if (!file) {
+      *numa_node = -1;
+    }
+  }
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "GPU NUMA node not supported");
+#endif  // __linux__ && TRITON_ENABLE_GPU
+}
+
+TRITONSERVER_Error*
+NumaNodeCpus(const int numa_node, std::vector<int>* cpus)
+{
+  cpus->clear();
+
+#ifdef __linux__
+  const std::string path = "/sys/devices/system/node/node" +
+                           std::to_string(numa_node) + "/cpulist";
+  std::ifstream file(path);
+  RETURN_ERROR_IF_FALSE(
+      file.good(), TRITONSERVER_ERROR_NOT_FOUND,
+      std::string("unable to read CPUs of NUMA node ") +
+          std::to_string(numa_node) + " from '" + path + "'");
+
+  // The list is a comma separated list of CPUs and CPU ranges,
+  // e.g. "0-7,16-23".
+  std::string list;
+  std::getline(file, list);
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    int first, last;
+    const size_t dash = range.find('-');
+    try {
+      first = std::stoi(range.substr(0, dash));
+      last = (dash == std::string::npos) ? first
+                                         : std::stoi(range.substr(dash + 1));
+    }
+    catch (const std::exception& ex) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("unexpected CPU list '") + list + "' in '" + path +
+           "'")
+              .c_str());
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus->push_back(cpu);
+    }
+  }
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "NUMA topology not supported");
+#endif  // __linux__
+}
+
+TRITONSERVER_Error*
+SetThreadNumaAffinity(const int numa_node)
+{
+  if (numa_node < 0) {
+    return nullptr;  // success
+  }
+
+#ifdef __linux__
+  std::vector<int> cpus;
+  RETURN_IF_ERROR(NumaNodeCpus(numa_node, &cpus));
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (const int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+
+  const int err =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  RETURN_ERROR_IF_FALSE(
+      err == 0, TRITONSERVER_ERROR_INTERNAL,
+      std::string("failed to set CPU affinity to NUMA node ") +
+          std::to_string(numa_node) + ": " + strerror(err));
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "NUMA affinity not supported");
+#endif  // __linux__
+}
+
+TRITONSERVER_Error*
+BindMemoryToNumaNode(void* ptr, const size_t byte_size, const int numa_node)
+{
+#ifdef __linux__
+  RETURN_ERROR_IF_FALSE(
+      (numa_node >= 0) && (static_cast<size_t>(numa_node) < kMaxNumaNodes),
+      TRITONSERVER_ERROR_INVALID_ARG,
+      std::string("invalid NUMA node ") + std::to_string(numa_node));
+
+  constexpr size_t kBitsPerWord = 8 * sizeof(unsigned long);
+  unsigned long node_mask[kMaxNumaNodes / kBitsPerWord] = {};
+  node_mask[numa_node / kBitsPerWord] = 1UL << (numa_node % kBitsPerWord);
+
+  // mbind() requires a page aligned address.
+  const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(page_size - 1);
+  const uintptr_t end = reinterpret_cast<uintptr_t>(ptr) + byte_size;
+  if (syscall(
+          SYS_mbind, begin, end - begin, kMpolPreferred, node_mask,
+          kMaxNumaNodes, 0 /* flags */) != 0) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNAVAILABLE,
+        (std::string("failed to bind memory to NUMA node ") +
+         std::to_string(numa_node) + ": " + strerror(errno))
+            .c_str());
+  }
+
+  return nullptr;  // success
+#else
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_UNSUPPORTED, "NUMA memory binding not supported");
+#endif  // __linux__
+}
+
+}}  // namespace triton::backend
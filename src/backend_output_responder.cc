@@ -30,12 +30,43 @@
 #include "triton/backend/backend_model.h"
 #include "triton/backend/backend_model_instance.h"
 
+#ifdef TRITON_ENABLE_GPU
+#include "kernel.h"
+#endif  // TRITON_ENABLE_GPU
+
 namespace triton { namespace backend {
 
 //
 // BackendOutputResponder
 //
 BackendOutputResponder::~BackendOutputResponder()
+{
+  ReleaseBatchMemories();
+}
+
+void
+BackendOutputResponder::Reset(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    std::vector<TRITONBACKEND_Response*>* responses)
+{
+  ReleaseBatchMemories();
+  requests_ = requests;
+  request_count_ = request_count;
+  responses_ = responses;
+  need_sync_ = false;
+  compute_waited_ = false;
+  metadata_ = nullptr;
+
+  pending_pinned_byte_size_ = 0;
+  pending_pinned_offset_ = 0;
+  pending_pinned_outputs_.clear();
+  pending_kernel_copies_.clear();
+  deferred_pinned_.clear();
+  deferred_outputs_.clear();
+}
+
+void
+BackendOutputResponder::ReleaseBatchMemories()
 {
   for (auto& pinned_memory : pinned_memories_) {
     LOG_IF_ERROR(
@@ -44,6 +75,12 @@ BackendOutputResponder::~BackendOutputResponder()
             TRITONSERVER_MEMORY_CPU_PINNED, 0),
         "failed to free pinned memory");
   }
+  pinned_memories_.clear();
+  for (auto& arena_memory : arena_memories_) {
+    pinned_arena_->Return(arena_memory);
+  }
+  arena_memories_.clear();
+  device_tables_.clear();
 }
 
 void
@@ -52,23 +89,24 @@ BackendOutputResponder::ProcessTensor(
     std::vector<int64_t>& batchn_shape, const char* buffer,
     const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
 {
-  // A value of CPU_PINNED indicates that pinned memory buffer is not
-  // needed for this tensor. Any other value indicates that a pinned
-  // memory buffer is needed when the target memory type matches
-  // 'use_pinned_memory_type'.
-  TRITONSERVER_MemoryType use_pinned_memory_type =
-      TRITONSERVER_MEMORY_CPU_PINNED;
-  if (pinned_enabled_ && (memory_type != TRITONSERVER_MEMORY_CPU_PINNED)) {
-    use_pinned_memory_type = (memory_type == TRITONSERVER_MEMORY_CPU)
-                                 ? TRITONSERVER_MEMORY_GPU
-                                 : TRITONSERVER_MEMORY_CPU;
-  }
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::RESPONDER_PROCESS);
+#endif  // TRITON_ENABLE_STATS
+
+  WaitComputeStream();
 
+  // Without a batch dimension each response gets the whole tensor.
+  const TRITONSERVER_MemoryType use_pinned_memory_type = ApplyPinnedPolicy(
+      UsePinnedMemoryType(memory_type), responses_->size(),
+      GetByteSize(datatype, batchn_shape) *
+          ((max_batch_size_ == 0) ? responses_->size() : 1));
+
+  const size_t output_index = OutputIndex(output_name);
   size_t tensor_offset = 0;
   
   /* 为每个request准备response */
   for (size_t idx = 0; idx < responses_->size(); idx++) {
-    auto& request = requests_[idx];
     auto& response = (*responses_)[idx];
 
     // If then pending copies are from tensor buffer that is not
@@ -78,77 +116,157 @@ BackendOutputResponder::ProcessTensor(
     if ((pending_pinned_byte_size_ > 0) &&
         (tensor_offset !=
          (pending_pinned_byte_size_ + pending_pinned_offset_))) {
-      need_sync_ |= FlushPendingPinned(buffer, memory_type, memory_type_id);
+      need_sync_ |=
+          FlushPendingPinned(output_name, buffer, memory_type, memory_type_id);
     }
 
     // Override shape to be correct for this response.
     /* 获取当前request的真实batch_size，用于形成该request对应output的shape，从而计算该request对应output的数据大小 */
-    if (max_batch_size_ != 0) {
-      const char* name;
-      TRITONBACKEND_RequestInputName(request, 0, &name);
-      TRITONBACKEND_Input* input;
-      TRITONBACKEND_RequestInput(request, name, &input);
-      const int64_t* shape;
-      TRITONBACKEND_InputProperties(
-          input, nullptr, nullptr, &shape, nullptr, nullptr, nullptr);
-      batchn_shape[0] = shape[0];
-    }
+    SetBatchDimension(idx, &batchn_shape);
 
     /* 当前request对应输出的数据大小 */
     const size_t tensor_byte_size = GetByteSize(datatype, batchn_shape);
 
-    TRITONBACKEND_Output* response_output;
+    TRITONBACKEND_Output* response_output = nullptr;
     if (response != nullptr) {
-      uint32_t output_count;
-      RESPOND_AND_SET_NULL_IF_ERROR(
-          /* 获取当前response所包含的output的数量 */
-          &response, TRITONBACKEND_RequestOutputCount(request, &output_count));
-      if (response != nullptr) {
-        /* 遍历该response所需的每个output */
-        for (uint32_t output_idx = 0; output_idx < output_count; output_idx++) {
-          const char* name;
-          /* 取得当前output的名称 */
-          RESPOND_AND_SET_NULL_IF_ERROR(
-              &response,
-              TRITONBACKEND_RequestOutputName(request, output_idx, &name));
-          /* 根据目标output的名称找到当前正要处理的output */
-          if ((response != nullptr) && (output_name == name)) {
-            /* 为当前目标output在response中创建output tensor对象 */
-            RESPOND_AND_SET_NULL_IF_ERROR(
-                &response, TRITONBACKEND_ResponseOutput(
-                               response, &response_output, name, datatype,
-                               batchn_shape.data(), batchn_shape.size()));
-            /* 把输出buffer的内容拷贝到response中的buffer里 */
-            if (response != nullptr) {
-              need_sync_ |= SetFixedSizeOutputBuffer(
-                  &response, response_output, output_name, tensor_byte_size,
-                  tensor_offset, buffer, memory_type, memory_type_id,
-                  use_pinned_memory_type);
-            }
-
-            break;
-          }
-        }
+      CreateRequestedOutput(
+          idx, &response, output_name, output_index, datatype, batchn_shape,
+          &response_output);
+      /* 把输出buffer的内容拷贝到response中的buffer里 */
+      if (response_output != nullptr) {
+        need_sync_ |= SetFixedSizeOutputBuffer(
+            &response, response_output, output_name, tensor_byte_size,
+            tensor_offset, buffer, memory_type, memory_type_id,
+            use_pinned_memory_type);
       }
     }
 
     tensor_offset += tensor_byte_size;
   }
 
-  // Done with the tensor, flush any pending pinned copies.
-  need_sync_ |= FlushPendingPinned(buffer, memory_type, memory_type_id);
+  // Done with the tensor, flush any pending pinned and kernel copies
+  // and launch the queued copies.
+  need_sync_ |=
+      FlushPendingPinned(output_name, buffer, memory_type, memory_type_id);
+  need_sync_ |= FlushQueuedCopies();
+#ifdef TRITON_ENABLE_GPU
+  if (need_sync_ && (event_ != nullptr)) {
+    cudaEventRecord(event_, stream_);
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+TRITONSERVER_Error*
+BackendOutputResponder::ProcessVariableSizeTensor(
+    const std::string& output_name, const TRITONSERVER_DataType datatype,
+    const std::vector<std::vector<int64_t>>& shapes,
+    const std::vector<size_t>& offsets, const std::vector<size_t>& byte_sizes,
+    const char* buffer, const size_t buffer_byte_size,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
+{
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::RESPONDER_PROCESS);
+#endif  // TRITON_ENABLE_STATS
+
+  const size_t response_count = responses_->size();
+  if ((shapes.size() != response_count) ||
+      (offsets.size() != response_count) ||
+      (byte_sizes.size() != response_count)) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("expected ") + std::to_string(response_count) +
+         " shapes, offsets and byte sizes for output '" + output_name +
+         "', got " + std::to_string(shapes.size()) + ", " +
+         std::to_string(offsets.size()) + " and " +
+         std::to_string(byte_sizes.size()))
+            .c_str());
+  }
+
+  // Written so that 'offsets[idx] + byte_sizes[idx]' can't overflow.
+  for (size_t idx = 0; idx < response_count; idx++) {
+    if ((offsets[idx] > buffer_byte_size) ||
+        (byte_sizes[idx] > (buffer_byte_size - offsets[idx]))) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("slice of response ") + std::to_string(idx) +
+           " for output '" + output_name + "' at offset " +
+           std::to_string(offsets[idx]) + " with byte size " +
+           std::to_string(byte_sizes[idx]) + " exceeds the " +
+           std::to_string(buffer_byte_size) + " bytes of the buffer")
+              .c_str());
+    }
+  }
+
+  WaitComputeStream();
+
+  size_t total_byte_size = 0;
+  for (const size_t byte_size : byte_sizes) {
+    total_byte_size += byte_size;
+  }
+  const TRITONSERVER_MemoryType use_pinned_memory_type = ApplyPinnedPolicy(
+      UsePinnedMemoryType(memory_type), response_count, total_byte_size);
+  const size_t output_index = OutputIndex(output_name);
+
+  for (size_t idx = 0; idx < response_count; idx++) {
+    auto& response = (*responses_)[idx];
+
+    // If the pending copies are from a region of the tensor buffer
+    // that is not contiguous with 'response's slice, then perform the
+    // pending copies so that a new contiguous region can be started.
+    if ((pending_pinned_byte_size_ > 0) &&
+        (offsets[idx] !=
+         (pending_pinned_byte_size_ + pending_pinned_offset_))) {
+      need_sync_ |=
+          FlushPendingPinned(output_name, buffer, memory_type, memory_type_id);
+    }
+
+    TRITONBACKEND_Output* response_output = nullptr;
+    if (response != nullptr) {
+      CreateRequestedOutput(
+          idx, &response, output_name, output_index, datatype, shapes[idx],
+          &response_output);
+      if (response_output != nullptr) {
+        need_sync_ |= SetFixedSizeOutputBuffer(
+            &response, response_output, output_name, byte_sizes[idx],
+            offsets[idx], buffer, memory_type, memory_type_id,
+            use_pinned_memory_type);
+      }
+    }
+  }
+
+  // Done with the tensor, flush any pending pinned and kernel copies
+  // and launch the queued copies.
+  need_sync_ |=
+      FlushPendingPinned(output_name, buffer, memory_type, memory_type_id);
+  need_sync_ |= FlushQueuedCopies();
 #ifdef TRITON_ENABLE_GPU
   if (need_sync_ && (event_ != nullptr)) {
     cudaEventRecord(event_, stream_);
   }
 #endif  // TRITON_ENABLE_GPU
+
+  return nullptr;  // success
 }
 
 bool
 BackendOutputResponder::Finalize()
 {
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      stats_, BackendCopyStats::Stage::RESPONDER_FINALIZE);
+#endif  // TRITON_ENABLE_STATS
+
+  // Every Process*() function launches the copies it queues, this only
+  // guards against a copy being left in the graph.
+  need_sync_ |= LaunchCopyGraph();
+
 #ifdef TRITON_ENABLE_GPU
   if ((!deferred_pinned_.empty()) && need_sync_) {
+#ifdef TRITON_ENABLE_STATS
+    BackendCopyStats::ScopedTimer sync_timer(
+        stats_, BackendCopyStats::Stage::RESPONDER_SYNC_WAIT);
+#endif  // TRITON_ENABLE_STATS
     if (event_ != nullptr) {
       cudaEventSynchronize(event_);
     } else {
@@ -166,19 +284,22 @@ BackendOutputResponder::Finalize()
     char* pinned_buffer = def.pinned_memory_;
 
     size_t offset = 0;
-    for (auto& pr : def.responses_) {
-      auto& response = pr.first;
-      auto& response_output = pr.second;
+    for (size_t idx = def.responses_begin_; idx < def.responses_end_; ++idx) {
+      auto& response = deferred_outputs_[idx].first;
+      auto& response_output = deferred_outputs_[idx].second;
 
       bool cuda_used = false;
       RESPOND_AND_SET_NULL_IF_ERROR(
           response,
           CopyBuffer(
-              response_output.name_, pinned_memory_type, pinned_memory_id,
+              "pinned buffer", pinned_memory_type, pinned_memory_id,
               response_output.memory_type_, response_output.memory_type_id_,
               response_output.buffer_byte_size_, pinned_buffer + offset,
               const_cast<void*>(response_output.buffer_), stream_, &cuda_used));
       need_sync_ |= cuda_used;
+      RecordCopy(
+          pinned_memory_type, response_output.memory_type_,
+          response_output.buffer_byte_size_);
 
       offset += response_output.buffer_byte_size_;
     }
@@ -191,10 +312,193 @@ BackendOutputResponder::Finalize()
   }
 #endif  // TRITON_ENABLE_GPU
   deferred_pinned_.clear();
+  deferred_outputs_.clear();
 
   return need_sync_;
 }
 
+void
+BackendOutputResponder::WaitComputeStream()
+{
+#ifdef TRITON_ENABLE_GPU
+  // The tensors are produced on a different stream than the copies so
+  // make the copies wait for them, once as all the tensors are produced
+  // before the first one is processed.
+  if (!compute_waited_ && (compute_stream_ != stream_) &&
+      (compute_event_ != nullptr)) {
+    cudaEventRecord(compute_event_, compute_stream_);
+    cudaStreamWaitEvent(stream_, compute_event_, 0);
+  }
+#endif  // TRITON_ENABLE_GPU
+  compute_waited_ = true;
+}
+
+TRITONSERVER_MemoryType
+BackendOutputResponder::UsePinnedMemoryType(
+    const TRITONSERVER_MemoryType tensor_memory_type) const
+{
+  // A value of CPU_PINNED indicates that pinned memory buffer is not
+  // needed for this tensor. Any other value indicates that a pinned
+  // memory buffer is needed when the target memory type matches
+  // 'use_pinned_memory_type'.
+  TRITONSERVER_MemoryType use_pinned_memory_type =
+      TRITONSERVER_MEMORY_CPU_PINNED;
+  if (pinned_enabled_ &&
+      (tensor_memory_type != TRITONSERVER_MEMORY_CPU_PINNED)) {
+    use_pinned_memory_type = (tensor_memory_type == TRITONSERVER_MEMORY_CPU)
+                                 ? TRITONSERVER_MEMORY_GPU
+                                 : TRITONSERVER_MEMORY_CPU;
+  }
+
+  return use_pinned_memory_type;
+}
+
+TRITONSERVER_MemoryType
+BackendOutputResponder::ApplyPinnedPolicy(
+    const TRITONSERVER_MemoryType use_pinned_memory_type,
+    const size_t response_count, const size_t byte_size)
+{
+  if ((pinned_policy_ == nullptr) ||
+      (use_pinned_memory_type == TRITONSERVER_MEMORY_CPU_PINNED)) {
+    return use_pinned_memory_type;
+  }
+
+  const bool staged = pinned_policy_->UseStaging(response_count, byte_size);
+  RecordPinnedDecision(staged);
+  return staged ? use_pinned_memory_type : TRITONSERVER_MEMORY_CPU_PINNED;
+}
+
+void
+BackendOutputResponder::AllocateTensor(
+    const std::string& output_name, const TRITONSERVER_DataType datatype,
+    std::vector<int64_t>& batchn_shape,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id,
+    std::vector<ResponseBuffer>* response_buffers)
+{
+  response_buffers->clear();
+  response_buffers->resize(responses_->size());
+  const size_t output_index = OutputIndex(output_name);
+
+  for (size_t idx = 0; idx < responses_->size(); idx++) {
+    auto& response = (*responses_)[idx];
+    if (response == nullptr) {
+      continue;
+    }
+
+    SetBatchDimension(idx, &batchn_shape);
+    const size_t tensor_byte_size = GetByteSize(datatype, batchn_shape);
+
+    TRITONBACKEND_Output* response_output = nullptr;
+    CreateRequestedOutput(
+        idx, &response, output_name, output_index, datatype, batchn_shape,
+        &response_output);
+    if (response_output == nullptr) {
+      continue;
+    }
+
+    void* buffer = nullptr;
+    TRITONSERVER_MemoryType actual_memory_type = memory_type;
+    int64_t actual_memory_type_id = memory_type_id;
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        &response, TRITONBACKEND_OutputBuffer(
+                       response_output, &buffer, tensor_byte_size,
+                       &actual_memory_type, &actual_memory_type_id));
+    if (response != nullptr) {
+      auto& response_buffer = (*response_buffers)[idx];
+      response_buffer.buffer_ = reinterpret_cast<char*>(buffer);
+      response_buffer.byte_size_ = tensor_byte_size;
+      response_buffer.memory_type_ = actual_memory_type;
+      response_buffer.memory_type_id_ = actual_memory_type_id;
+    }
+  }
+}
+
+void
+BackendOutputResponder::SetBatchDimension(
+    const size_t idx, std::vector<int64_t>* batchn_shape)
+{
+  if (max_batch_size_ != 0) {
+    if (metadata_ != nullptr) {
+      (*batchn_shape)[0] = metadata_->BatchSize(idx);
+      return;
+    }
+
+    TRITONBACKEND_Request* request = requests_[idx];
+    const char* name;
+    TRITONBACKEND_RequestInputName(request, 0, &name);
+    TRITONBACKEND_Input* input;
+    TRITONBACKEND_RequestInput(request, name, &input);
+    const int64_t* shape;
+    TRITONBACKEND_InputProperties(
+        input, nullptr, nullptr, &shape, nullptr, nullptr, nullptr);
+    (*batchn_shape)[0] = shape[0];
+  }
+}
+
+size_t
+BackendOutputResponder::OutputIndex(const std::string& output_name) const
+{
+  return (metadata_ != nullptr) ? metadata_->OutputIndex(output_name)
+                                : BackendRequestMetadata::kNoOutput;
+}
+
+void
+BackendOutputResponder::CreateRequestedOutput(
+    const size_t idx, TRITONBACKEND_Response** response,
+    const std::string& output_name, const size_t output_index,
+    const TRITONSERVER_DataType datatype, const std::vector<int64_t>& shape,
+    TRITONBACKEND_Output** response_output)
+{
+  *response_output = nullptr;
+
+  // With the request metadata the requested outputs are known without
+  // querying the request.
+  if (metadata_ != nullptr) {
+    if (metadata_->IsOutputRequested(idx, output_index)) {
+      TRITONBACKEND_Output* output;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          response, TRITONBACKEND_ResponseOutput(
+                        *response, &output, output_name.c_str(), datatype,
+                        shape.data(), shape.size()));
+      if (*response != nullptr) {
+        *response_output = output;
+      }
+    }
+    return;
+  }
+
+  TRITONBACKEND_Request* request = requests_[idx];
+
+  uint32_t output_count;
+  RESPOND_AND_SET_NULL_IF_ERROR(
+      /* 获取当前response所包含的output的数量 */
+      response, TRITONBACKEND_RequestOutputCount(request, &output_count));
+  if (*response == nullptr) {
+    return;
+  }
+
+  /* 遍历该response所需的每个output */
+  for (uint32_t output_idx = 0; output_idx < output_count; output_idx++) {
+    const char* name;
+    /* 取得当前output的名称 */
+    RESPOND_AND_SET_NULL_IF_ERROR(
+        response, TRITONBACKEND_RequestOutputName(request, output_idx, &name));
+    /* 根据目标output的名称找到当前正要处理的output */
+    if ((*response != nullptr) && (output_name == name)) {
+      /* 为当前目标output在response中创建output tensor对象 */
+      TRITONBACKEND_Output* output;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          response, TRITONBACKEND_ResponseOutput(
+                        *response, &output, name, datatype, shape.data(),
+                        shape.size()));
+      if (*response != nullptr) {
+        *response_output = output;
+      }
+      break;
+    }
+  }
+}
+
 bool
 BackendOutputResponder::SetFixedSizeOutputBuffer(
     TRITONBACKEND_Response** response, TRITONBACKEND_Output* response_output,
@@ -231,16 +535,40 @@ BackendOutputResponder::SetFixedSizeOutputBuffer(
     pending_pinned_byte_size_ += tensor_byte_size;
     pending_pinned_outputs_.push_back(std::make_pair(
         response, OutputData(
-                      output_name, buffer, tensor_byte_size, actual_memory_type,
+                      buffer, tensor_byte_size, actual_memory_type,
                       actual_memory_type_id)));
-  } else {
+  }
+#ifdef TRITON_ENABLE_GPU
+  // GPU to GPU copies can be delayed and performed by one kernel
+  // launch with the other GPU copies of the tensor.
+  else if (
+      (copy_kernel_threshold_ > 0) &&
+      (tensor_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (actual_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (tensor_memory_type_id == actual_memory_type_id)) {
+    pending_kernel_copies_.emplace_back(
+        response, tensor_buffer + tensor_offset, buffer, tensor_byte_size,
+        actual_memory_type_id);
+    RecordCopy(tensor_memory_type, actual_memory_type, tensor_byte_size);
+  }
+#endif  // TRITON_ENABLE_GPU
+  else {
     // Direct copy without intermediate pinned memory.
     bool cuda_used = false;
-    err = CopyBuffer(
-        output_name, tensor_memory_type, tensor_memory_type_id,
-        actual_memory_type, actual_memory_type_id, tensor_byte_size,
-        tensor_buffer + tensor_offset, buffer, stream_, &cuda_used);
+    {
+      BackendPinnedPolicy::CopyTimer policy_timer(
+          BackendPinnedPolicy::IsTransfer(
+              tensor_memory_type, actual_memory_type)
+              ? pinned_policy_
+              : nullptr,
+          stream_, tensor_byte_size);
+      err = IssueCopy(
+          output_name.c_str(), tensor_memory_type, tensor_memory_type_id,
+          actual_memory_type, actual_memory_type_id, tensor_byte_size,
+          tensor_buffer + tensor_offset, buffer, &cuda_used);
+    }
     cuda_copy |= cuda_used;
+    RecordCopy(tensor_memory_type, actual_memory_type, tensor_byte_size);
 
     if (err != nullptr) {
       RESPOND_AND_SET_NULL_IF_ERROR(response, err);
@@ -253,9 +581,15 @@ BackendOutputResponder::SetFixedSizeOutputBuffer(
 
 bool
 BackendOutputResponder::FlushPendingPinned(
-    const char* tensor_buffer, const TRITONSERVER_MemoryType tensor_memory_type,
+    const std::string& output_name, const char* tensor_buffer,
+    const TRITONSERVER_MemoryType tensor_memory_type,
     const int64_t tensor_memory_type_id)
 {
+#ifdef TRITON_ENABLE_STATS
+  BackendCopyStats::ScopedTimer timer(
+      pending_pinned_outputs_.empty() ? nullptr : stats_,
+      BackendCopyStats::Stage::RESPONDER_PINNED_FLUSH);
+#endif  // TRITON_ENABLE_STATS
   bool cuda_copy = false;
 
   // Will be copying from CPU->pinned->GPU or GPU->pinned->CPU
@@ -265,13 +599,9 @@ BackendOutputResponder::FlushPendingPinned(
   // directly go CPU->GPU or GPU->CPU.
   char* pinned_memory = nullptr;
   if (pending_pinned_byte_size_ > 0) {
-    TRITONSERVER_Error* err = TRITONBACKEND_MemoryManagerAllocate(
-        memory_manager_, reinterpret_cast<void**>(&pinned_memory),
-        TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */,
-        pending_pinned_byte_size_);
-    if (err != nullptr) {
-      pinned_memory = nullptr;
-      TRITONSERVER_ErrorDelete(err);
+    pinned_memory = AllocatePinnedBuffer(pending_pinned_byte_size_);
+    if (pinned_memory == nullptr) {
+      RecordPinnedFallback();
     }
   }
 
@@ -287,12 +617,15 @@ BackendOutputResponder::FlushPendingPinned(
       RESPOND_AND_SET_NULL_IF_ERROR(
           response,
           CopyBuffer(
-              response_output.name_, tensor_memory_type, tensor_memory_type_id,
+              output_name, tensor_memory_type, tensor_memory_type_id,
               response_output.memory_type_, response_output.memory_type_id_,
               response_output.buffer_byte_size_,
               tensor_buffer + pending_pinned_offset_ + offset,
               const_cast<void*>(response_output.buffer_), stream_, &cuda_used));
       cuda_copy |= cuda_used;
+      RecordCopy(
+          tensor_memory_type, response_output.memory_type_,
+          response_output.buffer_byte_size_);
 
       offset += response_output.buffer_byte_size_;
     }
@@ -301,12 +634,24 @@ BackendOutputResponder::FlushPendingPinned(
   // data to the pinned buffer.
   else {
     bool cuda_used = false;
-    auto err = CopyBuffer(
-        "pinned buffer", tensor_memory_type, tensor_memory_type_id,
-        TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */,
-        pending_pinned_byte_size_, tensor_buffer + pending_pinned_offset_,
-        pinned_memory, stream_, &cuda_used);
+    TRITONSERVER_Error* err;
+    {
+      // Only the host copy out of a CPU tensor is measured, a copy out
+      // of a GPU tensor is asynchronous.
+      BackendPinnedPolicy::ScopedTimer policy_timer(
+          (tensor_memory_type != TRITONSERVER_MEMORY_GPU) ? pinned_policy_
+                                                          : nullptr,
+          true /* staging */, pending_pinned_byte_size_);
+      err = IssueCopy(
+          "pinned buffer", tensor_memory_type, tensor_memory_type_id,
+          TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */,
+          pending_pinned_byte_size_, tensor_buffer + pending_pinned_offset_,
+          pinned_memory, &cuda_used);
+    }
     cuda_copy |= cuda_used;
+    RecordCopy(
+        tensor_memory_type, TRITONSERVER_MEMORY_CPU_PINNED,
+        pending_pinned_byte_size_);
 
     // If something goes wrong with the copy all the pending
     // responses fail...
@@ -343,21 +688,26 @@ BackendOutputResponder::FlushPendingPinned(
         bool cuda_used = false;
         RESPOND_AND_SET_NULL_IF_ERROR(
             response,
-            CopyBuffer(
-                response_output.name_, TRITONSERVER_MEMORY_CPU_PINNED,
+            IssueCopy(
+                output_name.c_str(), TRITONSERVER_MEMORY_CPU_PINNED,
                 0 /* memory_type_id */, response_output.memory_type_,
                 response_output.memory_type_id_,
                 response_output.buffer_byte_size_, pinned_memory + offset,
-                const_cast<void*>(response_output.buffer_), stream_,
-                &cuda_used));
+                const_cast<void*>(response_output.buffer_), &cuda_used));
         cuda_copy |= cuda_used;
+        RecordCopy(
+            TRITONSERVER_MEMORY_CPU_PINNED, response_output.memory_type_,
+            response_output.buffer_byte_size_);
 
         offset += response_output.buffer_byte_size_;
       }
     } else {
       deferred_pinned_.emplace_back(
-          pinned_memory, pending_pinned_byte_size_,
-          std::move(pending_pinned_outputs_));
+          pinned_memory, pending_pinned_byte_size_, deferred_outputs_.size(),
+          deferred_outputs_.size() + pending_pinned_outputs_.size());
+      deferred_outputs_.insert(
+          deferred_outputs_.end(), pending_pinned_outputs_.begin(),
+          pending_pinned_outputs_.end());
     }
   }
 
@@ -366,12 +716,231 @@ BackendOutputResponder::FlushPendingPinned(
   pending_pinned_offset_ = 0;
   pending_pinned_outputs_.clear();
 
-  // Need to hold on to the allocated pinned buffer as there are still
-  // copies in flight. Will delete it in finalize.
-  if (pinned_memory != nullptr) {
-    pinned_memories_.push_back(pinned_memory);
+  return cuda_copy;
+}
+
+TRITONSERVER_Error*
+BackendOutputResponder::IssueCopy(
+    const char* msg, const TRITONSERVER_MemoryType src_memory_type,
+    const int64_t src_memory_type_id,
+    const TRITONSERVER_MemoryType dst_memory_type,
+    const int64_t dst_memory_type_id, const size_t byte_size, const void* src,
+    void* dst, bool* cuda_used)
+{
+  if ((copy_graph_ != nullptr) &&
+      BackendCopyGraph::IsGraphCopy(
+          src_memory_type, src_memory_type_id, dst_memory_type,
+          dst_memory_type_id)) {
+    copy_graph_->AddCopy(
+        src, src_memory_type, src_memory_type_id, dst, dst_memory_type,
+        dst_memory_type_id, byte_size);
+    *cuda_used = true;
+    return nullptr;  // success
+  }
+
+  if ((src_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (dst_memory_type == TRITONSERVER_MEMORY_GPU) &&
+      (src_memory_type_id != dst_memory_type_id)) {
+    return IssueCopyBetweenGpus(
+        msg, src_memory_type_id, dst_memory_type_id, byte_size, src, dst,
+        cuda_used);
+  }
+
+  return CopyBuffer(
+      msg, src_memory_type, src_memory_type_id, dst_memory_type,
+      dst_memory_type_id, byte_size, src, dst, stream_, cuda_used);
+}
+
+TRITONSERVER_Error*
+BackendOutputResponder::IssueCopyBetweenGpus(
+    const char* msg, const int64_t src_device_id, const int64_t dst_device_id,
+    const size_t byte_size, const void* src, void* dst, bool* cuda_used)
+{
+  // With peer access enabled the copy goes directly between the GPUs.
+  // Otherwise it is staged through a pinned buffer owned by this object
+  // instead of the small buffers of the driver. The copy into the
+  // buffer and the copy out of it are both on 'stream_' so they are
+  // ordered.
+  GpuCopyPath path = GpuCopyPath::DRIVER_STAGED;
+  TRITONSERVER_Error* err = GetGpuCopyPath(src_device_id, dst_device_id, &path);
+  if (err != nullptr) {
+    TRITONSERVER_ErrorDelete(err);
+    path = GpuCopyPath::DRIVER_STAGED;
+  }
+
+  char* staging_buffer = nullptr;
+  if (path == GpuCopyPath::DRIVER_STAGED) {
+    staging_buffer = AllocatePinnedBuffer(byte_size);
+  }
+
+  // The driver still stages the copy if no pinned buffer is available.
+  if (staging_buffer == nullptr) {
+    return CopyBuffer(
+        msg, TRITONSERVER_MEMORY_GPU, src_device_id, TRITONSERVER_MEMORY_GPU,
+        dst_device_id, byte_size, src, dst, stream_, cuda_used);
+  }
+
+  RETURN_IF_ERROR(CopyBuffer(
+      msg, TRITONSERVER_MEMORY_GPU, src_device_id,
+      TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */, byte_size, src,
+      staging_buffer, stream_, cuda_used));
+  return CopyBuffer(
+      msg, TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */,
+      TRITONSERVER_MEMORY_GPU, dst_device_id, byte_size, staging_buffer, dst,
+      stream_, cuda_used);
+}
+
+bool
+BackendOutputResponder::FlushQueuedCopies()
+{
+  bool cuda_copy = FlushPendingKernelCopies();
+  cuda_copy |= LaunchCopyGraph();
+  return cuda_copy;
+}
+
+bool
+BackendOutputResponder::LaunchCopyGraph()
+{
+  bool cuda_used = false;
+  if ((copy_graph_ == nullptr) || (copy_graph_->PendingCount() == 0)) {
+    return cuda_used;
+  }
+
+  // The queued copies are for all the responses so if they can't be
+  // issued all the responses fail.
+  TRITONSERVER_Error* err = copy_graph_->Launch(stream_, &cuda_used);
+  if (err != nullptr) {
+    for (auto& response : *responses_) {
+      if (response != nullptr) {
+        LOG_IF_ERROR(
+            TRITONBACKEND_ResponseSend(
+                response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+            "failed to send error response");
+        response = nullptr;
+      }
+    }
+    TRITONSERVER_ErrorDelete(err);
+  }
+
+  return cuda_used;
+}
+
+char*
+BackendOutputResponder::AllocatePinnedBuffer(const size_t byte_size)
+{
+  // Need to hold on to the pinned buffer as there will be copies in
+  // flight. Will release it in the destructor.
+  if (pinned_arena_ != nullptr) {
+    BackendMemory* arena_memory;
+    TRITONSERVER_Error* err = pinned_arena_->Borrow(byte_size, &arena_memory);
+    if (err == nullptr) {
+      arena_memories_.push_back(arena_memory);
+      return arena_memory->MemoryPtr();
+    }
+    TRITONSERVER_ErrorDelete(err);
+  }
+
+  char* pinned_memory = nullptr;
+  TRITONSERVER_Error* err = TRITONBACKEND_MemoryManagerAllocate(
+      memory_manager_, reinterpret_cast<void**>(&pinned_memory),
+      TRITONSERVER_MEMORY_CPU_PINNED, 0 /* memory_type_id */, byte_size);
+  if (err != nullptr) {
+    TRITONSERVER_ErrorDelete(err);
+    return nullptr;
+  }
+
+  pinned_memories_.push_back(pinned_memory);
+  return pinned_memory;
+}
+
+bool
+BackendOutputResponder::FlushPendingKernelCopies()
+{
+  bool cuda_copy = false;
+  if (pending_kernel_copies_.empty()) {
+    return cuda_copy;
+  }
+
+#ifdef TRITON_ENABLE_GPU
+  // All the copies are from the same tensor so they target the same
+  // device. The kernel runs on 'stream_', so it is only launched if
+  // that is the device of 'stream_', otherwise the copies are done one
+  // by one.
+  const size_t count = pending_kernel_copies_.size();
+  const int64_t device_id = pending_kernel_copies_.front().device_id_;
+  int stream_device = -1;
+  TRITONSERVER_Error* stream_err = GetCudaStreamDevice(stream_, &stream_device);
+  if (stream_err != nullptr) {
+    TRITONSERVER_ErrorDelete(stream_err);
+    stream_device = -1;
   }
 
+  bool launched = false;
+  if ((count >= copy_kernel_threshold_) && (device_id == stream_device)) {
+    // Both tables must live until the kernel completes, they are
+    // released with this object.
+    const size_t table_byte_size = count * sizeof(CopyDescriptor);
+    char* host_table = AllocatePinnedBuffer(table_byte_size);
+    BackendMemory* device_table = nullptr;
+    if (host_table != nullptr) {
+      TRITONSERVER_Error* err = BackendMemory::Create(
+          memory_manager_,
+          {BackendMemory::AllocationType::GPU_POOL,
+           BackendMemory::AllocationType::GPU_ASYNC,
+           BackendMemory::AllocationType::GPU},
+          device_id, table_byte_size, stream_, &device_table);
+      if (err != nullptr) {
+        TRITONSERVER_ErrorDelete(err);
+        device_table = nullptr;
+      }
+    }
+    if (device_table != nullptr) {
+      device_tables_.emplace_back(device_table);
+      CopyDescriptor* descriptors =
+          reinterpret_cast<CopyDescriptor*>(host_table);
+      for (size_t idx = 0; idx < count; ++idx) {
+        const auto& copy = pending_kernel_copies_[idx];
+        descriptors[idx].src_ = copy.src_;
+        descriptors[idx].dst_ = copy.dst_;
+        descriptors[idx].byte_size_ = copy.byte_size_;
+      }
+      // The kernel is launched on the current device, which must be the
+      // device of 'stream_'.
+      int current_device = -1;
+      const bool overridden =
+          (cudaGetDevice(&current_device) == cudaSuccess) &&
+          (current_device != device_id) &&
+          (cudaSetDevice(device_id) == cudaSuccess);
+      launched =
+          (RunCopyKernel(
+               descriptors,
+               reinterpret_cast<CopyDescriptor*>(device_table->MemoryPtr()),
+               count, stream_) == cudaSuccess);
+      if (overridden) {
+        LOG_IF_CUDA_ERROR(
+            cudaSetDevice(current_device), "failed to set CUDA device");
+      }
+      cuda_copy |= launched;
+    }
+  }
+
+  // Too few copies to be worth a launch, or the launch could not be
+  // done, so just perform the copies one by one.
+  if (!launched) {
+    for (auto& copy : pending_kernel_copies_) {
+      bool cuda_used = false;
+      RESPOND_AND_SET_NULL_IF_ERROR(
+          copy.response_,
+          CopyBuffer(
+              "output buffer", TRITONSERVER_MEMORY_GPU, copy.device_id_,
+              TRITONSERVER_MEMORY_GPU, copy.device_id_, copy.byte_size_,
+              copy.src_, copy.dst_, stream_, &cuda_used));
+      cuda_copy |= cuda_used;
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  pending_kernel_copies_.clear();
   return cuda_copy;
 }
 
@@ -0,0 +1,149 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "triton/backend/backend_pinned_arena.h"
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendPinnedArena
+//
+constexpr size_t BackendPinnedArena::kMinClassByteSize;
+constexpr size_t BackendPinnedArena::kDefaultMaxCachedByteSize;
+
+BackendPinnedArena::BackendPinnedArena(
+    TRITONBACKEND_MemoryManager* manager, const size_t max_cached_byte_size,
+    const int numa_node)
+    : manager_(manager), max_cached_byte_size_(max_cached_byte_size),
+      numa_node_(numa_node), cached_byte_size_(0)
+{
+}
+
+void
+BackendPinnedArena::SizeClass(
+    const size_t byte_size, size_t* class_index, size_t* class_byte_size)
+{
+  if (byte_size <= kMinClassByteSize) {
+    *class_index = 0;
+    *class_byte_size = kMinClassByteSize;
+    return;
+  }
+
+  // Find 'log2' such that 2^log2 < byte_size <= 2^(log2 + 1) and
+  // round up to the next quarter step between those powers of 2.
+  size_t log2 = 0;
+  while ((size_t(1) << (log2 + 1)) < byte_size) {
+    log2++;
+  }
+  size_t min_log2 = 0;
+  while ((size_t(1) << min_log2) < kMinClassByteSize) {
+    min_log2++;
+  }
+
+  const size_t base = size_t(1) << log2;
+  const size_t step = base / 4;
+  const size_t steps = (byte_size - base + step - 1) / step;
+  *class_index = ((log2 - min_log2) * 4) + steps;
+  *class_byte_size = base + (steps * step);
+}
+
+TRITONSERVER_Error*
+BackendPinnedArena::Borrow(const size_t byte_size, BackendMemory** mem)
+{
+  *mem = nullptr;
+
+  size_t class_index, class_byte_size;
+  SizeClass(byte_size, &class_index, &class_byte_size);
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if ((class_index < idle_buffers_.size()) &&
+        !idle_buffers_[class_index].empty()) {
+      *mem = idle_buffers_[class_index].back().release();
+      idle_buffers_[class_index].pop_back();
+      cached_byte_size_ -= (*mem)->ByteSize();
+      return nullptr;  // success
+    }
+  }
+
+  // Nothing to reuse so take a new buffer for the size class from the
+  // pinned memory pool of the server, which doesn't need to pin new
+  // memory. Only if the pool is exhausted fall back to pinning memory
+  // with cudaHostAlloc, or on the NUMA node of the arena, which is
+  // expensive and synchronizes the device.
+  TRITONSERVER_Error* err = BackendMemory::Create(
+      manager_, BackendMemory::AllocationType::CPU_PINNED_POOL,
+      0 /* memory_type_id */, class_byte_size, mem);
+  if (err == nullptr) {
+    return nullptr;  // success
+  }
+  TRITONSERVER_ErrorDelete(err);
+
+  if (numa_node_ >= 0) {
+    err = BackendMemory::Create(
+        manager_, BackendMemory::AllocationType::CPU_PINNED_NUMA, numa_node_,
+        class_byte_size, mem);
+    if (err == nullptr) {
+      return nullptr;  // success
+    }
+    TRITONSERVER_ErrorDelete(err);
+  }
+  return BackendMemory::Create(
+      manager_, BackendMemory::AllocationType::CPU_PINNED,
+      0 /* memory_type_id */, class_byte_size, mem);
+}
+
+void
+BackendPinnedArena::Return(BackendMemory* mem)
+{
+  std::unique_ptr<BackendMemory> buffer(mem);
+
+  size_t class_index, class_byte_size;
+  SizeClass(buffer->ByteSize(), &class_index, &class_byte_size);
+  if (class_byte_size != buffer->ByteSize()) {
+    return;  // not from Borrow(), just free it
+  }
+
+  std::lock_guard<std::mutex> lk(mu_);
+  if ((cached_byte_size_ + buffer->ByteSize()) > max_cached_byte_size_) {
+    return;
+  }
+  if (class_index >= idle_buffers_.size()) {
+    idle_buffers_.resize(class_index + 1);
+  }
+  cached_byte_size_ += buffer->ByteSize();
+  idle_buffers_[class_index].emplace_back(std::move(buffer));
+}
+
+size_t
+BackendPinnedArena::CachedByteSize()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  return cached_byte_size_;
+}
+
+}}  // namespace triton::backend
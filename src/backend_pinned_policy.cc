@@ -0,0 +1,264 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_pinned_policy.h"
+
+namespace triton { namespace backend {
+
+namespace {
+
+// The initial estimates, a pageable transfer of about 10 GB/s with a
+// fixed cost of 10 us and a host copy of about 20 GB/s, so that
+// tensors are staged until the measured copies show otherwise.
+constexpr double kInitialCopyOverheadNs = 10000.0;
+constexpr double kInitialDirectNsPerByte = 0.1;
+constexpr double kInitialStagingNsPerByte = 0.05;
+
+// The weight of a new measurement in the rolling averages.
+constexpr double kAverageWeight = 0.125;
+
+void
+UpdateAverage(double* average, const double value)
+{
+  *average += kAverageWeight * (value - *average);
+}
+
+}  // namespace
+
+//
+// BackendPinnedPolicy
+//
+constexpr size_t BackendPinnedPolicy::kSmallCopyByteSize;
+constexpr size_t BackendPinnedPolicy::kLargeCopyByteSize;
+constexpr uint64_t BackendPinnedPolicy::kExploreInterval;
+constexpr size_t BackendPinnedPolicy::kMaxPendingTimings;
+
+BackendPinnedPolicy::CopyTimer::CopyTimer(
+    BackendPinnedPolicy* policy, cudaStream_t stream, const size_t byte_size)
+    : policy_(policy), stream_(stream), byte_size_(byte_size),
+      slot_(kMaxPendingTimings)
+{
+#ifdef TRITON_ENABLE_GPU
+  if (policy_ != nullptr) {
+    slot_ = policy_->BeginTiming();
+    if ((slot_ < kMaxPendingTimings) &&
+        (cudaEventRecord(policy_->timings_[slot_].start_, stream_) !=
+         cudaSuccess)) {
+      cudaGetLastError();  // clear the error
+      policy_->EndTiming(slot_, 0);
+      slot_ = kMaxPendingTimings;
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+BackendPinnedPolicy::CopyTimer::~CopyTimer()
+{
+#ifdef TRITON_ENABLE_GPU
+  if (slot_ < kMaxPendingTimings) {
+    size_t byte_size = byte_size_;
+    if (cudaEventRecord(policy_->timings_[slot_].end_, stream_) !=
+        cudaSuccess) {
+      cudaGetLastError();  // clear the error
+      byte_size = 0;
+    }
+    policy_->EndTiming(slot_, byte_size);
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+BackendPinnedPolicy::BackendPinnedPolicy()
+{
+  for (auto& timing : timings_) {
+    timing.state_ = Timing::State::FREE;
+    timing.start_ = nullptr;
+    timing.end_ = nullptr;
+    timing.byte_size_ = 0;
+  }
+  Reset();
+}
+
+BackendPinnedPolicy::~BackendPinnedPolicy()
+{
+#ifdef TRITON_ENABLE_GPU
+  for (auto& timing : timings_) {
+    if (timing.start_ != nullptr) {
+      cudaEventDestroy(timing.start_);
+    }
+    if (timing.end_ != nullptr) {
+      cudaEventDestroy(timing.end_);
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+bool
+BackendPinnedPolicy::UseStaging(
+    const size_t buffer_count, const size_t byte_size)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  CollectTimings();
+
+  // Compare the host time of one direct copy per buffer with the host
+  // copy of all the bytes into or out of the pinned buffer followed by
+  // a single copy. The transfer from or to the pinned buffer is
+  // asynchronous so only its fixed cost is counted.
+  const double direct_ns =
+      buffer_count * estimates_.copy_overhead_ns_ +
+      byte_size * estimates_.direct_ns_per_byte_;
+  const double staging_ns = estimates_.copy_overhead_ns_ +
+                            byte_size * estimates_.staging_ns_per_byte_;
+  bool staging = (direct_ns >= staging_ns);
+
+  decision_count_++;
+  if ((decision_count_ % kExploreInterval) == 0) {
+    staging = !staging;
+  }
+
+  return staging;
+}
+
+void
+BackendPinnedPolicy::RecordDirectCopy(
+    const size_t byte_size, const uint64_t duration_ns)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  UpdateDirectCopy(byte_size, duration_ns);
+}
+
+void
+BackendPinnedPolicy::UpdateDirectCopy(
+    const size_t byte_size, const uint64_t duration_ns)
+{
+  if (byte_size <= kSmallCopyByteSize) {
+    UpdateAverage(&estimates_.copy_overhead_ns_, duration_ns);
+  } else if (byte_size >= kLargeCopyByteSize) {
+    const double transfer_ns =
+        (duration_ns > estimates_.copy_overhead_ns_)
+            ? (duration_ns - estimates_.copy_overhead_ns_)
+            : 0.0;
+    UpdateAverage(&estimates_.direct_ns_per_byte_, transfer_ns / byte_size);
+  }
+}
+
+void
+BackendPinnedPolicy::RecordStagingCopy(
+    const size_t byte_size, const uint64_t duration_ns)
+{
+  if (byte_size == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(mu_);
+  UpdateAverage(
+      &estimates_.staging_ns_per_byte_,
+      static_cast<double>(duration_ns) / byte_size);
+}
+
+void
+BackendPinnedPolicy::GetEstimates(Estimates* estimates)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  *estimates = estimates_;
+}
+
+void
+BackendPinnedPolicy::Reset()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  estimates_.copy_overhead_ns_ = kInitialCopyOverheadNs;
+  estimates_.direct_ns_per_byte_ = kInitialDirectNsPerByte;
+  estimates_.staging_ns_per_byte_ = kInitialStagingNsPerByte;
+  decision_count_ = 0;
+}
+
+size_t
+BackendPinnedPolicy::BeginTiming()
+{
+#ifdef TRITON_ENABLE_GPU
+  std::lock_guard<std::mutex> lk(mu_);
+  for (size_t slot = 0; slot < kMaxPendingTimings; ++slot) {
+    auto& timing = timings_[slot];
+    if (timing.state_ != Timing::State::FREE) {
+      continue;
+    }
+    if ((timing.start_ == nullptr) &&
+        (cudaEventCreate(&timing.start_) != cudaSuccess)) {
+      cudaGetLastError();  // clear the error
+      timing.start_ = nullptr;
+      return kMaxPendingTimings;
+    }
+    if ((timing.end_ == nullptr) &&
+        (cudaEventCreate(&timing.end_) != cudaSuccess)) {
+      cudaGetLastError();  // clear the error
+      timing.end_ = nullptr;
+      return kMaxPendingTimings;
+    }
+    timing.state_ = Timing::State::ISSUING;
+    return slot;
+  }
+#endif  // TRITON_ENABLE_GPU
+  return kMaxPendingTimings;
+}
+
+void
+BackendPinnedPolicy::EndTiming(const size_t slot, const size_t byte_size)
+{
+  // A measurement of no bytes is dropped.
+  std::lock_guard<std::mutex> lk(mu_);
+  auto& timing = timings_[slot];
+  timing.byte_size_ = byte_size;
+  timing.state_ =
+      (byte_size > 0) ? Timing::State::PENDING : Timing::State::FREE;
+}
+
+void
+BackendPinnedPolicy::CollectTimings()
+{
+#ifdef TRITON_ENABLE_GPU
+  for (auto& timing : timings_) {
+    if (timing.state_ != Timing::State::PENDING) {
+      continue;
+    }
+
+    const cudaError_t err = cudaEventQuery(timing.end_);
+    if (err == cudaErrorNotReady) {
+      continue;
+    }
+    float elapsed_ms = 0.0f;
+    if ((err == cudaSuccess) &&
+        (cudaEventElapsedTime(&elapsed_ms, timing.start_, timing.end_) ==
+         cudaSuccess)) {
+      UpdateDirectCopy(
+          timing.byte_size_, static_cast<uint64_t>(elapsed_ms * 1000000.0));
+    } else {
+      cudaGetLastError();  // clear the error
+    }
+    timing.state_ = Timing::State::FREE;
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+}}  // namespace triton::backend
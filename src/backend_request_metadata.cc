@@ -0,0 +1,98 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_request_metadata.h"
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendRequestMetadata
+//
+constexpr size_t BackendRequestMetadata::kNoOutput;
+
+TRITONSERVER_Error*
+BackendRequestMetadata::Create(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    const int max_batch_size,
+    std::unique_ptr<BackendRequestMetadata>* metadata)
+{
+  std::unique_ptr<BackendRequestMetadata> md(
+      new BackendRequestMetadata(request_count));
+  md->batch_sizes_.resize(request_count, 0);
+
+  // The output indices of each request, the bitmaps are built once
+  // the number of distinct outputs is known.
+  std::vector<std::vector<size_t>> request_outputs(request_count);
+  for (uint32_t idx = 0; idx < request_count; idx++) {
+    TRITONBACKEND_Request* request = requests[idx];
+    if (max_batch_size != 0) {
+      TRITONBACKEND_Input* input;
+      RETURN_IF_ERROR(TRITONBACKEND_RequestInputByIndex(request, 0, &input));
+      const int64_t* shape;
+      uint32_t dims_count;
+      RETURN_IF_ERROR(TRITONBACKEND_InputProperties(
+          input, nullptr, nullptr, &shape, &dims_count, nullptr, nullptr));
+      if (dims_count > 0) {
+        md->batch_sizes_[idx] = shape[0];
+        md->total_batch_size_ += shape[0];
+      }
+    }
+
+    uint32_t output_count;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestOutputCount(request, &output_count));
+    request_outputs[idx].reserve(output_count);
+    for (uint32_t output_idx = 0; output_idx < output_count; output_idx++) {
+      const char* name;
+      RETURN_IF_ERROR(
+          TRITONBACKEND_RequestOutputName(request, output_idx, &name));
+      auto it =
+          md->output_indices_.emplace(name, md->output_indices_.size()).first;
+      request_outputs[idx].push_back(it->second);
+    }
+  }
+
+  md->words_per_request_ = (md->output_indices_.size() + 63) / 64;
+  md->requested_.resize(request_count * md->words_per_request_, 0);
+  for (uint32_t idx = 0; idx < request_count; idx++) {
+    uint64_t* bitmap = &md->requested_[idx * md->words_per_request_];
+    for (const size_t output_index : request_outputs[idx]) {
+      bitmap[output_index / 64] |= (uint64_t(1) << (output_index % 64));
+    }
+  }
+
+  *metadata = std::move(md);
+  return nullptr;  // success
+}
+
+size_t
+BackendRequestMetadata::OutputIndex(const std::string& name) const
+{
+  auto it = output_indices_.find(name);
+  return (it == output_indices_.end()) ? kNoOutput : it->second;
+}
+
+}}  // namespace triton::backend
@@ -0,0 +1,161 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_residency_cache.h"
+
+#include <cstring>
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendResidencyCache
+//
+BackendResidencyCache::BackendResidencyCache(
+    TRITONBACKEND_MemoryManager* memory_manager, const int64_t device_id,
+    cudaStream_t stream, const size_t byte_size_limit,
+    const std::set<std::string>& input_names)
+    : memory_manager_(memory_manager), device_id_(device_id), stream_(stream),
+      byte_size_limit_(byte_size_limit), input_names_(input_names),
+      byte_size_(0)
+{
+}
+
+size_t
+BackendResidencyCache::ByteSize()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  return byte_size_;
+}
+
+bool
+BackendResidencyCache::Find(
+    const std::string& key, std::shared_ptr<BackendMemory>* memory,
+    std::shared_ptr<const std::string>* contents)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+
+  lru_.splice(lru_.begin(), lru_, it->second);
+  *memory = it->second->memory_;
+  *contents = it->second->contents_;
+  return true;
+}
+
+TRITONSERVER_Error*
+BackendResidencyCache::Allocate(
+    const size_t byte_size, std::shared_ptr<BackendMemory>* memory)
+{
+  RETURN_ERROR_IF_TRUE(
+      byte_size > byte_size_limit_, TRITONSERVER_ERROR_UNAVAILABLE,
+      std::string(
+          "input of " + std::to_string(byte_size) +
+          " bytes exceeds the residency cache limit of " +
+          std::to_string(byte_size_limit_) + " bytes"));
+
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    Evict(byte_size);
+  }
+
+  BackendMemory* backend_memory = nullptr;
+  RETURN_IF_ERROR(BackendMemory::Create(
+      memory_manager_,
+      {BackendMemory::AllocationType::GPU_ASYNC,
+       BackendMemory::AllocationType::GPU},
+      device_id_, byte_size, stream_, &backend_memory));
+  memory->reset(backend_memory);
+  return nullptr;  // success
+}
+
+void
+BackendResidencyCache::Insert(
+    const std::string& key, const std::shared_ptr<BackendMemory>& memory,
+    const std::shared_ptr<const std::string>& contents)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    byte_size_ -= it->second->memory_->ByteSize();
+    lru_.erase(it->second);
+    entries_.erase(it);
+  }
+
+  Evict(memory->ByteSize());
+  lru_.push_front(Entry{key, memory, contents});
+  entries_.emplace(key, lru_.begin());
+  byte_size_ += memory->ByteSize();
+}
+
+void
+BackendResidencyCache::Clear()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  entries_.clear();
+  lru_.clear();
+  byte_size_ = 0;
+}
+
+void
+BackendResidencyCache::Evict(const size_t byte_size)
+{
+  while (!lru_.empty() && ((byte_size_ + byte_size) > byte_size_limit_)) {
+    byte_size_ -= lru_.back().memory_->ByteSize();
+    entries_.erase(lru_.back().key_);
+    lru_.pop_back();
+  }
+}
+
+uint64_t
+BackendResidencyCache::Hash(
+    const void* base, const size_t byte_size, const uint64_t seed)
+{
+  // Mix 8 bytes at a time so that hashing an input is much cheaper
+  // than copying it to the GPU.
+  constexpr uint64_t kMultiplier = 0x9e3779b97f4a7c15ULL;
+  const char* data = reinterpret_cast<const char*>(base);
+  uint64_t hash = seed ^ (byte_size * kMultiplier);
+
+  size_t offset = 0;
+  for (; offset + sizeof(uint64_t) <= byte_size; offset += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + offset, sizeof(word));
+    hash = (hash ^ word) * kMultiplier;
+    hash ^= hash >> 29;
+  }
+  if (offset < byte_size) {
+    uint64_t word = 0;
+    memcpy(&word, data + offset, byte_size - offset);
+    hash = (hash ^ word) * kMultiplier;
+    hash ^= hash >> 29;
+  }
+
+  return hash;
+}
+
+}}  // namespace triton::backend
@@ -0,0 +1,147 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_resource_registry.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendResourceRegistry
+//
+BackendResourceRegistry::BackendResourceRegistry() : resources_(nullptr)
+{
+  std::unique_ptr<const Resources> empty(new Resources());
+  std::lock_guard<std::mutex> lk(mu_);
+  Publish(std::move(empty));
+}
+
+void
+BackendResourceRegistry::Publish(std::unique_ptr<const Resources>&& updated)
+{
+  resources_.store(updated.get(), std::memory_order_release);
+  snapshots_.emplace_back(std::move(updated));
+}
+
+std::shared_ptr<void>
+BackendResourceRegistry::FindResource(
+    const std::string& name, const std::type_info& type) const
+{
+  const Resources* resources = resources_.load(std::memory_order_acquire);
+  const auto it = resources->find(name);
+  if ((it == resources->end()) || (*it->second.type_ != type)) {
+    return nullptr;
+  }
+
+  return it->second.resource_;
+}
+
+TRITONSERVER_Error*
+BackendResourceRegistry::GetOrCreateResource(
+    const std::string& name, const std::type_info& type,
+    const std::function<TRITONSERVER_Error*(std::shared_ptr<void>*)>& create,
+    std::shared_ptr<void>* resource)
+{
+  // Most calls find the resource already registered.
+  const Resources* resources = resources_.load(std::memory_order_acquire);
+  auto it = resources->find(name);
+
+  std::unique_lock<std::mutex> lk(mu_, std::defer_lock);
+  if (it == resources->end()) {
+    // Check again once registrations are serialized, the resource may
+    // have been created by another caller in the meantime. If another
+    // caller is creating it wait for it to be done, and if its
+    // creation failed create it here.
+    lk.lock();
+    while (true) {
+      resources = resources_.load(std::memory_order_acquire);
+      it = resources->find(name);
+      if ((it != resources->end()) ||
+          (creating_.find(name) == creating_.end())) {
+        break;
+      }
+      created_cv_.wait(lk);
+    }
+  }
+
+  if (it != resources->end()) {
+    RETURN_ERROR_IF_TRUE(
+        *it->second.type_ != type, TRITONSERVER_ERROR_INVALID_ARG,
+        std::string(
+            "resource '" + name + "' is registered with a different type"));
+    *resource = it->second.resource_;
+    return nullptr;  // success
+  }
+
+  // Create the resource without holding the lock, so that 'create'
+  // doesn't serialize the lookups and registrations of other names.
+  creating_.insert(name);
+  lk.unlock();
+
+  std::shared_ptr<void> created;
+  TRITONSERVER_Error* err = create(&created);
+  if ((err == nullptr) && (created == nullptr)) {
+    err = TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        std::string("failed to create resource '" + name + "'").c_str());
+  }
+
+  lk.lock();
+  creating_.erase(name);
+  created_cv_.notify_all();
+  RETURN_IF_ERROR(err);
+
+  resources = resources_.load(std::memory_order_acquire);
+  std::unique_ptr<Resources> updated(new Resources(*resources));
+  Entry& entry = (*updated)[name];
+  entry.resource_ = created;
+  entry.type_ = &type;
+  Publish(std::move(updated));
+
+  *resource = std::move(created);
+  return nullptr;  // success
+}
+
+bool
+BackendResourceRegistry::Remove(const std::string& name)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  const Resources* resources = resources_.load(std::memory_order_acquire);
+  if (resources->find(name) == resources->end()) {
+    return false;
+  }
+
+  std::unique_ptr<Resources> updated(new Resources(*resources));
+  updated->erase(name);
+  Publish(std::move(updated));
+  return true;
+}
+
+size_t
+BackendResourceRegistry::Count() const
+{
+  return resources_.load(std::memory_order_acquire)->size();
+}
+
+}}  // namespace triton::backend
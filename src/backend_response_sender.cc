@@ -0,0 +1,218 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_response_sender.h"
+
+#include <algorithm>
+#include <cstring>
+#include "triton/backend/backend_common.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif  // _MSC_VER
+
+namespace triton { namespace backend {
+
+namespace {
+
+// Return the index of the lowest set bit of non-zero 'word'.
+size_t
+LowestSetBit(const uint64_t word)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward64(&idx, word);
+  return idx;
+#else
+  return __builtin_ctzll(word);
+#endif  // _MSC_VER
+}
+
+}  // namespace
+
+//
+// BackendResponseSender
+//
+constexpr size_t BackendResponseSender::kNoResponse;
+
+BackendResponseSender::BackendResponseSender(
+    std::vector<TRITONBACKEND_Response*>* responses)
+    : responses_(responses), live_((responses->size() + 63) / 64, 0),
+      live_count_(0)
+{
+  for (size_t idx = 0; idx < responses_->size(); idx++) {
+    if ((*responses_)[idx] != nullptr) {
+      live_[idx / 64] |= (uint64_t(1) << (idx % 64));
+      live_count_++;
+    }
+  }
+}
+
+BackendResponseSender::~BackendResponseSender()
+{
+  SendErrors();
+}
+
+size_t
+BackendResponseSender::NextLive(const size_t idx) const
+{
+  size_t word_idx = idx / 64;
+  if (word_idx >= live_.size()) {
+    return kNoResponse;
+  }
+
+  uint64_t word = live_[word_idx] & (~uint64_t(0) << (idx % 64));
+  while (word == 0) {
+    if (++word_idx == live_.size()) {
+      return kNoResponse;
+    }
+    word = live_[word_idx];
+  }
+
+  return word_idx * 64 + LowestSetBit(word);
+}
+
+void
+BackendResponseSender::SetError(const size_t idx, TRITONSERVER_Error* err)
+{
+  if (!IsLive(idx)) {
+    TRITONSERVER_ErrorDelete(err);
+    return;
+  }
+
+  // The response may have been set to nullptr in the response vector
+  // without a Refresh(), in which case it is no longer live, as in
+  // Send().
+  if ((*responses_)[idx] == nullptr) {
+    ClearLive(idx);
+    TRITONSERVER_ErrorDelete(err);
+    return;
+  }
+
+  // Share the previous error object if 'err' is the same error.
+  if (!errors_.empty() &&
+      (TRITONSERVER_ErrorCode(errors_.back()) == TRITONSERVER_ErrorCode(err)) &&
+      (strcmp(
+           TRITONSERVER_ErrorMessage(errors_.back()),
+           TRITONSERVER_ErrorMessage(err)) == 0)) {
+    TRITONSERVER_ErrorDelete(err);
+  } else {
+    errors_.push_back(err);
+  }
+
+  failed_.emplace_back((*responses_)[idx], errors_.size() - 1);
+  (*responses_)[idx] = nullptr;
+  ClearLive(idx);
+}
+
+void
+BackendResponseSender::SetErrorAll(TRITONSERVER_Error* err)
+{
+  if (live_count_ == 0) {
+    TRITONSERVER_ErrorDelete(err);
+    return;
+  }
+
+  // Skip the responses that were set to nullptr in the response
+  // vector without a Refresh(), as Send() does.
+  bool used = false;
+  for (size_t idx = NextLive(0); idx != kNoResponse; idx = NextLive(idx + 1)) {
+    auto& response = (*responses_)[idx];
+    if (response != nullptr) {
+      if (!used) {
+        errors_.push_back(err);
+        used = true;
+      }
+      failed_.emplace_back(response, errors_.size() - 1);
+      response = nullptr;
+    }
+  }
+
+  if (!used) {
+    TRITONSERVER_ErrorDelete(err);
+  }
+
+  std::fill(live_.begin(), live_.end(), 0);
+  live_count_ = 0;
+}
+
+void
+BackendResponseSender::Refresh()
+{
+  for (size_t idx = NextLive(0); idx != kNoResponse; idx = NextLive(idx + 1)) {
+    if ((*responses_)[idx] == nullptr) {
+      ClearLive(idx);
+    }
+  }
+}
+
+void
+BackendResponseSender::Send(const bool send_live, const uint32_t flags)
+{
+  SendErrors();
+
+  if (send_live) {
+    for (size_t idx = NextLive(0); idx != kNoResponse;
+         idx = NextLive(idx + 1)) {
+      auto& response = (*responses_)[idx];
+      if (response != nullptr) {
+        LOG_IF_ERROR(
+            TRITONBACKEND_ResponseSend(response, flags, nullptr /* success */),
+            "failed sending response");
+        response = nullptr;
+      }
+    }
+
+    std::fill(live_.begin(), live_.end(), 0);
+    live_count_ = 0;
+  }
+}
+
+void
+BackendResponseSender::ClearLive(const size_t idx)
+{
+  live_[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+  live_count_--;
+}
+
+void
+BackendResponseSender::SendErrors()
+{
+  for (const auto& failed : failed_) {
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseSend(
+            failed.first, TRITONSERVER_RESPONSE_COMPLETE_FINAL,
+            errors_[failed.second]),
+        "failed to send error response");
+  }
+  failed_.clear();
+
+  for (auto err : errors_) {
+    TRITONSERVER_ErrorDelete(err);
+  }
+  errors_.clear();
+}
+
+}}  // namespace triton::backend
@@ -0,0 +1,224 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_streaming_responder.h"
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend {
+
+//
+// BackendStreamingResponder
+//
+BackendStreamingResponder::BackendStreamingResponder(
+    const uint32_t request_count, TRITONBACKEND_MemoryManager* memory_manager,
+    const bool pinned_enabled, cudaStream_t stream, cudaEvent_t event,
+    BackendPinnedArena* pinned_arena)
+    : stream_count_(request_count), active_count_(0), in_step_(false),
+      stream_(stream), event_(event), factories_(request_count, nullptr),
+      ending_(request_count, false), responses_(request_count, nullptr),
+      responder_(
+          nullptr /* requests */, request_count, &responses_,
+          0 /* max_batch_size */, memory_manager, pinned_enabled, stream,
+          event, pinned_arena)
+{
+}
+
+TRITONSERVER_Error*
+BackendStreamingResponder::Create(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    TRITONBACKEND_MemoryManager* memory_manager, const bool pinned_enabled,
+    cudaStream_t stream, cudaEvent_t event, BackendPinnedArena* pinned_arena,
+    std::unique_ptr<BackendStreamingResponder>* responder)
+{
+  std::unique_ptr<BackendStreamingResponder> sr(new BackendStreamingResponder(
+      request_count, memory_manager, pinned_enabled, stream, event,
+      pinned_arena));
+
+  // The requested outputs of the streams are gathered once, so the
+  // steps don't need the requests.
+  RETURN_IF_ERROR(BackendRequestMetadata::Create(
+      requests, request_count, 0 /* max_batch_size */, &sr->metadata_));
+
+  for (uint32_t idx = 0; idx < request_count; idx++) {
+    TRITONSERVER_Error* err =
+        TRITONBACKEND_ResponseFactoryNew(&sr->factories_[idx], requests[idx]);
+    if (err != nullptr) {
+      // None of the streams has started, so the caller can still
+      // respond to the requests with the error.
+      for (uint32_t created = 0; created < idx; created++) {
+        sr->CompleteStream(created, false /* send_final_flag */);
+      }
+      sr->factories_[idx] = nullptr;
+      return err;
+    }
+    sr->active_count_++;
+  }
+
+  *responder = std::move(sr);
+  return nullptr;  // success
+}
+
+BackendStreamingResponder::~BackendStreamingResponder()
+{
+  for (uint32_t idx = 0; idx < stream_count_; idx++) {
+    if (responses_[idx] != nullptr) {
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseDelete(responses_[idx]),
+          "failed to delete unsent response");
+      responses_[idx] = nullptr;
+    }
+    if (factories_[idx] != nullptr) {
+      CompleteStream(idx, true /* send_final_flag */);
+    }
+  }
+}
+
+void
+BackendStreamingResponder::BeginStep()
+{
+  responder_.Reset(nullptr /* requests */, stream_count_, &responses_);
+  responder_.SetRequestMetadata(metadata_.get());
+
+  for (uint32_t idx = 0; idx < stream_count_; idx++) {
+    ending_[idx] = false;
+    responses_[idx] = nullptr;
+    if (factories_[idx] == nullptr) {
+      continue;
+    }
+
+    TRITONSERVER_Error* err =
+        TRITONBACKEND_ResponseNewFromFactory(&responses_[idx], factories_[idx]);
+    if (err != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_ERROR,
+          (std::string("failed to create response for stream ") +
+           std::to_string(idx) + ": " + TRITONSERVER_ErrorMessage(err))
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+      responses_[idx] = nullptr;
+      CompleteStream(idx, true /* send_final_flag */);
+    }
+  }
+  in_step_ = true;
+}
+
+void
+BackendStreamingResponder::ProcessTensor(
+    const std::string& name, const TRITONSERVER_DataType datatype,
+    std::vector<int64_t>& stream_shape, const char* buffer,
+    const TRITONSERVER_MemoryType memory_type, const int64_t memory_type_id)
+{
+  responder_.ProcessTensor(
+      name, datatype, stream_shape, buffer, memory_type, memory_type_id);
+}
+
+void
+BackendStreamingResponder::FailStream(
+    const uint32_t idx, TRITONSERVER_Error* error)
+{
+  if (factories_[idx] != nullptr) {
+    TRITONBACKEND_Response* response = responses_[idx];
+    responses_[idx] = nullptr;
+    if (response == nullptr) {
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseNewFromFactory(&response, factories_[idx]),
+          "failed to create error response");
+    }
+    if (response != nullptr) {
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseSend(
+              response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, error),
+          "failed to send error response");
+      CompleteStream(idx, false /* send_final_flag */);
+    } else {
+      CompleteStream(idx, true /* send_final_flag */);
+    }
+  }
+  TRITONSERVER_ErrorDelete(error);
+}
+
+void
+BackendStreamingResponder::SendStep()
+{
+  if (!in_step_) {
+    return;
+  }
+  in_step_ = false;
+
+  if (responder_.Finalize()) {
+#ifdef TRITON_ENABLE_GPU
+    if (event_ != nullptr) {
+      cudaEventSynchronize(event_);
+    } else {
+      cudaStreamSynchronize(stream_);
+    }
+#endif  // TRITON_ENABLE_GPU
+  }
+
+  for (uint32_t idx = 0; idx < stream_count_; idx++) {
+    if (factories_[idx] == nullptr) {
+      continue;
+    }
+
+    // The responder sends a final error response for an output that
+    // can't be set, which completes the stream.
+    TRITONBACKEND_Response* response = responses_[idx];
+    if (response == nullptr) {
+      CompleteStream(idx, false /* send_final_flag */);
+      continue;
+    }
+
+    responses_[idx] = nullptr;
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseSend(
+            response,
+            ending_[idx] ? TRITONSERVER_RESPONSE_COMPLETE_FINAL : 0,
+            nullptr /* success */),
+        "failed to send response");
+    if (ending_[idx]) {
+      CompleteStream(idx, false /* send_final_flag */);
+    }
+  }
+}
+
+void
+BackendStreamingResponder::CompleteStream(
+    const uint32_t idx, const bool send_final_flag)
+{
+  if (send_final_flag) {
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseFactorySendFlags(
+            factories_[idx], TRITONSERVER_RESPONSE_COMPLETE_FINAL),
+        "failed to send final flag");
+  }
+  LOG_IF_ERROR(
+      TRITONBACKEND_ResponseFactoryDelete(factories_[idx]),
+      "failed to delete response factory");
+  factories_[idx] = nullptr;
+  active_count_--;
+}
+
+}}  // namespace triton::backend
@@ -0,0 +1,142 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "triton/backend/backend_thread_pool.h"
+
+#include <algorithm>
+
+namespace triton { namespace backend {
+
+//
+// BackendThreadPool
+//
+BackendThreadPool::BackendThreadPool(const size_t thread_count)
+    : exiting_(false)
+{
+  for (size_t i = 0; i < thread_count; ++i) {
+    workers_.emplace_back(&BackendThreadPool::WorkerThread, this);
+  }
+}
+
+BackendThreadPool::~BackendThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    exiting_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void
+BackendThreadPool::ParallelFor(
+    const size_t count, const std::function<void(size_t)>& fn)
+{
+  if (count == 0) {
+    return;
+  }
+
+  // Run in the calling thread if there is nothing to share the work
+  // with.
+  if ((count == 1) || workers_.empty()) {
+    for (size_t i = 0; i < count; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  // The job lives on the stack of the calling thread, which doesn't
+  // return before the job is out of the queue and no worker uses it.
+  Job job(count, &fn);
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    jobs_.push_back(&job);
+  }
+  cv_.notify_all();
+
+  // The calling thread takes part in the job until all indices are
+  // taken, then removes the job from the queue so no other worker
+  // picks it up, and waits for the workers that are running it.
+  RunJob(&job);
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = std::find(jobs_.begin(), jobs_.end(), &job);
+    if (it != jobs_.end()) {
+      jobs_.erase(it);
+    }
+  }
+  std::unique_lock<std::mutex> lk(job.mu_);
+  job.cv_.wait(lk, [&job] { return job.active_ == 0; });
+}
+
+void
+BackendThreadPool::RunJob(Job* job)
+{
+  size_t idx;
+  while ((idx = job->next_++) < job->count_) {
+    (*job->fn_)(idx);
+  }
+}
+
+void
+BackendThreadPool::WorkerThread()
+{
+  std::unique_lock<std::mutex> lk(mu_);
+  while (true) {
+    cv_.wait(lk, [this] { return exiting_ || !jobs_.empty(); });
+    if (exiting_) {
+      return;
+    }
+
+    // The job is taken while holding 'mu_' so the calling thread of
+    // ParallelFor() waits for this worker once it removed the job.
+    Job* job = jobs_.front();
+    ++job->active_;
+    lk.unlock();
+    RunJob(job);
+
+    // All indices of the job are taken so it can be removed, unless
+    // the calling thread or another worker already did.
+    lk.lock();
+    if (!jobs_.empty() && (jobs_.front() == job)) {
+      jobs_.pop_front();
+    }
+    lk.unlock();
+
+    // Notify while holding the lock of the job, the job may be
+    // destroyed as soon as it is released.
+    {
+      std::lock_guard<std::mutex> job_lk(job->mu_);
+      if (--job->active_ == 0) {
+        job->cv_.notify_all();
+      }
+    }
+    lk.lock();
+  }
+}
+
+}}  // namespace triton::backend
@@ -0,0 +1,202 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "kernel.h"
+
+#include <cuda_fp16.h>
+
+namespace triton { namespace backend {
+
+namespace {
+
+constexpr int kCopyKernelBlockSize = 256;
+constexpr size_t kCopyKernelMaxGridSize = 65535;
+constexpr int kConvertKernelBlockSize = 256;
+constexpr uint64_t kConvertKernelMaxGridSize = 65535;
+
+__global__ void
+CopyKernel(const CopyDescriptor* table, const size_t count)
+{
+  // Each block copies one slice at a time, using 16-byte accesses
+  // when the slice allows it.
+  for (size_t idx = blockIdx.x; idx < count; idx += gridDim.x) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(table[idx].src_);
+    uint8_t* dst = reinterpret_cast<uint8_t*>(table[idx].dst_);
+    const uint64_t byte_size = table[idx].byte_size_;
+
+    uint64_t vector_byte_size = 0;
+    if (((reinterpret_cast<uintptr_t>(src) |
+          reinterpret_cast<uintptr_t>(dst)) %
+         sizeof(int4)) == 0) {
+      vector_byte_size = byte_size - (byte_size % sizeof(int4));
+      const int4* vsrc = reinterpret_cast<const int4*>(src);
+      int4* vdst = reinterpret_cast<int4*>(dst);
+      for (uint64_t i = threadIdx.x; i < (vector_byte_size / sizeof(int4));
+           i += blockDim.x) {
+        vdst[i] = vsrc[i];
+      }
+    }
+
+    for (uint64_t i = vector_byte_size + threadIdx.x; i < byte_size;
+         i += blockDim.x) {
+      dst[i] = src[i];
+    }
+  }
+}
+
+template <typename T>
+__device__ float
+LoadElement(const T value)
+{
+  return static_cast<float>(value);
+}
+
+__device__ float
+LoadElement(const __half value)
+{
+  return __half2float(value);
+}
+
+__device__ void
+StoreElement(const float value, float* dst)
+{
+  *dst = value;
+}
+
+__device__ void
+StoreElement(const float value, __half* dst)
+{
+  *dst = __float2half_rn(value);
+}
+
+template <typename S, typename D>
+__global__ void
+ConvertKernel(
+    const S* src, D* dst, const uint64_t count, const float scale,
+    const float bias, const uint64_t item_size, const uint64_t channels)
+{
+  const uint64_t stride = static_cast<uint64_t>(gridDim.x) * blockDim.x;
+  for (uint64_t idx = static_cast<uint64_t>(blockIdx.x) * blockDim.x +
+                      threadIdx.x;
+       idx < count; idx += stride) {
+    // Reads are coalesced, writes are strided by the pixel count when
+    // the layout is changed.
+    uint64_t dst_idx = idx;
+    if (channels != 0) {
+      const uint64_t item = idx / item_size;
+      const uint64_t offset = idx - (item * item_size);
+      const uint64_t pixel = offset / channels;
+      const uint64_t channel = offset - (pixel * channels);
+      dst_idx = (item * item_size) + (channel * (item_size / channels)) + pixel;
+    }
+    StoreElement(LoadElement(src[idx]) * scale + bias, dst + dst_idx);
+  }
+}
+
+template <typename S, typename D>
+cudaError_t
+LaunchConvertKernel(
+    const void* src, void* dst, const uint64_t count,
+    const ConvertDescriptor& desc, cudaStream_t stream)
+{
+  uint64_t grid_size =
+      (count + kConvertKernelBlockSize - 1) / kConvertKernelBlockSize;
+  if (grid_size > kConvertKernelMaxGridSize) {
+    grid_size = kConvertKernelMaxGridSize;
+  }
+  ConvertKernel<S, D><<<grid_size, kConvertKernelBlockSize, 0, stream>>>(
+      reinterpret_cast<const S*>(src), reinterpret_cast<D*>(dst), count,
+      desc.scale_, desc.bias_, desc.item_size_, desc.channels_);
+  return cudaGetLastError();
+}
+
+template <typename D>
+cudaError_t
+DispatchConvertKernel(
+    const void* src, void* dst, const uint64_t count,
+    const ConvertDescriptor& desc, cudaStream_t stream)
+{
+  switch (desc.src_type_) {
+    case ConvertType::UINT8:
+      return LaunchConvertKernel<uint8_t, D>(src, dst, count, desc, stream);
+    case ConvertType::INT8:
+      return LaunchConvertKernel<int8_t, D>(src, dst, count, desc, stream);
+    case ConvertType::INT16:
+      return LaunchConvertKernel<int16_t, D>(src, dst, count, desc, stream);
+    case ConvertType::INT32:
+      return LaunchConvertKernel<int32_t, D>(src, dst, count, desc, stream);
+    case ConvertType::FP16:
+      return LaunchConvertKernel<__half, D>(src, dst, count, desc, stream);
+    case ConvertType::FP32:
+      return LaunchConvertKernel<float, D>(src, dst, count, desc, stream);
+  }
+  return cudaErrorInvalidValue;
+}
+
+}  // namespace
+
+cudaError_t
+RunCopyKernel(
+    const CopyDescriptor* host_table, CopyDescriptor* device_table,
+    const size_t count, cudaStream_t stream)
+{
+  if (count == 0) {
+    return cudaSuccess;
+  }
+
+  cudaError_t err = cudaMemcpyAsync(
+      device_table, host_table, count * sizeof(CopyDescriptor),
+      cudaMemcpyHostToDevice, stream);
+  if (err != cudaSuccess) {
+    return err;
+  }
+
+  const size_t grid_size =
+      (count < kCopyKernelMaxGridSize) ? count : kCopyKernelMaxGridSize;
+  CopyKernel<<<grid_size, kCopyKernelBlockSize, 0, stream>>>(
+      device_table, count);
+  return cudaGetLastError();
+}
+
+cudaError_t
+RunConvertKernel(
+    const void* src, void* dst, const uint64_t count,
+    const ConvertDescriptor& desc, cudaStream_t stream)
+{
+  if (count == 0) {
+    return cudaSuccess;
+  }
+
+  switch (desc.dst_type_) {
+    case ConvertType::FP16:
+      return DispatchConvertKernel<__half>(src, dst, count, desc, stream);
+    case ConvertType::FP32:
+      return DispatchConvertKernel<float>(src, dst, count, desc, stream);
+    default:
+      return cudaErrorInvalidValue;
+  }
+}
+
+}}  // namespace triton::backend
@@ -0,0 +1,74 @@
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cuda_runtime_api.h>
+#include <stdint.h>
+
+namespace triton { namespace backend {
+
+// A single slice copied by RunCopyKernel(). 'src' and 'dst' must be
+// accessible from the device the kernel runs on.
+struct CopyDescriptor {
+  const void* src_;
+  void* dst_;
+  uint64_t byte_size_;
+};
+
+// Perform the 'count' copies described by 'host_table' with a single
+// kernel launch on 'stream'. 'host_table' is first copied into
+// 'device_table', which must be device memory large enough for
+// 'count' descriptors. 'host_table' should be pinned memory and must
+// not be modified or released until the copies complete.
+cudaError_t RunCopyKernel(
+    const CopyDescriptor* host_table, CopyDescriptor* device_table,
+    const size_t count, cudaStream_t stream);
+
+// The element types of the conversions performed by
+// RunConvertKernel(). Only FP16 and FP32 can be converted to.
+enum class ConvertType { UINT8, INT8, INT16, INT32, FP16, FP32 };
+
+// A conversion performed by RunConvertKernel(). Each element is cast
+// to 'dst_type_' as 'element * scale_ + bias_'. If 'channels_' is not
+// 0 the elements are batch items of 'item_size_' elements in HWC
+// layout that are also transposed to CHW layout.
+struct ConvertDescriptor {
+  ConvertType src_type_;
+  ConvertType dst_type_;
+  float scale_;
+  float bias_;
+  uint64_t item_size_;
+  uint64_t channels_;
+};
+
+// Convert the 'count' elements of 'src' into 'dst' as described by
+// 'desc' with a single kernel launch on 'stream'. 'src' and 'dst'
+// must be device memory and must not overlap.
+cudaError_t RunConvertKernel(
+    const void* src, void* dst, const uint64_t count,
+    const ConvertDescriptor& desc, cudaStream_t stream);
+
+}}  // namespace triton::backend